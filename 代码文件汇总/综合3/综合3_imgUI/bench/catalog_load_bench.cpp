@@ -0,0 +1,186 @@
+// 商品目录启动基准测试：在临时目录生成商家文本文件，比较 Store 从文本商家文件导入
+// 与从二进制快照（catalog.bin）映射加载的耗时，列出 Store 记录的各阶段耗时，以及只映射快照、读取视图的耗时。
+// 用法: catalog_load_bench [商品数量=200000] [商家数量=200] [轮数=3]
+#include "../store/store.h"
+#include "../store/catalog_file.h"
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <filesystem>
+#include <cstdlib>
+
+namespace fs = std::filesystem;
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+    double elapsedMs(Clock::time_point start)
+    {
+        return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    }
+
+    // 与商家文件格式一致：ID,类型,名称,描述,价格,数量,折扣,商家,种类特有字段
+    void writeSellerFiles(const std::string &directory, int count, int sellers)
+    {
+        std::vector<std::ofstream> files;
+        for (int s = 0; s < sellers; ++s)
+        {
+            files.emplace_back(directory + "/sellers/seller" + std::to_string(s) + ".txt");
+        }
+        for (int i = 0; i < count; ++i)
+        {
+            std::ostringstream line;
+            std::string seller = "seller" + std::to_string(i % sellers);
+            line << (i + 1) << ",";
+            switch (i % 4)
+            {
+            case 0:
+                line << "Book,图书" << i << ",一本测试用的图书" << i << "," << 5.0 + (i * 7919 % 2000) * 0.5 << "," << (i * 37) % 200
+                     << "," << (i % 10) / 20.0 << "," << seller << ",作者" << i % 97 << ",978" << i;
+                break;
+            case 1:
+                line << "Clothing,服装" << i << ",纯棉测试服装" << i << "," << 20.0 + i % 300 << "," << (i * 13) % 150
+                     << "," << (i % 5) / 10.0 << "," << seller << ",M,红";
+                break;
+            case 2:
+                line << "Food,食品" << i << ",测试零食" << i << "," << 1.5 + i % 50 << "," << (i * 7) % 500
+                     << ",0," << seller << ",2030-01-01";
+                break;
+            default:
+                line << "Generic,商品" << i << ",其他测试商品" << i << "," << 9.9 + i % 1000 << "," << (i * 3) % 80
+                     << "," << (i % 4) / 10.0 << "," << seller << ",分类" << i % 7;
+                break;
+            }
+            files[i % sellers] << line.str() << "\n";
+        }
+    }
+
+    // 构造 Store 即完成加载；加载过程的逐商家日志不计入输出
+    double timeStoreStartup(const std::string &directory, StoreLoadTimings &timings)
+    {
+        std::streambuf *original = std::cout.rdbuf();
+        std::ostringstream discard;
+        std::cout.rdbuf(discard.rdbuf());
+        auto start = Clock::now();
+        double ms = 0.0;
+        {
+            Store store(directory);
+            ms = elapsedMs(start);
+            timings = store.getLoadTimings();
+        }
+        std::cout.rdbuf(original);
+        return ms;
+    }
+
+    void printRow(const char *label, double ms, size_t products)
+    {
+        std::cout << std::left << std::setw(34) << label
+                  << std::right << std::setw(12) << std::fixed << std::setprecision(2) << ms
+                  << std::setw(14) << std::setprecision(0) << (ms > 0 ? products / ms * 1000.0 : 0.0) << std::endl;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    int count = argc > 1 ? std::atoi(argv[1]) : 200000;
+    int sellers = argc > 2 ? std::atoi(argv[2]) : 200;
+    int rounds = argc > 3 ? std::atoi(argv[3]) : 3;
+    if (count <= 0 || sellers <= 0 || rounds <= 0)
+    {
+        std::cerr << "用法: catalog_load_bench [商品数量] [商家数量] [轮数]" << std::endl;
+        return 1;
+    }
+
+    std::string directory = (fs::temp_directory_path() / "catalog_load_bench").string();
+    fs::remove_all(directory);
+    fs::create_directories(directory + "/sellers");
+    writeSellerFiles(directory, count, sellers);
+    std::string snapshot = directory + "/catalog.bin";
+
+    std::cout << "商品数量: " << count << "，商家数量: " << sellers << "，轮数: " << rounds << "（取最好成绩）" << std::endl;
+    std::cout << std::left << std::setw(34) << "阶段"
+              << std::right << std::setw(12) << "ms"
+              << std::setw(14) << "商品/秒" << std::endl;
+
+    // 文本导入：每轮删除快照，Store 解析商家文件后重新写出快照
+    double bestText = 0.0;
+    StoreLoadTimings textTimings;
+    for (int r = 0; r < rounds; ++r)
+    {
+        fs::remove(snapshot);
+        StoreLoadTimings timings;
+        double ms = timeStoreStartup(directory, timings);
+        if (r == 0 || ms < bestText)
+        {
+            bestText = ms;
+            textTimings = timings;
+        }
+    }
+    size_t loaded = textTimings.products;
+    printRow("文本导入（含写出快照）", bestText, loaded);
+    std::string parseLabel = "  其中: 解析商家文件（" + std::to_string(textTimings.parseThreads) + " 线程）";
+    printRow(parseLabel.c_str(), textTimings.readMs, loaded);
+    printRow("  其中: 建立索引", textTimings.indexMs, loaded);
+    printRow("  其中: 写出快照", textTimings.snapshotMs, loaded);
+
+    // 快照加载：上一轮写出的快照比商家文件新，Store 直接映射
+    double bestSnapshot = 0.0;
+    StoreLoadTimings snapshotTimings;
+    for (int r = 0; r < rounds; ++r)
+    {
+        StoreLoadTimings timings;
+        double ms = timeStoreStartup(directory, timings);
+        if (r == 0 || ms < bestSnapshot)
+        {
+            bestSnapshot = ms;
+            snapshotTimings = timings;
+        }
+    }
+    printRow("二进制快照加载", bestSnapshot, loaded);
+    printRow("  其中: 读取快照并创建商品", snapshotTimings.readMs, loaded);
+    printRow("  其中: 建立索引", snapshotTimings.indexMs, loaded);
+
+    // 快照本身：映射并校验，然后只读取视图、不创建商品
+    double bestOpen = 0.0;
+    double bestScan = 0.0;
+    size_t scanned = 0;
+    for (int r = 0; r < rounds; ++r)
+    {
+        CatalogFile catalog;
+        auto start = Clock::now();
+        if (!catalog.open(snapshot))
+        {
+            std::cerr << "无法打开快照" << std::endl;
+            return 1;
+        }
+        double openMs = elapsedMs(start);
+        start = Clock::now();
+        size_t bytes = 0;
+        for (size_t i = 0; i < catalog.size(); ++i)
+        {
+            CatalogFile::ProductView view = catalog.product(i);
+            bytes += view.name.size() + view.description.size() + static_cast<size_t>(view.quantity);
+        }
+        double scanMs = elapsedMs(start);
+        scanned = catalog.size();
+        bestOpen = (r == 0 || openMs < bestOpen) ? openMs : bestOpen;
+        bestScan = (r == 0 || scanMs < bestScan) ? scanMs : bestScan;
+        if (bytes == 0)
+        {
+            std::cout << "(空快照)" << std::endl;
+        }
+    }
+    printRow("仅映射并校验快照", bestOpen, scanned);
+    printRow("仅遍历记录视图", bestScan, scanned);
+
+    std::cout << "快照大小: " << fs::file_size(snapshot) / 1024 << "KB，加速比: " << std::setprecision(2)
+              << (bestSnapshot > 0 ? bestText / bestSnapshot : 0.0) << "x" << std::endl;
+
+    fs::remove_all(directory);
+    return 0;
+}
@@ -0,0 +1,238 @@
+// 库存锁定争用基准测试：多个线程反复锁定、解锁 1 件库存，比较原先的全局互斥锁实现
+// （一把锁保护锁定表，锁内按ID查找商品）与商品自身原子计数上的 CAS 实现，以及完整的 Store::lockInventory 接口。
+// 两种访问模式：各线程锁定不同的商品；所有线程锁定同一件热门商品。
+// 用法: inventory_reserve_bench [每线程操作次数=200000] [最大线程数=8]
+#include "../store/store.h"
+#include "../user/user.h"
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <unordered_map>
+#include <filesystem>
+#include <cstdlib>
+
+namespace fs = std::filesystem;
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+    const int kProducts = 64;
+    const int kStock = 1000000;
+
+    // 原实现：全局互斥锁保护锁定表，锁内查找商品、检查可售库存
+    class MutexInventory
+    {
+    public:
+        explicit MutexInventory(const std::vector<Product *> &products)
+        {
+            for (Product *product : products)
+            {
+                byId[product->getId()] = product;
+            }
+        }
+
+        bool lock(uint64_t productId, int quantity)
+        {
+            std::lock_guard<std::mutex> guard(mutex);
+            auto productIt = byId.find(productId);
+            if (productIt == byId.end())
+            {
+                return false;
+            }
+            int &current = locked[productId];
+            if (productIt->second->getQuantity() - current < quantity)
+            {
+                return false;
+            }
+            current += quantity;
+            return true;
+        }
+
+        bool unlock(uint64_t productId, int quantity)
+        {
+            std::lock_guard<std::mutex> guard(mutex);
+            auto it = locked.find(productId);
+            if (it == locked.end() || it->second < quantity)
+            {
+                return false;
+            }
+            it->second -= quantity;
+            if (it->second <= 0)
+            {
+                locked.erase(it);
+            }
+            return true;
+        }
+
+    private:
+        std::mutex mutex;
+        std::unordered_map<uint64_t, Product *> byId;
+        std::unordered_map<uint64_t, int> locked;
+    };
+
+    // 只有无锁的查找表和商品计数，不含 Store 取目录版本的开销
+    class AtomicInventory
+    {
+    public:
+        explicit AtomicInventory(const std::vector<Product *> &products)
+        {
+            for (Product *product : products)
+            {
+                byId[product->getId()] = product;
+            }
+        }
+
+        bool lock(uint64_t productId, int quantity)
+        {
+            auto it = byId.find(productId);
+            return it != byId.end() && it->second->tryReserve(quantity);
+        }
+
+        bool unlock(uint64_t productId, int quantity)
+        {
+            auto it = byId.find(productId);
+            return it != byId.end() && it->second->release(quantity);
+        }
+
+    private:
+        std::unordered_map<uint64_t, Product *> byId; // 构造后只读
+    };
+
+    struct Variant
+    {
+        const char *name;
+        std::function<bool(uint64_t)> lock;
+        std::function<bool(uint64_t)> unlock;
+    };
+
+    // 每个线程执行 operations 轮锁定、解锁；hot 为真时所有线程使用同一件商品。返回每轮平均耗时（纳秒，按总轮数计）
+    double runThreads(const Variant &variant, const std::vector<uint64_t> &ids, int threads, int operations, bool hot, bool &ok)
+    {
+        std::atomic<int> ready(0);
+        std::atomic<bool> start(false);
+        std::atomic<bool> failed(false);
+        auto worker = [&](int t)
+        {
+            ready++;
+            while (!start)
+            {
+                std::this_thread::yield();
+            }
+            for (int i = 0; i < operations; ++i)
+            {
+                // 不同商品模式下每个线程只使用自己的那一组商品
+                uint64_t id = hot ? ids[0] : ids[(t + (i % (kProducts / threads)) * threads) % kProducts];
+                if (!variant.lock(id) || !variant.unlock(id))
+                {
+                    failed = true;
+                }
+            }
+        };
+
+        std::vector<std::thread> workers;
+        for (int t = 0; t < threads; ++t)
+        {
+            workers.emplace_back(worker, t);
+        }
+        while (ready < threads)
+        {
+            std::this_thread::yield();
+        }
+        auto begin = Clock::now();
+        start = true;
+        for (std::thread &thread : workers)
+        {
+            thread.join();
+        }
+        double totalNs = std::chrono::duration<double, std::nano>(Clock::now() - begin).count();
+        ok = !failed;
+        return totalNs / (static_cast<double>(operations) * threads);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    int operations = argc > 1 ? std::atoi(argv[1]) : 200000;
+    int maxThreads = argc > 2 ? std::atoi(argv[2]) : 8;
+    if (operations <= 0 || maxThreads <= 0 || maxThreads > kProducts)
+    {
+        std::cerr << "用法: inventory_reserve_bench [每线程操作次数] [最大线程数(1-" << kProducts << ")]" << std::endl;
+        return 1;
+    }
+
+    // Store 在临时目录中创建商品；加载、添加商品的日志不计入输出
+    std::string directory = (fs::temp_directory_path() / "inventory_reserve_bench").string();
+    fs::remove_all(directory);
+    std::streambuf *original = std::cout.rdbuf();
+    std::ostringstream discard;
+    std::cout.rdbuf(discard.rdbuf());
+    std::vector<uint64_t> ids;
+    std::vector<Product *> products;
+    {
+        Seller seller("bench_seller", "bench");
+        std::unique_ptr<Store> store(new Store(directory));
+        for (int i = 0; i < kProducts; ++i)
+        {
+            store->createGenericProduct(&seller, "商品" + std::to_string(i), "测试商品", 10.0, kStock, "测试");
+        }
+        for (Product *product : store->getProducts())
+        {
+            ids.push_back(product->getId());
+            products.push_back(product);
+        }
+        std::cout.rdbuf(original);
+        if (static_cast<int>(products.size()) != kProducts)
+        {
+            std::cerr << "无法创建测试商品" << std::endl;
+            return 1;
+        }
+
+        MutexInventory mutexInventory(products);
+        AtomicInventory atomicInventory(products);
+        std::vector<Variant> variants = {
+            {"全局互斥锁（原实现）", [&](uint64_t id) { return mutexInventory.lock(id, 1); },
+             [&](uint64_t id) { return mutexInventory.unlock(id, 1); }},
+            {"商品原子计数 CAS", [&](uint64_t id) { return atomicInventory.lock(id, 1); },
+             [&](uint64_t id) { return atomicInventory.unlock(id, 1); }},
+            {"Store::lockInventory", [&](uint64_t id) { return store->lockInventory(id, 1); },
+             [&](uint64_t id) { return store->unlockInventory(id, 1); }},
+        };
+
+        std::cout << "商品数量: " << kProducts << "，每线程操作次数: " << operations
+                  << "，硬件线程数: " << std::thread::hardware_concurrency() << std::endl;
+        for (int mode = 0; mode < 2; ++mode)
+        {
+            bool hot = mode == 1;
+            std::cout << "\n== " << (hot ? "所有线程锁定同一件商品" : "各线程锁定不同商品") << " ==" << std::endl;
+            std::cout << std::left << std::setw(26) << "实现" << std::right << std::setw(8) << "线程"
+                      << std::setw(14) << "ns/轮" << std::setw(16) << "万轮/秒" << std::endl;
+            for (const Variant &variant : variants)
+            {
+                for (int threads = 1; threads <= maxThreads; threads *= 2)
+                {
+                    bool ok = true;
+                    double ns = runThreads(variant, ids, threads, operations, hot, ok);
+                    std::cout << std::left << std::setw(26) << variant.name << std::right << std::setw(8) << threads
+                              << std::setw(14) << std::fixed << std::setprecision(1) << ns
+                              << std::setw(16) << std::setprecision(1) << (ns > 0 ? 1e9 / ns / 1e4 : 0.0)
+                              << (ok ? "" : "  (有操作失败)") << std::endl;
+                }
+            }
+        }
+
+        std::cout.rdbuf(discard.rdbuf());
+        store.reset();
+        std::cout.rdbuf(original);
+    }
+    fs::remove_all(directory);
+    return 0;
+}
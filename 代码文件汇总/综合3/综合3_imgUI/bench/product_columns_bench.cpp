@@ -0,0 +1,249 @@
+// 商品列式存储基准测试：比较逐个解引用商品指针的扫描循环与
+// 列式数组上的标量、SIMD 扫描在价格区间、低库存、折扣、商家+分类四类条件下的耗时。
+// 用法: product_columns_bench [商品数量=100000] [迭代次数=200]
+#include "../store/store.h"
+#include "../store/product_columns.h"
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <functional>
+#include <cstdlib>
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+    // 模拟 Store 中的商品：分散在堆上，按商家轮流分配
+    std::vector<Product *> makeProducts(int count)
+    {
+        std::vector<Product *> products;
+        products.reserve(count);
+        for (int i = 0; i < count; ++i)
+        {
+            std::string name = "商品" + std::to_string(i);
+            std::string seller = "seller" + std::to_string(i % 20);
+            double price = 5.0 + (i * 7919 % 2000) * 0.5;
+            int quantity = (i * 37) % 200;
+            ProductAttributes attributes;
+            switch (i % 4)
+            {
+            case 0:
+                attributes = BookAttributes{"作者", "978" + std::to_string(i)};
+                break;
+            case 1:
+                attributes = ClothingAttributes{"M", "红"};
+                break;
+            case 2:
+                attributes = FoodAttributes{"2030-01-01"};
+                break;
+            default:
+                attributes = GenericAttributes{"分类" + std::to_string(i % 7)};
+                break;
+            }
+            Product *product = new Product(name, "测试商品", price, quantity, std::move(attributes), seller);
+            product->setId(static_cast<uint64_t>(i) + 1);
+            product->setDiscountRate((i % 10) / 20.0);
+            products.push_back(product);
+        }
+        return products;
+    }
+
+    struct Variant
+    {
+        const char *name;
+        std::function<size_t()> scan; // 返回命中数量
+    };
+
+    void runCase(const char *label, const std::vector<Variant> &variants, int iterations, size_t productCount)
+    {
+        std::cout << "\n== " << label << " ==" << std::endl;
+        std::cout << std::left << std::setw(16) << "实现"
+                  << std::right << std::setw(10) << "命中数"
+                  << std::setw(16) << "us/次扫描"
+                  << std::setw(14) << "ns/商品" << std::endl;
+        for (const Variant &variant : variants)
+        {
+            size_t hits = variant.scan();
+            auto start = Clock::now();
+            size_t sink = 0;
+            for (int it = 0; it < iterations; ++it)
+            {
+                sink += variant.scan();
+            }
+            double totalNs = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+            std::cout << std::left << std::setw(16) << variant.name
+                      << std::right << std::setw(10) << hits
+                      << std::setw(16) << std::fixed << std::setprecision(2) << totalNs / iterations / 1000.0
+                      << std::setw(14) << std::setprecision(3) << totalNs / iterations / productCount << std::endl;
+            if (sink == 0)
+            {
+                std::cout << "(无命中)" << std::endl;
+            }
+        }
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    int count = argc > 1 ? std::atoi(argv[1]) : 100000;
+    int iterations = argc > 2 ? std::atoi(argv[2]) : 200;
+    if (count <= 0 || iterations <= 0)
+    {
+        std::cerr << "用法: product_columns_bench [商品数量] [迭代次数]" << std::endl;
+        return 1;
+    }
+
+    std::vector<Product *> products = makeProducts(count);
+    ProductColumns columns;
+    columns.rebuild(products);
+    // 与 Store 相同：锁定数量记在商品上，扫描时从库存中扣除
+    std::vector<int> locked(products.size(), 0);
+    for (size_t i = 0; i < products.size(); i += 13)
+    {
+        if (products[i]->tryReserve(3))
+        {
+            locked[i] = 3;
+        }
+    }
+
+    // 列式扫描直接调用内核，不含结果转换成商品指针的开销，由下方单独列出的完整接口体现
+    std::vector<double> price, discount;
+    std::vector<int32_t> quantity, lockedColumn;
+    std::vector<uint32_t> seller, category;
+    for (size_t i = 0; i < products.size(); ++i)
+    {
+        price.push_back(products[i]->getPrice());
+        discount.push_back(products[i]->getDiscountRate());
+        quantity.push_back(products[i]->getQuantity());
+        lockedColumn.push_back(locked[i]);
+        seller.push_back(static_cast<uint32_t>(i % 20));
+        category.push_back(static_cast<uint32_t>(i % 4));
+    }
+    std::vector<uint32_t> rows;
+    rows.reserve(products.size());
+
+    std::cout << "商品数量: " << count << "，迭代次数: " << iterations
+              << "，SIMD: " << (ColumnScan::simdEnabled() ? "SSE2" : "未启用") << std::endl;
+
+    const double low = 100.0;
+    const double high = 300.0;
+    auto pointerPriceRange = [&]()
+    {
+        size_t hits = 0;
+        for (const Product *p : products)
+        {
+            double value = p->getPrice();
+            hits += value >= low && value <= high;
+        }
+        return hits;
+    };
+    auto scalarPriceRange = [&]()
+    {
+        rows.clear();
+        ColumnScan::selectRangeScalar(price.data(), price.size(), low, high, rows);
+        return rows.size();
+    };
+    auto simdPriceRange = [&]()
+    {
+        rows.clear();
+        ColumnScan::selectRange(price.data(), price.size(), low, high, rows);
+        return rows.size();
+    };
+    auto columnsPriceRange = [&]()
+    {
+        return columns.selectPriceRange(low, high).size();
+    };
+    runCase("价格区间 100-300", {{"指针遍历", pointerPriceRange}, {"列式标量", scalarPriceRange}, {"列式 SIMD", simdPriceRange}, {"ProductColumns", columnsPriceRange}}, iterations, products.size());
+
+    const int threshold = 10;
+    auto pointerLowStock = [&]()
+    {
+        size_t hits = 0;
+        for (size_t i = 0; i < products.size(); ++i)
+        {
+            hits += products[i]->getAvailable() < threshold;
+        }
+        return hits;
+    };
+    auto scalarLowStock = [&]()
+    {
+        rows.clear();
+        ColumnScan::selectAvailableBelowScalar(quantity.data(), lockedColumn.data(), quantity.size(), threshold, rows);
+        return rows.size();
+    };
+    auto simdLowStock = [&]()
+    {
+        rows.clear();
+        ColumnScan::selectAvailableBelow(quantity.data(), lockedColumn.data(), quantity.size(), threshold, rows);
+        return rows.size();
+    };
+    auto columnsLowStock = [&]()
+    {
+        return columns.selectLowStock(threshold, "").size();
+    };
+    runCase("可售库存 < 10", {{"指针遍历", pointerLowStock}, {"列式标量", scalarLowStock}, {"列式 SIMD", simdLowStock}, {"ProductColumns", columnsLowStock}}, iterations, products.size());
+
+    const double minRate = 0.3;
+    auto pointerDiscount = [&]()
+    {
+        size_t hits = 0;
+        for (const Product *p : products)
+        {
+            hits += p->getDiscountRate() >= minRate;
+        }
+        return hits;
+    };
+    auto scalarDiscount = [&]()
+    {
+        rows.clear();
+        ColumnScan::selectAtLeastScalar(discount.data(), discount.size(), minRate, rows);
+        return rows.size();
+    };
+    auto simdDiscount = [&]()
+    {
+        rows.clear();
+        ColumnScan::selectAtLeast(discount.data(), discount.size(), minRate, rows);
+        return rows.size();
+    };
+    auto columnsDiscount = [&]()
+    {
+        return columns.selectDiscountAtLeast(minRate).size();
+    };
+    runCase("折扣 >= 30%", {{"指针遍历", pointerDiscount}, {"列式标量", scalarDiscount}, {"列式 SIMD", simdDiscount}, {"ProductColumns", columnsDiscount}}, iterations, products.size());
+
+    // 商家+分类：指针遍历按分类折扣原先的方式比较字符串
+    auto pointerSellerCategory = [&]()
+    {
+        size_t hits = 0;
+        for (const Product *p : products)
+        {
+            hits += p->getSellerUsername() == "seller1" && p->getUserCategory() == "Clothing";
+        }
+        return hits;
+    };
+    auto scalarSellerCategory = [&]()
+    {
+        rows.clear();
+        ColumnScan::selectEqualPairScalar(seller.data(), category.data(), seller.size(), 1, 1, rows);
+        return rows.size();
+    };
+    auto simdSellerCategory = [&]()
+    {
+        rows.clear();
+        ColumnScan::selectEqualPair(seller.data(), category.data(), seller.size(), 1, 1, rows);
+        return rows.size();
+    };
+    auto columnsSellerCategory = [&]()
+    {
+        return columns.selectSellerCategory("seller1", "Clothing").size();
+    };
+    runCase("商家 seller1 + 分类 Clothing", {{"指针遍历", pointerSellerCategory}, {"列式标量", scalarSellerCategory}, {"列式 SIMD", simdSellerCategory}, {"ProductColumns", columnsSellerCategory}}, iterations, products.size());
+
+    for (Product *product : products)
+    {
+        delete product;
+    }
+    return 0;
+}
@@ -0,0 +1,158 @@
+// 线上格式基准测试：比较文本格式与二进制 TLV 格式在商品列表、订单列表响应上的
+// 消息大小与编码/解码耗时。
+// 用法: protocol_bench [列表长度=500] [迭代次数=200]
+#include "../network/protocol.h"
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <cstdlib>
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+    std::vector<Protocol::ProductData> makeProducts(int count)
+    {
+        static const char *types[] = {"Book", "Clothing", "Food", "Generic"};
+        std::vector<Protocol::ProductData> products;
+        products.reserve(count);
+        for (int i = 0; i < count; ++i)
+        {
+            Protocol::ProductData p;
+            p.id = "商品" + std::to_string(i);
+            p.name = p.id;
+            p.description = "这是第 " + std::to_string(i) + " 件测试商品的描述";
+            p.type = types[i % 4];
+            p.originalPrice = 10.0 + (i % 97) * 1.25;
+            p.discountRate = (i % 10) / 20.0;
+            p.price = p.originalPrice * (1.0 - p.discountRate);
+            p.quantity = (i * 37) % 1000;
+            p.sellerUsername = "seller" + std::to_string(i % 20);
+            if (p.type == "Book")
+            {
+                p.attributes["author"] = "作者" + std::to_string(i % 50);
+                p.attributes["isbn"] = "978" + std::to_string(1000000000 + i);
+            }
+            products.push_back(p);
+        }
+        return products;
+    }
+
+    std::vector<Protocol::OrderData> makeOrders(int count)
+    {
+        std::vector<Protocol::OrderData> orders;
+        orders.reserve(count);
+        for (int i = 0; i < count; ++i)
+        {
+            Protocol::OrderData order;
+            order.orderId = "ORD" + std::to_string(1700000000000LL + i);
+            order.customerUsername = "customer" + std::to_string(i % 30);
+            order.status = Protocol::OrderStatus::COMPLETED;
+            order.timestamp = 1700000000 + i;
+            order.totalAmount = 0.0;
+            for (int j = 0; j < 1 + i % 5; ++j)
+            {
+                Protocol::CartItemData item;
+                item.productId = "商品" + std::to_string(i + j);
+                item.productName = item.productId;
+                item.quantity = 1 + j;
+                item.priceAtAddition = 9.99 + j;
+                item.sellerUsername = "seller" + std::to_string(j);
+                order.totalAmount += item.quantity * item.priceAtAddition;
+                order.items.push_back(item);
+            }
+            orders.push_back(order);
+        }
+        return orders;
+    }
+
+    // 按服务端的方式组装列表响应
+    template <typename Record>
+    Protocol::Message buildResponse(const std::vector<Record> &records, const std::string &listName, Protocol::WireFormat format)
+    {
+        Protocol::Message msg(Protocol::MessageType::RESPONSE_DATA, "SESSION_1700000000000_123456");
+        msg.requestId = 42;
+        std::vector<std::string> &list = msg.addList(listName);
+        list.reserve(records.size());
+        for (const auto &record : records)
+        {
+            list.push_back(record.encode(format));
+        }
+        return msg;
+    }
+
+    // 按客户端的方式解析列表响应
+    template <typename Record>
+    size_t parseResponse(const std::string &payload, const std::string &listName)
+    {
+        Protocol::Message msg = Protocol::Message::decode(payload);
+        const std::vector<std::string> &list = msg.getList(listName);
+        std::vector<Record> records;
+        records.reserve(list.size());
+        for (const auto &record : list)
+        {
+            records.push_back(Record::decode(record));
+        }
+        return records.size();
+    }
+
+    template <typename Record>
+    void runCase(const char *label, const std::vector<Record> &records, const std::string &listName, int iterations)
+    {
+        std::cout << "\n== " << label << "（" << records.size() << " 条记录，" << iterations << " 次迭代）==" << std::endl;
+        std::cout << std::left << std::setw(8) << "格式"
+                  << std::right << std::setw(12) << "字节/消息"
+                  << std::setw(12) << "字节/记录"
+                  << std::setw(16) << "编码 ns/记录"
+                  << std::setw(16) << "解码 ns/记录" << std::endl;
+
+        for (Protocol::WireFormat format : {Protocol::WireFormat::TEXT, Protocol::WireFormat::BINARY})
+        {
+            std::string payload;
+            size_t sink = 0;
+
+            auto encodeStart = Clock::now();
+            for (int it = 0; it < iterations; ++it)
+            {
+                payload = buildResponse(records, listName, format).encode(format);
+                sink += payload.size();
+            }
+            double encodeNs = std::chrono::duration<double, std::nano>(Clock::now() - encodeStart).count();
+
+            auto decodeStart = Clock::now();
+            for (int it = 0; it < iterations; ++it)
+            {
+                sink += parseResponse<Record>(payload, listName);
+            }
+            double decodeNs = std::chrono::duration<double, std::nano>(Clock::now() - decodeStart).count();
+
+            double perRecord = static_cast<double>(iterations) * records.size();
+            std::cout << std::left << std::setw(8) << Protocol::wireFormatName(format)
+                      << std::right << std::setw(12) << payload.size()
+                      << std::setw(12) << std::fixed << std::setprecision(1) << payload.size() / static_cast<double>(records.size())
+                      << std::setw(16) << encodeNs / perRecord
+                      << std::setw(16) << decodeNs / perRecord << std::endl;
+            if (sink == 0)
+            {
+                std::cout << "(无输出)" << std::endl;
+            }
+        }
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    int count = argc > 1 ? std::atoi(argv[1]) : 500;
+    int iterations = argc > 2 ? std::atoi(argv[2]) : 200;
+    if (count <= 0 || iterations <= 0)
+    {
+        std::cerr << "用法: protocol_bench [列表长度] [迭代次数]" << std::endl;
+        return 1;
+    }
+
+    runCase("商品列表", makeProducts(count), "products", iterations);
+    runCase("订单列表", makeOrders(count), "orders", iterations);
+    return 0;
+}
@@ -113,6 +113,7 @@ void ClientUI::disconnectFromServer()
     {
         if (isLoggedIn)
         {
+            releaseDirectPurchaseLock();
             networkClient->logout();
         }
         networkClient->disconnect();
@@ -126,6 +127,7 @@ void ClientUI::mainLoop()
     while (!glfwWindowShouldClose(window) && !shouldClose)
     {
         glfwPollEvents();
+        processServerPushes();
 
         // 开始新帧
         ImGui_ImplOpenGL3_NewFrame();
@@ -390,9 +392,9 @@ void ClientUI::renderUserMenu()
     if (ImGui::Button("进入商城", ImVec2(120, 40)))
     {
         currentPage = 2; // 切换到商城
-        searchResults.clear();
         memset(searchBuffer, 0, sizeof(searchBuffer));
         refreshProducts();
+        performSearch();
     }
 
     ImGui::SameLine();
@@ -704,12 +706,22 @@ void ClientUI::renderStoreCustomer()
     ImGui::PopStyleVar();
 
     ImGui::Spacing(); // 商品列表
-    if (strlen(searchBuffer) > 0)
+    renderSortControls();
+    if (strlen(searchBuffer) > 0 || productSortIndex != 0 || productFilterEnabled)
     {
-        // 如果有搜索关键词，显示搜索结果
+        // 有搜索关键词、选择了排序或开启筛选时，显示服务端过滤、排序并分页返回的结果
         if (!searchResults.empty())
         {
-            renderProductList(searchResults, "搜索结果");
+            renderProductList(searchResults, strlen(searchBuffer) > 0 ? "搜索结果" : (productFilterEnabled ? "筛选结果" : "所有商品"));
+            if (!pagedCursor.empty())
+            {
+                ImGui::Text("已加载 %d / %lld 件", (int)searchResults.size(), pagedTotal);
+                ImGui::SameLine();
+                if (ImGui::Button("加载更多", ImVec2(100, 25)))
+                {
+                    loadProductPage(false);
+                }
+            }
         }
         else
         {
@@ -764,7 +776,7 @@ void ClientUI::renderStoreCustomer()
                 else
                 {
                     // 首先锁定库存
-                    if (networkClient->lockInventory(targetProduct->id, buyQuantity))
+                    if (networkClient->lockInventory(targetProduct->id, buyQuantity, targetProduct->sellerUsername, lockedReservationId))
                     {
                         // 库存锁定成功，设置确认对话框参数并显示
                         productToPurchase = *targetProduct;
@@ -815,7 +827,7 @@ void ClientUI::renderStoreCustomer()
                 }
                 else
                 {
-                    if (networkClient->addToCart(targetProduct->id, buyQuantity))
+                    if (networkClient->addToCart(targetProduct->id, buyQuantity, targetProduct->sellerUsername))
                     {
                         // ImGui::OpenPopup("加入购物车成功");
                         addToCartSuccessMessage = "商品 \"" + targetProduct->name + "\" 已成功加入购物车！";
@@ -1127,7 +1139,7 @@ void ClientUI::renderStoreSeller()
             }
             else
             {
-                if (networkClient && networkClient->manageProductPrice(priceProductName, newPrice))
+                if (networkClient && networkClient->manageProductPrice(ownProductId(priceProductName), newPrice))
                 {
                     ImGui::OpenPopup("价格修改成功");
                     memset(priceProductName, 0, sizeof(priceProductName));
@@ -1181,7 +1193,7 @@ void ClientUI::renderStoreSeller()
             }
             else
             {
-                if (networkClient && networkClient->manageProductQuantity(qtyProductName, newQty))
+                if (networkClient && networkClient->manageProductQuantity(ownProductId(qtyProductName), newQty))
                 {
                     ImGui::OpenPopup("库存修改成功");
                     memset(qtyProductName, 0, sizeof(qtyProductName));
@@ -1223,7 +1235,7 @@ void ClientUI::renderStoreSeller()
             }
             else
             {
-                if (networkClient && networkClient->manageProductDiscount(discountProductName, newDiscount / 100.0))
+                if (networkClient && networkClient->manageProductDiscount(ownProductId(discountProductName), newDiscount / 100.0))
                 {
                     ImGui::OpenPopup("折扣修改成功");
                     memset(discountProductName, 0, sizeof(discountProductName));
@@ -2029,13 +2041,22 @@ void ClientUI::logout()
 {
     if (networkClient && isLoggedIn)
     {
+        releaseDirectPurchaseLock();
         networkClient->logout();
     }
+    showDirectPurchaseConfirmDialog = false;
     isLoggedIn = false;
     userType = Protocol::UserType::CUSTOMER;
     currentUser = Protocol::UserData();
+    if (networkClient && catalogSubscribed)
+    {
+        networkClient->unsubscribeProducts({});
+    }
+    catalogSubscribed = false;
     allProducts.clear();
+    catalogSyncState = CatalogSyncState();
     searchResults.clear();
+    pagedCursor.clear();
     cartItems.clear();
     userOrders.clear();
 }
@@ -2046,10 +2067,25 @@ void ClientUI::refreshProducts()
         return;
 
     std::cout << "刷新产品列表前，当前产品数量: " << allProducts.size() << std::endl;
-    allProducts.clear();
-    if (networkClient->getAllProducts(allProducts))
+    long long previousVersion = catalogSyncState.valid ? catalogSyncState.version : -1;
+    bool refreshed = networkClient->syncProducts(allProducts, catalogSyncState);
+    if (!refreshed)
     {
-        std::cout << "产品列表刷新成功，新产品数量: " << allProducts.size() << std::endl;
+        // 旧版服务器不支持增量同步时回退为全量获取
+        catalogSyncState = CatalogSyncState();
+        allProducts.clear();
+        refreshed = networkClient->getAllProducts(allProducts);
+    }
+    if (refreshed)
+    {
+        std::cout << "产品列表刷新成功，新产品数量: " << allProducts.size()
+                  << "，目录版本: " << previousVersion << " -> " << catalogSyncState.version << std::endl;
+
+        // 首次拿到目录版本后订阅变化推送，之后库存和价格变化会自动合并进来
+        if (!catalogSubscribed && catalogSyncState.valid)
+        {
+            catalogSubscribed = networkClient->subscribeCatalog(catalogSyncState);
+        }
 
         // 调试：显示前几个产品的库存信息
         for (size_t i = 0; i < std::min((size_t)3, allProducts.size()); ++i)
@@ -2064,6 +2100,52 @@ void ClientUI::refreshProducts()
     }
 }
 
+void ClientUI::processServerPushes()
+{
+    if (!networkClient)
+        return;
+
+    bool needSync = false;
+    bool applied = false;
+    while (networkClient->hasResponse())
+    {
+        Protocol::Message push = networkClient->getNextResponse();
+        if (push.type != Protocol::MessageType::PRODUCT_CHANGED)
+        {
+            continue;
+        }
+        if (!NetworkClient::applyProductPush(push, allProducts, catalogSyncState))
+        {
+            needSync = true;
+        }
+        applied = true;
+    }
+
+    // 已加载的分页结果也换成最新的库存和价格（不重新排序，下次加载时由服务端重新排序）
+    if (applied && !searchResults.empty())
+    {
+        std::map<std::string, const Protocol::ProductData *> latest;
+        for (const auto &product : allProducts)
+        {
+            latest[product.id + '\x1f' + product.sellerUsername] = &product;
+        }
+        for (auto &product : searchResults)
+        {
+            auto it = latest.find(product.id + '\x1f' + product.sellerUsername);
+            if (it != latest.end())
+            {
+                product = *it->second;
+            }
+        }
+    }
+
+    // 推送与本地版本衔接不上时做一次增量同步补齐
+    if (needSync && catalogSyncState.valid)
+    {
+        refreshProducts();
+    }
+}
+
 void ClientUI::refreshCart()
 {
     if (!networkClient || !isLoggedIn)
@@ -2088,9 +2170,63 @@ void ClientUI::performSearch()
         return;
 
     searchResults.clear();
-    if (strlen(searchBuffer) > 0)
+    pagedCursor.clear();
+    if (strlen(searchBuffer) > 0 || productSortIndex != 0 || productFilterEnabled)
     {
-        networkClient->searchProducts(searchBuffer, searchResults);
+        loadProductPage(true);
+    }
+}
+
+void ClientUI::loadProductPage(bool reset)
+{
+    if (!networkClient)
+        return;
+
+    static const char *sortKeys[] = {"", "price", "discount", "stock", "name", "seller"};
+    if (reset)
+    {
+        pagedQuery = ProductPageQuery();
+        pagedQuery.keyword = searchBuffer;
+        pagedQuery.sort = sortKeys[productSortIndex];
+        pagedQuery.descending = productSortDescending;
+        if (productFilterEnabled)
+        {
+            pagedQuery.filtered = true;
+            pagedQuery.category = filterCategory;
+            pagedQuery.minPrice = filterMinPrice > 0.0f ? filterMinPrice : -1.0;
+            pagedQuery.maxPrice = filterMaxPrice > 0.0f ? filterMaxPrice : -1.0;
+            pagedQuery.inStockOnly = filterInStockOnly;
+            pagedQuery.discountedOnly = filterDiscountedOnly;
+        }
+        searchResults.clear();
+        pagedCursor.clear();
+        pagedTotal = 0;
+    }
+    else if (pagedCursor.empty())
+    {
+        return;
+    }
+
+    ProductPage page;
+    if (!networkClient->getProductPage(pagedQuery, pagedCursor, page))
+    {
+        if (!reset)
+        {
+            // 游标对应的目录快照已被淘汰，从第一页重新加载
+            std::cout << "分页游标已失效，重新加载商品列表" << std::endl;
+            loadProductPage(true);
+        }
+        return;
+    }
+
+    searchResults.insert(searchResults.end(), page.products.begin(), page.products.end());
+    pagedCursor = page.nextCursor;
+    pagedTotal = page.total;
+    if (pagedQuery.filtered)
+    {
+        categoryFacets = page.categoryCounts;
+        inStockFacet = page.inStockCount;
+        discountedFacet = page.discountedCount;
     }
 }
 
@@ -2099,7 +2235,7 @@ void ClientUI::addProductToCart(const Protocol::ProductData &product)
     if (!networkClient || !isLoggedIn)
         return;
 
-    if (networkClient->addToCart(product.id, 1))
+    if (networkClient->addToCart(product.id, 1, product.sellerUsername))
     {
         // 显示成功弹窗
         addToCartSuccessMessage = "商品 \"" + product.name + "\" 已成功加入购物车！";
@@ -2166,15 +2302,16 @@ void ClientUI::checkoutWithInventoryLock()
     }
 
     // 第一步：尝试锁定所有购物车商品的库存
-    if (!networkClient->lockCartInventory(cartItems))
+    std::string reservationId;
+    if (!networkClient->lockCartInventory(cartItems, reservationId))
     {
         setError("库存锁定失败！部分商品可能库存不足或已售完");
         return;
     }
 
-    // 第二步：创建订单
+    // 第二步：创建订单，锁定的库存交给订单结算
     std::string orderId;
-    bool orderCreated = networkClient->createOrder(cartItems, orderId);
+    bool orderCreated = networkClient->createOrder(cartItems, orderId, reservationId);
 
     if (orderCreated)
     {
@@ -2193,8 +2330,14 @@ void ClientUI::checkoutWithInventoryLock()
     }
     else
     {
-        // 订单创建失败 - 解锁库存
-        if (!networkClient->unlockCartInventory(cartItems))
+        // 订单创建失败 - 解锁库存。按预留ID解锁失败说明预留已交给订单（订单失败时由服务端解锁）或已到期，
+        // 不能再按商品解锁，否则会误放本会话的其他锁定
+        if (!reservationId.empty())
+        {
+            networkClient->releaseReservation(reservationId);
+            setError("订单创建失败！可能是余额不足或其他原因，库存已释放");
+        }
+        else if (!networkClient->unlockCartInventory(cartItems))
         {
             setError("警告：订单创建失败且库存解锁失败！请联系客服处理");
         }
@@ -2220,7 +2363,7 @@ void ClientUI::addToCartByName(const std::string &productName, int quantity)
     {
         if (product.name == productName)
         {
-            if (networkClient->addToCart(product.id, quantity))
+            if (networkClient->addToCart(product.id, quantity, product.sellerUsername))
             {
                 setStatus("商品已加入购物车！");
                 refreshCart();
@@ -2235,19 +2378,32 @@ void ClientUI::addToCartByName(const std::string &productName, int quantity)
     setError("找不到商品: %s", productName.c_str());
 }
 
-void ClientUI::purchaseProduct(const std::string &productName, int quantity)
+std::string ClientUI::ownProductId(const std::string &productName) const
+{
+    for (const auto &product : allProducts)
+    {
+        if (product.name == productName && product.sellerUsername == currentUser.username)
+        {
+            return product.id;
+        }
+    }
+    return productName;
+}
+
+void ClientUI::purchaseProduct(const std::string &productName, int quantity, const std::string &sellerUsername)
 {
     // 直接购买逻辑 - 库存已在确认对话框显示前锁定
     for (const auto &product : allProducts)
     {
-        if (product.name == productName)
+        if (product.name == productName && (sellerUsername.empty() || product.sellerUsername == sellerUsername))
         {
-            // 库存已锁定，直接创建订单
+            // 库存已锁定，直接创建订单，锁定的库存交给订单结算
             std::string orderId;
-            if (networkClient->createDirectOrder(product.id, quantity, orderId))
+            if (networkClient->createDirectOrder(product.id, quantity, orderId, product.sellerUsername, lockedReservationId))
             {
-                // 购买成功，重置库存锁定状态
+                // 购买成功，预留已由订单消耗，重置库存锁定状态
                 inventoryLocked = false;
+                lockedReservationId.clear();
 
                 // 显示购买成功弹窗
                 directPurchaseSuccessMessage = "购买成功！\n\n商品：" + product.name +
@@ -2272,22 +2428,46 @@ void ClientUI::purchaseProduct(const std::string &productName, int quantity)
             else
             {
                 // 订单创建失败，解锁库存
-                if (inventoryLocked && !networkClient->unlockInventory(product.id, quantity))
+                if (!releaseDirectPurchaseLock())
                 {
                     setError("警告：购买失败且库存解锁失败！请联系客服处理");
                 }
                 else
                 {
-                    inventoryLocked = false;
                     setError("直接购买失败！可能是余额不足或其他原因，库存已释放");
                 }
             }
             return;
         }
     }
+    releaseDirectPurchaseLock();
     setError("找不到商品: %s", productName.c_str());
 }
 
+bool ClientUI::releaseDirectPurchaseLock()
+{
+    if (!inventoryLocked)
+    {
+        lockedReservationId.clear();
+        return true;
+    }
+    // 按预留ID解锁。解锁失败说明预留已交给订单（订单失败时由服务端解锁）或已到期，库存都已归还
+    if (!lockedReservationId.empty())
+    {
+        networkClient->releaseReservation(lockedReservationId);
+        inventoryLocked = false;
+        lockedReservationId.clear();
+        return true;
+    }
+    // 没有预留ID时（旧服务端）按商品和数量解锁
+    if (!networkClient->unlockInventory(productToPurchase.id, quantityToPurchase, productToPurchase.sellerUsername))
+    {
+        return false;
+    }
+    inventoryLocked = false;
+    return true;
+}
+
 // 网络操作辅助方法
 void ClientUI::setStatus(const std::string &message)
 {
@@ -2510,26 +2690,43 @@ void ClientUI::renderSearchBox()
 
     ImGui::SetNextItemWidth(-150.0f); // 留出按钮空间
     bool searchTextChanged = ImGui::InputTextWithHint("##search", "搜索商品名称、描述或类别...", searchBuffer, IM_ARRAYSIZE(searchBuffer));
+    bool searchInputActive = ImGui::IsItemActive();
+    bool searchSubmitted = ImGui::IsItemDeactivated() && (ImGui::IsKeyPressed(ImGuiKey_Enter) || ImGui::IsKeyPressed(ImGuiKey_KeypadEnter));
+    float searchInputWidth = ImGui::GetItemRectSize().x;
 
     ImGui::PopStyleColor(3);
     ImGui::PopStyleVar(2);
 
+    // 输入时只请求联想，回车、点击搜索或选择联想项时才搜索；清空输入框时恢复显示全部商品
+    if (searchTextChanged)
+    {
+        suggestions.clear();
+        if (strlen(searchBuffer) > 0)
+        {
+            pendingSuggestions = networkClient->requestSuggestions(searchBuffer);
+        }
+        else
+        {
+            pendingSuggestions = std::future<Protocol::Message>();
+            memset(lastSearchBuffer, 0, sizeof(lastSearchBuffer));
+            performSearch();
+        }
+    }
+    if (pendingSuggestions.valid() && pendingSuggestions.wait_for(std::chrono::seconds(0)) == std::future_status::ready)
+    {
+        NetworkClient::parseSuggestions(pendingSuggestions.get(), suggestions);
+    }
+
     // 搜索按钮
     ImGui::SameLine();
     ImGui::PushStyleVar(ImGuiStyleVar_FrameRounding, 15.0f);
-    if (ImGui::Button("搜索", ImVec2(70, 40)) || searchTextChanged)
+    if (ImGui::Button("搜索", ImVec2(70, 40)) || searchSubmitted)
     {
-        if (searchTextChanged || strcmp(searchBuffer, lastSearchBuffer) != 0)
+        suggestions.clear();
+        if (strcmp(searchBuffer, lastSearchBuffer) != 0)
         {
             strcpy_s(lastSearchBuffer, sizeof(lastSearchBuffer), searchBuffer);
-            if (strlen(searchBuffer) == 0)
-            {
-                searchResults.clear();
-            }
-            else
-            {
-                performSearch();
-            }
+            performSearch();
         }
     }
 
@@ -2537,12 +2734,118 @@ void ClientUI::renderSearchBox()
     ImGui::SameLine();
     if (ImGui::Button("清除", ImVec2(70, 40)))
     {
-        searchResults.clear();
         memset(searchBuffer, 0, sizeof(searchBuffer));
         memset(lastSearchBuffer, 0, sizeof(lastSearchBuffer));
+        suggestions.clear();
         refreshProducts();
+        performSearch();
     }
     ImGui::PopStyleVar();
+
+    // 联想列表：输入框获得焦点（或鼠标停在列表上）时显示在搜索框下方
+    if (!suggestions.empty() && (searchInputActive || suggestionsHovered))
+    {
+        float listHeight = ImGui::GetTextLineHeightWithSpacing() * suggestions.size() + ImGui::GetStyle().WindowPadding.y * 2;
+        ImGui::PushStyleColor(ImGuiCol_ChildBg, ImVec4(0.16f, 0.17f, 0.18f, 1.0f));
+        ImGui::BeginChild("##searchSuggestions", ImVec2(searchInputWidth, listHeight), ImGuiChildFlags_Borders);
+        std::string selected;
+        for (const auto &suggestion : suggestions)
+        {
+            if (ImGui::Selectable(suggestion.c_str()))
+            {
+                selected = suggestion;
+            }
+        }
+        suggestionsHovered = ImGui::IsWindowHovered();
+        ImGui::EndChild();
+        ImGui::PopStyleColor();
+
+        if (!selected.empty())
+        {
+            strcpy_s(searchBuffer, sizeof(searchBuffer), selected.c_str());
+            strcpy_s(lastSearchBuffer, sizeof(lastSearchBuffer), searchBuffer);
+            suggestions.clear();
+            suggestionsHovered = false;
+            performSearch();
+        }
+    }
+    else
+    {
+        suggestionsHovered = false;
+    }
+}
+
+// 渲染排序选择：由服务端排序后分页返回
+void ClientUI::renderSortControls()
+{
+    const char *sortNames[] = {"默认顺序", "价格", "折扣", "库存", "名称", "商家"};
+    bool changed = false;
+
+    ImGui::SetNextItemWidth(150);
+    changed |= ImGui::Combo("排序", &productSortIndex, sortNames, IM_ARRAYSIZE(sortNames));
+    ImGui::SameLine();
+    changed |= ImGui::Checkbox("降序", &productSortDescending);
+    ImGui::SameLine();
+    changed |= ImGui::Checkbox("筛选", &productFilterEnabled);
+    if (productFilterEnabled)
+    {
+        changed |= renderFilterControls();
+    }
+
+    if (changed)
+    {
+        performSearch();
+    }
+}
+
+// 渲染筛选条件：分类和有货、折扣选项旁显示服务端返回的商品数
+bool ClientUI::renderFilterControls()
+{
+    bool changed = false;
+
+    std::string preview = filterCategory.empty() ? "全部分类" : filterCategory;
+    ImGui::SetNextItemWidth(180);
+    if (ImGui::BeginCombo("分类", preview.c_str()))
+    {
+        if (ImGui::Selectable("全部分类", filterCategory.empty()))
+        {
+            filterCategory.clear();
+            changed = true;
+        }
+        for (const auto &facet : categoryFacets)
+        {
+            std::string label = facet.value + " (" + std::to_string(facet.count) + ")";
+            if (ImGui::Selectable(label.c_str(), facet.value == filterCategory))
+            {
+                filterCategory = facet.value;
+                changed = true;
+            }
+        }
+        ImGui::EndCombo();
+    }
+
+    // 价格输入完成（失去焦点或回车）后才重新查询，0 表示不限
+    ImGui::SameLine();
+    ImGui::SetNextItemWidth(100);
+    ImGui::InputFloat("最低价", &filterMinPrice, 0.0f, 0.0f, "%.2f");
+    changed |= ImGui::IsItemDeactivatedAfterEdit();
+    ImGui::SameLine();
+    ImGui::SetNextItemWidth(100);
+    ImGui::InputFloat("最高价", &filterMaxPrice, 0.0f, 0.0f, "%.2f");
+    changed |= ImGui::IsItemDeactivatedAfterEdit();
+    if (filterMinPrice < 0.0f)
+        filterMinPrice = 0.0f;
+    if (filterMaxPrice < 0.0f)
+        filterMaxPrice = 0.0f;
+
+    ImGui::SameLine();
+    std::string inStockLabel = "仅看有货 (" + std::to_string(inStockFacet) + ")###filterInStock";
+    changed |= ImGui::Checkbox(inStockLabel.c_str(), &filterInStockOnly);
+    ImGui::SameLine();
+    std::string discountedLabel = "仅看折扣 (" + std::to_string(discountedFacet) + ")###filterDiscounted";
+    changed |= ImGui::Checkbox(discountedLabel.c_str(), &filterDiscountedOnly);
+
+    return changed;
 }
 
 // 渲染现代化产品卡片
@@ -2740,7 +3043,7 @@ void ClientUI::renderPurchaseConfirmDialog()
 
         if (ImGui::Button("确认购买", ImVec2(90, 0)))
         {
-            purchaseProduct(productToPurchase.name, quantityToPurchase);
+            purchaseProduct(productToPurchase.name, quantityToPurchase, productToPurchase.sellerUsername);
             showPurchaseConfirmDialog = false;
             ImGui::CloseCurrentPopup();
         }
@@ -2804,7 +3107,7 @@ void ClientUI::renderDirectPurchaseConfirmDialog()
 
         if (ImGui::Button("确认购买", ImVec2(90, 0)) && canPurchase)
         {
-            purchaseProduct(productToPurchase.name, quantityToPurchase);
+            purchaseProduct(productToPurchase.name, quantityToPurchase, productToPurchase.sellerUsername);
             showDirectPurchaseConfirmDialog = false;
             ImGui::CloseCurrentPopup();
         }
@@ -2819,9 +3122,8 @@ void ClientUI::renderDirectPurchaseConfirmDialog()
             // 取消购买时需要解锁库存
             if (inventoryLocked)
             {
-                if (networkClient->unlockInventory(productToPurchase.id, quantityToPurchase))
+                if (releaseDirectPurchaseLock())
                 {
-                    inventoryLocked = false;
                     std::cout << "取消购买，库存已解锁" << std::endl;
                 }
                 else
@@ -53,8 +53,27 @@ private:
   bool isLoggedIn = false; // 商品相关
   char searchBuffer[128] = {0};
   char lastSearchBuffer[128] = {0}; // 用于跟踪搜索框内容变化
+  std::future<Protocol::Message> pendingSuggestions; // 输入变化时发出的联想请求，每帧检查是否已返回
+  std::vector<std::string> suggestions;              // 搜索框下方的联想列表
+  bool suggestionsHovered = false;                   // 上一帧鼠标在联想列表上，点击时输入框失去焦点也继续显示
   std::vector<Protocol::ProductData> allProducts;
-  std::vector<Protocol::ProductData> searchResults;
+  CatalogSyncState catalogSyncState; // allProducts 对应的服务端目录版本，刷新时只取增量
+  bool catalogSubscribed = false;    // 已订阅目录变化推送，库存/价格变化无需手动刷新
+  std::vector<Protocol::ProductData> searchResults; // 搜索或排序浏览时由服务端逐页返回
+  int productSortIndex = 0;           // 0=默认顺序, 1=价格, 2=折扣, 3=库存, 4=名称, 5=商家
+  bool productSortDescending = false;
+  ProductPageQuery pagedQuery;        // searchResults 对应的查询条件
+  std::string pagedCursor;            // 下一页游标，为空表示已全部加载
+  long long pagedTotal = 0;
+  bool productFilterEnabled = false; // 开启后由服务端按下列条件筛选
+  std::string filterCategory;        // 为空表示全部分类
+  float filterMinPrice = 0.0f;       // 0 表示不限
+  float filterMaxPrice = 0.0f;
+  bool filterInStockOnly = false;
+  bool filterDiscountedOnly = false;
+  std::vector<ProductFacetCount> categoryFacets; // 最近一次筛选返回的分类计数
+  long long inStockFacet = 0;
+  long long discountedFacet = 0;
 
   // 购买商品
   char buyProductName[128] = {0};
@@ -87,7 +106,8 @@ private:
   bool showCartCheckoutConfirmDialog = false;
   Protocol::ProductData productToPurchase;
   int quantityToPurchase = 1;
-  bool inventoryLocked = false; // 标记直接购买时库存是否已锁定// 成功消息弹窗状态
+  bool inventoryLocked = false; // 标记直接购买时库存是否已锁定
+  std::string lockedReservationId; // 直接购买锁定库存得到的预留ID，下单时交给订单// 成功消息弹窗状态
   bool showAddToCartSuccessPopup = false;
   std::string addToCartSuccessMessage;
   bool showDirectPurchaseSuccessPopup = false;
@@ -142,6 +162,8 @@ private:
   bool renderModernButton(const char *label, ImVec2 size, bool primary = false);
   void renderCard(const char *title, const char *content, bool collapsible = false);
   void renderSearchBox();
+  void renderSortControls();
+  bool renderFilterControls(); // 返回筛选条件是否变化
   void renderProductCard(const Protocol::ProductData &product);
   void renderStatusBar();
 
@@ -177,17 +199,23 @@ public:
   // 商品操作
   bool addProduct(const Protocol::ProductData &product);
   void refreshProducts();
+  void processServerPushes(); // 每帧取出服务端推送的商品变化并合并到 allProducts
   void refreshCart();
   void refreshOrders();
   void refreshUserOrders();
   void performSearch();
+  void loadProductPage(bool reset); // reset 时按当前搜索词和排序从第一页加载，否则追加下一页
   void addProductToCart(const Protocol::ProductData &product);
   void updateCartQuantity(const std::string &productId, int newQuantity);
   void removeFromCart(const std::string &productId);
   void checkout();
   void checkoutWithInventoryLock();
   void addToCartByName(const std::string &productName, int quantity);
-  void purchaseProduct(const std::string &productName, int quantity);
+  // 商家管理按名称输入商品：换成当前商家同名商品的ID，本地没有该商品时原样返回名称由服务端查找
+  std::string ownProductId(const std::string &productName) const;
+  void purchaseProduct(const std::string &productName, int quantity, const std::string &sellerUsername = "");
+  // 直接购买没有下单成功时释放确认前锁定的库存，返回是否释放成功（没有锁定时也返回 true）
+  bool releaseDirectPurchaseLock();
   void clearMessages();
 
   // 状态和错误消息方法
@@ -1,7 +1,9 @@
 #include <iostream>
 #include <string>
 #include "client/client_ui.h"
+#ifdef _WIN32
 #include <windows.h>
+#endif
 
 int main()
 {
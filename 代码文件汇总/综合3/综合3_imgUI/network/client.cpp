@@ -1,25 +1,25 @@
 #include "client.h"
 #include <iostream>
 #include <chrono>
+#include <unordered_map>
 
 NetworkClient::NetworkClient(const std::string &address, int port)
     : serverAddress(address), serverPort(port), clientSocket(INVALID_SOCKET),
-      isConnected(false), shouldStop(false)
+      wireFormat(Protocol::WireFormat::TEXT),
+      isConnected(false), shouldStop(false), nextRequestId(1)
 {
 
-    // 初始化Winsock
-    WSADATA wsaData;
-    int result = WSAStartup(MAKEWORD(2, 2), &wsaData);
-    if (result != 0)
+    // 初始化套接字库
+    if (!SocketCompat::initialize())
     {
-        std::cerr << "WSAStartup failed: " << result << std::endl;
+        std::cerr << "套接字库初始化失败: " << SocketCompat::lastError() << std::endl;
     }
 }
 
 NetworkClient::~NetworkClient()
 {
     disconnect();
-    WSACleanup();
+    SocketCompat::cleanup();
 }
 
 bool NetworkClient::connect()
@@ -33,12 +33,12 @@ bool NetworkClient::connect()
     clientSocket = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
     if (clientSocket == INVALID_SOCKET)
     {
-        std::cerr << "Socket creation failed: " << WSAGetLastError() << std::endl;
+        std::cerr << "Socket creation failed: " << SocketCompat::lastError() << std::endl;
         return false;
     }
 
     // 设置服务器地址
-    sockaddr_in serverAddr;
+    sockaddr_in serverAddr{};
     serverAddr.sin_family = AF_INET;
     serverAddr.sin_port = htons(serverPort);
     inet_pton(AF_INET, serverAddress.c_str(), &serverAddr.sin_addr);
@@ -46,8 +46,8 @@ bool NetworkClient::connect()
     // 连接服务器
     if (::connect(clientSocket, (sockaddr *)&serverAddr, sizeof(serverAddr)) == SOCKET_ERROR)
     {
-        std::cerr << "Connect failed: " << WSAGetLastError() << std::endl;
-        closesocket(clientSocket);
+        std::cerr << "Connect failed: " << SocketCompat::lastError() << std::endl;
+        SocketCompat::closeSocket(clientSocket);
         clientSocket = INVALID_SOCKET;
         return false;
     }
@@ -59,9 +59,37 @@ bool NetworkClient::connect()
     receiveThread = std::thread(&NetworkClient::receiveLoop, this);
 
     std::cout << "已连接到服务器 " << serverAddress << ":" << serverPort << std::endl;
+
+    // 每次新连接都从文本格式开始，再尝试切换到二进制格式
+    wireFormat.store(Protocol::WireFormat::TEXT);
+    negotiateWireFormat(Protocol::WireFormat::BINARY);
     return true;
 }
 
+bool NetworkClient::negotiateWireFormat(Protocol::WireFormat preferred)
+{
+    Protocol::Message request(Protocol::MessageType::PROTOCOL_NEGOTIATE, sessionId);
+    std::string formats = Protocol::wireFormatName(preferred);
+    if (preferred != Protocol::WireFormat::TEXT)
+    {
+        formats += ",text";
+    }
+    request.setData("formats", formats);
+
+    Protocol::Message response = sendRequest(request);
+    Protocol::WireFormat chosen;
+    if (response.type == Protocol::MessageType::RESPONSE_SUCCESS &&
+        Protocol::parseWireFormat(response.getData("format"), chosen))
+    {
+        wireFormat.store(chosen);
+        std::cout << "线上格式: " << Protocol::wireFormatName(chosen) << std::endl;
+        return true;
+    }
+
+    wireFormat.store(Protocol::WireFormat::TEXT);
+    return false;
+}
+
 void NetworkClient::disconnect()
 {
     if (!isConnected.load())
@@ -74,7 +102,9 @@ void NetworkClient::disconnect()
 
     if (clientSocket != INVALID_SOCKET)
     {
-        closesocket(clientSocket);
+        // 先 shutdown 以唤醒阻塞在 recv 上的接收线程（POSIX 下仅 close 不会唤醒）
+        SocketCompat::shutdownSocket(clientSocket);
+        SocketCompat::closeSocket(clientSocket);
         clientSocket = INVALID_SOCKET;
     }
 
@@ -83,6 +113,9 @@ void NetworkClient::disconnect()
         receiveThread.join();
     }
 
+    // 唤醒所有仍在等待响应的请求（返回空消息）
+    failPendingRequests();
+
     // 清理消息队列
     std::lock_guard<std::mutex> lock(queueMutex);
     while (!responseQueue.empty())
@@ -103,7 +136,7 @@ void NetworkClient::receiveLoop()
             break;
         }
 
-        Protocol::Message message = Protocol::Message::deserialize(rawData);
+        Protocol::Message message = Protocol::Message::decode(rawData);
 
         // 如果设置了回调函数，调用回调
         if (messageCallback)
@@ -111,13 +144,41 @@ void NetworkClient::receiveLoop()
             messageCallback(message);
         }
 
-        // 将消息放入队列
+        // 带请求ID的响应交给对应的等待者
+        if (message.requestId != 0)
+        {
+            std::shared_ptr<std::promise<Protocol::Message>> waiter;
+            {
+                std::lock_guard<std::mutex> lock(pendingMutex);
+                auto it = pendingRequests.find(message.requestId);
+                if (it != pendingRequests.end())
+                {
+                    waiter = it->second;
+                    pendingRequests.erase(it);
+                }
+            }
+            if (waiter)
+            {
+                waiter->set_value(std::move(message));
+            }
+            else
+            {
+                // 等待者已超时放弃，丢弃迟到的响应，避免被其他请求误取
+                std::cerr << "丢弃迟到的响应，请求ID: " << message.requestId << std::endl;
+            }
+            continue;
+        }
+
+        // 服务器主动推送等无请求ID的消息放入队列
         {
             std::lock_guard<std::mutex> lock(queueMutex);
             responseQueue.push(message);
         }
         queueCondition.notify_one();
     }
+
+    // 连接断开后不会再有响应到达
+    failPendingRequests();
 }
 
 bool NetworkClient::sendRawData(const std::string &data)
@@ -127,11 +188,14 @@ bool NetworkClient::sendRawData(const std::string &data)
         return false;
     }
 
+    // 多个请求可能并发发送，长度前缀和数据必须连续写出
+    std::lock_guard<std::mutex> lock(sendMutex);
+
     // 发送数据长度
     uint32_t dataLength = htonl(static_cast<uint32_t>(data.length()));
     if (send(clientSocket, reinterpret_cast<const char *>(&dataLength), sizeof(dataLength), 0) == SOCKET_ERROR)
     {
-        std::cerr << "Send length failed: " << WSAGetLastError() << std::endl;
+        std::cerr << "Send length failed: " << SocketCompat::lastError() << std::endl;
         return false;
     }
 
@@ -144,7 +208,7 @@ bool NetworkClient::sendRawData(const std::string &data)
         int sent = send(clientSocket, data.c_str() + totalSent, dataSize - totalSent, 0);
         if (sent == SOCKET_ERROR)
         {
-            std::cerr << "Send data failed: " << WSAGetLastError() << std::endl;
+            std::cerr << "Send data failed: " << SocketCompat::lastError() << std::endl;
             return false;
         }
         totalSent += sent;
@@ -171,7 +235,7 @@ std::string NetworkClient::receiveRawData()
         }
         else
         {
-            std::cerr << "Receive length failed: " << WSAGetLastError() << std::endl;
+            std::cerr << "Receive length failed: " << SocketCompat::lastError() << std::endl;
         }
         isConnected.store(false);
         return "";
@@ -189,7 +253,7 @@ std::string NetworkClient::receiveRawData()
         int received = recv(clientSocket, &data[totalReceived], dataLength - totalReceived, 0);
         if (received <= 0)
         {
-            std::cerr << "Receive data failed: " << WSAGetLastError() << std::endl;
+            std::cerr << "Receive data failed: " << SocketCompat::lastError() << std::endl;
             isConnected.store(false);
             return "";
         }
@@ -201,7 +265,7 @@ std::string NetworkClient::receiveRawData()
 
 bool NetworkClient::sendMessage(const Protocol::Message &message)
 {
-    std::string serialized = message.serialize();
+    std::string serialized = message.encode(wireFormat.load());
     return sendRawData(serialized);
 }
 
@@ -218,7 +282,7 @@ Protocol::Message NetworkClient::waitForResponse(Protocol::MessageType expectedT
                                         { return !responseQueue.empty(); }))
             {
                 Protocol::Message msg = responseQueue.front();
-                if (msg.type == expectedType || expectedType == Protocol::MessageType::RESPONSE_DATA)
+                if (msg.type == expectedType)
                 {
                     responseQueue.pop();
                     return msg;
@@ -248,6 +312,73 @@ Protocol::Message NetworkClient::waitForResponse(Protocol::MessageType expectedT
     return Protocol::Message(); // 超时返回空消息
 }
 
+std::future<Protocol::Message> NetworkClient::sendRequestAsync(Protocol::Message &request)
+{
+    request.requestId = nextRequestId.fetch_add(1);
+    if (request.requestId == 0)
+    {
+        // 0 保留给非请求消息，回绕时跳过
+        request.requestId = nextRequestId.fetch_add(1);
+    }
+
+    auto waiter = std::make_shared<std::promise<Protocol::Message>>();
+    std::future<Protocol::Message> result = waiter->get_future();
+    {
+        std::lock_guard<std::mutex> lock(pendingMutex);
+        pendingRequests[request.requestId] = waiter;
+    }
+
+    if (!sendMessage(request))
+    {
+        std::lock_guard<std::mutex> lock(pendingMutex);
+        if (pendingRequests.erase(request.requestId) > 0)
+        {
+            waiter->set_value(Protocol::Message());
+        }
+    }
+    return result;
+}
+
+Protocol::Message NetworkClient::sendRequest(Protocol::Message &request, int timeoutMs)
+{
+    std::future<Protocol::Message> result = sendRequestAsync(request);
+    if (result.wait_for(std::chrono::milliseconds(timeoutMs)) == std::future_status::ready)
+    {
+        return result.get();
+    }
+
+    // 超时：注销等待者，之后到达的响应会被丢弃
+    {
+        std::lock_guard<std::mutex> lock(pendingMutex);
+        if (pendingRequests.erase(request.requestId) == 0)
+        {
+            // 恰好在注销前收到了响应
+            return result.get();
+        }
+    }
+    std::cerr << "请求超时，请求ID: " << request.requestId << std::endl;
+    return Protocol::Message(); // 超时返回空消息
+}
+
+size_t NetworkClient::getPendingRequestCount() const
+{
+    std::lock_guard<std::mutex> lock(pendingMutex);
+    return pendingRequests.size();
+}
+
+void NetworkClient::failPendingRequests()
+{
+    std::map<uint32_t, std::shared_ptr<std::promise<Protocol::Message>>> pending;
+    {
+        std::lock_guard<std::mutex> lock(pendingMutex);
+        pending.swap(pendingRequests);
+    }
+    for (auto &pair : pending)
+    {
+        pair.second->set_value(Protocol::Message());
+    }
+}
+
 bool NetworkClient::hasResponse() const
 {
     std::lock_guard<std::mutex> lock(queueMutex);
@@ -284,13 +415,13 @@ bool NetworkClient::loginWithError(const std::string &username, const std::strin
     request.setData("username", username);
     request.setData("password", password);
 
-    if (!sendMessage(request))
+    if (!isConnected.load())
     {
         errorMessage = "无法发送登录请求";
         return false;
     }
 
-    Protocol::Message response = waitForResponse(Protocol::MessageType::RESPONSE_SUCCESS);
+    Protocol::Message response = sendRequest(request);
     if (response.type == Protocol::MessageType::RESPONSE_SUCCESS)
     {
         sessionId = response.getData("sessionId");
@@ -314,12 +445,7 @@ bool NetworkClient::registerUser(const std::string &username, const std::string
     request.setData("password", password);
     request.setData("userType", std::to_string(static_cast<int>(userType)));
 
-    if (!sendMessage(request))
-    {
-        return false;
-    }
-
-    Protocol::Message response = waitForResponse(Protocol::MessageType::RESPONSE_SUCCESS);
+    Protocol::Message response = sendRequest(request);
     return response.type == Protocol::MessageType::RESPONSE_SUCCESS;
 }
 
@@ -327,12 +453,7 @@ bool NetworkClient::logout()
 {
     Protocol::Message request(Protocol::MessageType::USER_LOGOUT, sessionId);
 
-    if (!sendMessage(request))
-    {
-        return false;
-    }
-
-    Protocol::Message response = waitForResponse(Protocol::MessageType::RESPONSE_SUCCESS);
+    Protocol::Message response = sendRequest(request);
     if (response.type == Protocol::MessageType::RESPONSE_SUCCESS)
     {
         sessionId.clear();
@@ -347,46 +468,221 @@ bool NetworkClient::getAllProducts(std::vector<Protocol::ProductData> &products)
 {
     Protocol::Message request(Protocol::MessageType::PRODUCT_GET_ALL, sessionId);
 
-    if (!sendMessage(request))
+    Protocol::Message response = sendRequest(request);
+    if (response.type == Protocol::MessageType::RESPONSE_DATA)
+    {
+        products.clear();
+        const std::vector<std::string> &records = response.getList("products");
+        products.reserve(records.size());
+        for (const auto &productData : records)
+        {
+            products.push_back(Protocol::ProductData::decode(productData));
+        }
+        return true;
+    }
+
+    return false;
+}
+
+namespace
+{
+    // 把增量响应/推送中的商品合并到本地列表：商品按 (ID, 商家) 定位，已有的就地更新，新的追加到末尾
+    void mergeProductChanges(std::vector<Protocol::ProductData> &products, const Protocol::Message &message)
+    {
+        auto productKey = [](const std::string &id, const std::string &seller)
+        { return id + '\x1f' + seller; };
+        std::unordered_map<std::string, size_t> index;
+        const std::vector<std::string> &records = message.getList("products");
+        index.reserve(products.size() + records.size());
+        for (size_t i = 0; i < products.size(); ++i)
+        {
+            index.emplace(productKey(products[i].id, products[i].sellerUsername), i);
+        }
+
+        for (const auto &productData : records)
+        {
+            Protocol::ProductData product = Protocol::ProductData::decode(productData);
+            auto inserted = index.emplace(productKey(product.id, product.sellerUsername), products.size());
+            if (inserted.second)
+            {
+                products.push_back(std::move(product));
+            }
+            else
+            {
+                products[inserted.first->second] = std::move(product);
+            }
+        }
+
+        const std::vector<std::string> &removedIds = message.getList("removedIds");
+        const std::vector<std::string> &removedSellers = message.getList("removedSellers");
+        if (removedIds.empty())
+        {
+            return;
+        }
+        std::vector<bool> removed(products.size(), false);
+        for (size_t i = 0; i < removedIds.size() && i < removedSellers.size(); ++i)
+        {
+            auto it = index.find(productKey(removedIds[i], removedSellers[i]));
+            if (it != index.end())
+            {
+                removed[it->second] = true;
+            }
+        }
+        size_t kept = 0;
+        for (size_t i = 0; i < products.size(); ++i)
+        {
+            if (!removed[i])
+            {
+                if (kept != i)
+                {
+                    products[kept] = std::move(products[i]);
+                }
+                kept++;
+            }
+        }
+        products.resize(kept);
+    }
+
+    bool parseVersionFields(const Protocol::Message &message, long long &epoch, long long &version)
+    {
+        try
+        {
+            epoch = std::stoll(message.getData("epoch"));
+            version = std::stoll(message.getData("version"));
+            return true;
+        }
+        catch (const std::exception &)
+        {
+            return false;
+        }
+    }
+}
+
+bool NetworkClient::syncProducts(std::vector<Protocol::ProductData> &products, CatalogSyncState &state)
+{
+    Protocol::Message request(Protocol::MessageType::PRODUCT_SYNC, sessionId);
+    if (state.valid)
+    {
+        request.setData("epoch", std::to_string(state.epoch));
+        request.setData("sinceVersion", std::to_string(state.version));
+    }
+
+    Protocol::Message response = sendRequest(request);
+    if (response.type != Protocol::MessageType::RESPONSE_DATA)
     {
         return false;
     }
 
-    Protocol::Message response = waitForResponse(Protocol::MessageType::RESPONSE_DATA);
-    if (response.type == Protocol::MessageType::RESPONSE_DATA)
+    if (response.getData("delta") == "1")
+    {
+        mergeProductChanges(products, response);
+    }
+    else
     {
+        // 全量响应：整体替换
+        const std::vector<std::string> &records = response.getList("products");
         products.clear();
-        int count = std::stoi(response.getData("count"));
-        for (int i = 0; i < count; ++i)
+        products.reserve(records.size());
+        for (const auto &productData : records)
         {
-            std::string productData = response.getData("product_" + std::to_string(i));
-            products.push_back(Protocol::ProductData::deserialize(productData));
+            products.push_back(Protocol::ProductData::decode(productData));
         }
-        return true;
     }
 
-    return false;
+    // 服务端未提供版本信息时下次仍取全量
+    state.valid = parseVersionFields(response, state.epoch, state.version);
+    return true;
 }
 
-// 购物车操作实现
-bool NetworkClient::getCart(std::vector<Protocol::CartItemData> &cartItems)
+bool NetworkClient::subscribeCatalog(const CatalogSyncState &state)
 {
-    Protocol::Message request(Protocol::MessageType::CART_GET, sessionId);
+    Protocol::Message request(Protocol::MessageType::PRODUCT_SUBSCRIBE, sessionId);
+    request.setData("scope", "catalog");
+    if (state.valid)
+    {
+        request.setData("epoch", std::to_string(state.epoch));
+        request.setData("sinceVersion", std::to_string(state.version));
+    }
 
-    if (!sendMessage(request))
+    Protocol::Message response = sendRequest(request);
+    return response.type == Protocol::MessageType::RESPONSE_SUCCESS;
+}
+
+bool NetworkClient::subscribeProducts(const std::vector<std::string> &productIds)
+{
+    Protocol::Message request(Protocol::MessageType::PRODUCT_SUBSCRIBE, sessionId);
+    request.addList("productIds") = productIds;
+
+    Protocol::Message response = sendRequest(request);
+    return response.type == Protocol::MessageType::RESPONSE_SUCCESS;
+}
+
+bool NetworkClient::unsubscribeProducts(const std::vector<std::string> &productIds)
+{
+    Protocol::Message request(Protocol::MessageType::PRODUCT_UNSUBSCRIBE, sessionId);
+    request.addList("productIds") = productIds;
+
+    Protocol::Message response = sendRequest(request);
+    return response.type == Protocol::MessageType::RESPONSE_SUCCESS;
+}
+
+bool NetworkClient::applyProductPush(const Protocol::Message &push, std::vector<Protocol::ProductData> &products, CatalogSyncState &state)
+{
+    long long epoch = 0;
+    long long version = 0;
+    long long sinceVersion = 0;
+    if (!parseVersionFields(push, epoch, version) || push.getData("resync") == "1")
     {
         return false;
     }
 
-    Protocol::Message response = waitForResponse(Protocol::MessageType::RESPONSE_DATA);
+    if (push.getData("catalog") != "1")
+    {
+        // 只订阅了部分商品：推送不覆盖整个目录，只更新这些商品，不推进目录版本
+        mergeProductChanges(products, push);
+        return true;
+    }
+
+    try
+    {
+        sinceVersion = std::stoll(push.getData("sinceVersion"));
+    }
+    catch (const std::exception &)
+    {
+        return false;
+    }
+
+    if (!state.valid || epoch != state.epoch)
+    {
+        return false;
+    }
+    if (version <= state.version)
+    {
+        return true; // 本地已经是更新的版本（例如刚做过同步）
+    }
+    if (sinceVersion > state.version)
+    {
+        return false; // 中间缺了变化，需要增量同步补齐
+    }
+
+    // 推送中的记录是 version 时的最新状态，与本地重叠的部分重复应用也没有影响
+    mergeProductChanges(products, push);
+    state.version = version;
+    return true;
+}
+
+// 购物车操作实现
+bool NetworkClient::getCart(std::vector<Protocol::CartItemData> &cartItems)
+{
+    Protocol::Message request(Protocol::MessageType::CART_GET, sessionId);
+
+    Protocol::Message response = sendRequest(request);
     if (response.type == Protocol::MessageType::RESPONSE_DATA)
     {
         cartItems.clear();
-        int count = std::stoi(response.getData("count"));
-        for (int i = 0; i < count; ++i)
+        for (const auto &itemData : response.getList("items"))
         {
-            std::string itemData = response.getData("item_" + std::to_string(i));
-            cartItems.push_back(Protocol::CartItemData::deserialize(itemData));
+            cartItems.push_back(Protocol::CartItemData::decode(itemData));
         }
         return true;
     }
@@ -394,18 +690,17 @@ bool NetworkClient::getCart(std::vector<Protocol::CartItemData> &cartItems)
     return false;
 }
 
-bool NetworkClient::addToCart(const std::string &productId, int quantity)
+bool NetworkClient::addToCart(const std::string &productId, int quantity, const std::string &sellerUsername)
 {
     Protocol::Message request(Protocol::MessageType::CART_ADD_ITEM, sessionId);
     request.setData("productId", productId);
     request.setData("quantity", std::to_string(quantity));
-
-    if (!sendMessage(request))
+    if (!sellerUsername.empty())
     {
-        return false;
+        request.setData("sellerUsername", sellerUsername);
     }
 
-    Protocol::Message response = waitForResponse(Protocol::MessageType::RESPONSE_SUCCESS);
+    Protocol::Message response = sendRequest(request);
     return response.type == Protocol::MessageType::RESPONSE_SUCCESS;
 }
 
@@ -414,12 +709,7 @@ bool NetworkClient::removeFromCart(const std::string &productId)
     Protocol::Message request(Protocol::MessageType::CART_REMOVE_ITEM, sessionId);
     request.setData("productId", productId);
 
-    if (!sendMessage(request))
-    {
-        return false;
-    }
-
-    Protocol::Message response = waitForResponse(Protocol::MessageType::RESPONSE_SUCCESS);
+    Protocol::Message response = sendRequest(request);
     return response.type == Protocol::MessageType::RESPONSE_SUCCESS;
 }
 
@@ -427,46 +717,34 @@ bool NetworkClient::clearCart()
 {
     Protocol::Message request(Protocol::MessageType::CART_CLEAR, sessionId);
 
-    if (!sendMessage(request))
-    {
-        return false;
-    }
-
-    Protocol::Message response = waitForResponse(Protocol::MessageType::RESPONSE_SUCCESS);
+    Protocol::Message response = sendRequest(request);
     return response.type == Protocol::MessageType::RESPONSE_SUCCESS;
 }
 
 bool NetworkClient::addProduct(const Protocol::ProductData &product)
 {
     Protocol::Message request(Protocol::MessageType::PRODUCT_ADD, sessionId);
-    request.setData("productData", product.serialize());
+    request.setData("productData", product.encode(wireFormat.load()));
 
-    if (!sendMessage(request))
-    {
-        return false;
-    }
-
-    Protocol::Message response = waitForResponse(Protocol::MessageType::RESPONSE_SUCCESS);
+    Protocol::Message response = sendRequest(request);
     return response.type == Protocol::MessageType::RESPONSE_SUCCESS;
 }
 
 // 订单操作实现
-bool NetworkClient::createOrder(const std::vector<Protocol::CartItemData> &items, std::string &orderId)
+bool NetworkClient::createOrder(const std::vector<Protocol::CartItemData> &items, std::string &orderId, const std::string &reservationId)
 {
     Protocol::Message request(Protocol::MessageType::ORDER_CREATE, sessionId);
-    request.setData("itemCount", std::to_string(items.size()));
-
-    for (size_t i = 0; i < items.size(); ++i)
+    std::vector<std::string> &records = request.addList("items");
+    for (const auto &item : items)
     {
-        request.setData("item_" + std::to_string(i), items[i].serialize());
+        records.push_back(item.encode(wireFormat.load()));
     }
-
-    if (!sendMessage(request))
+    if (!reservationId.empty())
     {
-        return false;
+        request.setData("reservationId", reservationId);
     }
 
-    Protocol::Message response = waitForResponse(Protocol::MessageType::RESPONSE_SUCCESS);
+    Protocol::Message response = sendRequest(request);
     if (response.type == Protocol::MessageType::RESPONSE_SUCCESS)
     {
         orderId = response.getData("orderId");
@@ -475,18 +753,22 @@ bool NetworkClient::createOrder(const std::vector<Protocol::CartItemData> &items
     return false;
 }
 
-bool NetworkClient::createDirectOrder(const std::string &productId, int quantity, std::string &orderId)
+bool NetworkClient::createDirectOrder(const std::string &productId, int quantity, std::string &orderId, const std::string &sellerUsername,
+                                      const std::string &reservationId)
 {
     Protocol::Message request(Protocol::MessageType::ORDER_DIRECT_PURCHASE, sessionId);
     request.setData("productId", productId);
     request.setData("quantity", std::to_string(quantity));
-
-    if (!sendMessage(request))
+    if (!sellerUsername.empty())
     {
-        return false;
+        request.setData("sellerUsername", sellerUsername);
+    }
+    if (!reservationId.empty())
+    {
+        request.setData("reservationId", reservationId);
     }
 
-    Protocol::Message response = waitForResponse(Protocol::MessageType::RESPONSE_SUCCESS);
+    Protocol::Message response = sendRequest(request);
     if (response.type == Protocol::MessageType::RESPONSE_SUCCESS)
     {
         orderId = response.getData("orderId");
@@ -500,21 +782,15 @@ bool NetworkClient::getUserOrders(std::vector<Protocol::OrderData> &orders)
 {
     Protocol::Message request(Protocol::MessageType::ORDER_GET_BY_USER, sessionId);
 
-    if (!sendMessage(request))
-    {
-        return false;
-    }
-
-    Protocol::Message response = waitForResponse(Protocol::MessageType::RESPONSE_DATA);
+    Protocol::Message response = sendRequest(request);
     if (response.type == Protocol::MessageType::RESPONSE_DATA)
     {
         orders.clear();
-        int count = std::stoi(response.getData("count"));
-        for (int i = 0; i < count; ++i)
+        const std::vector<std::string> &records = response.getList("orders");
+        orders.reserve(records.size());
+        for (const auto &orderData : records)
         {
-            std::string orderData = response.getData("order_" + std::to_string(i));
-            // std::cerr << "Received order data: " << orderData << std::endl;
-            orders.push_back(Protocol::OrderData::deserialize(orderData));
+            orders.push_back(Protocol::OrderData::decode(orderData));
         }
         return true;
     }
@@ -527,12 +803,7 @@ bool NetworkClient::getUserInfo(Protocol::UserData &userData)
 {
     Protocol::Message request(Protocol::MessageType::USER_GET_INFO, sessionId);
 
-    if (!sendMessage(request))
-    {
-        return false;
-    }
-
-    Protocol::Message response = waitForResponse(Protocol::MessageType::RESPONSE_DATA);
+    Protocol::Message response = sendRequest(request);
     if (response.type == Protocol::MessageType::RESPONSE_DATA)
     {
         userData = Protocol::UserData::deserialize(response.getData("userData"));
@@ -548,12 +819,7 @@ bool NetworkClient::changePassword(const std::string &oldPassword, const std::st
     request.setData("oldPassword", oldPassword);
     request.setData("newPassword", newPassword);
 
-    if (!sendMessage(request))
-    {
-        return false;
-    }
-
-    Protocol::Message response = waitForResponse(Protocol::MessageType::RESPONSE_SUCCESS);
+    Protocol::Message response = sendRequest(request);
     return response.type == Protocol::MessageType::RESPONSE_SUCCESS;
 }
 
@@ -562,12 +828,7 @@ bool NetworkClient::updateBalance(double amount)
     Protocol::Message request(Protocol::MessageType::USER_UPDATE_BALANCE, sessionId);
     request.setData("amount", std::to_string(amount));
 
-    if (!sendMessage(request))
-    {
-        return false;
-    }
-
-    Protocol::Message response = waitForResponse(Protocol::MessageType::RESPONSE_SUCCESS);
+    Protocol::Message response = sendRequest(request);
     return response.type == Protocol::MessageType::RESPONSE_SUCCESS;
 }
 
@@ -577,22 +838,15 @@ bool NetworkClient::searchProducts(const std::string &keyword, std::vector<Proto
     Protocol::Message request(Protocol::MessageType::PRODUCT_SEARCH, sessionId);
     request.setData("keyword", keyword);
 
-    if (!sendMessage(request))
-    {
-        return false;
-    }
-
-    Protocol::Message response = waitForResponse(Protocol::MessageType::RESPONSE_DATA);
+    Protocol::Message response = sendRequest(request);
     if (response.type == Protocol::MessageType::RESPONSE_DATA)
     {
         products.clear();
-        int count = std::stoi(response.getData("count"));
-        for (int i = 0; i < count; ++i)
+        const std::vector<std::string> &records = response.getList("products");
+        products.reserve(records.size());
+        for (const auto &productData : records)
         {
-            std::string productData = response.getData("product_" + std::to_string(i));
-
-            // std::cerr << "Received product data: " << productData << std::endl;
-            products.push_back(Protocol::ProductData::deserialize(productData));
+            products.push_back(Protocol::ProductData::decode(productData));
         }
         return true;
     }
@@ -600,6 +854,120 @@ bool NetworkClient::searchProducts(const std::string &keyword, std::vector<Proto
     return false;
 }
 
+std::future<Protocol::Message> NetworkClient::requestSuggestions(const std::string &prefix, int limit)
+{
+    Protocol::Message request(Protocol::MessageType::PRODUCT_SUGGEST, sessionId);
+    request.setData("prefix", prefix);
+    request.setData("limit", std::to_string(limit));
+    return sendRequestAsync(request);
+}
+
+bool NetworkClient::parseSuggestions(const Protocol::Message &response, std::vector<std::string> &suggestions)
+{
+    if (response.type != Protocol::MessageType::RESPONSE_DATA)
+    {
+        return false;
+    }
+    suggestions = response.getList("suggestions");
+    return true;
+}
+
+bool NetworkClient::getProductPage(const ProductPageQuery &query, const std::string &cursor, ProductPage &page)
+{
+    Protocol::MessageType type = query.filtered          ? Protocol::MessageType::PRODUCT_FILTER
+                                 : query.keyword.empty() ? Protocol::MessageType::PRODUCT_GET_ALL
+                                                         : Protocol::MessageType::PRODUCT_SEARCH;
+    Protocol::Message request(type, sessionId);
+    if (query.filtered)
+    {
+        if (!query.category.empty())
+        {
+            request.addList("categories").push_back(query.category);
+        }
+        if (query.minPrice >= 0.0)
+        {
+            request.setData("minPrice", std::to_string(query.minPrice));
+        }
+        if (query.maxPrice >= 0.0)
+        {
+            request.setData("maxPrice", std::to_string(query.maxPrice));
+        }
+        request.setData("inStock", query.inStockOnly ? "1" : "0");
+        request.setData("discounted", query.discountedOnly ? "1" : "0");
+    }
+    if (!query.keyword.empty())
+    {
+        request.setData("keyword", query.keyword);
+    }
+    request.setData("limit", std::to_string(query.limit));
+    request.setData("sort", query.sort);
+    request.setData("order", query.descending ? "desc" : "asc");
+    if (!cursor.empty())
+    {
+        request.setData("cursor", cursor);
+    }
+
+    Protocol::Message response = sendRequest(request);
+    if (response.type != Protocol::MessageType::RESPONSE_DATA)
+    {
+        return false;
+    }
+
+    page.products.clear();
+    const std::vector<std::string> &records = response.getList("products");
+    page.products.reserve(records.size());
+    for (const auto &productData : records)
+    {
+        page.products.push_back(Protocol::ProductData::decode(productData));
+    }
+    page.nextCursor = response.getData("nextCursor");
+    try
+    {
+        page.total = std::stoll(response.getData("total"));
+    }
+    catch (const std::exception &)
+    {
+        page.total = static_cast<long long>(page.products.size());
+    }
+
+    if (query.filtered)
+    {
+        auto readCounts = [&response](const std::string &name, std::vector<ProductFacetCount> &counts)
+        {
+            const std::vector<std::string> &values = response.getList(name + "Values");
+            const std::vector<std::string> &numbers = response.getList(name + "Counts");
+            counts.clear();
+            for (size_t i = 0; i < values.size() && i < numbers.size(); ++i)
+            {
+                ProductFacetCount count;
+                count.value = values[i];
+                try
+                {
+                    count.count = std::stoll(numbers[i]);
+                }
+                catch (const std::exception &)
+                {
+                    count.count = 0;
+                }
+                counts.push_back(count);
+            }
+        };
+        readCounts("category", page.categoryCounts);
+        readCounts("priceRange", page.priceRangeCounts);
+        try
+        {
+            page.inStockCount = std::stoll(response.getData("inStockCount"));
+            page.discountedCount = std::stoll(response.getData("discountedCount"));
+        }
+        catch (const std::exception &)
+        {
+            page.inStockCount = 0;
+            page.discountedCount = 0;
+        }
+    }
+    return true;
+}
+
 // 购物车商品更新实现
 bool NetworkClient::updateCartItem(const std::string &productId, int newQuantity)
 {
@@ -607,58 +975,38 @@ bool NetworkClient::updateCartItem(const std::string &productId, int newQuantity
     request.setData("productId", productId);
     request.setData("quantity", std::to_string(newQuantity));
 
-    if (!sendMessage(request))
-    {
-        return false;
-    }
-
-    Protocol::Message response = waitForResponse(Protocol::MessageType::RESPONSE_SUCCESS);
+    Protocol::Message response = sendRequest(request);
     return response.type == Protocol::MessageType::RESPONSE_SUCCESS;
 }
 
 // 商家管理操作实现
-bool NetworkClient::manageProductPrice(const std::string &productName, double newPrice)
+bool NetworkClient::manageProductPrice(const std::string &productId, double newPrice)
 {
     Protocol::Message request(Protocol::MessageType::PRODUCT_MANAGE_PRICE, sessionId);
-    request.setData("productName", productName);
+    request.setData("productId", productId);
     request.setData("newPrice", std::to_string(newPrice));
 
-    if (!sendMessage(request))
-    {
-        return false;
-    }
-
-    Protocol::Message response = waitForResponse(Protocol::MessageType::RESPONSE_SUCCESS);
+    Protocol::Message response = sendRequest(request);
     return response.type == Protocol::MessageType::RESPONSE_SUCCESS;
 }
 
-bool NetworkClient::manageProductQuantity(const std::string &productName, int newQuantity)
+bool NetworkClient::manageProductQuantity(const std::string &productId, int newQuantity)
 {
     Protocol::Message request(Protocol::MessageType::PRODUCT_MANAGE_QUANTITY, sessionId);
-    request.setData("productName", productName);
+    request.setData("productId", productId);
     request.setData("newQuantity", std::to_string(newQuantity));
 
-    if (!sendMessage(request))
-    {
-        return false;
-    }
-
-    Protocol::Message response = waitForResponse(Protocol::MessageType::RESPONSE_SUCCESS);
+    Protocol::Message response = sendRequest(request);
     return response.type == Protocol::MessageType::RESPONSE_SUCCESS;
 }
 
-bool NetworkClient::manageProductDiscount(const std::string &productName, double newDiscount)
+bool NetworkClient::manageProductDiscount(const std::string &productId, double newDiscount)
 {
     Protocol::Message request(Protocol::MessageType::PRODUCT_MANAGE_DISCOUNT, sessionId);
-    request.setData("productName", productName);
+    request.setData("productId", productId);
     request.setData("newDiscount", std::to_string(newDiscount));
 
-    if (!sendMessage(request))
-    {
-        return false;
-    }
-
-    Protocol::Message response = waitForResponse(Protocol::MessageType::RESPONSE_SUCCESS);
+    Protocol::Message response = sendRequest(request);
     return response.type == Protocol::MessageType::RESPONSE_SUCCESS;
 }
 
@@ -668,82 +1016,88 @@ bool NetworkClient::applyCategoryDiscount(const std::string &category, double di
     request.setData("category", category);
     request.setData("discount", std::to_string(discount));
 
-    if (!sendMessage(request))
-    {
-        return false;
-    }
-
-    Protocol::Message response = waitForResponse(Protocol::MessageType::RESPONSE_SUCCESS);
+    Protocol::Message response = sendRequest(request);
     return response.type == Protocol::MessageType::RESPONSE_SUCCESS;
 }
 
 // 库存锁定操作实现
-bool NetworkClient::lockInventory(const std::string &productId, int quantity)
+bool NetworkClient::lockInventory(const std::string &productId, int quantity, const std::string &sellerUsername, std::string &reservationId)
 {
     Protocol::Message request(Protocol::MessageType::INVENTORY_LOCK, sessionId);
     request.setData("productId", productId);
     request.setData("quantity", std::to_string(quantity));
-
-    if (!sendMessage(request))
+    if (!sellerUsername.empty())
     {
-        return false;
+        request.setData("sellerUsername", sellerUsername);
     }
 
-    Protocol::Message response = waitForResponse(Protocol::MessageType::RESPONSE_SUCCESS);
-    return response.type == Protocol::MessageType::RESPONSE_SUCCESS;
+    Protocol::Message response = sendRequest(request);
+    if (response.type == Protocol::MessageType::RESPONSE_SUCCESS)
+    {
+        reservationId = response.getData("reservationId");
+        return true;
+    }
+    return false;
 }
 
-bool NetworkClient::unlockInventory(const std::string &productId, int quantity)
+bool NetworkClient::unlockInventory(const std::string &productId, int quantity, const std::string &sellerUsername)
 {
     Protocol::Message request(Protocol::MessageType::INVENTORY_UNLOCK, sessionId);
     request.setData("productId", productId);
     request.setData("quantity", std::to_string(quantity));
-
-    if (!sendMessage(request))
+    if (!sellerUsername.empty())
     {
-        return false;
+        request.setData("sellerUsername", sellerUsername);
     }
 
-    Protocol::Message response = waitForResponse(Protocol::MessageType::RESPONSE_SUCCESS);
+    Protocol::Message response = sendRequest(request);
     return response.type == Protocol::MessageType::RESPONSE_SUCCESS;
 }
 
-bool NetworkClient::lockCartInventory(const std::vector<Protocol::CartItemData> &items)
+bool NetworkClient::lockCartInventory(const std::vector<Protocol::CartItemData> &items, std::string &reservationId)
 {
     Protocol::Message request(Protocol::MessageType::INVENTORY_LOCK, sessionId);
-    request.setData("itemCount", std::to_string(items.size()));
-
-    for (size_t i = 0; i < items.size(); ++i)
+    std::vector<std::string> &productIds = request.addList("productIds");
+    std::vector<std::string> &quantities = request.addList("quantities");
+    std::vector<std::string> &sellers = request.addList("sellers");
+    for (const auto &item : items)
     {
-        request.setData("productId_" + std::to_string(i), items[i].productId);
-        request.setData("quantity_" + std::to_string(i), std::to_string(items[i].quantity));
+        productIds.push_back(item.productId);
+        quantities.push_back(std::to_string(item.quantity));
+        sellers.push_back(item.sellerUsername);
     }
 
-    if (!sendMessage(request))
+    Protocol::Message response = sendRequest(request);
+    if (response.type == Protocol::MessageType::RESPONSE_SUCCESS)
     {
-        return false;
+        reservationId = response.getData("reservationId");
+        return true;
     }
-
-    Protocol::Message response = waitForResponse(Protocol::MessageType::RESPONSE_SUCCESS);
-    return response.type == Protocol::MessageType::RESPONSE_SUCCESS;
+    return false;
 }
 
 bool NetworkClient::unlockCartInventory(const std::vector<Protocol::CartItemData> &items)
 {
     Protocol::Message request(Protocol::MessageType::INVENTORY_UNLOCK, sessionId);
-    request.setData("itemCount", std::to_string(items.size()));
-
-    for (size_t i = 0; i < items.size(); ++i)
+    std::vector<std::string> &productIds = request.addList("productIds");
+    std::vector<std::string> &quantities = request.addList("quantities");
+    std::vector<std::string> &sellers = request.addList("sellers");
+    for (const auto &item : items)
     {
-        request.setData("productId_" + std::to_string(i), items[i].productId);
-        request.setData("quantity_" + std::to_string(i), std::to_string(items[i].quantity));
+        productIds.push_back(item.productId);
+        quantities.push_back(std::to_string(item.quantity));
+        sellers.push_back(item.sellerUsername);
     }
 
-    if (!sendMessage(request))
-    {
-        return false;
-    }
+    Protocol::Message response = sendRequest(request);
+    return response.type == Protocol::MessageType::RESPONSE_SUCCESS;
+}
+
+bool NetworkClient::releaseReservation(const std::string &reservationId)
+{
+    Protocol::Message request(Protocol::MessageType::INVENTORY_UNLOCK, sessionId);
+    request.setData("reservationId", reservationId);
 
-    Protocol::Message response = waitForResponse(Protocol::MessageType::RESPONSE_SUCCESS);
+    Protocol::Message response = sendRequest(request);
     return response.type == Protocol::MessageType::RESPONSE_SUCCESS;
 }
@@ -2,8 +2,7 @@
 #define NETWORK_CLIENT_H
 
 #include "../network/protocol.h"
-#include <winsock2.h>
-#include <ws2tcpip.h>
+#include "socket_compat.h"
 #include <string>
 #include <functional>
 #include <thread>
@@ -11,8 +10,55 @@
 #include <condition_variable>
 #include <queue>
 #include <atomic>
+#include <map>
+#include <memory>
+#include <future>
 
-#pragma comment(lib, "ws2_32.lib")
+// 客户端持有的商品列表对应的服务端目录标识与版本，用于增量同步
+struct CatalogSyncState
+{
+    long long epoch = 0;
+    long long version = 0;
+    bool valid = false; // 尚未同步过（或已失效）时为 false，下次同步取全量
+};
+
+// 分页浏览商品的查询条件：keyword 为空时浏览整个目录；sort 为空时按目录顺序。
+// filtered 为 true 时由服务端按筛选条件过滤（PRODUCT_FILTER），响应附带各维度计数
+struct ProductPageQuery
+{
+    std::string keyword;
+    std::string sort; // price, discount, stock, name, seller
+    bool descending = false;
+    int limit = 50;
+
+    bool filtered = false;
+    std::string category;   // 为空表示不限
+    double minPrice = -1.0; // 小于 0 表示不限
+    double maxPrice = -1.0;
+    bool inStockOnly = false;
+    bool discountedOnly = false;
+};
+
+// 筛选维度中一个取值及满足其他条件时该取值下的商品数
+struct ProductFacetCount
+{
+    std::string value;
+    long long count = 0;
+};
+
+// 一页商品；取下一页时把 nextCursor 连同原查询条件一起传回，为空表示已是最后一页
+struct ProductPage
+{
+    std::vector<Protocol::ProductData> products;
+    long long total = 0;
+    std::string nextCursor;
+
+    // 筛选查询的各维度计数
+    std::vector<ProductFacetCount> categoryCounts;
+    std::vector<ProductFacetCount> priceRangeCounts;
+    long long inStockCount = 0;
+    long long discountedCount = 0;
+};
 
 class NetworkClient
 {
@@ -21,6 +67,7 @@ private:
     std::string serverAddress;
     int serverPort;
     std::string sessionId;
+    std::atomic<Protocol::WireFormat> wireFormat; // 发送时使用的线上格式（连接后协商）
 
     // 消息处理
     std::thread receiveThread;
@@ -32,11 +79,18 @@ private:
     mutable std::mutex queueMutex;
     std::condition_variable queueCondition;
 
+    // 在途请求表：请求ID -> 等待该响应的 promise，允许同一连接上同时有多个请求
+    std::map<uint32_t, std::shared_ptr<std::promise<Protocol::Message>>> pendingRequests;
+    mutable std::mutex pendingMutex;
+    std::atomic<uint32_t> nextRequestId;
+    std::mutex sendMutex;
+
     // 回调函数
     std::function<void(const Protocol::Message &)> messageCallback;
 
     // 内部方法
     void receiveLoop();
+    void failPendingRequests();
     bool sendRawData(const std::string &data);
     std::string receiveRawData();
 
@@ -48,9 +102,19 @@ public:
     bool connect();
     void disconnect();
     bool isConnectionActive() const { return isConnected.load(); }
+    // 与服务器协商线上格式，失败（如旧版服务器）时保持文本格式
+    bool negotiateWireFormat(Protocol::WireFormat preferred);
+    Protocol::WireFormat getWireFormat() const { return wireFormat.load(); }
 
     // 消息发送
-    bool sendMessage(const Protocol::Message &message); // 消息接收
+    bool sendMessage(const Protocol::Message &message);
+
+    // 请求/响应：为请求分配 requestId 并登记到在途请求表，响应按 requestId 匹配
+    std::future<Protocol::Message> sendRequestAsync(Protocol::Message &request);
+    Protocol::Message sendRequest(Protocol::Message &request, int timeoutMs = 2000); // 超时或断开返回空消息
+    size_t getPendingRequestCount() const;
+
+    // 消息接收（无请求ID的推送消息）
     Protocol::Message waitForResponse(Protocol::MessageType expectedType, int timeoutMs = 2000);
     Protocol::Message waitForResponseBlocking(Protocol::MessageType expectedType); // 无超时限制版本
     bool hasResponse() const;
@@ -73,6 +137,20 @@ public:
     // 商品操作
     bool getAllProducts(std::vector<Protocol::ProductData> &products);
     bool searchProducts(const std::string &keyword, std::vector<Protocol::ProductData> &products);
+    // 由服务端排序并分页；cursor 为空取第一页。游标过期（快照已淘汰）时返回 false，应从第一页重新加载
+    bool getProductPage(const ProductPageQuery &query, const std::string &cursor, ProductPage &page);
+    // 搜索联想：异步发送，不阻塞界面；响应到达后用 parseSuggestions 取出联想的商品名称
+    std::future<Protocol::Message> requestSuggestions(const std::string &prefix, int limit = 8);
+    static bool parseSuggestions(const Protocol::Message &response, std::vector<std::string> &suggestions);
+    // 增量同步：只下载 state 版本之后变化的商品并合并到 products，服务端也可能直接返回全量
+    bool syncProducts(std::vector<Protocol::ProductData> &products, CatalogSyncState &state);
+
+    // 商品变化订阅：订阅后服务端以 PRODUCT_CHANGED 消息推送变化（通过 getNextResponse 取出）
+    bool subscribeCatalog(const CatalogSyncState &state);
+    bool subscribeProducts(const std::vector<std::string> &productIds);
+    bool unsubscribeProducts(const std::vector<std::string> &productIds); // 为空时取消全部订阅
+    // 把一条推送合并到本地商品列表；返回 false 表示推送与本地版本衔接不上，应调用 syncProducts 补齐
+    static bool applyProductPush(const Protocol::Message &push, std::vector<Protocol::ProductData> &products, CatalogSyncState &state);
     bool getProductById(const std::string &productId, Protocol::ProductData &product);
     bool addProduct(const Protocol::ProductData &product);
     bool updateProduct(const Protocol::ProductData &product);
@@ -81,27 +159,32 @@ public:
 
     // 购物车操作
     bool getCart(std::vector<Protocol::CartItemData> &cartItems);
-    bool addToCart(const std::string &productId, int quantity);
+    // sellerUsername 可为空；多个商家有同名商品时须指定，否则服务端拒绝请求
+    bool addToCart(const std::string &productId, int quantity, const std::string &sellerUsername = "");
     bool updateCartItem(const std::string &productId, int newQuantity);
     bool removeFromCart(const std::string &productId);
     bool clearCart(); // 订单操作
-    bool createOrder(const std::vector<Protocol::CartItemData> &items, std::string &orderId);
-    bool createDirectOrder(const std::string &productId, int quantity, std::string &orderId);
+    // reservationId 为下单前锁定库存得到的预留ID：订单结算时消耗该预留，未用完的部分由服务端解锁
+    bool createOrder(const std::vector<Protocol::CartItemData> &items, std::string &orderId, const std::string &reservationId = "");
+    bool createDirectOrder(const std::string &productId, int quantity, std::string &orderId, const std::string &sellerUsername = "",
+                           const std::string &reservationId = "");
     bool getUserOrders(std::vector<Protocol::OrderData> &orders);
     bool getOrderById(const std::string &orderId, Protocol::OrderData &order);
     bool updateOrderStatus(const std::string &orderId, Protocol::OrderStatus status);
     bool getAllOrders(std::vector<Protocol::OrderData> &orders); // 管理员功能
 
     // 库存锁定操作
-    bool lockInventory(const std::string &productId, int quantity);
-    bool unlockInventory(const std::string &productId, int quantity);
-    bool lockCartInventory(const std::vector<Protocol::CartItemData> &items);
+    // 锁定成功时 reservationId 为服务端生成的预留ID，下单时交给订单或凭它解锁
+    bool lockInventory(const std::string &productId, int quantity, const std::string &sellerUsername, std::string &reservationId);
+    bool unlockInventory(const std::string &productId, int quantity, const std::string &sellerUsername = "");
+    bool lockCartInventory(const std::vector<Protocol::CartItemData> &items, std::string &reservationId);
     bool unlockCartInventory(const std::vector<Protocol::CartItemData> &items);
+    bool releaseReservation(const std::string &reservationId);
 
     // 商家管理操作
-    bool manageProductPrice(const std::string &productName, double newPrice);
-    bool manageProductQuantity(const std::string &productName, int newQuantity);
-    bool manageProductDiscount(const std::string &productName, double newDiscount);
+    bool manageProductPrice(const std::string &productId, double newPrice);
+    bool manageProductQuantity(const std::string &productId, int newQuantity);
+    bool manageProductDiscount(const std::string &productId, double newDiscount);
     bool applyCategoryDiscount(const std::string &category, double discount);
 };
 
@@ -0,0 +1,331 @@
+#include "event_loop.h"
+#include "server.h"
+#include <iostream>
+
+#ifdef __linux__
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#else
+#ifndef _WIN32
+#include <poll.h>
+#endif
+#endif
+
+namespace
+{
+    const int kMaxEventsPerWait = 256;
+    const int kPollTimeoutMs = 50;
+}
+
+EventLoop::EventLoop(int index)
+    : loopIndex(index), server(nullptr), running(false), sessionCount(0)
+#ifdef __linux__
+      ,
+      epollFd(-1), wakeupFd(-1)
+#endif
+{
+}
+
+EventLoop::~EventLoop()
+{
+    stop();
+}
+
+bool EventLoop::start(NetworkServer *owner)
+{
+    if (running.load())
+    {
+        return true;
+    }
+    server = owner;
+
+#ifdef __linux__
+    epollFd = epoll_create1(EPOLL_CLOEXEC);
+    if (epollFd < 0)
+    {
+        std::cerr << "epoll_create1 失败: " << errno << std::endl;
+        return false;
+    }
+
+    wakeupFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (wakeupFd < 0)
+    {
+        std::cerr << "eventfd 创建失败: " << errno << std::endl;
+        ::close(epollFd);
+        epollFd = -1;
+        return false;
+    }
+
+    epoll_event ev{};
+    ev.events = EPOLLIN;
+    ev.data.fd = wakeupFd;
+    epoll_ctl(epollFd, EPOLL_CTL_ADD, wakeupFd, &ev);
+#endif
+
+    running.store(true);
+    loopThread = std::thread(&EventLoop::loop, this);
+    return true;
+}
+
+void EventLoop::stop()
+{
+    if (!running.exchange(false))
+    {
+        return;
+    }
+
+    wakeup();
+    if (loopThread.joinable())
+    {
+        loopThread.join();
+    }
+
+#ifdef __linux__
+    if (wakeupFd >= 0)
+    {
+        ::close(wakeupFd);
+        wakeupFd = -1;
+    }
+    if (epollFd >= 0)
+    {
+        ::close(epollFd);
+        epollFd = -1;
+    }
+#endif
+}
+
+void EventLoop::addSession(std::shared_ptr<ClientSession> session)
+{
+    {
+        std::lock_guard<std::mutex> lock(pendingMutex);
+        pendingSessions.push_back(std::move(session));
+    }
+    wakeup();
+}
+
+void EventLoop::setWriteInterest(ClientSession *session, bool enable)
+{
+#ifdef __linux__
+    // epoll_ctl 本身是线程安全的，调用方持有会话的发送锁以保证开关顺序
+    epoll_event ev{};
+    ev.events = EPOLLIN | EPOLLRDHUP;
+    if (enable)
+    {
+        ev.events |= EPOLLOUT;
+    }
+    ev.data.fd = session->getSocket();
+    epoll_ctl(epollFd, EPOLL_CTL_MOD, session->getSocket(), &ev);
+#else
+    // poll 后端每轮都会根据 hasPendingOutput() 重新计算关注事件
+    (void)session;
+    (void)enable;
+#endif
+}
+
+void EventLoop::wakeup()
+{
+#ifdef __linux__
+    if (wakeupFd >= 0)
+    {
+        uint64_t one = 1;
+        ssize_t ignored = ::write(wakeupFd, &one, sizeof(one));
+        (void)ignored;
+    }
+#endif
+}
+
+void EventLoop::adoptPendingSessions()
+{
+    std::vector<std::shared_ptr<ClientSession>> adopted;
+    {
+        std::lock_guard<std::mutex> lock(pendingMutex);
+        adopted.swap(pendingSessions);
+    }
+
+    for (auto &session : adopted)
+    {
+        SOCKET fd = session->getSocket();
+        if (fd == INVALID_SOCKET)
+        {
+            continue;
+        }
+
+#ifdef __linux__
+        epoll_event ev{};
+        ev.events = EPOLLIN | EPOLLRDHUP;
+        ev.data.fd = fd;
+        if (epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &ev) != 0)
+        {
+            std::cerr << "epoll 注册客户端套接字失败: " << errno << std::endl;
+            session->stopSession();
+            server->onSessionClosed(session);
+            continue;
+        }
+#endif
+        sessions[fd] = session;
+        session->attachToLoop(this);
+    }
+    sessionCount.store(sessions.size());
+}
+
+void EventLoop::handleReadable(const std::shared_ptr<ClientSession> &session)
+{
+    if (!session->onReadable(server))
+    {
+        closeSession(session);
+    }
+}
+
+void EventLoop::handleWritable(const std::shared_ptr<ClientSession> &session)
+{
+    if (!session->onWritable())
+    {
+        closeSession(session);
+    }
+}
+
+void EventLoop::closeSession(const std::shared_ptr<ClientSession> &session)
+{
+    SOCKET fd = session->getSocket();
+    if (fd != INVALID_SOCKET)
+    {
+#ifdef __linux__
+        epoll_ctl(epollFd, EPOLL_CTL_DEL, fd, nullptr);
+#endif
+        sessions.erase(fd);
+    }
+    sessionCount.store(sessions.size());
+
+    // 先从表中移除再关闭套接字，避免文件描述符被复用后误删新连接
+    session->stopSession();
+    server->onSessionClosed(session);
+}
+
+void EventLoop::closeAllSessions()
+{
+    adoptPendingSessions();
+    std::vector<std::shared_ptr<ClientSession>> remaining;
+    remaining.reserve(sessions.size());
+    for (auto &pair : sessions)
+    {
+        remaining.push_back(pair.second);
+    }
+    for (auto &session : remaining)
+    {
+        closeSession(session);
+    }
+}
+
+void EventLoop::loop()
+{
+#ifdef __linux__
+    std::vector<epoll_event> events(kMaxEventsPerWait);
+
+    while (running.load())
+    {
+        int count = epoll_wait(epollFd, events.data(), kMaxEventsPerWait, -1);
+        if (count < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            std::cerr << "epoll_wait 失败: " << errno << std::endl;
+            break;
+        }
+
+        for (int i = 0; i < count; ++i)
+        {
+            int fd = events[i].data.fd;
+            if (fd == wakeupFd)
+            {
+                uint64_t value;
+                while (::read(wakeupFd, &value, sizeof(value)) > 0)
+                {
+                }
+                adoptPendingSessions();
+                continue;
+            }
+
+            auto it = sessions.find(fd);
+            if (it == sessions.end())
+            {
+                continue;
+            }
+            std::shared_ptr<ClientSession> session = it->second;
+
+            uint32_t flags = events[i].events;
+            if (flags & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR))
+            {
+                handleReadable(session);
+                if (session->getSocket() == INVALID_SOCKET)
+                {
+                    continue;
+                }
+            }
+            if (flags & EPOLLOUT)
+            {
+                handleWritable(session);
+            }
+        }
+    }
+#else
+    std::vector<pollfd> fds;
+    std::vector<std::shared_ptr<ClientSession>> polled;
+
+    while (running.load())
+    {
+        adoptPendingSessions();
+
+        fds.clear();
+        polled.clear();
+        for (auto &pair : sessions)
+        {
+            pollfd pfd{};
+            pfd.fd = pair.first;
+            pfd.events = POLLIN;
+            if (pair.second->hasPendingOutput())
+            {
+                pfd.events |= POLLOUT;
+            }
+            fds.push_back(pfd);
+            polled.push_back(pair.second);
+        }
+
+        if (fds.empty())
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(kPollTimeoutMs));
+            continue;
+        }
+
+#ifdef _WIN32
+        int count = WSAPoll(fds.data(), static_cast<ULONG>(fds.size()), kPollTimeoutMs);
+#else
+        int count = ::poll(fds.data(), fds.size(), kPollTimeoutMs);
+#endif
+        if (count <= 0)
+        {
+            continue;
+        }
+
+        for (size_t i = 0; i < fds.size(); ++i)
+        {
+            const std::shared_ptr<ClientSession> &session = polled[i];
+            if (fds[i].revents & (POLLIN | POLLHUP | POLLERR))
+            {
+                handleReadable(session);
+                if (session->getSocket() == INVALID_SOCKET)
+                {
+                    continue;
+                }
+            }
+            if (fds[i].revents & POLLOUT)
+            {
+                handleWritable(session);
+            }
+        }
+    }
+#endif
+
+    closeAllSessions();
+}
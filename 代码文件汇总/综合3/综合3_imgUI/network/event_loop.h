@@ -0,0 +1,63 @@
+#ifndef EVENT_LOOP_H
+#define EVENT_LOOP_H
+
+#include "socket_compat.h"
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <vector>
+#include <unordered_map>
+#include <memory>
+
+// 前向声明
+class ClientSession;
+class NetworkServer;
+
+// I/O 事件循环：每个实例由一个固定线程驱动，负责一组非阻塞客户端套接字。
+// Linux 下使用 epoll，其他平台回退到 poll/WSAPoll。
+class EventLoop
+{
+private:
+    int loopIndex;
+    NetworkServer *server;
+    std::thread loopThread;
+    std::atomic<bool> running;
+
+    // 其他线程投递的新会话，由事件循环线程接管
+    std::vector<std::shared_ptr<ClientSession>> pendingSessions;
+    std::mutex pendingMutex;
+
+    // 仅由事件循环线程访问
+    std::unordered_map<SOCKET, std::shared_ptr<ClientSession>> sessions;
+    std::atomic<size_t> sessionCount;
+
+#ifdef __linux__
+    int epollFd;
+    int wakeupFd;
+#endif
+
+    void loop();
+    void adoptPendingSessions();
+    void handleReadable(const std::shared_ptr<ClientSession> &session);
+    void handleWritable(const std::shared_ptr<ClientSession> &session);
+    void closeSession(const std::shared_ptr<ClientSession> &session);
+    void closeAllSessions();
+    void wakeup();
+
+public:
+    explicit EventLoop(int index);
+    ~EventLoop();
+
+    bool start(NetworkServer *owner);
+    void stop();
+
+    // 线程安全：把新连接交给本循环
+    void addSession(std::shared_ptr<ClientSession> session);
+    // 线程安全：输出缓冲区有积压时关注可写事件，清空后取消关注
+    void setWriteInterest(ClientSession *session, bool enable);
+
+    size_t getSessionCount() const { return sessionCount.load(); }
+    int getIndex() const { return loopIndex; }
+};
+
+#endif // EVENT_LOOP_H
@@ -0,0 +1,171 @@
+#include "handler_pool.h"
+#include <iostream>
+#include <algorithm>
+
+HandlerPool::HandlerPool(size_t workers, size_t capacity)
+    : workerCount(std::max<size_t>(1, workers)), capacity(std::max<size_t>(1, capacity)),
+      stopping(false), started(false),
+      queueDepth(0), maxQueueDepth(0), busyWorkers(0),
+      submittedCount(0), completedCount(0), rejectedCount(0),
+      totalWaitNs(0), maxWaitNs(0), totalRunNs(0)
+{
+}
+
+HandlerPool::~HandlerPool()
+{
+    stop();
+}
+
+void HandlerPool::start()
+{
+    std::lock_guard<std::mutex> lock(poolMutex);
+    if (started)
+    {
+        return;
+    }
+    started = true;
+    stopping = false;
+    for (size_t i = 0; i < workerCount; ++i)
+    {
+        workers.emplace_back(&HandlerPool::workerLoop, this);
+    }
+}
+
+void HandlerPool::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(poolMutex);
+        if (!started)
+        {
+            return;
+        }
+        stopping = true;
+    }
+    readyCondition.notify_all();
+
+    for (auto &worker : workers)
+    {
+        if (worker.joinable())
+        {
+            worker.join();
+        }
+    }
+    workers.clear();
+
+    std::lock_guard<std::mutex> lock(poolMutex);
+    started = false;
+}
+
+bool HandlerPool::submit(const std::string &key, std::function<void()> task)
+{
+    {
+        std::lock_guard<std::mutex> lock(poolMutex);
+        if (stopping || !started || queueDepth >= capacity)
+        {
+            rejectedCount++;
+            return false;
+        }
+
+        Strand &strand = strands[key];
+        strand.tasks.push_back(Task{std::move(task), Clock::now()});
+        queueDepth++;
+        submittedCount++;
+        maxQueueDepth = std::max(maxQueueDepth, queueDepth);
+
+        if (strand.scheduled)
+        {
+            // 该键已在就绪队列中或正在执行，任务会在前一个完成后被取出
+            return true;
+        }
+        strand.scheduled = true;
+        readyKeys.push_back(key);
+    }
+    readyCondition.notify_one();
+    return true;
+}
+
+void HandlerPool::workerLoop()
+{
+    std::unique_lock<std::mutex> lock(poolMutex);
+    while (true)
+    {
+        readyCondition.wait(lock, [this]
+                            { return !readyKeys.empty() || stopping; });
+        if (readyKeys.empty())
+        {
+            // 只有在停止且队列已清空时才退出
+            break;
+        }
+
+        std::string key = std::move(readyKeys.front());
+        readyKeys.pop_front();
+
+        auto strandIt = strands.find(key);
+        Task task = std::move(strandIt->second.tasks.front());
+        strandIt->second.tasks.pop_front();
+        queueDepth--;
+        busyWorkers++;
+
+        Clock::time_point startedAt = Clock::now();
+        uint64_t waitNs = std::chrono::duration_cast<std::chrono::nanoseconds>(startedAt - task.enqueuedAt).count();
+        totalWaitNs += waitNs;
+        maxWaitNs = std::max(maxWaitNs, waitNs);
+
+        lock.unlock();
+        try
+        {
+            task.fn();
+        }
+        catch (const std::exception &e)
+        {
+            std::cerr << "处理任务时发生异常 (键: " << key << "): " << e.what() << std::endl;
+        }
+        catch (...)
+        {
+            std::cerr << "处理任务时发生未知异常 (键: " << key << ")" << std::endl;
+        }
+        uint64_t runNs = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - startedAt).count();
+        lock.lock();
+
+        busyWorkers--;
+        completedCount++;
+        totalRunNs += runNs;
+
+        // 同一个键还有任务则重新排到就绪队列末尾，保证不同键之间的公平性
+        strandIt = strands.find(key);
+        if (strandIt->second.tasks.empty())
+        {
+            strands.erase(strandIt);
+        }
+        else
+        {
+            readyKeys.push_back(std::move(key));
+            readyCondition.notify_one();
+        }
+    }
+}
+
+HandlerPool::Stats HandlerPool::getStats() const
+{
+    std::lock_guard<std::mutex> lock(poolMutex);
+    Stats stats;
+    stats.workerCount = workerCount;
+    stats.capacity = capacity;
+    stats.queueDepth = queueDepth;
+    stats.maxQueueDepth = maxQueueDepth;
+    stats.activeKeys = strands.size();
+    stats.busyWorkers = busyWorkers;
+    stats.submitted = submittedCount;
+    stats.completed = completedCount;
+    stats.rejected = rejectedCount;
+    if (completedCount + busyWorkers > 0)
+    {
+        stats.avgWaitMs = totalWaitNs / 1e6 / static_cast<double>(completedCount + busyWorkers);
+    }
+    if (completedCount > 0)
+    {
+        stats.avgRunMs = totalRunNs / 1e6 / static_cast<double>(completedCount);
+    }
+    stats.maxWaitMs = maxWaitNs / 1e6;
+    return stats;
+}
@@ -0,0 +1,90 @@
+#ifndef HANDLER_POOL_H
+#define HANDLER_POOL_H
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <unordered_map>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+// 业务处理线程池：
+// - 同一排序键（通常是用户名）的任务按提交顺序串行执行
+// - 不同键的任务由多个工作线程并行执行
+// - 排队任务总数有上限，超出时 submit 返回 false，由调用方回复"服务器繁忙"
+class HandlerPool
+{
+public:
+    struct Stats
+    {
+        size_t workerCount = 0;
+        size_t capacity = 0;
+        size_t queueDepth = 0;    // 当前排队（尚未开始执行）的任务数
+        size_t maxQueueDepth = 0; // 历史峰值
+        size_t activeKeys = 0;    // 当前有排队或执行中任务的键数
+        size_t busyWorkers = 0;   // 正在执行任务的工作线程数
+        uint64_t submitted = 0;
+        uint64_t completed = 0;
+        uint64_t rejected = 0;
+        double avgWaitMs = 0.0; // 从入队到开始执行的平均等待时间
+        double maxWaitMs = 0.0;
+        double avgRunMs = 0.0; // 任务平均执行时间
+    };
+
+    HandlerPool(size_t workers, size_t capacity);
+    ~HandlerPool();
+
+    void start();
+    // 停止接收新任务，等待已排队任务执行完毕后退出
+    void stop();
+
+    bool submit(const std::string &key, std::function<void()> task);
+    Stats getStats() const;
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Task
+    {
+        std::function<void()> fn;
+        Clock::time_point enqueuedAt;
+    };
+
+    // 每个键一条串行队列；键在就绪队列中或正在执行时不会被其他线程重复调度
+    struct Strand
+    {
+        std::deque<Task> tasks;
+        bool scheduled = false;
+    };
+
+    size_t workerCount;
+    size_t capacity;
+    std::vector<std::thread> workers;
+
+    mutable std::mutex poolMutex;
+    std::condition_variable readyCondition;
+    std::unordered_map<std::string, Strand> strands;
+    std::deque<std::string> readyKeys;
+    bool stopping;
+    bool started;
+
+    // 统计数据（受 poolMutex 保护）
+    size_t queueDepth;
+    size_t maxQueueDepth;
+    size_t busyWorkers;
+    uint64_t submittedCount;
+    uint64_t completedCount;
+    uint64_t rejectedCount;
+    uint64_t totalWaitNs;
+    uint64_t maxWaitNs;
+    uint64_t totalRunNs;
+
+    void workerLoop();
+};
+
+#endif // HANDLER_POOL_H
@@ -1,136 +1,440 @@
 #include "protocol.h"
+#include "wire.h"
 #include <sstream>
 #include <iostream>
+#include <charconv>
+#include <algorithm>
 
 namespace Protocol
 {
 
+    // FieldTable 实现
+    void FieldTable::set(const std::string &key, const std::string &value)
+    {
+        auto it = std::lower_bound(fields.begin(), fields.end(), key,
+                                   [](const Field &field, const std::string &k)
+                                   { return field.first < k; });
+        if (it != fields.end() && it->first == key)
+        {
+            it->second = value;
+        }
+        else
+        {
+            fields.insert(it, Field(key, value));
+        }
+    }
+
+    const std::string *FieldTable::find(std::string_view key) const
+    {
+        auto it = std::lower_bound(fields.begin(), fields.end(), key,
+                                   [](const Field &field, std::string_view k)
+                                   { return std::string_view(field.first) < k; });
+        return (it != fields.end() && it->first == key) ? &it->second : nullptr;
+    }
+
+    std::vector<std::string> &FieldTable::list(const std::string &name)
+    {
+        for (auto &entry : lists)
+        {
+            if (entry.first == name)
+            {
+                return entry.second;
+            }
+        }
+        lists.emplace_back(name, std::vector<std::string>());
+        return lists.back().second;
+    }
+
+    const std::vector<std::string> *FieldTable::findList(std::string_view name) const
+    {
+        for (const auto &entry : lists)
+        {
+            if (entry.first == name)
+            {
+                return &entry.second;
+            }
+        }
+        return nullptr;
+    }
+
+    const std::vector<std::string> &Message::getList(const std::string &name) const
+    {
+        static const std::vector<std::string> empty;
+        const std::vector<std::string> *list = data.findList(name);
+        return list ? *list : empty;
+    }
+
     // Message序列化实现
+    // 格式：类型|会话ID|请求ID|字段数|key=value|...|列表数|列表名|记录数|长度:记录|...
+    // 记录带长度前缀，内容中可以出现任意分隔符
+    namespace
+    {
+        void appendTextBody(const FieldTable &data, std::string &out)
+        {
+            // 序列化数据字段
+            out.append(std::to_string(data.size())).append("|");
+            for (const auto &pair : data)
+            {
+                out.append(pair.first).append("=").append(pair.second).append("|");
+            }
+
+            // 序列化记录列表
+            const auto &lists = data.getLists();
+            out.append(std::to_string(lists.size())).append("|");
+            for (const auto &list : lists)
+            {
+                out.append(list.first).append("|");
+                out.append(std::to_string(list.second.size())).append("|");
+                for (const auto &item : list.second)
+                {
+                    out.append(std::to_string(item.size())).append(":").append(item).append("|");
+                }
+            }
+        }
+
+        void writeBinaryBody(const FieldTable &data, Wire::Writer &writer)
+        {
+            writer.writeVarint(data.size());
+            for (const auto &pair : data)
+            {
+                writer.writeString(pair.first);
+                int64_t intValue;
+                if (Wire::parseCanonicalInt(pair.second, intValue))
+                {
+                    writer.writeByte(static_cast<uint8_t>(Wire::FieldType::INT));
+                    writer.writeSigned(intValue);
+                }
+                else
+                {
+                    writer.writeByte(static_cast<uint8_t>(Wire::FieldType::STRING));
+                    writer.writeString(pair.second);
+                }
+            }
+
+            writer.writeVarint(data.getLists().size());
+            for (const auto &list : data.getLists())
+            {
+                writer.writeString(list.first);
+                writer.writeVarint(list.second.size());
+                for (const auto &item : list.second)
+                {
+                    writer.writeString(item);
+                }
+            }
+        }
+
+        size_t estimateBodySize(const FieldTable &data)
+        {
+            size_t estimate = 8;
+            for (const auto &pair : data)
+            {
+                estimate += pair.first.size() + pair.second.size() + 4;
+            }
+            for (const auto &list : data.getLists())
+            {
+                estimate += list.first.size() + 8;
+                for (const auto &item : list.second)
+                {
+                    estimate += item.size() + 6;
+                }
+            }
+            return estimate;
+        }
+    }
+
     std::string Message::serialize() const
     {
-        std::ostringstream oss;
-        oss << static_cast<int>(type) << "|" << sessionId << "|";
+        std::string out = encodeHeader(WireFormat::TEXT);
+        out.reserve(out.size() + estimateBodySize(data));
+        appendTextBody(data, out);
+        return out;
+    }
 
-        // 序列化数据字段
-        oss << data.size() << "|";
-        for (const auto &pair : data)
+    std::string Message::encodeHeader(WireFormat format) const
+    {
+        std::string out;
+        if (format == WireFormat::BINARY)
         {
-            oss << pair.first << "=" << pair.second << "|";
+            Wire::Writer writer(out);
+            writer.writeByte(Wire::kMessageMagic);
+            writer.writeVarint(static_cast<uint32_t>(static_cast<int>(type)));
+            writer.writeVarint(requestId);
+            writer.writeString(sessionId);
+            return out;
         }
+        out.append(std::to_string(static_cast<int>(type))).append("|");
+        out.append(sessionId).append("|");
+        out.append(std::to_string(requestId)).append("|");
+        return out;
+    }
 
-        return oss.str();
+    std::string Message::encodeBody(WireFormat format) const
+    {
+        std::string out;
+        out.reserve(estimateBodySize(data));
+        if (format == WireFormat::BINARY)
+        {
+            Wire::Writer writer(out);
+            writeBinaryBody(data, writer);
+        }
+        else
+        {
+            appendTextBody(data, out);
+        }
+        return out;
     }
-    Message Message::deserialize(const std::string &str)
+
+    namespace
     {
-        Message msg;
-        size_t pos = 0;
-        std::string token;
+        // 帧头：消息类型、请求ID、会话ID
+        struct FrameHeader
+        {
+            MessageType type = MessageType::HEARTBEAT;
+            uint32_t requestId = 0;
+            std::string_view sessionId;
+        };
 
-        try
+        template <typename T>
+        bool parseNumber(std::string_view text, T &value)
+        {
+            const char *last = text.data() + text.size();
+            auto result = std::from_chars(text.data(), last, value);
+            return result.ec == std::errc() && result.ptr == last;
+        }
+
+        // 文本格式解析：键值视图直接指向 str，不做任何拷贝。
+        // 与旧实现一样宽松：缺失的部分保持默认值，数字格式错误时停止解析并返回 false。
+        bool parseTextFrame(std::string_view str, FrameHeader &header, FrameBuffer &out)
         {
+            out.fields.clear();
+            out.lists.clear();
+            out.listItems.clear();
+            size_t pos = 0;
+            size_t next = str.find('|', pos);
+
             // 解析消息类型
-            size_t next_pos = str.find('|', pos);
-            if (next_pos != std::string::npos)
+            if (next != std::string_view::npos)
             {
-                token = str.substr(pos, next_pos - pos);
-                msg.type = static_cast<MessageType>(std::stoi(token));
-                pos = next_pos + 1;
+                int typeValue = 0;
+                if (!parseNumber(str.substr(pos, next - pos), typeValue))
+                {
+                    std::cerr << "消息反序列化错误: 无效的消息类型" << std::endl;
+                    return false;
+                }
+                header.type = static_cast<MessageType>(typeValue);
+                pos = next + 1;
             }
 
             // 解析会话ID
-            next_pos = str.find('|', pos);
-            if (next_pos != std::string::npos)
+            next = str.find('|', pos);
+            if (next != std::string_view::npos)
             {
-                msg.sessionId = str.substr(pos, next_pos - pos);
-                pos = next_pos + 1;
+                header.sessionId = str.substr(pos, next - pos);
+                pos = next + 1;
+            }
+
+            // 解析请求ID
+            next = str.find('|', pos);
+            if (next != std::string_view::npos)
+            {
+                if (!parseNumber(str.substr(pos, next - pos), header.requestId))
+                {
+                    std::cerr << "消息反序列化错误: 无效的请求ID" << std::endl;
+                    return false;
+                }
+                pos = next + 1;
             }
 
             // 解析数据字段数量
             int dataCount = 0;
-            next_pos = str.find('|', pos);
-            if (next_pos != std::string::npos)
+            next = str.find('|', pos);
+            if (next != std::string_view::npos)
             {
-                token = str.substr(pos, next_pos - pos);
-                dataCount = std::stoi(token);
-                pos = next_pos + 1;
+                if (!parseNumber(str.substr(pos, next - pos), dataCount))
+                {
+                    std::cerr << "消息反序列化错误: 无效的字段数量" << std::endl;
+                    return false;
+                }
+                pos = next + 1;
             }
 
-            // 解析数据字段 - 改进的逻辑
+            // 解析数据字段
             int parsedCount = 0;
-            while (parsedCount < dataCount && pos < str.length())
+            while (parsedCount < dataCount && pos < str.size())
             {
-                // 查找下一个 key=value 对
-                next_pos = str.find('|', pos);
-                if (next_pos == std::string::npos)
+                next = str.find('|', pos);
+                std::string_view token = str.substr(pos, next == std::string_view::npos ? std::string_view::npos : next - pos);
+
+                size_t eq = token.find('=');
+                if (eq != std::string_view::npos)
                 {
-                    // 最后一个字段
-                    token = str.substr(pos);
+                    out.fields.emplace_back(token.substr(0, eq), token.substr(eq + 1));
                 }
-                else
+
+                parsedCount++;
+                if (next == std::string_view::npos)
                 {
-                    token = str.substr(pos, next_pos - pos);
+                    return true;
                 }
+                pos = next + 1;
+            }
 
-                // 解析 key=value
-                size_t eq_pos = token.find('=');
-                if (eq_pos != std::string::npos)
-                {
-                    std::string key = token.substr(0, eq_pos);
-                    std::string value = token.substr(eq_pos + 1); // 对于包含内部分隔符的值（如订单数据），需要特殊处理
-                    if (key.find("order_") == 0)
-                    {
-                        // 这是订单数据，可能包含内部的 | 分隔符
-                        // 需要查找到下一个 key= 模式来确定真正的结束位置
-                        size_t search_pos = next_pos + 1;
-                        while (search_pos < str.length())
-                        {
-                            size_t temp_pos = str.find('|', search_pos);
-                            if (temp_pos == std::string::npos)
-                            {
-                                // 没有更多的 | 分隔符，包含剩余所有内容
-                                if (search_pos < str.length())
-                                {
-                                    value += "|" + str.substr(search_pos);
-                                }
-                                next_pos = std::string::npos; // 标记为最后一个字段
-                                break;
-                            }
+            // 解析记录列表（旧格式没有这一部分）
+            size_t listCount = 0;
+            next = str.find('|', pos);
+            if (next == std::string_view::npos || !parseNumber(str.substr(pos, next - pos), listCount))
+            {
+                return true;
+            }
+            pos = next + 1;
 
-                            std::string temp_token = str.substr(search_pos, temp_pos - search_pos);
-                            if (temp_token.find('=') != std::string::npos &&
-                                (temp_token.find("order_") == 0 || temp_token == "count" || temp_token.find("user_") == 0))
-                            {
-                                // 找到了下一个有效的 key=value 对
-                                break;
-                            }
+            for (size_t l = 0; l < listCount; ++l)
+            {
+                FrameBuffer::ListRange range;
+                size_t itemCount = 0;
+                size_t nameEnd = str.find('|', pos);
+                size_t countEnd = (nameEnd == std::string_view::npos) ? nameEnd : str.find('|', nameEnd + 1);
+                if (countEnd == std::string_view::npos || !parseNumber(str.substr(nameEnd + 1, countEnd - nameEnd - 1), itemCount))
+                {
+                    std::cerr << "消息反序列化错误: 无效的列表头" << std::endl;
+                    return false;
+                }
+                range.name = str.substr(pos, nameEnd - pos);
+                range.first = out.listItems.size();
+                range.count = 0;
+                pos = countEnd + 1;
 
-                            // 继续包含到值中
-                            value += "|" + temp_token;
-                            next_pos = temp_pos;
-                            search_pos = temp_pos + 1;
-                        }
+                for (size_t i = 0; i < itemCount; ++i)
+                {
+                    size_t colon = str.find(':', pos);
+                    size_t length = 0;
+                    if (colon == std::string_view::npos || !parseNumber(str.substr(pos, colon - pos), length) ||
+                        length > str.size() - colon - 1 || colon + 1 + length >= str.size() || str[colon + 1 + length] != '|')
+                    {
+                        std::cerr << "消息反序列化错误: 列表记录长度不匹配" << std::endl;
+                        return false;
                     }
-
-                    msg.data[key] = value;
+                    out.listItems.push_back(str.substr(colon + 1, length));
+                    range.count++;
+                    pos = colon + 1 + length + 1;
                 }
+                out.lists.push_back(range);
+            }
+            return true;
+        }
 
-                parsedCount++;
-                if (next_pos != std::string::npos)
+        // 二进制格式解析：STRING 值直接指向 str；INT 值还原为十进制文本写入 out.scratch，
+        // 全部写完后再生成视图（scratch 增长时可能重新分配）
+        bool parseBinaryFrame(std::string_view str, FrameHeader &header, FrameBuffer &out)
+        {
+            out.fields.clear();
+            out.scratch.clear();
+            out.intSlots.clear();
+            out.lists.clear();
+            out.listItems.clear();
+
+            Wire::Reader reader(str);
+            if (reader.readByte() != Wire::kMessageMagic)
+            {
+                std::cerr << "二进制消息解析错误: 魔数不匹配" << std::endl;
+                return false;
+            }
+
+            header.type = static_cast<MessageType>(static_cast<int>(reader.readVarint()));
+            header.requestId = static_cast<uint32_t>(reader.readVarint());
+            header.sessionId = reader.readView();
+            uint64_t fieldCount = reader.readVarint();
+            for (uint64_t i = 0; i < fieldCount && reader.isOk(); ++i)
+            {
+                std::string_view key = reader.readView();
+                Wire::FieldType fieldType = static_cast<Wire::FieldType>(reader.readByte());
+                switch (fieldType)
                 {
-                    pos = next_pos + 1;
-                }
-                else
+                case Wire::FieldType::STRING:
+                    out.fields.emplace_back(key, reader.readView());
+                    break;
+                case Wire::FieldType::INT:
                 {
+                    char digits[24];
+                    auto result = std::to_chars(digits, digits + sizeof(digits), static_cast<long long>(reader.readSigned()));
+                    out.intSlots.emplace_back(out.fields.size(), out.scratch.size());
+                    out.scratch.append(digits, result.ptr);
+                    out.fields.emplace_back(key, std::string_view());
                     break;
                 }
+                default:
+                    std::cerr << "二进制消息解析错误: 未知字段类型 " << static_cast<int>(fieldType) << std::endl;
+                    out.fields.clear();
+                    return false;
+                }
+            }
+
+            // 记录列表（旧格式没有这一部分）
+            uint64_t listCount = reader.atEnd() ? 0 : reader.readVarint();
+            for (uint64_t l = 0; l < listCount && reader.isOk(); ++l)
+            {
+                FrameBuffer::ListRange range;
+                range.name = reader.readView();
+                range.first = out.listItems.size();
+                range.count = 0;
+                uint64_t itemCount = reader.readVarint();
+                for (uint64_t i = 0; i < itemCount && reader.isOk(); ++i)
+                {
+                    out.listItems.push_back(reader.readView());
+                    range.count++;
+                }
+                out.lists.push_back(range);
             }
+
+            if (!reader.isOk())
+            {
+                std::cerr << "二进制消息解析错误: 数据被截断" << std::endl;
+                out.fields.clear();
+                out.lists.clear();
+                return false;
+            }
+
+            for (size_t i = 0; i < out.intSlots.size(); ++i)
+            {
+                size_t offset = out.intSlots[i].second;
+                size_t end = (i + 1 < out.intSlots.size()) ? out.intSlots[i + 1].second : out.scratch.size();
+                out.fields[out.intSlots[i].first].second = std::string_view(out.scratch.data() + offset, end - offset);
+            }
+            return true;
         }
-        catch (const std::exception &e)
+
+        bool isBinaryFrame(std::string_view str)
+        {
+            return !str.empty() && static_cast<uint8_t>(str[0]) == Wire::kMessageMagic;
+        }
+
+        Message copyToMessage(const FrameHeader &header, const FrameBuffer &parsed)
         {
-            std::cerr << "消息反序列化错误: " << e.what() << std::endl;
+            Message msg(header.type, std::string(header.sessionId));
+            msg.requestId = header.requestId;
+            for (const auto &field : parsed.fields)
+            {
+                msg.data.set(std::string(field.first), std::string(field.second));
+            }
+            for (const auto &range : parsed.lists)
+            {
+                std::vector<std::string> &list = msg.addList(std::string(range.name));
+                list.reserve(list.size() + range.count);
+                for (size_t i = 0; i < range.count; ++i)
+                {
+                    list.emplace_back(parsed.listItems[range.first + i]);
+                }
+            }
+            return msg;
         }
+    }
 
-        return msg;
+    Message Message::deserialize(const std::string &str)
+    {
+        FrameHeader header;
+        FrameBuffer parsed;
+        parseTextFrame(str, header, parsed);
+        return copyToMessage(header, parsed);
     }
 
     // UserData序列化实现
@@ -360,4 +664,341 @@ namespace Protocol
         return order;
     }
 
+    // ===== 二进制编码 =====
+    // 消息帧：魔数 | varint 类型 | varint 请求ID | 会话ID | varint 字段数 | 字段...
+    // 字段：键 | 1 字节类型 | 值（STRING 为长度前缀字节串，INT 为 zigzag varint）
+    // 记录（商品/购物车项/订单）：魔数 | 各字段按固定顺序排列，整数用 zigzag varint，金额用紧凑十进制编码
+
+    const char *wireFormatName(WireFormat format)
+    {
+        return format == WireFormat::BINARY ? "binary" : "text";
+    }
+
+    bool parseWireFormat(std::string_view name, WireFormat &format)
+    {
+        if (name == "binary")
+        {
+            format = WireFormat::BINARY;
+            return true;
+        }
+        if (name == "text")
+        {
+            format = WireFormat::TEXT;
+            return true;
+        }
+        return false;
+    }
+
+    std::string Message::encode(WireFormat format) const
+    {
+        return format == WireFormat::BINARY ? serializeBinary() : serialize();
+    }
+
+    Message Message::decode(const std::string &str)
+    {
+        if (!str.empty() && static_cast<uint8_t>(str[0]) == Wire::kMessageMagic)
+        {
+            return deserializeBinary(str);
+        }
+        return deserialize(str);
+    }
+
+    std::string Message::serializeBinary() const
+    {
+        std::string out;
+        out.reserve(16 + sessionId.size() + estimateBodySize(data));
+        Wire::Writer writer(out);
+        writer.writeByte(Wire::kMessageMagic);
+        writer.writeVarint(static_cast<uint32_t>(static_cast<int>(type)));
+        writer.writeVarint(requestId);
+        writer.writeString(sessionId);
+        writeBinaryBody(data, writer);
+        return out;
+    }
+
+    Message Message::deserializeBinary(const std::string &str)
+    {
+        FrameHeader header;
+        FrameBuffer parsed;
+        if (!parseBinaryFrame(str, header, parsed))
+        {
+            return Message();
+        }
+        return copyToMessage(header, parsed);
+    }
+
+    MessageView MessageView::parse(std::shared_ptr<FrameBuffer> frame)
+    {
+        MessageView view;
+        if (!frame)
+        {
+            return view;
+        }
+
+        FrameHeader header;
+        std::string_view bytes(frame->bytes);
+        if (isBinaryFrame(bytes))
+        {
+            if (!parseBinaryFrame(bytes, header, *frame))
+            {
+                return view;
+            }
+        }
+        else if (!parseTextFrame(bytes, header, *frame))
+        {
+            return view;
+        }
+
+        view.type = header.type;
+        view.requestId = header.requestId;
+        view.sessionId = header.sessionId;
+        view.frame = std::move(frame);
+        return view;
+    }
+
+    // 字段数通常很少，线性查找即可；与 Message 的 map 语义一致，重复键以最后一个为准
+    const std::pair<std::string_view, std::string_view> *MessageView::findField(std::string_view key) const
+    {
+        if (!frame)
+        {
+            return nullptr;
+        }
+        const auto &fields = frame->fields;
+        for (auto it = fields.rbegin(); it != fields.rend(); ++it)
+        {
+            if (it->first == key)
+            {
+                return &*it;
+            }
+        }
+        return nullptr;
+    }
+
+    std::string_view MessageView::getView(std::string_view key) const
+    {
+        const auto *field = findField(key);
+        return field ? field->second : std::string_view();
+    }
+
+    ListView MessageView::getList(std::string_view name) const
+    {
+        ListView view;
+        if (!frame)
+        {
+            return view;
+        }
+        for (const auto &range : frame->lists)
+        {
+            if (range.name == name)
+            {
+                view.items = frame->listItems.data() + range.first;
+                view.count = range.count;
+                break;
+            }
+        }
+        return view;
+    }
+
+    bool MessageView::hasData(std::string_view key) const
+    {
+        return findField(key) != nullptr;
+    }
+
+    bool MessageView::getInt(std::string_view key, int &value) const
+    {
+        const auto *field = findField(key);
+        return field && parseNumber(field->second, value);
+    }
+
+    bool MessageView::getInt(std::string_view key, long long &value) const
+    {
+        const auto *field = findField(key);
+        return field && parseNumber(field->second, value);
+    }
+
+    Message MessageView::toMessage() const
+    {
+        FrameHeader header;
+        header.type = type;
+        header.requestId = requestId;
+        header.sessionId = sessionId;
+        if (!frame)
+        {
+            return copyToMessage(header, FrameBuffer());
+        }
+        return copyToMessage(header, *frame);
+    }
+
+    namespace
+    {
+        bool hasRecordMagic(const std::string &str)
+        {
+            return !str.empty() && static_cast<uint8_t>(str[0]) == Wire::kRecordMagic;
+        }
+
+        void writeCartItem(Wire::Writer &writer, const CartItemData &item)
+        {
+            writer.writeString(item.productId);
+            writer.writeString(item.productName);
+            writer.writeSigned(item.quantity);
+            writer.writeDecimal(item.priceAtAddition);
+            writer.writeString(item.sellerUsername);
+        }
+
+        CartItemData readCartItem(Wire::Reader &reader)
+        {
+            CartItemData item;
+            item.productId = reader.readString();
+            item.productName = reader.readString();
+            item.quantity = static_cast<int>(reader.readSigned());
+            item.priceAtAddition = reader.readDecimal();
+            item.sellerUsername = reader.readString();
+            return item;
+        }
+    }
+
+    std::string ProductData::encode(WireFormat format) const
+    {
+        if (format != WireFormat::BINARY)
+        {
+            return serialize();
+        }
+
+        std::string out;
+        out.reserve(48 + id.size() + name.size() + description.size() + type.size() + sellerUsername.size());
+        Wire::Writer writer(out);
+        writer.writeByte(Wire::kRecordMagic);
+        writer.writeString(id);
+        writer.writeString(name);
+        writer.writeString(description);
+        writer.writeString(type);
+        writer.writeDecimal(price);
+        writer.writeDecimal(originalPrice);
+        writer.writeSigned(quantity);
+        writer.writeDecimal(discountRate);
+        writer.writeString(sellerUsername);
+        writer.writeVarint(attributes.size());
+        for (const auto &attr : attributes)
+        {
+            writer.writeString(attr.first);
+            writer.writeString(attr.second);
+        }
+        return out;
+    }
+
+    ProductData ProductData::decode(const std::string &str)
+    {
+        if (!hasRecordMagic(str))
+        {
+            return deserialize(str);
+        }
+
+        ProductData product;
+        Wire::Reader reader(str);
+        reader.readByte();
+        product.id = reader.readString();
+        product.name = reader.readString();
+        product.description = reader.readString();
+        product.type = reader.readString();
+        product.price = reader.readDecimal();
+        product.originalPrice = reader.readDecimal();
+        product.quantity = static_cast<int>(reader.readSigned());
+        product.discountRate = reader.readDecimal();
+        product.sellerUsername = reader.readString();
+        uint64_t attrCount = reader.readVarint();
+        for (uint64_t i = 0; i < attrCount && reader.isOk(); ++i)
+        {
+            std::string key = reader.readString();
+            product.attributes[key] = reader.readString();
+        }
+
+        if (!reader.isOk())
+        {
+            std::cerr << "商品数据反序列化错误: 二进制数据被截断" << std::endl;
+        }
+        return product;
+    }
+
+    std::string CartItemData::encode(WireFormat format) const
+    {
+        if (format != WireFormat::BINARY)
+        {
+            return serialize();
+        }
+
+        std::string out;
+        Wire::Writer writer(out);
+        writer.writeByte(Wire::kRecordMagic);
+        writeCartItem(writer, *this);
+        return out;
+    }
+
+    CartItemData CartItemData::decode(const std::string &str)
+    {
+        if (!hasRecordMagic(str))
+        {
+            return deserialize(str);
+        }
+
+        Wire::Reader reader(str);
+        reader.readByte();
+        CartItemData item = readCartItem(reader);
+        if (!reader.isOk())
+        {
+            std::cerr << "购物车项数据反序列化错误: 二进制数据被截断" << std::endl;
+        }
+        return item;
+    }
+
+    std::string OrderData::encode(WireFormat format) const
+    {
+        if (format != WireFormat::BINARY)
+        {
+            return serialize();
+        }
+
+        std::string out;
+        Wire::Writer writer(out);
+        writer.writeByte(Wire::kRecordMagic);
+        writer.writeString(orderId);
+        writer.writeString(customerUsername);
+        writer.writeDecimal(totalAmount);
+        writer.writeSigned(static_cast<int>(status));
+        writer.writeSigned(timestamp);
+        writer.writeVarint(items.size());
+        for (const auto &item : items)
+        {
+            writeCartItem(writer, item);
+        }
+        return out;
+    }
+
+    OrderData OrderData::decode(const std::string &str)
+    {
+        if (!hasRecordMagic(str))
+        {
+            return deserialize(str);
+        }
+
+        OrderData order;
+        Wire::Reader reader(str);
+        reader.readByte();
+        order.orderId = reader.readString();
+        order.customerUsername = reader.readString();
+        order.totalAmount = reader.readDecimal();
+        order.status = static_cast<OrderStatus>(reader.readSigned());
+        order.timestamp = reader.readSigned();
+        uint64_t itemCount = reader.readVarint();
+        for (uint64_t i = 0; i < itemCount && reader.isOk(); ++i)
+        {
+            order.items.push_back(readCartItem(reader));
+        }
+
+        if (!reader.isOk())
+        {
+            std::cerr << "订单数据反序列化错误: 二进制数据被截断" << std::endl;
+        }
+        return order;
+    }
+
 } // namespace Protocol
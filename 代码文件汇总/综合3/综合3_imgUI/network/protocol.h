@@ -3,7 +3,11 @@
 
 #include <string>
 #include <vector>
+#include <deque>
 #include <map>
+#include <cstdint>
+#include <string_view>
+#include <memory>
 
 // 网络协议定义
 namespace Protocol
@@ -30,6 +34,12 @@ namespace Protocol
         PRODUCT_MANAGE_QUANTITY = 2008,
         PRODUCT_MANAGE_DISCOUNT = 2009,
         PRODUCT_APPLY_CATEGORY_DISCOUNT = 2010,
+        PRODUCT_SYNC = 2011,        // 按目录版本增量同步商品列表
+        PRODUCT_SUBSCRIBE = 2012,   // 订阅整个目录或指定商品的变化
+        PRODUCT_UNSUBSCRIBE = 2013, // 取消订阅
+        PRODUCT_CHANGED = 2014,     // 服务端推送：商品变化（无请求ID）
+        PRODUCT_SUGGEST = 2015,     // 按名称前缀取搜索联想
+        PRODUCT_FILTER = 2016,      // 按分类、类型、商家、价格等组合筛选，附带各维度计数
 
         // 购物车相关
         CART_GET = 3000,
@@ -37,16 +47,17 @@ namespace Protocol
         CART_UPDATE_ITEM = 3002,
         CART_REMOVE_ITEM = 3003,
         CART_CLEAR = 3004, // 订单相关
-        ORDER_CREATE = 4000,
-        ORDER_DIRECT_PURCHASE = 4001,
+        ORDER_CREATE = 4000,          // 可选 reservationId：结算时先消耗本连接的该预留，未用完的部分解锁；
+                                      // 不带时消耗本连接锁定的订单商品
+        ORDER_DIRECT_PURCHASE = 4001, // 同上
         ORDER_GET_BY_USER = 4002,
         ORDER_GET_BY_ID = 4003,
         ORDER_UPDATE_STATUS = 4004,
         ORDER_GET_ALL = 4005,
 
         // 库存锁定相关
-        INVENTORY_LOCK = 4100,
-        INVENTORY_UNLOCK = 4101,
+        INVENTORY_LOCK = 4100,   // 响应带 reservationId 与 ttl（秒）；到期未解锁或连接断开时自动释放
+        INVENTORY_UNLOCK = 4101, // 按 reservationId，或按商品与数量释放本连接的锁定
         INVENTORY_RESERVE = 4102,
 
         // 响应
@@ -55,8 +66,20 @@ namespace Protocol
         RESPONSE_DATA = 5002,
 
         // 心跳
-        HEARTBEAT = 6000
+        HEARTBEAT = 6000,
+
+        // 连接参数协商（线上格式等）
+        PROTOCOL_NEGOTIATE = 6001
+    };
+    // 线上编码格式：TEXT 便于调试，BINARY 为带类型的 TLV 编码，按连接协商
+    enum class WireFormat : uint8_t
+    {
+        TEXT = 0,
+        BINARY = 1
     };
+    const char *wireFormatName(WireFormat format);
+    bool parseWireFormat(std::string_view name, WireFormat &format);
+
     // 用户类型
     enum class UserType : int
     {
@@ -73,15 +96,40 @@ namespace Protocol
         CANCELLED_FUNDS = 4,
         CANCELLED_USER = 5
     };
+    // 消息字段表：标量字段存放在按键排序的 vector 中（二分查找），
+    // 同类记录（商品、购物车项、订单等）放在命名列表中按顺序保存，不再合成 product_0 这类键
+    class FieldTable
+    {
+    public:
+        using Field = std::pair<std::string, std::string>;
+        using List = std::pair<std::string, std::vector<std::string>>;
+
+        void set(const std::string &key, const std::string &value);
+        const std::string *find(std::string_view key) const;
+        size_t size() const { return fields.size(); }
+        std::vector<Field>::const_iterator begin() const { return fields.begin(); }
+        std::vector<Field>::const_iterator end() const { return fields.end(); }
+
+        // 获取指定名称的列表，不存在时创建；返回的引用在之后添加其他列表时仍然有效
+        std::vector<std::string> &list(const std::string &name);
+        const std::vector<std::string> *findList(std::string_view name) const;
+        const std::deque<List> &getLists() const { return lists; }
+
+    private:
+        std::vector<Field> fields; // 按键有序
+        std::deque<List> lists;    // 按添加顺序
+    };
+
     // 网络消息结构
     struct Message
     {
         MessageType type;
-        std::string sessionId;                   // 会话ID
-        std::map<std::string, std::string> data; // 消息数据
+        std::string sessionId; // 会话ID
+        uint32_t requestId;    // 请求ID：客户端分配，服务端在响应中原样回显；0 表示非请求/响应消息
+        FieldTable data;       // 消息数据
 
-        Message() : type(MessageType::HEARTBEAT) {}
-        Message(MessageType t, const std::string &sid = "") : type(t), sessionId(sid) {}
+        Message() : type(MessageType::HEARTBEAT), requestId(0) {}
+        Message(MessageType t, const std::string &sid = "") : type(t), sessionId(sid), requestId(0) {}
 
         // 序列化为字符串
         std::string serialize() const;
@@ -89,19 +137,103 @@ namespace Protocol
         // 从字符串反序列化
         static Message deserialize(const std::string &str);
 
+        // 按指定格式编码；decode 根据首字节自动识别文本/二进制格式
+        std::string encode(WireFormat format) const;
+        static Message decode(const std::string &str);
+        std::string serializeBinary() const;
+        static Message deserializeBinary(const std::string &str);
+
+        // 帧按"帧头 + 消息体"两段编码：帧头只含类型、会话ID、请求ID，
+        // 消息体为数据字段与记录列表。encode(f) == encodeHeader(f) + encodeBody(f)，
+        // 因此内容相同的响应可以共享同一份预编码的消息体，只按请求重写帧头。
+        std::string encodeHeader(WireFormat format) const;
+        std::string encodeBody(WireFormat format) const;
+
         // 设置数据字段
         void setData(const std::string &key, const std::string &value)
         {
-            data[key] = value;
+            data.set(key, value);
         }
 
         // 获取数据字段
         std::string getData(const std::string &key) const
         {
-            auto it = data.find(key);
-            return (it != data.end()) ? it->second : "";
+            const std::string *value = data.find(key);
+            return value ? *value : "";
         }
+
+        // 记录列表：每个元素是一条已编码的记录
+        std::vector<std::string> &addList(const std::string &name) { return data.list(name); }
+        const std::vector<std::string> &getList(const std::string &name) const;
+    };
+    // 接收帧缓冲区：由会话复用（见 ClientSession::acquireFrame），MessageView 的视图都指向这里
+    struct FrameBuffer
+    {
+        std::string bytes;   // 帧内容（不含长度前缀）
+        std::string scratch; // 二进制 INT 字段还原出的十进制文本
+        std::vector<std::pair<std::string_view, std::string_view>> fields;
+        std::vector<std::pair<size_t, size_t>> intSlots; // 解析期间使用：(字段下标, scratch 偏移)
+
+        // 列表：lists 中每一项对应 listItems 中的一段连续记录
+        struct ListRange
+        {
+            std::string_view name;
+            size_t first;
+            size_t count;
+        };
+        std::vector<ListRange> lists;
+        std::vector<std::string_view> listItems;
+    };
+
+    // 列表视图：指向帧缓冲区中的一组记录
+    struct ListView
+    {
+        const std::string_view *items = nullptr;
+        size_t count = 0;
+
+        size_t size() const { return count; }
+        bool empty() const { return count == 0; }
+        std::string_view operator[](size_t i) const { return items[i]; }
+        const std::string_view *begin() const { return items; }
+        const std::string_view *end() const { return items + count; }
+    };
+
+    // 已解码消息的只读视图：键和值都是指向帧缓冲区的 string_view，读取字段不分配内存。
+    // 视图可以拷贝（共享同一帧缓冲区），帧缓冲区在最后一个视图销毁后才会被复用；
+    // 需要在视图之外保存字段时用 getData() 拷贝。
+    class MessageView
+    {
+    public:
+        MessageType type;
+        uint32_t requestId;
+
+        MessageView() : type(MessageType::HEARTBEAT), requestId(0) {}
+
+        // 解析 frame->bytes（自动识别文本/二进制格式）；格式错误时返回空视图
+        static MessageView parse(std::shared_ptr<FrameBuffer> frame);
+
+        std::string_view getSessionId() const { return sessionId; }
+        // 零拷贝读取字段，字段不存在时返回空视图
+        std::string_view getView(std::string_view key) const;
+        std::string getData(std::string_view key) const { return std::string(getView(key)); }
+        bool hasData(std::string_view key) const;
+        // 按十进制整数解析字段，不分配内存；字段不存在或不是整数时返回 false
+        bool getInt(std::string_view key, int &value) const;
+        bool getInt(std::string_view key, long long &value) const;
+        size_t getFieldCount() const { return frame ? frame->fields.size() : 0; }
+        // 零拷贝读取记录列表，不存在时返回空列表
+        ListView getList(std::string_view name) const;
+
+        // 拷贝为拥有所有权的 Message
+        Message toMessage() const;
+
+    private:
+        std::string_view sessionId;
+        std::shared_ptr<const FrameBuffer> frame;
+
+        const std::pair<std::string_view, std::string_view> *findField(std::string_view key) const;
     };
+
     // 用户数据结构
     struct UserData
     {
@@ -128,6 +260,8 @@ namespace Protocol
 
         std::string serialize() const;
         static ProductData deserialize(const std::string &str);
+        std::string encode(WireFormat format) const;
+        static ProductData decode(const std::string &str);
     };
     // 购物车项数据结构
     struct CartItemData
@@ -140,6 +274,8 @@ namespace Protocol
 
         std::string serialize() const;
         static CartItemData deserialize(const std::string &str);
+        std::string encode(WireFormat format) const;
+        static CartItemData decode(const std::string &str);
     };
     // 订单数据结构
     struct OrderData
@@ -153,6 +289,8 @@ namespace Protocol
 
         std::string serialize() const;
         static OrderData deserialize(const std::string &str);
+        std::string encode(WireFormat format) const;
+        static OrderData decode(const std::string &str);
     };
 
 } // namespace Protocol
@@ -1,16 +1,23 @@
 #include "server.h"
+#include "event_loop.h"
 #include "../user/user.h"
 #include "../store/store.h"
 #include "../order/ordermanager.h"
+#include "../store/facet_index.h"
 #include <iostream>
 #include <sstream>
 #include <random>
 #include <algorithm>
 #include <chrono>
+#include <future>
+#include <cstring>
+#include <charconv>
 
 // ClientSession 实现
 ClientSession::ClientSession(SOCKET socket, const std::string &sid)
-    : clientSocket(socket), sessionId(sid), userType(Protocol::UserType::CUSTOMER), isActive(true)
+    : clientSocket(socket), sessionId(sid), userType(Protocol::UserType::CUSTOMER), isActive(true),
+      wireFormat(Protocol::WireFormat::TEXT), eventLoop(nullptr), outOffset(0), writeInterest(false),
+      dispatchPending(0)
 {
 }
 
@@ -19,142 +26,318 @@ ClientSession::~ClientSession()
     stopSession();
 }
 
-void ClientSession::startSession(NetworkServer *server)
+void ClientSession::attachToLoop(EventLoop *loop)
 {
-    clientThread = std::thread(&ClientSession::sessionLoop, this, server);
+    std::lock_guard<std::mutex> lock(outMutex);
+    eventLoop = loop;
+
+    // 接管之前就已排队的数据（例如连接后立即推送的消息）
+    if (!outQueue.empty() && !writeInterest && eventLoop)
+    {
+        writeInterest = true;
+        eventLoop->setWriteInterest(this, true);
+    }
 }
 
 void ClientSession::stopSession()
 {
     isActive.store(false);
+    std::lock_guard<std::mutex> lock(outMutex);
     if (clientSocket != INVALID_SOCKET)
     {
-        closesocket(clientSocket);
+        SocketCompat::closeSocket(clientSocket);
         clientSocket = INVALID_SOCKET;
     }
-    if (clientThread.joinable())
-    {
-        clientThread.join();
-    }
+    outQueue.clear();
+    outOffset = 0;
+    writeInterest = false;
+    eventLoop = nullptr;
 }
 
-void ClientSession::sessionLoop(NetworkServer *server)
+bool ClientSession::onReadable(NetworkServer *server)
 {
-    std::cout << "客户端会话开始: " << sessionId << std::endl;
+    const size_t kReadChunk = 16 * 1024;
 
-    while (isActive.load())
+    // 读取套接字中所有可用数据，直到内核缓冲区为空
+    while (true)
     {
-        std::string rawData = receiveRawData();
-        if (rawData.empty())
+        size_t oldSize = inBuffer.size();
+        inBuffer.resize(oldSize + kReadChunk);
+        int received = recv(clientSocket, &inBuffer[oldSize], static_cast<int>(kReadChunk), 0);
+        if (received > 0)
+        {
+            inBuffer.resize(oldSize + received);
+            continue;
+        }
+
+        inBuffer.resize(oldSize);
+        if (received == 0)
+        {
+            isActive.store(false);
+            return false;
+        }
+
+        int err = SocketCompat::lastError();
+        if (SocketCompat::wouldBlock(err))
         {
             break;
         }
+        if (SocketCompat::interrupted(err))
+        {
+            continue;
+        }
+        isActive.store(false);
+        return false;
+    }
 
-        Protocol::Message message = Protocol::Message::deserialize(rawData);
-        message.sessionId = sessionId; // 确保会话ID正确
+    // 按 4 字节长度前缀切分完整的帧并分发
+    size_t offset = 0;
+    while (inBuffer.size() - offset >= sizeof(uint32_t))
+    {
+        uint32_t dataLength;
+        std::memcpy(&dataLength, inBuffer.data() + offset, sizeof(dataLength));
+        dataLength = ntohl(dataLength);
 
-        // 处理消息
-        server->handleClientMessage(shared_from_this(), message);
+        if (dataLength > kMaxFrameSize)
+        {
+            std::cerr << "会话 " << sessionId << " 收到超长帧 (" << dataLength << " 字节)，断开连接" << std::endl;
+            isActive.store(false);
+            return false;
+        }
+        if (inBuffer.size() - offset - sizeof(uint32_t) < dataLength)
+        {
+            break; // 帧尚未接收完整
+        }
+
+        // 帧内容拷贝到复用的帧缓冲区（稳定状态下不分配内存），解析出的字段都是指向它的视图
+        std::shared_ptr<Protocol::FrameBuffer> frame = acquireFrame();
+        frame->bytes.assign(inBuffer, offset + sizeof(uint32_t), dataLength);
+        offset += sizeof(uint32_t) + dataLength;
+
+        Protocol::MessageView message = Protocol::MessageView::parse(std::move(frame));
+
+        // 交给业务线程池处理，I/O 线程继续处理其他连接
+        server->dispatchMessage(shared_from_this(), message);
     }
+    inBuffer.erase(0, offset);
 
-    std::cout << "客户端会话结束: " << sessionId << std::endl;
+    return true;
 }
 
-bool ClientSession::sendRawData(const std::string &data)
+std::shared_ptr<Protocol::FrameBuffer> ClientSession::acquireFrame()
 {
-    if (clientSocket == INVALID_SOCKET)
+    for (auto &frame : framePool)
     {
-        return false;
+        // use_count() == 1 表示只剩池本身持有，没有视图再引用它。
+        // 读到 1 后加 acquire 屏障，与业务线程释放引用时的 release 操作同步，
+        // 保证对方对缓冲区的读取都发生在这里复用之前。
+        if (frame.use_count() == 1)
+        {
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (frame->bytes.capacity() > kMaxPooledFrameBytes)
+            {
+                frame = std::make_shared<Protocol::FrameBuffer>();
+            }
+            return frame;
+        }
     }
 
-    // 发送数据长度
-    uint32_t dataLength = htonl(static_cast<uint32_t>(data.length()));
-    if (send(clientSocket, reinterpret_cast<const char *>(&dataLength), sizeof(dataLength), 0) == SOCKET_ERROR)
+    auto frame = std::make_shared<Protocol::FrameBuffer>();
+    if (framePool.size() < kMaxPooledFrames)
+    {
+        framePool.push_back(frame);
+    }
+    return frame;
+}
+
+bool ClientSession::onWritable()
+{
+    std::lock_guard<std::mutex> lock(outMutex);
+    if (!flushOutputLocked())
     {
         return false;
     }
 
-    // 发送数据内容
-    int totalSent = 0;
-    int dataSize = static_cast<int>(data.length());
+    if (outQueue.empty() && writeInterest)
+    {
+        writeInterest = false;
+        if (eventLoop)
+        {
+            eventLoop->setWriteInterest(this, false);
+        }
+    }
+    return true;
+}
+
+bool ClientSession::hasPendingOutput() const
+{
+    std::lock_guard<std::mutex> lock(outMutex);
+    return !outQueue.empty();
+}
 
-    while (totalSent < dataSize)
+// 尽可能多地写出发送队列，多个块合并为一次聚集发送。调用方需持有 outMutex
+bool ClientSession::flushOutputLocked()
+{
+    while (!outQueue.empty())
     {
-        int sent = send(clientSocket, data.c_str() + totalSent, dataSize - totalSent, 0);
-        if (sent == SOCKET_ERROR)
+        SocketCompat::IoSlice slices[SocketCompat::kMaxIoSlices];
+        int sliceCount = 0;
+        size_t offset = outOffset;
+        for (auto it = outQueue.begin(); it != outQueue.end() && sliceCount < SocketCompat::kMaxIoSlices; ++it)
         {
-            return false;
+            const std::string &bytes = it->bytes();
+            slices[sliceCount].data = bytes.data() + offset;
+            slices[sliceCount].size = bytes.size() - offset;
+            sliceCount++;
+            offset = 0;
         }
-        totalSent += sent;
+
+        int sent = SocketCompat::sendGather(clientSocket, slices, sliceCount);
+        if (sent > 0)
+        {
+            // 弹出已完整写出的块，私有块的存储留给下一条消息复用
+            size_t remaining = static_cast<size_t>(sent);
+            while (remaining > 0)
+            {
+                size_t left = outQueue.front().bytes().size() - outOffset;
+                if (remaining < left)
+                {
+                    outOffset += remaining;
+                    break;
+                }
+                remaining -= left;
+                outOffset = 0;
+                if (!outQueue.front().shared && outQueue.front().owned.capacity() <= kMaxPooledFrameBytes)
+                {
+                    spareOutBuffer = std::move(outQueue.front().owned);
+                    spareOutBuffer.clear();
+                }
+                outQueue.pop_front();
+            }
+            continue;
+        }
+
+        int err = SocketCompat::lastError();
+        if (SocketCompat::wouldBlock(err))
+        {
+            return true;
+        }
+        if (SocketCompat::interrupted(err))
+        {
+            continue;
+        }
+        isActive.store(false);
+        return false;
     }
 
+    outOffset = 0;
     return true;
 }
 
-std::string ClientSession::receiveRawData()
+// 追加到队尾的私有块；队尾是共享块（或队列为空）时新开一个私有块
+void ClientSession::appendOwnedLocked(const char *data, size_t size)
 {
-    if (clientSocket == INVALID_SOCKET)
+    if (outQueue.empty() || outQueue.back().shared)
     {
-        return "";
+        outQueue.emplace_back();
+        outQueue.back().owned = std::move(spareOutBuffer);
+        spareOutBuffer.clear();
     }
+    outQueue.back().owned.append(data, size);
+}
 
-    // 接收数据长度
-    uint32_t dataLength;
-    int received = recv(clientSocket, reinterpret_cast<char *>(&dataLength), sizeof(dataLength), 0);
-    if (received <= 0)
+// 入队后尝试立即写出；写不完时登记可写事件，由事件循环继续发送
+bool ClientSession::scheduleFlushLocked()
+{
+    // 已有积压时保持顺序，由事件循环在可写时继续发送
+    if (writeInterest)
     {
-        isActive.store(false);
-        return "";
+        return true;
     }
 
-    dataLength = ntohl(dataLength);
+    if (!flushOutputLocked())
+    {
+        return false;
+    }
 
-    // 接收数据内容
-    std::string data;
-    data.resize(dataLength);
+    if (!outQueue.empty() && eventLoop)
+    {
+        writeInterest = true;
+        eventLoop->setWriteInterest(this, true);
+    }
+    return true;
+}
 
-    int totalReceived = 0;
-    while (totalReceived < static_cast<int>(dataLength))
+bool ClientSession::sendRawData(const std::string &data)
+{
+    std::lock_guard<std::mutex> lock(outMutex);
+    if (clientSocket == INVALID_SOCKET)
     {
-        int received = recv(clientSocket, &data[totalReceived], dataLength - totalReceived, 0);
-        if (received <= 0)
-        {
-            isActive.store(false);
-            return "";
-        }
-        totalReceived += received;
+        return false;
+    }
+
+    // 长度前缀 + 数据内容追加到发送队列
+    uint32_t dataLength = htonl(static_cast<uint32_t>(data.length()));
+    appendOwnedLocked(reinterpret_cast<const char *>(&dataLength), sizeof(dataLength));
+    appendOwnedLocked(data.data(), data.size());
+    return scheduleFlushLocked();
+}
+
+bool ClientSession::sendSharedFrame(const std::string &header, std::shared_ptr<const std::string> body)
+{
+    std::lock_guard<std::mutex> lock(outMutex);
+    if (clientSocket == INVALID_SOCKET)
+    {
+        return false;
     }
 
-    return data;
+    uint32_t dataLength = htonl(static_cast<uint32_t>(header.size() + body->size()));
+    appendOwnedLocked(reinterpret_cast<const char *>(&dataLength), sizeof(dataLength));
+    appendOwnedLocked(header.data(), header.size());
+    if (!body->empty())
+    {
+        OutChunk chunk;
+        chunk.shared = std::move(body);
+        outQueue.push_back(std::move(chunk));
+    }
+    return scheduleFlushLocked();
 }
 
 bool ClientSession::sendMessage(const Protocol::Message &message)
 {
-    std::string serialized = message.serialize();
+    std::string serialized = message.encode(wireFormat.load());
     return sendRawData(serialized);
 }
 
+std::string ClientSession::getOrderingKey() const
+{
+    std::lock_guard<std::mutex> lock(identityMutex);
+    return username.empty() ? "session:" + sessionId : "user:" + username;
+}
+
 // NetworkServer 实现
-NetworkServer::NetworkServer(int port)
+NetworkServer::NetworkServer(int port, int ioThreads, int handlerThreads, size_t handlerQueueCapacity)
     : port(port), serverSocket(INVALID_SOCKET), isRunning(false),
+      ioThreadCount(ioThreads > 0 ? ioThreads : static_cast<int>(std::max(1u, std::thread::hardware_concurrency()))),
+      nextLoopIndex(0),
+      handlerThreadCount(handlerThreads > 0 ? handlerThreads : static_cast<int>(std::max(4u, 2 * std::thread::hardware_concurrency()))),
+      handlerQueueCapacity(handlerQueueCapacity),
       userFile("./server_data/users.txt"),
       storeDir("./server_data/store"),
       orderDir("./server_data/orders")
 {
 
-    // 初始化Winsock
-    WSADATA wsaData;
-    int result = WSAStartup(MAKEWORD(2, 2), &wsaData);
-    if (result != 0)
+    // 初始化套接字库
+    if (!SocketCompat::initialize())
     {
-        std::cerr << "WSAStartup failed: " << result << std::endl;
+        std::cerr << "套接字库初始化失败: " << SocketCompat::lastError() << std::endl;
     }
 }
 
 NetworkServer::~NetworkServer()
 {
     stop();
-    WSACleanup();
+    SocketCompat::cleanup();
 }
 
 bool NetworkServer::start()
@@ -168,7 +351,7 @@ bool NetworkServer::start()
     serverSocket = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
     if (serverSocket == INVALID_SOCKET)
     {
-        std::cerr << "Socket creation failed: " << WSAGetLastError() << std::endl;
+        std::cerr << "Socket creation failed: " << SocketCompat::lastError() << std::endl;
         return false;
     }
 
@@ -177,30 +360,99 @@ bool NetworkServer::start()
     setsockopt(serverSocket, SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<const char *>(&opt), sizeof(opt));
 
     // 绑定地址
-    sockaddr_in serverAddr;
+    sockaddr_in serverAddr{};
     serverAddr.sin_family = AF_INET;
     serverAddr.sin_addr.s_addr = INADDR_ANY;
     serverAddr.sin_port = htons(port);
 
     if (bind(serverSocket, reinterpret_cast<sockaddr *>(&serverAddr), sizeof(serverAddr)) == SOCKET_ERROR)
     {
-        std::cerr << "Bind failed: " << WSAGetLastError() << std::endl;
-        closesocket(serverSocket);
+        std::cerr << "Bind failed: " << SocketCompat::lastError() << std::endl;
+        SocketCompat::closeSocket(serverSocket);
+        serverSocket = INVALID_SOCKET;
         return false;
     }
 
     // 开始监听
     if (listen(serverSocket, SOMAXCONN) == SOCKET_ERROR)
     {
-        std::cerr << "Listen failed: " << WSAGetLastError() << std::endl;
-        closesocket(serverSocket);
+        std::cerr << "Listen failed: " << SocketCompat::lastError() << std::endl;
+        SocketCompat::closeSocket(serverSocket);
+        serverSocket = INVALID_SOCKET;
+        return false;
+    }
+
+    // 初始化业务组件：用户数据、订单管理器与商品目录互不依赖，在另一个线程中加载，和商品目录重叠
+    auto startupBegin = std::chrono::steady_clock::now();
+    auto elapsedMs = [](std::chrono::steady_clock::time_point since)
+    {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - since).count();
+    };
+    double userMs = 0.0;
+    double orderMs = 0.0;
+    auto loadUsersAndOrders = [this, &userMs, &orderMs, &elapsedMs]()
+    {
+        auto begin = std::chrono::steady_clock::now();
+        loadUserData();
+        userMs = elapsedMs(begin);
+        begin = std::chrono::steady_clock::now();
+        initializeOrderManager();
+        orderMs = elapsedMs(begin);
+    };
+    double storeMs = 0.0;
+    try
+    {
+        // 加载线程中的异常由 get() 在这里重新抛出；商品目录加载抛出异常时，
+        // 离开作用域的 future 会先等加载线程结束
+        std::future<void> loader = std::async(std::launch::async, loadUsersAndOrders);
+        auto storeBegin = std::chrono::steady_clock::now();
+        initializeStore();
+        storeMs = elapsedMs(storeBegin);
+        loader.get();
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << "业务组件初始化失败: " << e.what() << std::endl;
+        SocketCompat::closeSocket(serverSocket);
+        serverSocket = INVALID_SOCKET;
         return false;
     }
 
-    // 初始化业务组件
-    loadUserData();
-    initializeStore();
-    initializeOrderManager();
+    const StoreLoadTimings &load = store->getLoadTimings();
+    std::cout << "[启动耗时] 共 " << elapsedMs(startupBegin) << "ms：商品目录 " << storeMs << "ms（"
+              << (load.fromSnapshot ? "快照 " : "商家文件 ") << load.readMs << "ms，索引 " << load.indexMs
+              << "ms，日志重放 " << load.replayMs << "ms，目录快照编码等 " << storeMs - load.totalMs << "ms）"
+              << "，与之并行: 用户数据 " << userMs << "ms，订单管理器 " << orderMs << "ms" << std::endl;
+    subscriptionManager = std::make_unique<SubscriptionManager>(*catalogCache);
+    subscriptionManager->start();
+    reservationManager = std::make_unique<ReservationManager>(*store);
+    reservationManager->start();
+
+    // 启动业务线程池（需先于 I/O 线程启动，I/O 线程一收到消息就会投递任务）
+    handlerPool = std::make_unique<HandlerPool>(handlerThreadCount, handlerQueueCapacity);
+    handlerPool->start();
+    std::cout << "已启动 " << handlerThreadCount << " 个业务处理线程" << std::endl;
+
+    // 启动 I/O 线程
+    for (int i = 0; i < ioThreadCount; ++i)
+    {
+        auto loop = std::make_unique<EventLoop>(i);
+        if (!loop->start(this))
+        {
+            std::cerr << "I/O 线程 " << i << " 启动失败" << std::endl;
+            for (auto &started : ioLoops)
+            {
+                started->stop();
+            }
+            ioLoops.clear();
+            handlerPool->stop();
+            SocketCompat::closeSocket(serverSocket);
+            serverSocket = INVALID_SOCKET;
+            return false;
+        }
+        ioLoops.push_back(std::move(loop));
+    }
+    std::cout << "已启动 " << ioThreadCount << " 个 I/O 线程" << std::endl;
 
     isRunning.store(true);
 
@@ -219,10 +471,11 @@ void NetworkServer::stop()
 
     isRunning.store(false);
 
-    // 关闭服务器socket
+    // 关闭服务器socket（先 shutdown 以唤醒阻塞在 accept 上的线程）
     if (serverSocket != INVALID_SOCKET)
     {
-        closesocket(serverSocket);
+        SocketCompat::shutdownSocket(serverSocket);
+        SocketCompat::closeSocket(serverSocket);
         serverSocket = INVALID_SOCKET;
     }
 
@@ -232,6 +485,28 @@ void NetworkServer::stop()
         acceptThread.join();
     }
 
+    // 停止 I/O 线程，各线程退出前会关闭自己负责的会话
+    for (auto &loop : ioLoops)
+    {
+        loop->stop();
+    }
+    ioLoops.clear();
+
+    // 不再有新任务进入，等待已排队的业务任务执行完毕
+    if (handlerPool)
+    {
+        handlerPool->stop();
+    }
+
+    if (subscriptionManager)
+    {
+        subscriptionManager->stop();
+    }
+    if (reservationManager)
+    {
+        reservationManager->stop();
+    }
+
     // 停止所有客户端会话
     {
         std::lock_guard<std::mutex> lock(sessionsMutex);
@@ -244,6 +519,10 @@ void NetworkServer::stop()
 
     // 保存数据
     saveUserData();
+    if (store)
+    {
+        store->flush();
+    }
 
     std::cout << "服务器已停止" << std::endl;
 }
@@ -255,13 +534,25 @@ void NetworkServer::acceptLoop()
         SOCKET clientSocket = accept(serverSocket, nullptr, nullptr);
         if (clientSocket == INVALID_SOCKET)
         {
+            if (SocketCompat::interrupted(SocketCompat::lastError()) && isRunning.load())
+            {
+                continue;
+            }
             if (isRunning.load())
             {
-                std::cerr << "Accept failed: " << WSAGetLastError() << std::endl;
+                std::cerr << "Accept failed: " << SocketCompat::lastError() << std::endl;
             }
             break;
         }
 
+        if (!SocketCompat::setNonBlocking(clientSocket))
+        {
+            std::cerr << "设置非阻塞模式失败: " << SocketCompat::lastError() << std::endl;
+            SocketCompat::closeSocket(clientSocket);
+            continue;
+        }
+        SocketCompat::setNoDelay(clientSocket);
+
         // 生成会话ID
         std::string sessionId = generateSessionId();
 
@@ -273,10 +564,143 @@ void NetworkServer::acceptLoop()
             sessions.push_back(session);
         }
 
-        // 启动会话
-        session->startSession(this);
+        // 交给 I/O 线程（轮询分配）
+        EventLoop *loop = ioLoops[nextLoopIndex++ % ioLoops.size()].get();
+        loop->addSession(session);
 
-        std::cout << "新客户端连接，会话ID: " << sessionId << std::endl;
+        std::cout << "新客户端连接，会话ID: " << sessionId << "，I/O 线程: " << loop->getIndex() << std::endl;
+    }
+}
+
+void NetworkServer::onSessionClosed(const std::shared_ptr<ClientSession> &session)
+{
+    std::cout << "客户端会话结束: " << session->getSessionId() << std::endl;
+    if (subscriptionManager)
+    {
+        subscriptionManager->removeSession(session->getSessionId());
+    }
+    // 客户端断开时不会再来解锁，本会话的预留全部释放
+    if (reservationManager)
+    {
+        size_t released = reservationManager->releaseSession(session->getSessionId());
+        if (released > 0)
+        {
+            std::cout << "已释放会话 " << session->getSessionId() << " 的 " << released << " 个库存预留" << std::endl;
+        }
+    }
+    removeSession(session->getSessionId());
+}
+
+size_t NetworkServer::getActiveSessionCount()
+{
+    std::lock_guard<std::mutex> lock(sessionsMutex);
+    return sessions.size();
+}
+
+HandlerPool::Stats NetworkServer::getHandlerPoolStats() const
+{
+    return handlerPool ? handlerPool->getStats() : HandlerPool::Stats();
+}
+
+CatalogSnapshotCache::Stats NetworkServer::getCatalogStats() const
+{
+    return catalogCache ? catalogCache->getStats() : CatalogSnapshotCache::Stats();
+}
+
+SubscriptionManager::Stats NetworkServer::getSubscriptionStats() const
+{
+    return subscriptionManager ? subscriptionManager->getStats() : SubscriptionManager::Stats();
+}
+
+PoolStats NetworkServer::getProductPoolStats() const
+{
+    return store ? store->getProductPoolStats() : PoolStats();
+}
+
+PoolStats NetworkServer::getOrderPoolStats() const
+{
+    return orderManager ? orderManager->getOrderPoolStats() : PoolStats();
+}
+
+StoreWriter::Stats NetworkServer::getStoreWriterStats() const
+{
+    return store ? store->getWriterStats() : StoreWriter::Stats();
+}
+
+MutationLog::Stats NetworkServer::getMutationLogStats() const
+{
+    return store ? store->getMutationLogStats() : MutationLog::Stats();
+}
+
+ReservationManager::Stats NetworkServer::getReservationStats() const
+{
+    return reservationManager ? reservationManager->getStats() : ReservationManager::Stats();
+}
+
+// 由 I/O 线程调用：把解码后的消息投递到业务线程池，同一用户的请求保持顺序
+void NetworkServer::dispatchMessage(std::shared_ptr<ClientSession> session, const Protocol::MessageView &message)
+{
+    std::lock_guard<std::mutex> lock(session->dispatchMutex);
+    std::string key = session->getOrderingKey();
+    // 登录、注销后排序键改变：旧键上还有请求未执行完时先暂存，
+    // 否则新键上的请求可能与之并行或抢先执行，打乱同一连接的请求顺序
+    if (!session->heldMessages.empty() || (session->dispatchPending > 0 && key != session->dispatchKey))
+    {
+        // 暂存的请求同样占用业务队列的容量，超出时与线程池满一样直接拒绝
+        if (session->dispatchPending + session->heldMessages.size() >= handlerQueueCapacity)
+        {
+            sendErrorResponse(session, message, "服务器繁忙，请稍后重试");
+            return;
+        }
+        session->heldMessages.push_back(message);
+        return;
+    }
+    submitHandlerLocked(session, key, message);
+}
+
+// 调用方持有会话的派发锁
+void NetworkServer::submitHandlerLocked(const std::shared_ptr<ClientSession> &session, const std::string &key, const Protocol::MessageView &message)
+{
+    // 任务持有视图的拷贝，帧缓冲区在处理完成前不会被复用
+    auto task = [this, session, message]()
+    {
+        try
+        {
+            handleClientMessage(session, message);
+        }
+        catch (...)
+        {
+            finishDispatch(session);
+            throw;
+        }
+        finishDispatch(session);
+    };
+
+    session->dispatchKey = key;
+    session->dispatchPending++;
+    if (!handlerPool->submit(key, task))
+    {
+        session->dispatchPending--;
+        sendErrorResponse(session, message, "服务器繁忙，请稍后重试");
+    }
+}
+
+// 由业务线程在每个请求处理完后调用：旧键上的请求全部完成时，按当前排序键派发暂存的请求
+void NetworkServer::finishDispatch(const std::shared_ptr<ClientSession> &session)
+{
+    std::lock_guard<std::mutex> lock(session->dispatchMutex);
+    session->dispatchPending--;
+    if (session->dispatchPending > 0 || session->heldMessages.empty())
+    {
+        return;
+    }
+
+    std::string key = session->getOrderingKey();
+    std::deque<Protocol::MessageView> held;
+    held.swap(session->heldMessages);
+    for (const Protocol::MessageView &message : held)
+    {
+        submitHandlerLocked(session, key, message);
     }
 }
 
@@ -330,7 +754,7 @@ std::shared_ptr<ClientSession> NetworkServer::findSessionByUsername(const std::s
 }
 
 // 处理客户端消息
-void NetworkServer::handleClientMessage(std::shared_ptr<ClientSession> session, const Protocol::Message &message)
+void NetworkServer::handleClientMessage(std::shared_ptr<ClientSession> session, const Protocol::MessageView &message)
 {
     switch (message.type)
     {
@@ -358,6 +782,21 @@ void NetworkServer::handleClientMessage(std::shared_ptr<ClientSession> session,
     case Protocol::MessageType::PRODUCT_SEARCH:
         handleProductSearch(session, message);
         break;
+    case Protocol::MessageType::PRODUCT_SYNC:
+        handleProductSync(session, message);
+        break;
+    case Protocol::MessageType::PRODUCT_SUBSCRIBE:
+        handleProductSubscribe(session, message);
+        break;
+    case Protocol::MessageType::PRODUCT_UNSUBSCRIBE:
+        handleProductUnsubscribe(session, message);
+        break;
+    case Protocol::MessageType::PRODUCT_SUGGEST:
+        handleProductSuggest(session, message);
+        break;
+    case Protocol::MessageType::PRODUCT_FILTER:
+        handleProductFilter(session, message);
+        break;
     case Protocol::MessageType::CART_GET:
         handleCartGet(session, message);
         break;
@@ -403,14 +842,25 @@ void NetworkServer::handleClientMessage(std::shared_ptr<ClientSession> session,
     case Protocol::MessageType::INVENTORY_UNLOCK:
         handleInventoryUnlock(session, message);
         break;
+    case Protocol::MessageType::PROTOCOL_NEGOTIATE:
+        handleProtocolNegotiate(session, message);
+        break;
     default:
-        sendErrorResponse(session, "不支持的消息类型");
+        sendErrorResponse(session, message, "不支持的消息类型");
         break;
     }
 }
 
+// 解析列表中的数量字段（十进制整数），不分配内存
+static bool parseQuantity(std::string_view text, int &quantity)
+{
+    const char *last = text.data() + text.size();
+    auto result = std::from_chars(text.data(), last, quantity);
+    return result.ec == std::errc() && result.ptr == last;
+}
+
 // 用户登录处理
-void NetworkServer::handleUserLogin(std::shared_ptr<ClientSession> session, const Protocol::Message &message)
+void NetworkServer::handleUserLogin(std::shared_ptr<ClientSession> session, const Protocol::MessageView &message)
 {
     std::string username = message.getData("username");
     std::string password = message.getData("password");
@@ -419,13 +869,13 @@ void NetworkServer::handleUserLogin(std::shared_ptr<ClientSession> session, cons
     User *user = User::findUser(users, username);
     if (!user || user->getPassword() != password)
     {
-        sendErrorResponse(session, "用户名或密码错误");
+        sendErrorResponse(session, message, "用户名或密码错误");
         return;
     } // 检查该用户是否已经在其他客户端登录
     std::shared_ptr<ClientSession> existingSession = findSessionByUsername(username);
     if (existingSession && existingSession->getSessionId() != session->getSessionId())
     {
-        sendErrorResponse(session, "该用户已经登录");
+        sendErrorResponse(session, message, "该用户已经登录");
         std::cout << "用户 " << username << " 尝试重复登录，已拒绝" << std::endl;
         return;
     }
@@ -451,12 +901,12 @@ void NetworkServer::handleUserLogin(std::shared_ptr<ClientSession> session, cons
     responseData["sessionId"] = session->getSessionId();
     responseData["userData"] = convertToUserData(user).serialize();
 
-    sendSuccessResponse(session, responseData);
+    sendSuccessResponse(session, message, responseData);
     std::cout << "用户登录成功: " << username << std::endl;
 }
 
 // 用户注册处理
-void NetworkServer::handleUserRegister(std::shared_ptr<ClientSession> session, const Protocol::Message &message)
+void NetworkServer::handleUserRegister(std::shared_ptr<ClientSession> session, const Protocol::MessageView &message)
 {
     std::string username = message.getData("username");
     std::string password = message.getData("password");
@@ -465,7 +915,7 @@ void NetworkServer::handleUserRegister(std::shared_ptr<ClientSession> session, c
     // 检查用户名是否已存在
     if (User::isUsernameExists(users, username))
     {
-        sendErrorResponse(session, "用户名已存在");
+        sendErrorResponse(session, message, "用户名已存在");
         return;
     }
 
@@ -492,31 +942,40 @@ void NetworkServer::handleUserRegister(std::shared_ptr<ClientSession> session, c
         users.push_back(newUser);
 
         saveUserData();
-        sendSuccessResponse(session);
+        sendSuccessResponse(session, message);
         std::cout << "新用户注册成功: " << username << std::endl;
     }
     else
     {
-        sendErrorResponse(session, "创建用户失败");
+        sendErrorResponse(session, message, "创建用户失败");
     }
 }
 
 // 用户登出处理
-void NetworkServer::handleUserLogout(std::shared_ptr<ClientSession> session, const Protocol::Message &message)
+void NetworkServer::handleUserLogout(std::shared_ptr<ClientSession> session, const Protocol::MessageView &message)
 {
+    // 预留记在会话名下，登出后连接可能换另一个用户登录，不能让他的订单用上这些锁定
+    if (reservationManager)
+    {
+        size_t released = reservationManager->releaseSession(session->getSessionId());
+        if (released > 0)
+        {
+            std::cout << "用户登出，已释放 " << released << " 个库存预留" << std::endl;
+        }
+    }
     session->setUsername("");
     session->setUserType(Protocol::UserType::CUSTOMER);
-    sendSuccessResponse(session);
+    sendSuccessResponse(session, message);
     std::cout << "用户登出成功" << std::endl;
 }
 
 // 获取用户信息处理
-void NetworkServer::handleUserGetInfo(std::shared_ptr<ClientSession> session, const Protocol::Message &message)
+void NetworkServer::handleUserGetInfo(std::shared_ptr<ClientSession> session, const Protocol::MessageView &message)
 {
     std::string username = session->getUsername();
     if (username.empty())
     {
-        sendErrorResponse(session, "用户未登录");
+        sendErrorResponse(session, message, "用户未登录");
         return;
     }
 
@@ -524,7 +983,7 @@ void NetworkServer::handleUserGetInfo(std::shared_ptr<ClientSession> session, co
     User *user = User::findUser(users, username);
     if (!user)
     {
-        sendErrorResponse(session, "用户不存在");
+        sendErrorResponse(session, message, "用户不存在");
         return;
     }
 
@@ -532,17 +991,17 @@ void NetworkServer::handleUserGetInfo(std::shared_ptr<ClientSession> session, co
     std::map<std::string, std::string> responseData;
     responseData["userData"] = convertToUserData(user).serialize();
 
-    sendDataResponse(session, responseData);
+    sendDataResponse(session, message, responseData);
     std::cout << "用户 " << username << " 获取用户信息成功" << std::endl;
 }
 
 // 用户余额更新处理
-void NetworkServer::handleUserUpdateBalance(std::shared_ptr<ClientSession> session, const Protocol::Message &message)
+void NetworkServer::handleUserUpdateBalance(std::shared_ptr<ClientSession> session, const Protocol::MessageView &message)
 {
     std::string username = session->getUsername();
     if (username.empty())
     {
-        sendErrorResponse(session, "用户未登录");
+        sendErrorResponse(session, message, "用户未登录");
         return;
     }
 
@@ -555,13 +1014,13 @@ void NetworkServer::handleUserUpdateBalance(std::shared_ptr<ClientSession> sessi
     }
     catch (const std::exception &e)
     {
-        sendErrorResponse(session, "无效的充值金额");
+        sendErrorResponse(session, message, "无效的充值金额");
         return;
     }
 
     if (amount <= 0)
     {
-        sendErrorResponse(session, "充值金额必须大于0");
+        sendErrorResponse(session, message, "充值金额必须大于0");
         return;
     }
 
@@ -569,7 +1028,7 @@ void NetworkServer::handleUserUpdateBalance(std::shared_ptr<ClientSession> sessi
     User *user = User::findUser(users, username);
     if (!user)
     {
-        sendErrorResponse(session, "用户不存在");
+        sendErrorResponse(session, message, "用户不存在");
         return;
     }
 
@@ -582,24 +1041,24 @@ void NetworkServer::handleUserUpdateBalance(std::shared_ptr<ClientSession> sessi
         // 返回成功响应，包含新的余额
         std::map<std::string, std::string> responseData;
         responseData["newBalance"] = std::to_string(user->checkBalance());
-        sendSuccessResponse(session, responseData);
+        sendSuccessResponse(session, message, responseData);
 
         std::cout << "用户 " << username << " 充值成功，金额: " << amount
                   << "，当前余额: " << user->checkBalance() << std::endl;
     }
     else
     {
-        sendErrorResponse(session, "充值失败");
+        sendErrorResponse(session, message, "充值失败");
     }
 }
 
 // 用户密码修改处理
-void NetworkServer::handleUserChangePassword(std::shared_ptr<ClientSession> session, const Protocol::Message &message)
+void NetworkServer::handleUserChangePassword(std::shared_ptr<ClientSession> session, const Protocol::MessageView &message)
 {
     std::string username = session->getUsername();
     if (username.empty())
     {
-        sendErrorResponse(session, "用户未登录");
+        sendErrorResponse(session, message, "用户未登录");
         return;
     }
 
@@ -609,7 +1068,7 @@ void NetworkServer::handleUserChangePassword(std::shared_ptr<ClientSession> sess
 
     if (oldPassword.empty() || newPassword.empty())
     {
-        sendErrorResponse(session, "密码不能为空");
+        sendErrorResponse(session, message, "密码不能为空");
         return;
     }
 
@@ -617,7 +1076,7 @@ void NetworkServer::handleUserChangePassword(std::shared_ptr<ClientSession> sess
     User *user = User::findUser(users, username);
     if (!user)
     {
-        sendErrorResponse(session, "用户不存在");
+        sendErrorResponse(session, message, "用户不存在");
         return;
     }
 
@@ -627,65 +1086,377 @@ void NetworkServer::handleUserChangePassword(std::shared_ptr<ClientSession> sess
         // 保存用户数据
         saveUserData();
 
-        sendSuccessResponse(session);
+        sendSuccessResponse(session, message);
 
         std::cout << "用户 " << username << " 密码修改成功" << std::endl;
     }
     else
     {
-        sendErrorResponse(session, "原密码错误");
+        sendErrorResponse(session, message, "原密码错误");
     }
 }
 
 // 商品获取处理
-void NetworkServer::handleProductGetAll(std::shared_ptr<ClientSession> session, const Protocol::Message &message)
+void NetworkServer::handleProductGetAll(std::shared_ptr<ClientSession> session, const Protocol::MessageView &message)
 {
-    std::vector<Product *> allProducts = store->getProducts();
-    std::vector<Protocol::ProductData> productDataList = convertToProductDataList(allProducts);
+    if (message.hasData("limit") || message.hasData("cursor") || message.hasData("sort"))
+    {
+        handleProductPage(session, message, "");
+        return;
+    }
 
-    std::map<std::string, std::string> responseData;
-    responseData["count"] = std::to_string(productDataList.size());
+    // 目录未变化时直接复用预编码的消息体，不做任何转换和序列化
+    std::shared_ptr<const CatalogSnapshot> snapshot = catalogCache->get();
+    Protocol::WireFormat format = session->getWireFormat();
+    sendSharedResponse(session, message, format, snapshot->getBody(format));
+}
+
+// 商品增量同步处理：客户端带上持有的目录标识和版本，只返回此后新增、变化或移除的商品。
+// 标识不符（服务端已重启）、变更日志已不完整或变化的商品过多时回退为与 GET_ALL 相同的全量响应
+void NetworkServer::handleProductSync(std::shared_ptr<ClientSession> session, const Protocol::MessageView &message)
+{
+    std::shared_ptr<const CatalogSnapshot> snapshot = catalogCache->get();
+    Protocol::WireFormat format = session->getWireFormat();
+
+    long long epoch = 0;
+    long long sinceVersion = 0;
+    CatalogDelta delta;
+    bool canDelta = message.getInt("epoch", epoch) && message.getInt("sinceVersion", sinceVersion) &&
+                    static_cast<uint64_t>(epoch) == snapshot->getEpoch() && sinceVersion >= 0 &&
+                    catalogCache->getDelta(*snapshot, static_cast<uint64_t>(sinceVersion), delta) &&
+                    delta.size() * 2 <= snapshot->getProductCount(); // 变化超过目录的一半时全量响应更省事，也不会更大
+
+    if (!canDelta)
+    {
+        sendSharedResponse(session, message, format, snapshot->getBody(format));
+        return;
+    }
+
+    Protocol::Message response(Protocol::MessageType::RESPONSE_DATA);
+    response.setData("epoch", std::to_string(snapshot->getEpoch()));
+    response.setData("version", std::to_string(snapshot->getVersion()));
+    response.setData("delta", "1");
+    std::vector<std::string> &products = response.addList("products");
+    products.reserve(delta.positions.size());
+    // 按目录顺序发送，客户端追加新商品时与全量列表的顺序一致
+    for (size_t position : delta.positions)
+    {
+        const CatalogSnapshot::Entry &entry = *snapshot->getEntries()[position];
+        products.push_back(format == Protocol::WireFormat::BINARY ? entry.binaryRecord : entry.textRecord);
+    }
+    std::vector<std::string> &removedIds = response.addList("removedIds");
+    std::vector<std::string> &removedSellers = response.addList("removedSellers");
+    for (const CatalogChange &change : delta.removed)
+    {
+        removedIds.push_back(change.productId);
+        removedSellers.push_back(change.sellerUsername);
+    }
+    sendResponse(session, message, response);
+}
+
+// 商品变化订阅处理：scope=catalog 订阅整个目录（可带 epoch/sinceVersion 指定推送起点），
+// 否则订阅 productIds 列表中的商品。变化由 SubscriptionManager 按节拍合并后推送
+void NetworkServer::handleProductSubscribe(std::shared_ptr<ClientSession> session, const Protocol::MessageView &message)
+{
+    uint64_t version = 0;
+    if (message.getData("scope") == "catalog")
+    {
+        long long epoch = 0;
+        long long sinceVersion = -1;
+        message.getInt("epoch", epoch);
+        message.getInt("sinceVersion", sinceVersion);
+        if (sinceVersion < 0)
+        {
+            epoch = 0; // 未提供版本，从当前版本开始推送
+            sinceVersion = 0;
+        }
+        version = subscriptionManager->subscribeCatalog(session, static_cast<uint64_t>(epoch), static_cast<uint64_t>(sinceVersion));
+    }
+    else
+    {
+        Protocol::ListView productIds = message.getList("productIds");
+        if (productIds.empty())
+        {
+            sendErrorResponse(session, message, "订阅的商品列表不能为空");
+            return;
+        }
+        std::vector<std::string> ids;
+        ids.reserve(productIds.size());
+        for (const auto &productId : productIds)
+        {
+            ids.emplace_back(productId);
+        }
+        version = subscriptionManager->subscribeProducts(session, ids);
+    }
 
-    for (size_t i = 0; i < productDataList.size(); ++i)
+    sendSuccessResponse(session, message, {{"epoch", std::to_string(store->getCatalogEpoch())}, {"version", std::to_string(version)}});
+}
+
+void NetworkServer::handleProductUnsubscribe(std::shared_ptr<ClientSession> session, const Protocol::MessageView &message)
+{
+    std::vector<std::string> ids;
+    for (const auto &productId : message.getList("productIds"))
+    {
+        ids.emplace_back(productId);
+    }
+    subscriptionManager->unsubscribe(session->getSessionId(), ids);
+    sendSuccessResponse(session, message);
+}
+
+// 把一个维度的计数写成两个平行列表：<name>Values 和 <name>Counts
+static void addFacetCounts(Protocol::Message &response, const std::string &name, const std::vector<FacetCount> &counts)
+{
+    std::vector<std::string> &values = response.addList(name + "Values");
+    std::vector<std::string> &numbers = response.addList(name + "Counts");
+    for (const FacetCount &count : counts)
     {
-        responseData["product_" + std::to_string(i)] = productDataList[i].serialize();
+        values.push_back(count.value);
+        numbers.push_back(std::to_string(count.count));
     }
-    sendDataResponse(session, responseData);
+}
+
+// 商品分页处理：在目录快照上过滤、排序后取一页。第一页在当前快照上取并保留该快照，
+// 后续页面由游标指回同一快照，浏览过程中目录发生变化也不会重复或遗漏商品。
+// 响应带 total（满足条件的总数）和 nextCursor（没有下一页时为空）；
+// 带筛选条件时还附带各维度计数（见 CatalogFacetCounts）
+void NetworkServer::handleProductPage(std::shared_ptr<ClientSession> session, const Protocol::MessageView &message, const std::string &keyword,
+                                      const CatalogFilter *filter)
+{
+    CatalogPageQuery query;
+    if (filter)
+    {
+        query.filterKey = filter->describe();
+    }
+    query.keyword = SearchIndex::normalize(keyword);
+    std::vector<Product *> matches;
+    if (!keyword.empty())
+    {
+        matches = store->searchProducts(keyword);
+        query.matches = &matches;
+    }
+    if (!parseCatalogSortKey(message.getData("sort"), query.sortKey))
+    {
+        sendErrorResponse(session, message, "不支持的排序字段: " + message.getData("sort"));
+        return;
+    }
+    std::string order = message.getData("order");
+    if (!order.empty() && order != "asc" && order != "desc")
+    {
+        sendErrorResponse(session, message, "排序方向只能是 asc 或 desc");
+        return;
+    }
+    query.descending = order == "desc";
+
+    long long limit = static_cast<long long>(kDefaultProductPageSize);
+    if (message.hasData("limit") && (!message.getInt("limit", limit) || limit <= 0))
+    {
+        sendErrorResponse(session, message, "每页条数必须是正整数");
+        return;
+    }
+    query.limit = static_cast<size_t>(limit) > kMaxProductPageSize ? kMaxProductPageSize : static_cast<size_t>(limit);
+
+    std::shared_ptr<const CatalogSnapshot> snapshot;
+    std::string cursorText = message.getData("cursor");
+    if (cursorText.empty())
+    {
+        snapshot = catalogCache->get();
+    }
+    else
+    {
+        CatalogCursor cursor;
+        if (!decodeCatalogCursor(cursorText, cursor) || cursor.queryHash != hashCatalogQuery(query))
+        {
+            sendErrorResponse(session, message, "分页游标无效或与查询条件不符");
+            return;
+        }
+        snapshot = catalogCache->find(cursor.epoch, cursor.version);
+        if (!snapshot)
+        {
+            sendErrorResponse(session, message, "分页游标已过期，请重新加载");
+            return;
+        }
+        query.offset = cursor.offset;
+    }
+
+    FacetBitmap filtered;
+    CatalogFacetCounts facetCounts;
+    if (filter)
+    {
+        // 关键词命中的商品也转成位图，与筛选条件一起求交并参与各维度计数
+        FacetBitmap matched;
+        const FacetBitmap *extra = nullptr;
+        if (!keyword.empty())
+        {
+            matched = FacetBitmap(snapshot->getProductCount());
+            for (const Product *product : matches)
+            {
+                size_t position = 0;
+                if (snapshot->findPosition(product, position))
+                {
+                    matched.set(position);
+                }
+            }
+            extra = &matched;
+        }
+        std::shared_ptr<const FacetIndex> facetIndex = snapshot->getFacetIndex();
+        filtered = facetIndex->apply(*filter, extra);
+        facetCounts = facetIndex->count(*filter, extra);
+        query.filter = &filtered;
+    }
+
+    CatalogPage page;
+    snapshot->collectPage(query, page);
+
+    Protocol::WireFormat format = session->getWireFormat();
+    Protocol::Message response(Protocol::MessageType::RESPONSE_DATA);
+    response.setData("epoch", std::to_string(snapshot->getEpoch()));
+    response.setData("version", std::to_string(snapshot->getVersion()));
+    response.setData("total", std::to_string(page.total));
+    response.setData("offset", std::to_string(query.offset));
+
+    size_t nextOffset = query.offset + page.positions.size();
+    std::string nextCursor;
+    if (nextOffset < page.total && !page.positions.empty())
+    {
+        CatalogCursor cursor;
+        cursor.epoch = snapshot->getEpoch();
+        cursor.version = snapshot->getVersion();
+        cursor.queryHash = hashCatalogQuery(query);
+        cursor.offset = nextOffset;
+        nextCursor = encodeCatalogCursor(cursor);
+        catalogCache->pin(snapshot);
+    }
+    response.setData("nextCursor", nextCursor);
+    if (filter)
+    {
+        addFacetCounts(response, "category", facetCounts.categories);
+        addFacetCounts(response, "type", facetCounts.types);
+        addFacetCounts(response, "seller", facetCounts.sellers);
+        addFacetCounts(response, "priceRange", facetCounts.priceRanges);
+        response.setData("inStockCount", std::to_string(facetCounts.inStock));
+        response.setData("discountedCount", std::to_string(facetCounts.discounted));
+    }
+
+    std::vector<std::string> &products = response.addList("products");
+    products.reserve(page.positions.size());
+    for (size_t position : page.positions)
+    {
+        const CatalogSnapshot::Entry &entry = *snapshot->getEntries()[position];
+        products.push_back(format == Protocol::WireFormat::BINARY ? entry.binaryRecord : entry.textRecord);
+    }
+    sendResponse(session, message, response);
 }
 
 // 商品搜索处理
-void NetworkServer::handleProductSearch(std::shared_ptr<ClientSession> session, const Protocol::Message &message)
+void NetworkServer::handleProductSearch(std::shared_ptr<ClientSession> session, const Protocol::MessageView &message)
 {
     std::string keyword = message.getData("keyword");
     if (keyword.empty())
     {
-        sendErrorResponse(session, "搜索关键词不能为空");
+        sendErrorResponse(session, message, "搜索关键词不能为空");
+        return;
+    }
+    if (message.hasData("limit") || message.hasData("cursor") || message.hasData("sort"))
+    {
+        handleProductPage(session, message, keyword);
         return;
     }
 
-    // 使用Store的搜索功能
-    std::vector<Product *> searchResults = store->searchProductsByName(keyword);
+    // 在名称、描述和分类中检索
+    std::vector<Product *> searchResults = store->searchProducts(keyword);
     std::vector<Protocol::ProductData> productDataList = convertToProductDataList(searchResults);
 
-    std::map<std::string, std::string> responseData;
-    responseData["count"] = std::to_string(productDataList.size());
-
-    for (size_t i = 0; i < productDataList.size(); ++i)
+    Protocol::Message response(Protocol::MessageType::RESPONSE_DATA);
+    std::vector<std::string> &products = response.addList("products");
+    products.reserve(productDataList.size());
+    for (const auto &productData : productDataList)
     {
-        responseData["product_" + std::to_string(i)] = productDataList[i].serialize();
+        products.push_back(productData.encode(session->getWireFormat()));
     }
 
-    sendDataResponse(session, responseData);
+    sendResponse(session, message, response);
     std::cout << "商品搜索完成，关键词: \"" << keyword << "\"，找到 " << productDataList.size() << " 个结果" << std::endl;
 }
 
+// 商品筛选处理：categories、types、sellers 为列表（同一维度内任一匹配），
+// minPrice/maxPrice 按折扣后价格，inStock=1 只看有货，discounted=1 只看有折扣；
+// 可再带 keyword 与搜索组合。分页参数与 PRODUCT_GET_ALL 相同
+void NetworkServer::handleProductFilter(std::shared_ptr<ClientSession> session, const Protocol::MessageView &message)
+{
+    CatalogFilter filter;
+    for (const auto &value : message.getList("categories"))
+    {
+        filter.categories.emplace_back(value);
+    }
+    for (const auto &value : message.getList("types"))
+    {
+        filter.types.emplace_back(value);
+    }
+    for (const auto &value : message.getList("sellers"))
+    {
+        filter.sellers.emplace_back(value);
+    }
+
+    try
+    {
+        if (message.hasData("minPrice"))
+        {
+            filter.minPrice = std::stod(message.getData("minPrice"));
+        }
+        if (message.hasData("maxPrice"))
+        {
+            filter.maxPrice = std::stod(message.getData("maxPrice"));
+        }
+    }
+    catch (const std::exception &e)
+    {
+        sendErrorResponse(session, message, "无效的价格区间");
+        return;
+    }
+    if (filter.minPrice >= 0.0 && filter.maxPrice >= 0.0 && filter.minPrice > filter.maxPrice)
+    {
+        sendErrorResponse(session, message, "最低价格不能高于最高价格");
+        return;
+    }
+    filter.inStockOnly = message.getData("inStock") == "1";
+    filter.discountedOnly = message.getData("discounted") == "1";
+
+    handleProductPage(session, message, message.getData("keyword"), &filter);
+}
+
+// 搜索联想处理：返回 suggestions（商品名称）和对应的 stocks（同名商品库存合计），按库存从多到少
+void NetworkServer::handleProductSuggest(std::shared_ptr<ClientSession> session, const Protocol::MessageView &message)
+{
+    long long limit = static_cast<long long>(kDefaultSuggestionCount);
+    if (message.hasData("limit") && (!message.getInt("limit", limit) || limit <= 0))
+    {
+        sendErrorResponse(session, message, "联想条数必须是正整数");
+        return;
+    }
+    size_t count = static_cast<size_t>(limit) > SuggestIndex::kMaxSuggestions ? SuggestIndex::kMaxSuggestions : static_cast<size_t>(limit);
+
+    std::vector<SuggestIndex::Suggestion> suggestions = store->suggestProducts(message.getData("prefix"), count);
+
+    Protocol::Message response(Protocol::MessageType::RESPONSE_DATA);
+    std::vector<std::string> &names = response.addList("suggestions");
+    std::vector<std::string> &stocks = response.addList("stocks");
+    names.reserve(suggestions.size());
+    stocks.reserve(suggestions.size());
+    for (const auto &suggestion : suggestions)
+    {
+        names.push_back(suggestion.name);
+        stocks.push_back(std::to_string(suggestion.stock));
+    }
+    sendResponse(session, message, response);
+}
+
 // 购物车获取处理
-void NetworkServer::handleCartGet(std::shared_ptr<ClientSession> session, const Protocol::Message &message)
+void NetworkServer::handleCartGet(std::shared_ptr<ClientSession> session, const Protocol::MessageView &message)
 {
     std::string username = session->getUsername();
     if (username.empty())
     {
-        sendErrorResponse(session, "用户未登录");
+        sendErrorResponse(session, message, "用户未登录");
         return;
     }
 
@@ -694,16 +1465,17 @@ void NetworkServer::handleCartGet(std::shared_ptr<ClientSession> session, const
     Customer *customer = dynamic_cast<Customer *>(user);
     if (!customer)
     {
-        sendErrorResponse(session, "不是消费者用户");
+        sendErrorResponse(session, message, "不是消费者用户");
         return;
     }
 
     // 获取购物车数据
+    customer->upgradeLegacyCartItems(*store);
     std::vector<Protocol::CartItemData> cartData;
     for (const auto &item : customer->shoppingCartItems)
     {
         Protocol::CartItemData cartItem;
-        cartItem.productId = item.productId;
+        cartItem.productId = Store::productIdText(item.productId, item.productName);
         cartItem.productName = item.productName;
         cartItem.quantity = item.quantity;
         cartItem.priceAtAddition = item.priceAtAddition;
@@ -711,24 +1483,24 @@ void NetworkServer::handleCartGet(std::shared_ptr<ClientSession> session, const
         cartData.push_back(cartItem);
     }
 
-    std::map<std::string, std::string> responseData;
-    responseData["count"] = std::to_string(cartData.size());
-
-    for (size_t i = 0; i < cartData.size(); ++i)
+    Protocol::Message response(Protocol::MessageType::RESPONSE_DATA);
+    std::vector<std::string> &items = response.addList("items");
+    items.reserve(cartData.size());
+    for (const auto &cartItem : cartData)
     {
-        responseData["item_" + std::to_string(i)] = cartData[i].serialize();
+        items.push_back(cartItem.encode(session->getWireFormat()));
     }
 
-    sendDataResponse(session, responseData);
+    sendResponse(session, message, response);
 }
 
 // 购物车添加商品处理
-void NetworkServer::handleCartAddItem(std::shared_ptr<ClientSession> session, const Protocol::Message &message)
+void NetworkServer::handleCartAddItem(std::shared_ptr<ClientSession> session, const Protocol::MessageView &message)
 {
     std::string username = session->getUsername();
     if (username.empty())
     {
-        sendErrorResponse(session, "用户未登录");
+        sendErrorResponse(session, message, "用户未登录");
         return;
     }
 
@@ -737,47 +1509,51 @@ void NetworkServer::handleCartAddItem(std::shared_ptr<ClientSession> session, co
     Customer *customer = dynamic_cast<Customer *>(user);
     if (!customer)
     {
-        sendErrorResponse(session, "不是消费者用户");
+        sendErrorResponse(session, message, "不是消费者用户");
         return;
     }
 
     std::string productId = message.getData("productId");
-    int quantity = std::stoi(message.getData("quantity"));
+    int quantity = 0;
+    if (!message.getInt("quantity", quantity) || quantity <= 0)
+    {
+        sendErrorResponse(session, message, "无效的数量");
+        return;
+    }
 
     // 查找商品
-    Product *product = store->findProductByName(productId);
+    Product *product = findRequestedProduct(session, message, productId);
     if (!product)
     {
-        sendErrorResponse(session, "商品不存在");
         return;
     }
 
     // 检查库存
     if (product->getQuantity() < quantity)
     {
-        sendErrorResponse(session, "库存不足");
+        sendErrorResponse(session, message, "库存不足");
         return;
     } // 添加到购物车 - 使用正确的方法名和参数
     if (customer->addToCart(*product, quantity))
     {
         // 添加成功，需要将商品信息保存到购物车文件
         customer->saveCartToFile();
-        sendSuccessResponse(session);
+        sendSuccessResponse(session, message);
         std::cout << "商品已添加到购物车: " << productId << ", 数量: " << quantity << std::endl;
     }
     else
     {
-        sendErrorResponse(session, "添加商品到购物车失败");
+        sendErrorResponse(session, message, "添加商品到购物车失败");
     }
 }
 
 // 购物车移除商品处理
-void NetworkServer::handleCartRemoveItem(std::shared_ptr<ClientSession> session, const Protocol::Message &message)
+void NetworkServer::handleCartRemoveItem(std::shared_ptr<ClientSession> session, const Protocol::MessageView &message)
 {
     std::string username = session->getUsername();
     if (username.empty())
     {
-        sendErrorResponse(session, "用户未登录");
+        sendErrorResponse(session, message, "用户未登录");
         return;
     }
 
@@ -786,30 +1562,33 @@ void NetworkServer::handleCartRemoveItem(std::shared_ptr<ClientSession> session,
     Customer *customer = dynamic_cast<Customer *>(user);
     if (!customer)
     {
-        sendErrorResponse(session, "不是消费者用户");
+        sendErrorResponse(session, message, "不是消费者用户");
         return;
     }
 
-    std::string productId = message.getData("productId"); // 从购物车移除商品 - 使用正确的方法名
-    if (customer->removeCartItem(productId))
+    std::string productId = message.getData("productId"); // 从购物车移除商品：商品ID，旧客户端可能发送商品名称
+    uint64_t numericId = 0;
+    bool removed = Store::parseProductId(productId, numericId) ? customer->removeCartItem(numericId)
+                                                               : customer->removeCartItem(productId);
+    if (removed)
     {
         customer->saveCartToFile();
-        sendSuccessResponse(session);
+        sendSuccessResponse(session, message);
         std::cout << "商品已从购物车移除: " << productId << std::endl;
     }
     else
     {
-        sendErrorResponse(session, "移除商品失败");
+        sendErrorResponse(session, message, "移除商品失败");
     }
 }
 
 // 购物车清空处理
-void NetworkServer::handleCartClear(std::shared_ptr<ClientSession> session, const Protocol::Message &message)
+void NetworkServer::handleCartClear(std::shared_ptr<ClientSession> session, const Protocol::MessageView &message)
 {
     std::string username = session->getUsername();
     if (username.empty())
     {
-        sendErrorResponse(session, "用户未登录");
+        sendErrorResponse(session, message, "用户未登录");
         return;
     }
 
@@ -818,24 +1597,24 @@ void NetworkServer::handleCartClear(std::shared_ptr<ClientSession> session, cons
     Customer *customer = dynamic_cast<Customer *>(user);
     if (!customer)
     {
-        sendErrorResponse(session, "不是消费者用户");
+        sendErrorResponse(session, message, "不是消费者用户");
         return;
     }
 
     // 清空购物车 - 使用正确的方法名
     customer->clearCartAndFile();
 
-    sendSuccessResponse(session);
+    sendSuccessResponse(session, message);
     std::cout << "购物车已清空，用户: " << username << std::endl;
 }
 
 // 购物车商品数量更新处理
-void NetworkServer::handleCartUpdateItem(std::shared_ptr<ClientSession> session, const Protocol::Message &message)
+void NetworkServer::handleCartUpdateItem(std::shared_ptr<ClientSession> session, const Protocol::MessageView &message)
 {
     std::string username = session->getUsername();
     if (username.empty())
     {
-        sendErrorResponse(session, "用户未登录");
+        sendErrorResponse(session, message, "用户未登录");
         return;
     }
 
@@ -844,7 +1623,7 @@ void NetworkServer::handleCartUpdateItem(std::shared_ptr<ClientSession> session,
     Customer *customer = dynamic_cast<Customer *>(user);
     if (!customer)
     {
-        sendErrorResponse(session, "不是消费者用户");
+        sendErrorResponse(session, message, "不是消费者用户");
         return;
     }
 
@@ -856,68 +1635,70 @@ void NetworkServer::handleCartUpdateItem(std::shared_ptr<ClientSession> session,
     }
     catch (const std::exception &e)
     {
-        sendErrorResponse(session, "无效的数量");
+        sendErrorResponse(session, message, "无效的数量");
         return;
     }
 
     // 检查数量是否有效
     if (newQuantity < 0)
     {
-        sendErrorResponse(session, "数量不能为负数");
+        sendErrorResponse(session, message, "数量不能为负数");
         return;
     }
 
     // 如果新数量为0，则移除商品
     if (newQuantity == 0)
     {
-        if (customer->removeCartItem(productId))
+        uint64_t numericId = 0;
+        bool removed = Store::parseProductId(productId, numericId) ? customer->removeCartItem(numericId)
+                                                                   : customer->removeCartItem(productId);
+        if (removed)
         {
             customer->saveCartToFile();
-            sendSuccessResponse(session);
+            sendSuccessResponse(session, message);
             std::cout << "商品已从购物车移除: " << productId << std::endl;
         }
         else
         {
-            sendErrorResponse(session, "移除商品失败");
+            sendErrorResponse(session, message, "移除商品失败");
         }
         return;
     }
 
     // 查找商品以检查库存
-    Product *product = store->findProductByName(productId);
+    Product *product = findRequestedProduct(session, message, productId);
     if (!product)
     {
-        sendErrorResponse(session, "商品不存在");
         return;
     }
 
     // 检查库存
     if (product->getQuantity() < newQuantity)
     {
-        sendErrorResponse(session, "库存不足");
+        sendErrorResponse(session, message, "库存不足");
         return;
     }
 
     // 更新购物车商品数量
-    if (customer->updateCartItemQuantity(productId, newQuantity, *store))
+    if (customer->updateCartItemQuantity(*product, newQuantity))
     {
         customer->saveCartToFile();
-        sendSuccessResponse(session);
+        sendSuccessResponse(session, message);
         std::cout << "购物车商品数量已更新: " << productId << ", 新数量: " << newQuantity << std::endl;
     }
     else
     {
-        sendErrorResponse(session, "更新购物车商品数量失败");
+        sendErrorResponse(session, message, "更新购物车商品数量失败");
     }
 }
 
 // 添加商品处理
-void NetworkServer::handleProductAdd(std::shared_ptr<ClientSession> session, const Protocol::Message &message)
+void NetworkServer::handleProductAdd(std::shared_ptr<ClientSession> session, const Protocol::MessageView &message)
 {
     std::string username = session->getUsername();
     if (username.empty())
     {
-        sendErrorResponse(session, "用户未登录");
+        sendErrorResponse(session, message, "用户未登录");
         return;
     }
 
@@ -926,12 +1707,12 @@ void NetworkServer::handleProductAdd(std::shared_ptr<ClientSession> session, con
     Seller *seller = dynamic_cast<Seller *>(user);
     if (!seller)
     {
-        sendErrorResponse(session, "不是商家用户");
+        sendErrorResponse(session, message, "不是商家用户");
         return;
     }
     // 解析商品数据
     std::string productDataStr = message.getData("productData");
-    Protocol::ProductData productData = Protocol::ProductData::deserialize(productDataStr);    // 根据商品类型创建具体的商品对象，使用从客户端发送的attributes数据
+    Protocol::ProductData productData = Protocol::ProductData::decode(productDataStr);    // 根据商品类型创建具体的商品对象，使用从客户端发送的attributes数据
     bool success = false;
     if (productData.type == "Book")
     {
@@ -1000,22 +1781,22 @@ void NetworkServer::handleProductAdd(std::shared_ptr<ClientSession> session, con
     // 检查创建结果
     if (success)
     {
-        sendSuccessResponse(session);
+        sendSuccessResponse(session, message);
         std::cout << "商品添加成功: " << productData.name << "，商家: " << seller->getUsername() << std::endl;
     }
     else
     {
-        sendErrorResponse(session, "添加商品失败");
+        sendErrorResponse(session, message, "添加商品失败");
     }
 }
 
 // 订单创建处理
-void NetworkServer::handleOrderCreate(std::shared_ptr<ClientSession> session, const Protocol::Message &message)
+void NetworkServer::handleOrderCreate(std::shared_ptr<ClientSession> session, const Protocol::MessageView &message)
 {
     std::string username = session->getUsername();
     if (username.empty())
     {
-        sendErrorResponse(session, "用户未登录");
+        sendErrorResponse(session, message, "用户未登录");
         return;
     }
 
@@ -1024,17 +1805,18 @@ void NetworkServer::handleOrderCreate(std::shared_ptr<ClientSession> session, co
     Customer *customer = dynamic_cast<Customer *>(user);
     if (!customer)
     {
-        sendErrorResponse(session, "不是消费者用户");
+        sendErrorResponse(session, message, "不是消费者用户");
         return;
     }
 
     // 检查购物车是否为空
     if (customer->shoppingCartItems.empty())
     {
-        sendErrorResponse(session, "购物车为空");
+        sendErrorResponse(session, message, "购物车为空");
         return;
     }
     // 创建订单
+    customer->upgradeLegacyCartItems(*store);
     Order newOrder(customer->getUsername());
     for (const auto &cartItem : customer->shoppingCartItems)
     { // 将CartItem转换为OrderItem
@@ -1043,6 +1825,10 @@ void NetworkServer::handleOrderCreate(std::shared_ptr<ClientSession> session, co
                             cartItem.sellerUsername);
         newOrder.addItem(orderItem);
     }
+    if (!attachOrderReservation(session, message, newOrder))
+    {
+        return;
+    }
 
     // 提交订单给订单管理器
     auto submittedOrder = orderManager->submitOrderRequest(newOrder);
@@ -1055,23 +1841,25 @@ void NetworkServer::handleOrderCreate(std::shared_ptr<ClientSession> session, co
 
         std::map<std::string, std::string> responseData;
         responseData["orderId"] = submittedOrder->getOrderId();
-        sendSuccessResponse(session, responseData);
+        sendSuccessResponse(session, message, responseData);
 
         std::cout << "订单创建成功: " << submittedOrder->getOrderId() << std::endl;
     }
     else
     {
-        sendErrorResponse(session, "订单创建失败");
+        // 订单没能进入队列，带来的预留由这里解锁
+        releaseOrderReservation(newOrder);
+        sendErrorResponse(session, message, "订单创建失败");
     }
 }
 
 // 直接购买处理
-void NetworkServer::handleDirectPurchase(std::shared_ptr<ClientSession> session, const Protocol::Message &message)
+void NetworkServer::handleDirectPurchase(std::shared_ptr<ClientSession> session, const Protocol::MessageView &message)
 {
     std::string username = session->getUsername();
     if (username.empty())
     {
-        sendErrorResponse(session, "用户未登录");
+        sendErrorResponse(session, message, "用户未登录");
         return;
     }
 
@@ -1080,35 +1868,46 @@ void NetworkServer::handleDirectPurchase(std::shared_ptr<ClientSession> session,
     Customer *customer = dynamic_cast<Customer *>(user);
     if (!customer)
     {
-        sendErrorResponse(session, "不是消费者用户");
+        sendErrorResponse(session, message, "不是消费者用户");
         return;
     }
 
     // 获取请求参数
     std::string productId = message.getData("productId");
-    int quantity = std::stoi(message.getData("quantity"));
-
-    // 查找商品
-    Product *product = store->findProductByName(productId);
-    if (!product)
+    int quantity = 0;
+    if (!message.getInt("quantity", quantity) || quantity <= 0)
     {
-        sendErrorResponse(session, "商品不存在");
+        sendErrorResponse(session, message, "无效的数量");
         return;
     }
 
-    // 检查库存
-    if (product->getQuantity() < quantity)
+    // 查找商品
+    Product *product = findRequestedProduct(session, message, productId);
+    if (!product)
     {
-        sendErrorResponse(session, "库存不足");
         return;
     }
 
     // 创建直接购买订单（不涉及购物车）
     Order newOrder(customer->getUsername());
-    OrderItem orderItem(product->getName(), product->getName(),
+    OrderItem orderItem(product->getId(), product->getName(),
                         quantity, product->getPrice(),
                         product->getSellerUsername());
     newOrder.addItem(orderItem);
+    if (!attachOrderReservation(session, message, newOrder))
+    {
+        return;
+    }
+
+    // 检查库存：可售库存加上本单带来的买家预留
+    auto reservedIt = newOrder.getReservedQuantities().find(product->getId());
+    int reservedPart = reservedIt != newOrder.getReservedQuantities().end() ? reservedIt->second : 0;
+    if (product->getAvailable() + reservedPart < quantity)
+    {
+        releaseOrderReservation(newOrder);
+        sendErrorResponse(session, message, "库存不足");
+        return;
+    }
 
     // 提交订单给订单管理器
     auto submittedOrder = orderManager->submitOrderRequest(newOrder);
@@ -1119,23 +1918,71 @@ void NetworkServer::handleDirectPurchase(std::shared_ptr<ClientSession> session,
 
         std::map<std::string, std::string> responseData;
         responseData["orderId"] = submittedOrder->getOrderId();
-        sendSuccessResponse(session, responseData);
+        sendSuccessResponse(session, message, responseData);
 
         std::cout << "直接购买订单创建成功: " << submittedOrder->getOrderId() << std::endl;
     }
     else
     {
-        sendErrorResponse(session, "直接购买订单创建失败");
+        // 订单没能进入队列，带来的预留由这里解锁
+        releaseOrderReservation(newOrder);
+        sendErrorResponse(session, message, "直接购买订单创建失败");
+    }
+}
+
+void NetworkServer::releaseOrderReservation(const Order &order)
+{
+    for (const auto &reserved : order.getReservedQuantities())
+    {
+        store->unlockInventory(reserved.first, reserved.second);
     }
 }
 
+bool NetworkServer::attachOrderReservation(std::shared_ptr<ClientSession> session, const Protocol::MessageView &message, Order &order)
+{
+    std::string reservationText = message.getData("reservationId");
+    if (reservationText.empty())
+    {
+        // 未指定预留（旧客户端只记得锁过哪些商品）：本会话锁定的同一商品按订单数量交给订单，
+        // 否则买家自己锁定的库存在结算时也算作不可售
+        for (const OrderItem &item : order.getItems())
+        {
+            if (item.productId == 0)
+            {
+                continue;
+            }
+            int taken = reservationManager->takeQuantity(session->getSessionId(), item.productId, item.quantity);
+            if (taken > 0)
+            {
+                order.addReservedQuantity(item.productId, taken);
+            }
+        }
+        return true;
+    }
+
+    uint64_t reservationId = 0;
+    std::vector<ReservationManager::Item> items;
+    if (!Store::parseProductId(reservationText, reservationId) ||
+        !reservationManager->take(session->getSessionId(), reservationId, items))
+    {
+        sendErrorResponse(session, message, "下单失败：预留不存在、已过期或不属于当前会话");
+        return false;
+    }
+    for (const ReservationManager::Item &item : items)
+    {
+        order.addReservedQuantity(item.productId, item.quantity);
+    }
+    std::cout << "订单使用库存预留: " << reservationId << std::endl;
+    return true;
+}
+
 // 获取用户订单处理
-void NetworkServer::handleOrderGetByUser(std::shared_ptr<ClientSession> session, const Protocol::Message &message)
+void NetworkServer::handleOrderGetByUser(std::shared_ptr<ClientSession> session, const Protocol::MessageView &message)
 {
     std::string username = session->getUsername();
     if (username.empty())
     {
-        sendErrorResponse(session, "用户未登录");
+        sendErrorResponse(session, message, "用户未登录");
         return;
     }
 
@@ -1189,7 +2036,7 @@ void NetworkServer::handleOrderGetByUser(std::shared_ptr<ClientSession> session,
         for (const auto &item : order->getItems())
         {
             Protocol::CartItemData cartItem;
-            cartItem.productId = item.productId;
+            cartItem.productId = Store::productIdText(item.productId, item.productName);
             cartItem.productName = item.productName;
             cartItem.quantity = item.quantity;
             cartItem.priceAtAddition = item.priceAtPurchase;
@@ -1201,23 +2048,23 @@ void NetworkServer::handleOrderGetByUser(std::shared_ptr<ClientSession> session,
     }
 
     // 发送响应
-    std::map<std::string, std::string> responseData;
-    responseData["count"] = std::to_string(orderDataList.size());
-
-    for (size_t i = 0; i < orderDataList.size(); ++i)
+    Protocol::Message response(Protocol::MessageType::RESPONSE_DATA);
+    std::vector<std::string> &orders = response.addList("orders");
+    orders.reserve(orderDataList.size());
+    for (const auto &orderData : orderDataList)
     {
-        responseData["order_" + std::to_string(i)] = orderDataList[i].serialize();
+        orders.push_back(orderData.encode(session->getWireFormat()));
     }
-    sendDataResponse(session, responseData);
+    sendResponse(session, message, response);
 }
 
 // 商家管理处理函数
-void NetworkServer::handleProductManagePrice(std::shared_ptr<ClientSession> session, const Protocol::Message &message)
+void NetworkServer::handleProductManagePrice(std::shared_ptr<ClientSession> session, const Protocol::MessageView &message)
 {
     std::string username = session->getUsername();
     if (username.empty())
     {
-        sendErrorResponse(session, "用户未登录");
+        sendErrorResponse(session, message, "用户未登录");
         return;
     }
 
@@ -1226,12 +2073,17 @@ void NetworkServer::handleProductManagePrice(std::shared_ptr<ClientSession> sess
     Seller *seller = dynamic_cast<Seller *>(user);
     if (!seller)
     {
-        sendErrorResponse(session, "不是商家用户");
+        sendErrorResponse(session, message, "不是商家用户");
         return;
     }
 
     // 获取参数
-    std::string productName = message.getData("productName");
+    // 按商品ID修改；旧客户端只发送商品名称
+    std::string productId = message.getData("productId");
+    if (productId.empty())
+    {
+        productId = message.getData("productName");
+    }
     double newPrice = 0.0;
     try
     {
@@ -1239,28 +2091,28 @@ void NetworkServer::handleProductManagePrice(std::shared_ptr<ClientSession> sess
     }
     catch (const std::exception &e)
     {
-        sendErrorResponse(session, "无效的价格");
+        sendErrorResponse(session, message, "无效的价格");
         return;
     }
 
     // 调用Store方法修改价格
-    if (store->manageProductPrice(seller, productName, newPrice))
+    if (store->manageProductPrice(seller, productId, newPrice))
     {
-        sendSuccessResponse(session);
-        std::cout << "商家 " << username << " 修改商品 " << productName << " 价格为 " << newPrice << std::endl;
+        sendSuccessResponse(session, message);
+        std::cout << "商家 " << username << " 修改商品 " << productId << " 价格为 " << newPrice << std::endl;
     }
     else
     {
-        sendErrorResponse(session, "修改价格失败");
+        sendErrorResponse(session, message, "修改价格失败");
     }
 }
 
-void NetworkServer::handleProductManageQuantity(std::shared_ptr<ClientSession> session, const Protocol::Message &message)
+void NetworkServer::handleProductManageQuantity(std::shared_ptr<ClientSession> session, const Protocol::MessageView &message)
 {
     std::string username = session->getUsername();
     if (username.empty())
     {
-        sendErrorResponse(session, "用户未登录");
+        sendErrorResponse(session, message, "用户未登录");
         return;
     }
 
@@ -1269,12 +2121,17 @@ void NetworkServer::handleProductManageQuantity(std::shared_ptr<ClientSession> s
     Seller *seller = dynamic_cast<Seller *>(user);
     if (!seller)
     {
-        sendErrorResponse(session, "不是商家用户");
+        sendErrorResponse(session, message, "不是商家用户");
         return;
     }
 
     // 获取参数
-    std::string productName = message.getData("productName");
+    // 按商品ID修改；旧客户端只发送商品名称
+    std::string productId = message.getData("productId");
+    if (productId.empty())
+    {
+        productId = message.getData("productName");
+    }
     int newQuantity = 0;
     try
     {
@@ -1282,28 +2139,28 @@ void NetworkServer::handleProductManageQuantity(std::shared_ptr<ClientSession> s
     }
     catch (const std::exception &e)
     {
-        sendErrorResponse(session, "无效的数量");
+        sendErrorResponse(session, message, "无效的数量");
         return;
     }
 
     // 调用Store方法修改库存
-    if (store->manageProductQuantity(seller, productName, newQuantity))
+    if (store->manageProductQuantity(seller, productId, newQuantity))
     {
-        sendSuccessResponse(session);
-        std::cout << "商家 " << username << " 修改商品 " << productName << " 库存为 " << newQuantity << std::endl;
+        sendSuccessResponse(session, message);
+        std::cout << "商家 " << username << " 修改商品 " << productId << " 库存为 " << newQuantity << std::endl;
     }
     else
     {
-        sendErrorResponse(session, "修改库存失败");
+        sendErrorResponse(session, message, "修改库存失败");
     }
 }
 
-void NetworkServer::handleProductManageDiscount(std::shared_ptr<ClientSession> session, const Protocol::Message &message)
+void NetworkServer::handleProductManageDiscount(std::shared_ptr<ClientSession> session, const Protocol::MessageView &message)
 {
     std::string username = session->getUsername();
     if (username.empty())
     {
-        sendErrorResponse(session, "用户未登录");
+        sendErrorResponse(session, message, "用户未登录");
         return;
     }
 
@@ -1312,12 +2169,17 @@ void NetworkServer::handleProductManageDiscount(std::shared_ptr<ClientSession> s
     Seller *seller = dynamic_cast<Seller *>(user);
     if (!seller)
     {
-        sendErrorResponse(session, "不是商家用户");
+        sendErrorResponse(session, message, "不是商家用户");
         return;
     }
 
     // 获取参数
-    std::string productName = message.getData("productName");
+    // 按商品ID修改；旧客户端只发送商品名称
+    std::string productId = message.getData("productId");
+    if (productId.empty())
+    {
+        productId = message.getData("productName");
+    }
     double newDiscount = 0.0;
     try
     {
@@ -1325,28 +2187,28 @@ void NetworkServer::handleProductManageDiscount(std::shared_ptr<ClientSession> s
     }
     catch (const std::exception &e)
     {
-        sendErrorResponse(session, "无效的折扣");
+        sendErrorResponse(session, message, "无效的折扣");
         return;
     }
 
     // 调用Store方法修改折扣
-    if (store->manageProductDiscount(seller, productName, newDiscount))
+    if (store->manageProductDiscount(seller, productId, newDiscount))
     {
-        sendSuccessResponse(session);
-        std::cout << "商家 " << username << " 修改商品 " << productName << " 折扣为 " << (newDiscount * 100) << "%" << std::endl;
+        sendSuccessResponse(session, message);
+        std::cout << "商家 " << username << " 修改商品 " << productId << " 折扣为 " << (newDiscount * 100) << "%" << std::endl;
     }
     else
     {
-        sendErrorResponse(session, "修改折扣失败");
+        sendErrorResponse(session, message, "修改折扣失败");
     }
 }
 
-void NetworkServer::handleProductApplyCategoryDiscount(std::shared_ptr<ClientSession> session, const Protocol::Message &message)
+void NetworkServer::handleProductApplyCategoryDiscount(std::shared_ptr<ClientSession> session, const Protocol::MessageView &message)
 {
     std::string username = session->getUsername();
     if (username.empty())
     {
-        sendErrorResponse(session, "用户未登录");
+        sendErrorResponse(session, message, "用户未登录");
         return;
     }
 
@@ -1355,7 +2217,7 @@ void NetworkServer::handleProductApplyCategoryDiscount(std::shared_ptr<ClientSes
     Seller *seller = dynamic_cast<Seller *>(user);
     if (!seller)
     {
-        sendErrorResponse(session, "不是商家用户");
+        sendErrorResponse(session, message, "不是商家用户");
         return;
     }
 
@@ -1368,141 +2230,154 @@ void NetworkServer::handleProductApplyCategoryDiscount(std::shared_ptr<ClientSes
     }
     catch (const std::exception &e)
     {
-        sendErrorResponse(session, "无效的折扣");
+        sendErrorResponse(session, message, "无效的折扣");
         return;
     }
 
     // 调用Store方法应用类别折扣
     if (store->applyCategoryDiscount(seller, category, discount))
     {
-        sendSuccessResponse(session);
+        sendSuccessResponse(session, message);
         std::cout << "商家 " << username << " 为类别 " << category << " 应用了 " << (discount * 100) << "% 折扣" << std::endl;
     }
     else
     {
-        sendErrorResponse(session, "应用类别折扣失败");
+        sendErrorResponse(session, message, "应用类别折扣失败");
     }
 }
 
 // 库存锁定处理
-void NetworkServer::handleInventoryLock(std::shared_ptr<ClientSession> session, const Protocol::Message &message)
+void NetworkServer::handleInventoryLock(std::shared_ptr<ClientSession> session, const Protocol::MessageView &message)
 {
     std::string username = session->getUsername();
     if (username.empty())
     {
-        sendErrorResponse(session, "用户未登录");
+        sendErrorResponse(session, message, "用户未登录");
         return;
     }
 
+    // 可选的 ttl（秒）指定预留有效期，到期未解锁的库存自动释放
+    long long ttl = 0;
+    message.getInt("ttl", ttl);
+    // 请求可能在连接断开前已排队，断开后才执行：会话已离线时不再生成预留
+    auto sessionActive = [&session]
+    {
+        return session->isSessionActive();
+    };
+
     // 检查是否有单个商品的锁定请求
     std::string productId = message.getData("productId");
     if (!productId.empty())
     {
         // 单个商品锁定
         int quantity = 0;
-        try
+        if (!message.getInt("quantity", quantity))
         {
-            quantity = std::stoi(message.getData("quantity"));
+            sendErrorResponse(session, message, "无效的数量");
+            return;
         }
-        catch (const std::exception &e)
+
+        Product *product = findRequestedProduct(session, message, productId);
+        if (!product)
         {
-            sendErrorResponse(session, "无效的数量");
             return;
         }
 
-        // 锁定库存
-        if (store->lockInventory(productId, quantity))
+        // 锁定库存，生成属于本会话的预留
+        uint64_t reservationId = reservationManager->reserve(session->getSessionId(), {{product->getId(), quantity}}, ttl, sessionActive);
+        if (reservationId != 0)
         {
-            sendSuccessResponse(session);
-            std::cout << "用户 " << username << " 锁定库存成功: " << productId << ", 数量: " << quantity << std::endl;
+            sendReservationResponse(session, message, reservationId, ttl);
+            std::cout << "用户 " << username << " 锁定库存成功: " << productId << ", 数量: " << quantity
+                      << ", 预留: " << reservationId << std::endl;
         }
         else
         {
-            sendErrorResponse(session, "库存锁定失败");
+            sendErrorResponse(session, message, "库存锁定失败");
         }
     }
     else
     {
-        // 多个商品锁定（购物车）
-        std::string itemCountStr = message.getData("itemCount");
-        if (itemCountStr.empty())
+        // 多个商品锁定（购物车）：productIds 与 quantities 两个列表按下标一一对应
+        Protocol::ListView productIds = message.getList("productIds");
+        Protocol::ListView quantities = message.getList("quantities");
+        if (productIds.empty())
         {
-            sendErrorResponse(session, "缺少商品数量信息");
+            sendErrorResponse(session, message, "缺少商品数量信息");
             return;
         }
-
-        int itemCount = 0;
-        try
+        if (productIds.size() != quantities.size())
         {
-            itemCount = std::stoi(itemCountStr);
+            sendErrorResponse(session, message, "商品信息不完整");
+            return;
         }
-        catch (const std::exception &e)
+        size_t itemCount = productIds.size();
+        // 可选的 sellers 列表指定各商品所属商家，多个商家有同名商品时必须提供
+        Protocol::ListView sellerList = message.getList("sellers");
+        std::vector<std::string> sellers(itemCount);
+        for (size_t i = 0; i < itemCount && i < sellerList.size(); ++i)
         {
-            sendErrorResponse(session, "无效的商品数量");
-            return;
+            sellers[i] = std::string(sellerList[i]);
         }
 
-        // 收集所有商品和数量
-        std::vector<std::pair<std::string, int>> items;
-        for (int i = 0; i < itemCount; ++i)
+        // 收集所有商品ID和数量
+        std::vector<ReservationManager::Item> items;
+        items.reserve(itemCount);
+        for (size_t i = 0; i < itemCount; ++i)
         {
-            std::string prodId = message.getData("productId_" + std::to_string(i));
-            std::string quantityStr = message.getData("quantity_" + std::to_string(i));
-
-            if (prodId.empty() || quantityStr.empty())
-            {
-                sendErrorResponse(session, "商品信息不完整");
-                return;
-            }
-
             int qty = 0;
-            try
+            if (productIds[i].empty() || !parseQuantity(quantities[i], qty))
             {
-                qty = std::stoi(quantityStr);
-            }
-            catch (const std::exception &e)
-            {
-                sendErrorResponse(session, "无效的商品数量");
+                sendErrorResponse(session, message, "无效的商品数量");
                 return;
             }
 
-            items.push_back({prodId, qty});
-        }
-
-        // 锁定所有商品的库存
-        bool allLocked = true;
-        for (const auto &item : items)
-        {
-            if (!store->lockInventory(item.first, item.second))
+            Product *product = nullptr;
+            if (store->lookupProduct(std::string(productIds[i]), sellers[i], product) != ProductLookup::FOUND)
             {
-                allLocked = false;
-                // 回滚已锁定的库存
-                for (int j = 0; j < &item - &items[0]; ++j)
-                {
-                    store->unlockInventory(items[j].first, items[j].second);
-                }
-                break;
+                sendErrorResponse(session, message, "商品不存在或存在多个同名商品: " + std::string(productIds[i]));
+                return;
             }
+            items.push_back(ReservationManager::Item{product->getId(), qty});
         }
 
-        if (allLocked)
+        // 锁定所有商品的库存，作为一个预留：任一商品不足时已锁定的部分全部回滚
+        uint64_t reservationId = reservationManager->reserve(session->getSessionId(), items, ttl, sessionActive);
+        if (reservationId != 0)
         {
-            sendSuccessResponse(session);
-            std::cout << "用户 " << username << " 购物车库存锁定成功，商品数量: " << itemCount << std::endl;
+            sendReservationResponse(session, message, reservationId, ttl);
+            std::cout << "用户 " << username << " 购物车库存锁定成功，商品数量: " << itemCount
+                      << ", 预留: " << reservationId << std::endl;
         }
         else
         {
-            sendErrorResponse(session, "购物车库存锁定失败");
+            sendErrorResponse(session, message, "购物车库存锁定失败");
         }
     }
 }
 
-void NetworkServer::handleInventoryUnlock(std::shared_ptr<ClientSession> session, const Protocol::Message &message)
+void NetworkServer::handleInventoryUnlock(std::shared_ptr<ClientSession> session, const Protocol::MessageView &message)
 {
     std::string username = session->getUsername();
     if (username.empty())
     {
-        sendErrorResponse(session, "用户未登录");
+        sendErrorResponse(session, message, "用户未登录");
+        return;
+    }
+
+    // 带预留ID时释放整个预留；否则按商品和数量从本会话的预留中释放
+    std::string reservationText = message.getData("reservationId");
+    if (!reservationText.empty())
+    {
+        uint64_t reservationId = 0;
+        if (!Store::parseProductId(reservationText, reservationId) ||
+            !reservationManager->release(session->getSessionId(), reservationId))
+        {
+            sendErrorResponse(session, message, "库存解锁失败：预留不存在、已过期或不属于当前会话");
+            return;
+        }
+        sendSuccessResponse(session, message);
+        std::cout << "用户 " << username << " 释放库存预留: " << reservationId << std::endl;
         return;
     }
 
@@ -1512,78 +2387,124 @@ void NetworkServer::handleInventoryUnlock(std::shared_ptr<ClientSession> session
     {
         // 单个商品解锁
         int quantity = 0;
-        try
-        {
-            quantity = std::stoi(message.getData("quantity"));
-        }
-        catch (const std::exception &e)
+        if (!message.getInt("quantity", quantity))
         {
-            sendErrorResponse(session, "无效的数量");
+            sendErrorResponse(session, message, "无效的数量");
             return;
         }
 
         // 解锁库存
-        if (store->unlockInventory(productId, quantity))
+        Product *product = nullptr;
+        if (store->lookupProduct(productId, message.getData("sellerUsername"), product) == ProductLookup::FOUND &&
+            reservationManager->releaseQuantity(session->getSessionId(), product->getId(), quantity))
         {
-            sendSuccessResponse(session);
+            sendSuccessResponse(session, message);
             std::cout << "用户 " << username << " 解锁库存成功: " << productId << ", 数量: " << quantity << std::endl;
         }
         else
         {
-            sendErrorResponse(session, "库存解锁失败");
+            sendErrorResponse(session, message, "库存解锁失败");
         }
     }
     else
     {
-        // 多个商品解锁（购物车）
-        std::string itemCountStr = message.getData("itemCount");
-        if (itemCountStr.empty())
+        // 多个商品解锁（购物车）：productIds 与 quantities 两个列表按下标一一对应
+        Protocol::ListView productIds = message.getList("productIds");
+        Protocol::ListView quantities = message.getList("quantities");
+        if (productIds.empty())
         {
-            sendErrorResponse(session, "缺少商品数量信息");
+            sendErrorResponse(session, message, "缺少商品数量信息");
             return;
         }
+        size_t itemCount = std::min(productIds.size(), quantities.size());
+        Protocol::ListView sellers = message.getList("sellers");
 
-        int itemCount = 0;
-        try
+        // 逐个解锁，某个商品解锁失败时继续处理其他商品
+        for (size_t i = 0; i < itemCount; ++i)
         {
-            itemCount = std::stoi(itemCountStr);
+            int qty = 0;
+            if (productIds[i].empty() || !parseQuantity(quantities[i], qty))
+            {
+                std::cerr << "解锁商品 " << productIds[i] << " 失败: 无效的数量" << std::endl;
+                continue;
+            }
+            Product *product = nullptr;
+            std::string seller = i < sellers.size() ? std::string(sellers[i]) : std::string();
+            if (store->lookupProduct(std::string(productIds[i]), seller, product) != ProductLookup::FOUND)
+            {
+                std::cerr << "解锁商品 " << productIds[i] << " 失败: 商品不存在" << std::endl;
+                continue;
+            }
+            if (!reservationManager->releaseQuantity(session->getSessionId(), product->getId(), qty))
+            {
+                std::cerr << "解锁商品 " << productIds[i] << " 失败: 本会话没有足够的锁定数量" << std::endl;
+            }
         }
-        catch (const std::exception &e)
+
+        sendSuccessResponse(session, message);
+        std::cout << "用户 " << username << " 购物车库存解锁完成，商品数量: " << itemCount << std::endl;
+    }
+}
+
+void NetworkServer::sendReservationResponse(std::shared_ptr<ClientSession> session, const Protocol::MessageView &request,
+                                            uint64_t reservationId, long long ttl)
+{
+    sendSuccessResponse(session, request, {{"reservationId", std::to_string(reservationId)},
+                                           {"ttl", std::to_string(ReservationManager::effectiveTtl(ttl))}});
+}
+
+// 线上格式协商：客户端按优先顺序列出支持的格式（如 "binary,text"），服务端选择第一个支持的。
+// 确认响应仍按旧格式发送，之后本会话的所有消息改用新格式。
+void NetworkServer::handleProtocolNegotiate(std::shared_ptr<ClientSession> session, const Protocol::MessageView &message)
+{
+    std::string_view formats = message.getView("formats");
+    size_t start = 0;
+    while (start <= formats.size())
+    {
+        size_t end = formats.find(',', start);
+        if (end == std::string_view::npos)
         {
-            sendErrorResponse(session, "无效的商品数量");
-            return;
+            end = formats.size();
         }
 
-        // 收集所有商品和数量并解锁
-        for (int i = 0; i < itemCount; ++i)
+        Protocol::WireFormat format;
+        if (Protocol::parseWireFormat(formats.substr(start, end - start), format))
         {
-            std::string prodId = message.getData("productId_" + std::to_string(i));
-            std::string quantityStr = message.getData("quantity_" + std::to_string(i));
-
-            if (!prodId.empty() && !quantityStr.empty())
-            {
-                try
-                {
-                    int qty = std::stoi(quantityStr);
-                    store->unlockInventory(prodId, qty);
-                }
-                catch (const std::exception &e)
-                {
-                    // 继续处理其他商品，即使某个商品解锁失败
-                    std::cerr << "解锁商品 " << prodId << " 失败: " << e.what() << std::endl;
-                }
-            }
+            std::map<std::string, std::string> responseData;
+            responseData["format"] = Protocol::wireFormatName(format);
+            sendSuccessResponse(session, message, responseData);
+            session->setWireFormat(format);
+            std::cout << "会话 " << session->getSessionId() << " 使用 " << Protocol::wireFormatName(format) << " 格式" << std::endl;
+            return;
         }
-
-        sendSuccessResponse(session);
-        std::cout << "用户 " << username << " 购物车库存解锁完成，商品数量: " << itemCount << std::endl;
+        start = end + 1;
     }
+
+    sendErrorResponse(session, message, "没有双方都支持的线上格式");
 }
 
 // 响应发送辅助方法
-void NetworkServer::sendSuccessResponse(std::shared_ptr<ClientSession> session, const std::map<std::string, std::string> &data)
+// 响应消息回显请求的 requestId，客户端据此把响应交给对应的等待者
+Product *NetworkServer::findRequestedProduct(std::shared_ptr<ClientSession> session, const Protocol::MessageView &message, const std::string &productId)
+{
+    Product *product = nullptr;
+    switch (store->lookupProduct(productId, message.getData("sellerUsername"), product))
+    {
+    case ProductLookup::FOUND:
+        return product;
+    case ProductLookup::AMBIGUOUS:
+        sendErrorResponse(session, message, "多个商家都有该商品，请指定商家");
+        return nullptr;
+    default:
+        sendErrorResponse(session, message, "商品不存在");
+        return nullptr;
+    }
+}
+
+void NetworkServer::sendSuccessResponse(std::shared_ptr<ClientSession> session, const Protocol::MessageView &request, const std::map<std::string, std::string> &data)
 {
     Protocol::Message response(Protocol::MessageType::RESPONSE_SUCCESS, session->getSessionId());
+    response.requestId = request.requestId;
     for (const auto &pair : data)
     {
         response.setData(pair.first, pair.second);
@@ -1591,16 +2512,18 @@ void NetworkServer::sendSuccessResponse(std::shared_ptr<ClientSession> session,
     session->sendMessage(response);
 }
 
-void NetworkServer::sendErrorResponse(std::shared_ptr<ClientSession> session, const std::string &error)
+void NetworkServer::sendErrorResponse(std::shared_ptr<ClientSession> session, const Protocol::MessageView &request, const std::string &error)
 {
     Protocol::Message response(Protocol::MessageType::RESPONSE_ERROR, session->getSessionId());
+    response.requestId = request.requestId;
     response.setData("error", error);
     session->sendMessage(response);
 }
 
-void NetworkServer::sendDataResponse(std::shared_ptr<ClientSession> session, const std::map<std::string, std::string> &data)
+void NetworkServer::sendDataResponse(std::shared_ptr<ClientSession> session, const Protocol::MessageView &request, const std::map<std::string, std::string> &data)
 {
     Protocol::Message response(Protocol::MessageType::RESPONSE_DATA, session->getSessionId());
+    response.requestId = request.requestId;
     for (const auto &pair : data)
     {
         response.setData(pair.first, pair.second);
@@ -1608,6 +2531,22 @@ void NetworkServer::sendDataResponse(std::shared_ptr<ClientSession> session, con
     session->sendMessage(response);
 }
 
+// 发送调用方已构造好的响应（如带记录列表的数据响应），补全会话ID和请求ID
+void NetworkServer::sendResponse(std::shared_ptr<ClientSession> session, const Protocol::MessageView &request, Protocol::Message &response)
+{
+    response.sessionId = session->getSessionId();
+    response.requestId = request.requestId;
+    session->sendMessage(response);
+}
+
+void NetworkServer::sendSharedResponse(std::shared_ptr<ClientSession> session, const Protocol::MessageView &request,
+                                       Protocol::WireFormat format, std::shared_ptr<const std::string> body)
+{
+    Protocol::Message header(Protocol::MessageType::RESPONSE_DATA, session->getSessionId());
+    header.requestId = request.requestId;
+    session->sendSharedFrame(header.encodeHeader(format), std::move(body));
+}
+
 // 数据转换方法
 Protocol::UserData NetworkServer::convertToUserData(const User *user)
 {
@@ -1635,29 +2574,7 @@ Protocol::UserData NetworkServer::convertToUserData(const User *user)
 
 Protocol::ProductData NetworkServer::convertToProductData(const Product *product)
 {
-    Protocol::ProductData productData;
-    productData.id = product->getName(); // 使用名称作为ID
-    productData.name = product->getName();
-    productData.description = product->getDescription();
-
-    // 修复Generic产品显示问题：使用getUserCategory()显示实际类别名称
-    std::string userCategory = product->getUserCategory();
-    if (!userCategory.empty())
-    {
-        productData.type = userCategory; // 显示实际类别名称（如自定义标签）
-    }
-    else
-    {
-        productData.type = product->getType(); // 回退到基本类型
-    }
-    // 修复价格显示：发送折扣后的实际价格
-    productData.price = product->getPrice();                 // 使用 getPrice() 获取折扣后价格
-    productData.originalPrice = product->getOriginalPrice(); // 添加原价字段
-    productData.quantity = product->getQuantity();
-    productData.discountRate = product->getDiscountRate();
-    productData.sellerUsername = product->getSellerUsername();
-
-    return productData;
+    return makeProductData(product);
 }
 
 std::vector<Protocol::ProductData> NetworkServer::convertToProductDataList(const std::vector<Product *> &products)
@@ -1685,8 +2602,14 @@ void NetworkServer::saveUserData()
 
 void NetworkServer::initializeStore()
 {
-    store = std::make_unique<Store>(storeDir);
-    store->loadAllProducts();
+    store = std::make_unique<Store>(storeDir); // 构造时已加载商品，不再重复加载
+    // 变更已由日志保证持久，商家文件快照可以写得稀疏一些
+    StoreWriter::Options snapshotOptions;
+    snapshotOptions.interval = std::chrono::seconds(30);
+    snapshotOptions.maxPendingChanges = 4096;
+    store->startWriteBehind(snapshotOptions);
+    catalogCache = std::make_unique<CatalogSnapshotCache>(*store);
+    catalogCache->get(); // 预先构建首个快照，避免第一个请求承担全量编码
     std::cout << "商店数据已初始化" << std::endl;
 }
 
@@ -2,25 +2,30 @@
 #define NETWORK_SERVER_H
 
 #include "../network/protocol.h"
-#include <winsock2.h>
-#include <ws2tcpip.h>
+#include "socket_compat.h"
 #include <string>
 #include <vector>
+#include <deque>
 #include <map>
 #include <thread>
 #include <mutex>
 #include <atomic>
 #include <memory>
-
-#pragma comment(lib, "ws2_32.lib")
+#include "handler_pool.h"
+#include "../store/catalog_snapshot.h"
+#include "subscription_manager.h"
+#include "../store/reservation_manager.h"
 
 // 前向声明
 class User;
 class Store;
 class OrderManager;
+class Order;
 class Product;
+class EventLoop;
+struct CatalogFilter;
 
-// 客户端会话类
+// 客户端会话类：套接字为非阻塞模式，由所属 EventLoop 线程驱动读写
 class ClientSession : public std::enable_shared_from_this<ClientSession>
 {
 private:
@@ -28,8 +33,45 @@ private:
     std::string sessionId;
     std::string username;
     Protocol::UserType userType;
-    std::thread clientThread;
+    mutable std::mutex identityMutex; // 用户名/类型由业务线程修改、I/O 线程读取
     std::atomic<bool> isActive;
+    std::atomic<Protocol::WireFormat> wireFormat; // 发送时使用的线上格式，接收时逐帧自动识别
+    EventLoop *eventLoop;
+
+    // 接收缓冲区：仅由事件循环线程访问，可能包含不完整的帧
+    std::string inBuffer;
+
+    // 帧缓冲区池：完整的帧拷贝到池中的缓冲区后解析为 MessageView，
+    // 业务线程处理完（最后一个视图销毁）后缓冲区连同其容量被复用。仅由事件循环线程访问。
+    std::vector<std::shared_ptr<Protocol::FrameBuffer>> framePool;
+    std::shared_ptr<Protocol::FrameBuffer> acquireFrame();
+
+    // 发送队列：任意线程都可以发送消息，未能立即写出的数据在此排队。
+    // 普通消息追加到队尾的私有块；共享块（如目录快照的消息体）只持有引用，多个会话共用同一份字节。
+    struct OutChunk
+    {
+        std::string owned;
+        std::shared_ptr<const std::string> shared;
+        const std::string &bytes() const { return shared ? *shared : owned; }
+    };
+    std::deque<OutChunk> outQueue;
+    size_t outOffset;   // 队首块中已写出的字节数
+    std::string spareOutBuffer; // 发送完毕的私有块，保留容量供下一条消息复用
+    bool writeInterest;
+    mutable std::mutex outMutex;
+
+    // 业务线程池中的派发状态（由 NetworkServer 维护）：排序键在登录、注销时切换，
+    // 旧键上还有未执行完的请求时，新到的请求先暂存，等旧键上的请求全部完成后再按新键派发
+    std::mutex dispatchMutex;
+    std::string dispatchKey;   // 最近一次派发使用的排序键
+    size_t dispatchPending;    // 已派发、尚未执行完的请求数
+    std::deque<Protocol::MessageView> heldMessages;
+    friend class NetworkServer;
+
+    // 单帧最大长度，防止恶意长度字段耗尽内存
+    static const uint32_t kMaxFrameSize = 64 * 1024 * 1024;
+    static const size_t kMaxPooledFrames = 16;
+    static const size_t kMaxPooledFrameBytes = 1024 * 1024; // 超过此容量的缓冲区用完即释放
 
 public:
     ClientSession(SOCKET socket, const std::string &sid);
@@ -37,21 +79,51 @@ public:
 
     SOCKET getSocket() const { return clientSocket; }
     std::string getSessionId() const { return sessionId; }
-    std::string getUsername() const { return username; }
-    Protocol::UserType getUserType() const { return userType; }
+    std::string getUsername() const
+    {
+        std::lock_guard<std::mutex> lock(identityMutex);
+        return username;
+    }
+    Protocol::UserType getUserType() const
+    {
+        std::lock_guard<std::mutex> lock(identityMutex);
+        return userType;
+    }
     bool isSessionActive() const { return isActive.load(); }
 
-    void setUsername(const std::string &user) { username = user; }
-    void setUserType(Protocol::UserType type) { userType = type; }
+    void setUsername(const std::string &user)
+    {
+        std::lock_guard<std::mutex> lock(identityMutex);
+        username = user;
+    }
+    void setUserType(Protocol::UserType type)
+    {
+        std::lock_guard<std::mutex> lock(identityMutex);
+        userType = type;
+    }
+
+    // 业务线程池中的排序键：已登录按用户名串行，未登录按会话串行。
+    // 键切换时同一连接的请求顺序由 NetworkServer::dispatchMessage 保证
+    std::string getOrderingKey() const;
 
     bool sendMessage(const Protocol::Message &message);
-    std::string receiveRawData();
-    void startSession(class NetworkServer *server);
+    // 发送"帧头 + 共享消息体"组成的一帧：消息体不拷贝，直到写出完成前保持引用
+    bool sendSharedFrame(const std::string &header, std::shared_ptr<const std::string> body);
+    Protocol::WireFormat getWireFormat() const { return wireFormat.load(); }
+    void setWireFormat(Protocol::WireFormat format) { wireFormat.store(format); }
+    void attachToLoop(EventLoop *loop);
     void stopSession();
 
+    // 事件循环回调：返回 false 表示连接应当关闭
+    bool onReadable(class NetworkServer *server);
+    bool onWritable();
+    bool hasPendingOutput() const;
+
 private:
-    void sessionLoop(class NetworkServer *server);
     bool sendRawData(const std::string &data);
+    void appendOwnedLocked(const char *data, size_t size);
+    bool scheduleFlushLocked();
+    bool flushOutputLocked();
 };
 
 class NetworkServer
@@ -62,6 +134,16 @@ private:
     std::atomic<bool> isRunning;
     std::thread acceptThread;
 
+    // 固定数量的 I/O 线程，新连接按轮询方式分配
+    int ioThreadCount;
+    std::vector<std::unique_ptr<EventLoop>> ioLoops;
+    size_t nextLoopIndex;
+
+    // 业务处理线程池：I/O 线程只负责解码，handleXxx 在这里执行
+    int handlerThreadCount;
+    size_t handlerQueueCapacity;
+    std::unique_ptr<HandlerPool> handlerPool;
+
     // 客户端会话管理
     std::vector<std::shared_ptr<ClientSession>> sessions;
     std::mutex sessionsMutex;
@@ -69,8 +151,17 @@ private:
     // 业务逻辑组件
     std::vector<User *> users;
     std::unique_ptr<Store> store;
+    std::unique_ptr<CatalogSnapshotCache> catalogCache; // 预编码的商品目录，须在 store 之后声明
+    std::unique_ptr<SubscriptionManager> subscriptionManager; // 商品变化推送，须在 catalogCache 之后声明
+    std::unique_ptr<ReservationManager> reservationManager;   // 库存预留与到期释放，须在 store 之后声明
     std::unique_ptr<OrderManager> orderManager;
 
+    // 商品分页：未指定 limit 时的每页条数与允许的最大条数
+    static const size_t kDefaultProductPageSize = 50;
+    static const size_t kMaxProductPageSize = 500;
+    // 搜索联想：未指定 limit 时返回的条数
+    static const size_t kDefaultSuggestionCount = 8;
+
     // 数据文件路径
     std::string userFile;
     std::string storeDir;
@@ -89,61 +180,101 @@ private:
     std::vector<Protocol::ProductData> convertToProductDataList(const std::vector<Product *> &products);
 
 public:
-    NetworkServer(int port = 8888);
+    NetworkServer(int port = 8888, int ioThreads = 0, int handlerThreads = 0, size_t handlerQueueCapacity = 10000);
     ~NetworkServer();
 
     // 服务器控制
     bool start();
     void stop();
     bool isServerRunning() const { return isRunning.load(); }
+    int getIoThreadCount() const { return ioThreadCount; }
+    size_t getActiveSessionCount();
+    HandlerPool::Stats getHandlerPoolStats() const;
+    CatalogSnapshotCache::Stats getCatalogStats() const;
+    SubscriptionManager::Stats getSubscriptionStats() const;
+    PoolStats getProductPoolStats() const;
+    PoolStats getOrderPoolStats() const;
+    StoreWriter::Stats getStoreWriterStats() const;
+    MutationLog::Stats getMutationLogStats() const;
+    ReservationManager::Stats getReservationStats() const;
 
     // 客户端会话处理
-    void handleClientMessage(std::shared_ptr<ClientSession> session, const Protocol::Message &message);
+    void dispatchMessage(std::shared_ptr<ClientSession> session, const Protocol::MessageView &message);
+    void submitHandlerLocked(const std::shared_ptr<ClientSession> &session, const std::string &key, const Protocol::MessageView &message);
+    void finishDispatch(const std::shared_ptr<ClientSession> &session);
+    void handleClientMessage(std::shared_ptr<ClientSession> session, const Protocol::MessageView &message);
+    void onSessionClosed(const std::shared_ptr<ClientSession> &session);
 
     // 用户管理处理
-    void handleUserLogin(std::shared_ptr<ClientSession> session, const Protocol::Message &message);
-    void handleUserRegister(std::shared_ptr<ClientSession> session, const Protocol::Message &message);
-    void handleUserLogout(std::shared_ptr<ClientSession> session, const Protocol::Message &message);
-    void handleUserGetInfo(std::shared_ptr<ClientSession> session, const Protocol::Message &message);
-    void handleUserUpdateBalance(std::shared_ptr<ClientSession> session, const Protocol::Message &message);
-    void handleUserChangePassword(std::shared_ptr<ClientSession> session, const Protocol::Message &message);
+    void handleUserLogin(std::shared_ptr<ClientSession> session, const Protocol::MessageView &message);
+    void handleUserRegister(std::shared_ptr<ClientSession> session, const Protocol::MessageView &message);
+    void handleUserLogout(std::shared_ptr<ClientSession> session, const Protocol::MessageView &message);
+    void handleUserGetInfo(std::shared_ptr<ClientSession> session, const Protocol::MessageView &message);
+    void handleUserUpdateBalance(std::shared_ptr<ClientSession> session, const Protocol::MessageView &message);
+    void handleUserChangePassword(std::shared_ptr<ClientSession> session, const Protocol::MessageView &message);
 
     // 商品管理处理
-    void handleProductGetAll(std::shared_ptr<ClientSession> session, const Protocol::Message &message);
-    void handleProductSearch(std::shared_ptr<ClientSession> session, const Protocol::Message &message);
-    void handleProductGetById(std::shared_ptr<ClientSession> session, const Protocol::Message &message);
-    void handleProductAdd(std::shared_ptr<ClientSession> session, const Protocol::Message &message);
-    void handleProductUpdate(std::shared_ptr<ClientSession> session, const Protocol::Message &message);
-    void handleProductDelete(std::shared_ptr<ClientSession> session, const Protocol::Message &message);
-    void handleProductUpdateStock(std::shared_ptr<ClientSession> session, const Protocol::Message &message);
-    void handleProductManagePrice(std::shared_ptr<ClientSession> session, const Protocol::Message &message);
-    void handleProductManageQuantity(std::shared_ptr<ClientSession> session, const Protocol::Message &message);
-    void handleProductManageDiscount(std::shared_ptr<ClientSession> session, const Protocol::Message &message);
-    void handleProductApplyCategoryDiscount(std::shared_ptr<ClientSession> session, const Protocol::Message &message);
+    void handleProductGetAll(std::shared_ptr<ClientSession> session, const Protocol::MessageView &message);
+    void handleProductSearch(std::shared_ptr<ClientSession> session, const Protocol::MessageView &message);
+    void handleProductSync(std::shared_ptr<ClientSession> session, const Protocol::MessageView &message);
+    void handleProductSubscribe(std::shared_ptr<ClientSession> session, const Protocol::MessageView &message);
+    void handleProductUnsubscribe(std::shared_ptr<ClientSession> session, const Protocol::MessageView &message);
+    void handleProductSuggest(std::shared_ptr<ClientSession> session, const Protocol::MessageView &message);
+    // GET_ALL/SEARCH 带 limit、cursor、sort 任一字段时按页响应；keyword 为空表示整个目录
+    void handleProductPage(std::shared_ptr<ClientSession> session, const Protocol::MessageView &message, const std::string &keyword,
+                           const CatalogFilter *filter = nullptr);
+    void handleProductFilter(std::shared_ptr<ClientSession> session, const Protocol::MessageView &message);
+    void handleProductGetById(std::shared_ptr<ClientSession> session, const Protocol::MessageView &message);
+    void handleProductAdd(std::shared_ptr<ClientSession> session, const Protocol::MessageView &message);
+    void handleProductUpdate(std::shared_ptr<ClientSession> session, const Protocol::MessageView &message);
+    void handleProductDelete(std::shared_ptr<ClientSession> session, const Protocol::MessageView &message);
+    void handleProductUpdateStock(std::shared_ptr<ClientSession> session, const Protocol::MessageView &message);
+    void handleProductManagePrice(std::shared_ptr<ClientSession> session, const Protocol::MessageView &message);
+    void handleProductManageQuantity(std::shared_ptr<ClientSession> session, const Protocol::MessageView &message);
+    void handleProductManageDiscount(std::shared_ptr<ClientSession> session, const Protocol::MessageView &message);
+    void handleProductApplyCategoryDiscount(std::shared_ptr<ClientSession> session, const Protocol::MessageView &message);
 
     // 购物车管理处理
-    void handleCartGet(std::shared_ptr<ClientSession> session, const Protocol::Message &message);
-    void handleCartAddItem(std::shared_ptr<ClientSession> session, const Protocol::Message &message);
-    void handleCartUpdateItem(std::shared_ptr<ClientSession> session, const Protocol::Message &message);
-    void handleCartRemoveItem(std::shared_ptr<ClientSession> session, const Protocol::Message &message);
-    void handleCartClear(std::shared_ptr<ClientSession> session, const Protocol::Message &message);
+    void handleCartGet(std::shared_ptr<ClientSession> session, const Protocol::MessageView &message);
+    void handleCartAddItem(std::shared_ptr<ClientSession> session, const Protocol::MessageView &message);
+    void handleCartUpdateItem(std::shared_ptr<ClientSession> session, const Protocol::MessageView &message);
+    void handleCartRemoveItem(std::shared_ptr<ClientSession> session, const Protocol::MessageView &message);
+    void handleCartClear(std::shared_ptr<ClientSession> session, const Protocol::MessageView &message);
 
     // 库存锁定处理
-    void handleInventoryLock(std::shared_ptr<ClientSession> session, const Protocol::Message &message);
-    void handleInventoryUnlock(std::shared_ptr<ClientSession> session, const Protocol::Message &message);
+    void handleInventoryLock(std::shared_ptr<ClientSession> session, const Protocol::MessageView &message);
+    void handleInventoryUnlock(std::shared_ptr<ClientSession> session, const Protocol::MessageView &message);
+    // 锁定成功的响应：预留ID与实际生效的有效期（秒），客户端可凭预留ID解锁
+    void sendReservationResponse(std::shared_ptr<ClientSession> session, const Protocol::MessageView &request,
+                                 uint64_t reservationId, long long ttl);
+
+    // 连接参数协商
+    void handleProtocolNegotiate(std::shared_ptr<ClientSession> session, const Protocol::MessageView &message);
 
     // 订单管理处理
-    void handleOrderCreate(std::shared_ptr<ClientSession> session, const Protocol::Message &message);
-    void handleDirectPurchase(std::shared_ptr<ClientSession> session, const Protocol::Message &message);
-    void handleOrderGetByUser(std::shared_ptr<ClientSession> session, const Protocol::Message &message);
-    void handleOrderGetById(std::shared_ptr<ClientSession> session, const Protocol::Message &message);
-    void handleOrderUpdateStatus(std::shared_ptr<ClientSession> session, const Protocol::Message &message);
-    void handleOrderGetAll(std::shared_ptr<ClientSession> session, const Protocol::Message &message);
+    void handleOrderCreate(std::shared_ptr<ClientSession> session, const Protocol::MessageView &message);
+    void handleDirectPurchase(std::shared_ptr<ClientSession> session, const Protocol::MessageView &message);
+    // 请求带 reservationId 时把本会话的该预留交给订单，预留无效时回复错误并返回 false；
+    // 不带时把本会话锁定的订单商品交给订单
+    bool attachOrderReservation(std::shared_ptr<ClientSession> session, const Protocol::MessageView &message, Order &order);
+    // 订单没有交给结算时，解锁它带来的买家预留
+    void releaseOrderReservation(const Order &order);
+    void handleOrderGetByUser(std::shared_ptr<ClientSession> session, const Protocol::MessageView &message);
+    void handleOrderGetById(std::shared_ptr<ClientSession> session, const Protocol::MessageView &message);
+    void handleOrderUpdateStatus(std::shared_ptr<ClientSession> session, const Protocol::MessageView &message);
+    void handleOrderGetAll(std::shared_ptr<ClientSession> session, const Protocol::MessageView &message);
+
+    // 按请求中的 productId 和可选的 sellerUsername 查找商品，找不到或有歧义时发送错误响应并返回 nullptr
+    Product *findRequestedProduct(std::shared_ptr<ClientSession> session, const Protocol::MessageView &message, const std::string &productId);
 
     // 响应发送辅助方法
-    void sendSuccessResponse(std::shared_ptr<ClientSession> session, const std::map<std::string, std::string> &data = {});
-    void sendErrorResponse(std::shared_ptr<ClientSession> session, const std::string &error);
-    void sendDataResponse(std::shared_ptr<ClientSession> session, const std::map<std::string, std::string> &data);
+    void sendSuccessResponse(std::shared_ptr<ClientSession> session, const Protocol::MessageView &request, const std::map<std::string, std::string> &data = {});
+    void sendErrorResponse(std::shared_ptr<ClientSession> session, const Protocol::MessageView &request, const std::string &error);
+    void sendDataResponse(std::shared_ptr<ClientSession> session, const Protocol::MessageView &request, const std::map<std::string, std::string> &data);
+    void sendResponse(std::shared_ptr<ClientSession> session, const Protocol::MessageView &request, Protocol::Message &response);
+    // 以预编码的消息体响应：只按请求编码帧头，消息体在所有会话之间共享
+    void sendSharedResponse(std::shared_ptr<ClientSession> session, const Protocol::MessageView &request,
+                            Protocol::WireFormat format, std::shared_ptr<const std::string> body);
 
     // 数据持久化
     void saveUserData();
@@ -0,0 +1,170 @@
+#ifndef SOCKET_COMPAT_H
+#define SOCKET_COMPAT_H
+
+// 跨平台套接字兼容层：Windows 使用 Winsock，Linux/POSIX 使用 BSD socket
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#pragma comment(lib, "ws2_32.lib")
+
+using socklen_t = int;
+#else
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/uio.h>
+#include <cerrno>
+
+using SOCKET = int;
+#ifndef INVALID_SOCKET
+#define INVALID_SOCKET (-1)
+#endif
+#ifndef SOCKET_ERROR
+#define SOCKET_ERROR (-1)
+#endif
+#endif
+
+namespace SocketCompat
+{
+    // 初始化套接字库（Windows 下调用 WSAStartup，POSIX 下无操作）
+    inline bool initialize()
+    {
+#ifdef _WIN32
+        WSADATA wsaData;
+        return WSAStartup(MAKEWORD(2, 2), &wsaData) == 0;
+#else
+        return true;
+#endif
+    }
+
+    inline void cleanup()
+    {
+#ifdef _WIN32
+        WSACleanup();
+#endif
+    }
+
+    inline int closeSocket(SOCKET s)
+    {
+#ifdef _WIN32
+        return closesocket(s);
+#else
+        return ::close(s);
+#endif
+    }
+
+    // 关闭读写方向，用于唤醒阻塞在 accept/recv 上的线程
+    inline void shutdownSocket(SOCKET s)
+    {
+#ifdef _WIN32
+        shutdown(s, SD_BOTH);
+#else
+        shutdown(s, SHUT_RDWR);
+#endif
+    }
+
+    inline int lastError()
+    {
+#ifdef _WIN32
+        return WSAGetLastError();
+#else
+        return errno;
+#endif
+    }
+
+    // 非阻塞操作暂时无法完成（需要等待下一次可读/可写事件）
+    inline bool wouldBlock(int err)
+    {
+#ifdef _WIN32
+        return err == WSAEWOULDBLOCK;
+#else
+        return err == EAGAIN || err == EWOULDBLOCK;
+#endif
+    }
+
+    inline bool interrupted(int err)
+    {
+#ifdef _WIN32
+        return err == WSAEINTR;
+#else
+        return err == EINTR;
+#endif
+    }
+
+    inline bool setNonBlocking(SOCKET s)
+    {
+#ifdef _WIN32
+        u_long mode = 1;
+        return ioctlsocket(s, FIONBIO, &mode) == 0;
+#else
+        int flags = fcntl(s, F_GETFL, 0);
+        return flags >= 0 && fcntl(s, F_SETFL, flags | O_NONBLOCK) == 0;
+#endif
+    }
+
+    // 关闭 Nagle 算法，请求/响应模式下降低小包延迟
+    inline void setNoDelay(SOCKET s)
+    {
+        int opt = 1;
+        setsockopt(s, IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<const char *>(&opt), sizeof(opt));
+    }
+
+    // 发送时不产生 SIGPIPE（对端已关闭时返回错误而不是终止进程）
+    inline int sendNoSignal(SOCKET s, const char *data, int len)
+    {
+#if defined(MSG_NOSIGNAL)
+        return static_cast<int>(::send(s, data, len, MSG_NOSIGNAL));
+#else
+        return static_cast<int>(::send(s, data, len, 0));
+#endif
+    }
+
+    // 聚集发送的一段数据
+    struct IoSlice
+    {
+        const char *data;
+        size_t size;
+    };
+    const int kMaxIoSlices = 16;
+
+    // 一次系统调用发送多段不连续的数据（Windows 下为 WSASend，POSIX 下为 sendmsg），
+    // 返回实际发送的总字节数，失败返回 -1。count 不超过 kMaxIoSlices。
+    inline int sendGather(SOCKET s, const IoSlice *slices, int count)
+    {
+#ifdef _WIN32
+        WSABUF buffers[kMaxIoSlices];
+        for (int i = 0; i < count; ++i)
+        {
+            buffers[i].buf = const_cast<char *>(slices[i].data);
+            buffers[i].len = static_cast<ULONG>(slices[i].size);
+        }
+        DWORD sent = 0;
+        if (WSASend(s, buffers, static_cast<DWORD>(count), &sent, 0, nullptr, nullptr) != 0)
+        {
+            return -1;
+        }
+        return static_cast<int>(sent);
+#else
+        struct iovec buffers[kMaxIoSlices];
+        for (int i = 0; i < count; ++i)
+        {
+            buffers[i].iov_base = const_cast<char *>(slices[i].data);
+            buffers[i].iov_len = slices[i].size;
+        }
+        struct msghdr header = {};
+        header.msg_iov = buffers;
+        header.msg_iovlen = static_cast<size_t>(count);
+#if defined(MSG_NOSIGNAL)
+        return static_cast<int>(::sendmsg(s, &header, MSG_NOSIGNAL));
+#else
+        return static_cast<int>(::sendmsg(s, &header, 0));
+#endif
+#endif
+    }
+} // namespace SocketCompat
+
+#endif // SOCKET_COMPAT_H
@@ -0,0 +1,338 @@
+#include "subscription_manager.h"
+#include "server.h"
+#include "../store/catalog_snapshot.h"
+#include <iostream>
+
+SubscriptionManager::SubscriptionManager(CatalogSnapshotCache &catalog, std::chrono::milliseconds tickInterval)
+    : catalog(catalog), tickInterval(tickInterval), stopping(false), running(false)
+{
+}
+
+SubscriptionManager::~SubscriptionManager()
+{
+    stop();
+}
+
+void SubscriptionManager::start()
+{
+    std::lock_guard<std::mutex> lock(tickMutex);
+    if (running)
+    {
+        return;
+    }
+    running = true;
+    stopping = false;
+    tickThread = std::thread(&SubscriptionManager::tickLoop, this);
+}
+
+void SubscriptionManager::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(tickMutex);
+        if (!running)
+        {
+            return;
+        }
+        stopping = true;
+    }
+    tickCondition.notify_all();
+    if (tickThread.joinable())
+    {
+        tickThread.join();
+    }
+
+    std::lock_guard<std::mutex> lock(tickMutex);
+    running = false;
+}
+
+SubscriptionManager::Subscription &SubscriptionManager::subscriptionFor(const std::shared_ptr<ClientSession> &session,
+                                                                        uint64_t epoch, uint64_t version)
+{
+    auto inserted = subscriptions.emplace(session->getSessionId(), Subscription());
+    Subscription &subscription = inserted.first->second;
+    if (inserted.second)
+    {
+        subscription.session = session;
+        subscription.pushedEpoch = epoch;
+        subscription.pushedVersion = version;
+    }
+    return subscription;
+}
+
+uint64_t SubscriptionManager::subscribeCatalog(const std::shared_ptr<ClientSession> &session, uint64_t clientEpoch, uint64_t clientVersion)
+{
+    std::shared_ptr<const CatalogSnapshot> snapshot = catalog.get();
+    uint64_t baseline = snapshot->getVersion();
+    if (clientEpoch == snapshot->getEpoch() && clientVersion < baseline)
+    {
+        baseline = clientVersion;
+    }
+
+    std::lock_guard<std::mutex> lock(subscriptionsMutex);
+    Subscription &subscription = subscriptionFor(session, snapshot->getEpoch(), baseline);
+    if (!subscription.wholeCatalog && subscription.pushedEpoch == snapshot->getEpoch() && baseline < subscription.pushedVersion)
+    {
+        // 之前只订阅了部分商品，改为整目录后从客户端持有的版本开始补齐
+        subscription.pushedVersion = baseline;
+    }
+    subscription.wholeCatalog = true;
+    return subscription.pushedVersion;
+}
+
+uint64_t SubscriptionManager::subscribeProducts(const std::shared_ptr<ClientSession> &session, const std::vector<std::string> &productIds)
+{
+    std::shared_ptr<const CatalogSnapshot> snapshot = catalog.get();
+    std::lock_guard<std::mutex> lock(subscriptionsMutex);
+    Subscription &subscription = subscriptionFor(session, snapshot->getEpoch(), snapshot->getVersion());
+    subscription.productIds.insert(productIds.begin(), productIds.end());
+    return subscription.pushedVersion;
+}
+
+void SubscriptionManager::unsubscribe(const std::string &sessionId, const std::vector<std::string> &productIds)
+{
+    std::lock_guard<std::mutex> lock(subscriptionsMutex);
+    auto it = subscriptions.find(sessionId);
+    if (it == subscriptions.end())
+    {
+        return;
+    }
+    if (productIds.empty())
+    {
+        subscriptions.erase(it);
+        return;
+    }
+    for (const auto &productId : productIds)
+    {
+        it->second.productIds.erase(productId);
+    }
+    if (!it->second.wholeCatalog && it->second.productIds.empty())
+    {
+        subscriptions.erase(it);
+    }
+}
+
+void SubscriptionManager::removeSession(const std::string &sessionId)
+{
+    std::lock_guard<std::mutex> lock(subscriptionsMutex);
+    subscriptions.erase(sessionId);
+}
+
+SubscriptionManager::Stats SubscriptionManager::getStats() const
+{
+    std::lock_guard<std::mutex> lock(subscriptionsMutex);
+    Stats result = stats;
+    result.subscribers = subscriptions.size();
+    return result;
+}
+
+void SubscriptionManager::tickLoop()
+{
+    std::unique_lock<std::mutex> lock(tickMutex);
+    while (!stopping)
+    {
+        tickCondition.wait_for(lock, tickInterval, [this]
+                               { return stopping; });
+        if (stopping)
+        {
+            break;
+        }
+
+        lock.unlock();
+        try
+        {
+            tick();
+        }
+        catch (const std::exception &e)
+        {
+            std::cerr << "推送商品变化时发生异常: " << e.what() << std::endl;
+        }
+        lock.lock();
+    }
+}
+
+namespace
+{
+    // 同一节拍内起始版本相同的会话共用一份变化集合，整目录订阅者还共用编码好的消息体
+    struct PendingDelta
+    {
+        bool ok = false;
+        CatalogDelta delta;
+        std::shared_ptr<const std::string> catalogBodies[2]; // 按线上格式索引
+    };
+
+    void fillPushMessage(Protocol::Message &push, const CatalogSnapshot &snapshot, uint64_t sinceVersion)
+    {
+        push.setData("epoch", std::to_string(snapshot.getEpoch()));
+        push.setData("version", std::to_string(snapshot.getVersion()));
+        push.setData("sinceVersion", std::to_string(sinceVersion));
+    }
+}
+
+void SubscriptionManager::tick()
+{
+    std::shared_ptr<const CatalogSnapshot> snapshot = catalog.get();
+    const uint64_t epoch = snapshot->getEpoch();
+    const uint64_t version = snapshot->getVersion();
+
+    // 找出落后于当前版本的订阅，复制所需信息后释放锁再发送
+    struct Work
+    {
+        std::string sessionId;
+        std::shared_ptr<ClientSession> session;
+        bool wholeCatalog;
+        std::set<std::string> productIds;
+        uint64_t sinceEpoch;
+        bool sameEpoch;
+        uint64_t sinceVersion;
+    };
+    std::vector<Work> work;
+    {
+        std::lock_guard<std::mutex> lock(subscriptionsMutex);
+        for (auto it = subscriptions.begin(); it != subscriptions.end();)
+        {
+            Subscription &subscription = it->second;
+            if (subscription.pushedEpoch == epoch && subscription.pushedVersion == version)
+            {
+                ++it;
+                continue;
+            }
+            std::shared_ptr<ClientSession> session = subscription.session.lock();
+            if (!session || !session->isSessionActive())
+            {
+                it = subscriptions.erase(it);
+                continue;
+            }
+            work.push_back(Work{it->first, session, subscription.wholeCatalog, subscription.productIds,
+                                subscription.pushedEpoch, subscription.pushedEpoch == epoch, subscription.pushedVersion});
+            ++it;
+        }
+        if (work.empty())
+        {
+            return;
+        }
+        stats.ticks++;
+    }
+
+    std::map<uint64_t, PendingDelta> deltas;
+    std::vector<const Work *> advanced; // 本节拍已推送到当前版本的会话
+    uint64_t pushes = 0;
+    uint64_t pushedProducts = 0;
+    uint64_t deferred = 0;
+    uint64_t resyncs = 0;
+
+    for (Work &item : work)
+    {
+        if (item.session->hasPendingOutput())
+        {
+            // 上一条推送还没写出去，变化留到下一节拍一起合并
+            deferred++;
+            continue;
+        }
+
+        Protocol::WireFormat format = item.session->getWireFormat();
+        Protocol::Message header(Protocol::MessageType::PRODUCT_CHANGED, item.sessionId);
+
+        PendingDelta *pending = nullptr;
+        if (item.sameEpoch)
+        {
+            auto inserted = deltas.emplace(item.sinceVersion, PendingDelta());
+            pending = &inserted.first->second;
+            if (inserted.second)
+            {
+                pending->ok = catalog.getDelta(*snapshot, item.sinceVersion, pending->delta);
+            }
+        }
+
+        if (!pending || !pending->ok)
+        {
+            // 变更日志已无法覆盖（或服务端重新加载过目录），通知客户端自行重新同步
+            Protocol::Message push(Protocol::MessageType::PRODUCT_CHANGED, item.sessionId);
+            fillPushMessage(push, *snapshot, item.sinceVersion);
+            push.setData("resync", "1");
+            item.session->sendMessage(push);
+            advanced.push_back(&item);
+            resyncs++;
+            pushes++;
+            continue;
+        }
+
+        const CatalogDelta &delta = pending->delta;
+        if (item.wholeCatalog)
+        {
+            std::shared_ptr<const std::string> &body = pending->catalogBodies[static_cast<int>(format)];
+            if (!body)
+            {
+                Protocol::Message push(Protocol::MessageType::PRODUCT_CHANGED);
+                fillPushMessage(push, *snapshot, item.sinceVersion);
+                push.setData("catalog", "1");
+                std::vector<std::string> &products = push.addList("products");
+                products.reserve(delta.positions.size());
+                for (size_t position : delta.positions)
+                {
+                    const CatalogSnapshot::Entry &entry = *snapshot->getEntries()[position];
+                    products.push_back(format == Protocol::WireFormat::BINARY ? entry.binaryRecord : entry.textRecord);
+                }
+                std::vector<std::string> &removedIds = push.addList("removedIds");
+                std::vector<std::string> &removedSellers = push.addList("removedSellers");
+                for (const CatalogChange &change : delta.removed)
+                {
+                    removedIds.push_back(change.productId);
+                    removedSellers.push_back(change.sellerUsername);
+                }
+                body = std::make_shared<const std::string>(push.encodeBody(format));
+            }
+            item.session->sendSharedFrame(header.encodeHeader(format), body);
+            advanced.push_back(&item);
+            pushes++;
+            pushedProducts += delta.size();
+            continue;
+        }
+
+        // 只订阅了部分商品：挑出相关的变化，没有相关变化时只推进版本
+        Protocol::Message push(Protocol::MessageType::PRODUCT_CHANGED, item.sessionId);
+        fillPushMessage(push, *snapshot, item.sinceVersion);
+        std::vector<std::string> &products = push.addList("products");
+        std::vector<std::string> &removedIds = push.addList("removedIds");
+        std::vector<std::string> &removedSellers = push.addList("removedSellers");
+        for (size_t position : delta.positions)
+        {
+            const CatalogSnapshot::Entry &entry = *snapshot->getEntries()[position];
+            if (item.productIds.count(entry.productId) != 0)
+            {
+                products.push_back(format == Protocol::WireFormat::BINARY ? entry.binaryRecord : entry.textRecord);
+            }
+        }
+        for (const CatalogChange &change : delta.removed)
+        {
+            if (item.productIds.count(change.productId) != 0)
+            {
+                removedIds.push_back(change.productId);
+                removedSellers.push_back(change.sellerUsername);
+            }
+        }
+        if (!products.empty() || !removedIds.empty())
+        {
+            item.session->sendMessage(push);
+            pushes++;
+            pushedProducts += products.size() + removedIds.size();
+        }
+        advanced.push_back(&item);
+    }
+
+    std::lock_guard<std::mutex> lock(subscriptionsMutex);
+    for (const Work *item : advanced)
+    {
+        auto it = subscriptions.find(item->sessionId);
+        // 推送期间订阅可能被改回更早的版本（部分订阅改为整目录），此时不能覆盖，留给下一节拍补齐
+        if (it != subscriptions.end() && it->second.pushedEpoch == item->sinceEpoch &&
+            it->second.pushedVersion == item->sinceVersion)
+        {
+            it->second.pushedEpoch = epoch;
+            it->second.pushedVersion = version;
+        }
+    }
+    stats.pushes += pushes;
+    stats.pushedProducts += pushedProducts;
+    stats.deferred += deferred;
+    stats.resyncs += resyncs;
+}
@@ -0,0 +1,82 @@
+#ifndef SUBSCRIPTION_MANAGER_H
+#define SUBSCRIPTION_MANAGER_H
+
+#include "../network/protocol.h"
+#include <string>
+#include <vector>
+#include <set>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <chrono>
+#include <cstdint>
+
+class ClientSession;
+class CatalogSnapshotCache;
+
+// 商品变化订阅：会话可以订阅整个目录或指定商品。推送线程按固定节拍检查目录版本，
+// 把上次推送之后的全部变化合并成每个会话至多一条 PRODUCT_CHANGED 消息，
+// 同一商品在一个节拍内多次变化只推送最新状态。发送队列仍有积压的会话本节拍跳过，
+// 变化累积到下一节拍再合并推送，避免抢购时大量推送堆积在慢连接上。
+class SubscriptionManager
+{
+public:
+    struct Stats
+    {
+        size_t subscribers = 0;
+        uint64_t ticks = 0;          // 检测到目录变化的节拍数
+        uint64_t pushes = 0;         // 发送的推送消息数
+        uint64_t pushedProducts = 0; // 推送中携带的商品记录数
+        uint64_t deferred = 0;       // 因发送队列积压而推迟的次数
+        uint64_t resyncs = 0;        // 变化已无法增量描述、要求客户端重新同步的次数
+    };
+
+    explicit SubscriptionManager(CatalogSnapshotCache &catalog,
+                                 std::chrono::milliseconds tickInterval = std::chrono::milliseconds(200));
+    ~SubscriptionManager();
+
+    void start();
+    void stop();
+
+    // 订阅整个目录或追加订阅指定商品（按商品ID），返回推送起点的目录版本。
+    // 整目录订阅可以带上客户端已持有的目录标识和版本，首条推送即从该版本开始补齐
+    uint64_t subscribeCatalog(const std::shared_ptr<ClientSession> &session, uint64_t clientEpoch, uint64_t clientVersion);
+    uint64_t subscribeProducts(const std::shared_ptr<ClientSession> &session, const std::vector<std::string> &productIds);
+    // 取消指定商品的订阅；productIds 为空时取消该会话的全部订阅
+    void unsubscribe(const std::string &sessionId, const std::vector<std::string> &productIds);
+    void removeSession(const std::string &sessionId);
+
+    Stats getStats() const;
+
+private:
+    struct Subscription
+    {
+        std::weak_ptr<ClientSession> session;
+        bool wholeCatalog = false;
+        std::set<std::string> productIds;
+        uint64_t pushedEpoch = 0;
+        uint64_t pushedVersion = 0; // 该会话已推送到的目录版本
+    };
+
+    CatalogSnapshotCache &catalog;
+    std::chrono::milliseconds tickInterval;
+
+    std::map<std::string, Subscription> subscriptions; // 会话ID -> 订阅
+    mutable std::mutex subscriptionsMutex;
+
+    std::thread tickThread;
+    std::mutex tickMutex;
+    std::condition_variable tickCondition;
+    bool stopping;
+    bool running;
+
+    Stats stats; // 由 subscriptionsMutex 保护
+
+    Subscription &subscriptionFor(const std::shared_ptr<ClientSession> &session, uint64_t epoch, uint64_t version);
+    void tickLoop();
+    void tick();
+};
+
+#endif // SUBSCRIPTION_MANAGER_H
@@ -0,0 +1,203 @@
+#include "wire.h"
+#include <cstring>
+#include <limits>
+#include <cmath>
+
+namespace Wire
+{
+    namespace
+    {
+        const double kPow10[] = {1.0, 10.0, 100.0, 1000.0, 10000.0};
+        const int kMaxDecimalScale = 4;
+        const uint64_t kRawDoubleMarker = 7;
+        const double kMaxExactMantissa = 9007199254740992.0; // 2^53
+    }
+
+    bool parseCanonicalInt(const std::string &text, int64_t &value)
+    {
+        size_t len = text.size();
+        if (len == 0 || len > 20)
+        {
+            return false;
+        }
+
+        size_t pos = 0;
+        bool negative = false;
+        if (text[0] == '-')
+        {
+            negative = true;
+            pos = 1;
+            if (len == 1)
+            {
+                return false;
+            }
+        }
+
+        // "0" 是规范形式，"-0"、"007" 不是
+        if (text[pos] == '0' && (len - pos > 1 || negative))
+        {
+            return false;
+        }
+
+        uint64_t magnitude = 0;
+        for (size_t i = pos; i < len; ++i)
+        {
+            char c = text[i];
+            if (c < '0' || c > '9')
+            {
+                return false;
+            }
+            uint64_t digit = static_cast<uint64_t>(c - '0');
+            if (magnitude > (std::numeric_limits<uint64_t>::max() - digit) / 10)
+            {
+                return false;
+            }
+            magnitude = magnitude * 10 + digit;
+        }
+
+        const uint64_t maxPositive = static_cast<uint64_t>(std::numeric_limits<int64_t>::max());
+        if (negative)
+        {
+            if (magnitude > maxPositive + 1)
+            {
+                return false;
+            }
+            value = static_cast<int64_t>(0 - magnitude);
+        }
+        else
+        {
+            if (magnitude > maxPositive)
+            {
+                return false;
+            }
+            value = static_cast<int64_t>(magnitude);
+        }
+        return true;
+    }
+
+    void Writer::writeVarint(uint64_t value)
+    {
+        while (value >= 0x80)
+        {
+            out.push_back(static_cast<char>((value & 0x7F) | 0x80));
+            value >>= 7;
+        }
+        out.push_back(static_cast<char>(value));
+    }
+
+    void Writer::writeDouble(double value)
+    {
+        // 统一按小端写出，保证不同平台之间可以互通
+        uint64_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        for (int i = 0; i < 8; ++i)
+        {
+            out.push_back(static_cast<char>((bits >> (8 * i)) & 0xFF));
+        }
+    }
+
+    void Writer::writeDecimal(double value)
+    {
+        for (int scale = 0; scale <= kMaxDecimalScale; ++scale)
+        {
+            double scaled = value * kPow10[scale];
+            if (!(std::fabs(scaled) < kMaxExactMantissa))
+            {
+                break;
+            }
+            double mantissa = std::round(scaled);
+            if (mantissa / kPow10[scale] == value)
+            {
+                writeVarint(zigzagEncode(static_cast<int64_t>(mantissa)) * 8 + static_cast<uint64_t>(scale));
+                return;
+            }
+        }
+        writeVarint(kRawDoubleMarker);
+        writeDouble(value);
+    }
+
+    void Writer::writeString(const std::string &value)
+    {
+        writeVarint(value.size());
+        out.append(value);
+    }
+
+    uint8_t Reader::readByte()
+    {
+        if (!ok || cur >= end)
+        {
+            ok = false;
+            return 0;
+        }
+        return static_cast<uint8_t>(*cur++);
+    }
+
+    uint64_t Reader::readVarint()
+    {
+        uint64_t result = 0;
+        for (int shift = 0; shift < 64; shift += 7)
+        {
+            if (!ok || cur >= end)
+            {
+                ok = false;
+                return 0;
+            }
+            uint8_t byte = static_cast<uint8_t>(*cur++);
+            result |= static_cast<uint64_t>(byte & 0x7F) << shift;
+            if ((byte & 0x80) == 0)
+            {
+                return result;
+            }
+        }
+        ok = false; // 超过 10 字节，数据已损坏
+        return 0;
+    }
+
+    double Reader::readDouble()
+    {
+        if (!ok || remaining() < 8)
+        {
+            ok = false;
+            return 0.0;
+        }
+        uint64_t bits = 0;
+        for (int i = 0; i < 8; ++i)
+        {
+            bits |= static_cast<uint64_t>(static_cast<uint8_t>(cur[i])) << (8 * i);
+        }
+        cur += 8;
+        double value;
+        std::memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+
+    double Reader::readDecimal()
+    {
+        uint64_t header = readVarint();
+        uint64_t scale = header & 7;
+        if (scale == kRawDoubleMarker)
+        {
+            return readDouble();
+        }
+        if (scale > static_cast<uint64_t>(kMaxDecimalScale))
+        {
+            ok = false;
+            return 0.0;
+        }
+        return static_cast<double>(zigzagDecode(header >> 3)) / kPow10[scale];
+    }
+
+    std::string_view Reader::readView()
+    {
+        uint64_t len = readVarint();
+        if (!ok || len > remaining())
+        {
+            ok = false;
+            return std::string_view();
+        }
+        std::string_view value(cur, static_cast<size_t>(len));
+        cur += len;
+        return value;
+    }
+
+} // namespace Wire
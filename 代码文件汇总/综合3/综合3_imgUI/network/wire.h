@@ -0,0 +1,83 @@
+#ifndef WIRE_H
+#define WIRE_H
+
+#include <string>
+#include <string_view>
+#include <cstdint>
+
+// 二进制编码基础工具：变长整数（varint）、zigzag 有符号整数、定长小端 double、
+// 带长度前缀的字符串。所有读取都做边界检查，越界后 Reader 进入失败状态并返回默认值。
+namespace Wire
+{
+    // 二进制帧/记录的首字节魔数。取值落在 0x80-0xBF（UTF-8 续字节范围），
+    // 文本格式的首字节不可能是这些值，因此接收方可以逐帧自动识别格式。
+    const uint8_t kMessageMagic = 0xB1;
+    const uint8_t kRecordMagic = 0xB2;
+
+    // 字段值的线上类型
+    enum class FieldType : uint8_t
+    {
+        STRING = 0, // varint 长度 + 字节
+        INT = 1     // zigzag varint
+    };
+
+    inline uint64_t zigzagEncode(int64_t value)
+    {
+        return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+    }
+
+    inline int64_t zigzagDecode(uint64_t value)
+    {
+        return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+    }
+
+    // 判断字符串是否为规范十进制整数（无前导零、无多余符号、在 int64 范围内），
+    // 只有规范形式才能以 INT 类型编码并保证解码后与原字符串完全一致
+    bool parseCanonicalInt(const std::string &text, int64_t &value);
+
+    class Writer
+    {
+    private:
+        std::string &out;
+
+    public:
+        explicit Writer(std::string &buffer) : out(buffer) {}
+
+        void writeByte(uint8_t value) { out.push_back(static_cast<char>(value)); }
+        void writeVarint(uint64_t value);
+        void writeSigned(int64_t value) { writeVarint(zigzagEncode(value)); }
+        void writeDouble(double value);
+        // 价格/折扣等十进制小数：能以不超过 4 位小数精确表示时写成 varint(zigzag(尾数) * 8 + 小数位数)，
+        // 否则写标记 7 后跟 8 字节 double。常见金额只需 2~4 字节且解码结果与原值逐位相同。
+        void writeDecimal(double value);
+        void writeString(const std::string &value);
+    };
+
+    class Reader
+    {
+    private:
+        const char *cur;
+        const char *end;
+        bool ok;
+
+    public:
+        Reader(const char *data, size_t size) : cur(data), end(data + size), ok(true) {}
+        explicit Reader(std::string_view data) : Reader(data.data(), data.size()) {}
+
+        bool isOk() const { return ok; }
+        bool atEnd() const { return cur == end; }
+        size_t remaining() const { return static_cast<size_t>(end - cur); }
+
+        uint8_t readByte();
+        uint64_t readVarint();
+        int64_t readSigned() { return zigzagDecode(readVarint()); }
+        double readDouble();
+        double readDecimal();
+        std::string readString() { return std::string(readView()); }
+        // 返回指向输入缓冲区的视图，不拷贝；视图在输入缓冲区有效期间有效
+        std::string_view readView();
+    };
+
+} // namespace Wire
+
+#endif // WIRE_H
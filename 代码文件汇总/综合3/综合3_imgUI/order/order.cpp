@@ -46,7 +46,7 @@ bool Order::addItemFromProduct(const Product &product, int quantity)
         return false;
     // Note: Stock check should happen before calling this, or this method could also check
     // For now, assumes stock check is done externally before adding to order object
-    items.emplace_back(product.getName(), product.getName(), quantity, product.getPrice(), product.getSellerUsername());
+    items.emplace_back(product.getId(), product.getName(), quantity, product.getPrice(), product.getSellerUsername());
     calculateTotalAmount(); // Recalculate total every time an item is added
     return true;
 }
@@ -90,7 +90,7 @@ std::string OrderItem::toStringForSave() const
     std::stringstream ss;
     ss << std::fixed << std::setprecision(2);
     // Simple CSV-like, ensure no commas in your string fields or use a different delimiter/quoting
-    ss << productId << "," << productName << "," << quantity << "," << priceAtPurchase << "," << sellerUsername;
+    ss << Store::productIdText(productId, productName) << "," << productName << "," << quantity << "," << priceAtPurchase << "," << sellerUsername;
     return ss.str();
 }
 std::string Order::toStringForSaveHeader() const
@@ -3,6 +3,8 @@
 
 #include <string>
 #include <vector>
+#include <map>
+#include <cstdint>
 #include <ctime>
 #include <iomanip>  // For std::setprecision
 #include <iostream> // For display methods
@@ -16,14 +18,14 @@ class OrderItem
 {
 
 public:
-    std::string productId;
+    uint64_t productId; // 商品ID，0 表示分配ID之前保存的旧订单
     std::string productName;
     int quantity;
     double priceAtPurchase;
     std::string sellerUsername;
 
-    OrderItem(std::string pid, std::string pName, int qty, double price, std::string sUsername)
-        : productId(std::move(pid)), productName(std::move(pName)), quantity(qty),
+    OrderItem(uint64_t pid, std::string pName, int qty, double price, std::string sUsername)
+        : productId(pid), productName(std::move(pName)), quantity(qty),
           priceAtPurchase(price), sellerUsername(std::move(sUsername)) {}
 
     void display() const;
@@ -40,6 +42,8 @@ private:
     double totalAmount;
     bool isProcessed; // Indicates if the order has been processed
     time_t orderTimestamp;
+    // 结算时消耗的买家预留：商品ID -> 件数。下单时从会话的库存预留中取出，结算后未用完的部分解锁
+    std::map<uint64_t, int> reservedQuantities;
     std::string status; // e.g., "PENDING_CONFIRMATION", "COMPLETED", "CANCELLED_INSUFFICIENT_STOCK", "CANCELLED_INSUFFICIENT_FUNDS", "CANCELLED_BY_USER"
     static std::string generateOrderId();
 
@@ -71,6 +75,8 @@ public:
     void setOrderId(const std::string &id) { orderId = id; }
     void setTotalAmount(double amount) { totalAmount = amount; }
     bool getProcessed() const { return isProcessed; }
+    void addReservedQuantity(uint64_t productId, int quantity) { reservedQuantities[productId] += quantity; }
+    const std::map<uint64_t, int> &getReservedQuantities() const { return reservedQuantities; }
 
     void displaySummary() const;
 
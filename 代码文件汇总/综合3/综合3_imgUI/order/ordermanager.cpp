@@ -19,7 +19,7 @@ using namespace std;
 
 // 构造函数，初始化订单目录
 OrderManager::OrderManager(const std::string &ordersDir)
-    : completedOrdersDirectory(ordersDir), stopProcessing(false)
+    : completedOrdersDirectory(ordersDir), stopProcessing(false), orderPool(std::make_shared<ObjectPool<Order>>())
 {
     // 确保订单目录存在
     if (!std::filesystem::exists(completedOrdersDirectory))
@@ -130,67 +130,114 @@ void OrderManager::processNextOrderInternal(std::shared_ptr<Order> currentOrder,
          << "，客户: " << currentOrder->getCustomerUsername() << endl;
     currentOrder->setStatus("PROCESSING");
 
+    // 失败时把订单带来的买家预留全部解锁，库存不会因失败的订单一直被占用
+    auto failOrder = [&](const std::string &status)
+    {
+        for (const auto &reserved : currentOrder->getReservedQuantities())
+        {
+            store.unlockInventory(reserved.first, reserved.second);
+        }
+        currentOrder->setStatus(status);
+        saveOrderToFile(*currentOrder);
+        currentOrder->setProcessed(true); // 标记处理完成
+    };
+
     // 找到订单对应的客户
     Customer *customer = dynamic_cast<Customer *>(User::findUser(allUsers, currentOrder->getCustomerUsername()));
     if (!customer)
     {
         cerr << "错误: 找不到订单对应的客户 " << currentOrder->getCustomerUsername() << endl;
-        currentOrder->setStatus("FAILED_CUSTOMER_NOT_FOUND");
-        saveOrderToFile(*currentOrder);   // 注意这里需要解引用
-        currentOrder->setProcessed(true); // 标记处理完成
+        failOrder("FAILED_CUSTOMER_NOT_FOUND");
         return;
     }
 
-    // 第一阶段：重新验证商品（库存可能在队列等待期间发生变化）
-    for (const auto &item : currentOrder->getItems())
+    // 第一阶段：重新验证商品（库存可能在队列等待期间发生变化），并按订单项顺序分配买家预留
+    const std::vector<OrderItem> &items = currentOrder->getItems();
+    std::map<uint64_t, int> unusedReserved = currentOrder->getReservedQuantities();
+    std::vector<Product *> products;
+    std::vector<int> fromReserved;
+    for (const auto &item : items)
     {
-        Product *product = store.findProductByName(item.productId);
+        Product *product = store.resolveProduct(item.productId, item.productName, item.sellerUsername);
         if (!product)
         {
             cerr << "错误: 商品 \"" << item.productName << "\" 不存在或已下架。订单取消。" << endl;
-            currentOrder->setStatus("FAILED_PRODUCT_NOT_FOUND");
-            saveOrderToFile(*currentOrder);
-            currentOrder->setProcessed(true);
+            failOrder("FAILED_PRODUCT_NOT_FOUND");
             return;
         }
-        if (product->getQuantity() < item.quantity)
+        int reservedPart = 0;
+        auto reservedIt = unusedReserved.find(product->getId());
+        if (reservedIt != unusedReserved.end())
+        {
+            reservedPart = reservedIt->second < item.quantity ? reservedIt->second : item.quantity;
+            reservedIt->second -= reservedPart;
+        }
+        // 别人锁定的库存不能卖，可用的只有可售库存加上自己的预留
+        if (product->getAvailable() + reservedPart < item.quantity)
         {
             cerr << "错误: 商品 \"" << item.productName << "\" 库存不足 (需要 "
-                 << item.quantity << ", 现有 " << product->getQuantity() << ")。订单取消。" << endl;
-            currentOrder->setStatus("FAILED_INSUFFICIENT_STOCK");
-            saveOrderToFile(*currentOrder);
-            currentOrder->setProcessed(true);
+                 << item.quantity << ", 可售 " << product->getAvailable() << ", 本单预留 " << reservedPart
+                 << ")。订单取消。" << endl;
+            failOrder("FAILED_INSUFFICIENT_STOCK");
             return;
         }
+        products.push_back(product);
+        fromReserved.push_back(reservedPart);
     }
 
     // 第二阶段：验证客户余额
     if (customer->checkBalance() < currentOrder->getTotalAmount())
     {
         cerr << "错误: 客户 " << customer->getUsername() << " 余额不足。订单取消。" << endl;
-        currentOrder->setStatus("FAILED_INSUFFICIENT_FUNDS");
-        saveOrderToFile(*currentOrder);
-        currentOrder->setProcessed(true);
+        failOrder("FAILED_INSUFFICIENT_FUNDS");
         return;
     }
 
-    // 第三阶段：处理支付和更新库存
+    // 第三阶段：扣减库存。每件商品一次 CAS，第一阶段之后库存仍可能被并发的订单或锁定抢走，
+    // 任一商品扣减失败时把已扣减的商品按原样加回
+    auto rollbackStock = [&](size_t count)
+    {
+        for (size_t i = 0; i < count; ++i)
+        {
+            products[i]->restock(items[i].quantity, fromReserved[i]);
+        }
+    };
+    for (size_t i = 0; i < items.size(); ++i)
+    {
+        if (!products[i]->tryConsume(items[i].quantity, fromReserved[i]))
+        {
+            cerr << "错误: 商品 \"" << items[i].productName << "\" 库存已被抢先售出或锁定 (需要 "
+                 << items[i].quantity << ", 可售 " << products[i]->getAvailable() << ")。订单取消。" << endl;
+            rollbackStock(i);
+            failOrder("FAILED_INSUFFICIENT_STOCK");
+            return;
+        }
+    }
+
+    // 第四阶段：扣款，失败时归还库存
     if (!customer->withdraw(currentOrder->getTotalAmount()))
     {
         cerr << "严重错误: 客户 " << customer->getUsername()
              << " 扣款失败，尽管余额检查已通过。订单: " << currentOrder->getOrderId() << endl;
-        currentOrder->setStatus("FAILED_PAYMENT_ERROR");
-        saveOrderToFile(*currentOrder);
-        currentOrder->setProcessed(true);
+        rollbackStock(items.size());
+        failOrder("FAILED_PAYMENT_ERROR");
         return;
     }
 
+    // 预留中本单没有用到的部分解锁
+    for (const auto &reserved : unusedReserved)
+    {
+        if (reserved.second > 0)
+        {
+            store.unlockInventory(reserved.first, reserved.second);
+        }
+    }
+
     bool allSellersPaid = true;
-    for (const auto &item : currentOrder->getItems())
+    for (size_t i = 0; i < items.size(); ++i)
     {
-        Product *product = store.findProductByName(item.productId);
-        // 更新商品库存
-        product->setQuantity(product->getQuantity() - item.quantity);
+        const OrderItem &item = items[i];
+        store.markProductChanged(products[i]);
 
         // 向卖家转账
         User *seller = User::findUser(allUsers, item.sellerUsername);
@@ -221,7 +268,8 @@ void OrderManager::processNextOrderInternal(std::shared_ptr<Order> currentOrder,
     } // 保存所有更改（用户和商店）
     // 在服务端版本中，用户数据的保存由网络服务端统一管理
     // User::saveUsersToFile(allUsers, userFilePath);
-    store.saveAllProducts();
+    // 只记下有变更的商家，由商店的后台写入线程写文件（未启用时立即写出这些商家）
+    store.saveChanges();
 
     // 设置最终订单状态
     if (allSellersPaid)
@@ -277,8 +325,8 @@ bool OrderManager::saveOrderToFile(const Order &order) const
 // 提交订单到处理队列 (线程安全版本)
 std::shared_ptr<Order> OrderManager::submitOrderRequest(const Order &orderRequest)
 {
-    // 创建订单的共享指针副本
-    auto orderPtr = std::make_shared<Order>(orderRequest);
+    // 创建订单的共享指针副本（从订单对象池分配）
+    auto orderPtr = makeOrder(orderRequest);
 
     // 设置订单状态为等待队列处理
     orderPtr->setStatus("PENDING_IN_QUEUE");
@@ -435,7 +483,7 @@ void OrderManager::getUserOrders(const std::string &username,
                         double totalAmount = 0.0;
                         time_t timestamp = 0;
                         int itemsCount = 0; // 修改变量名
-                        std::string productId;
+                        uint64_t productId = 0;
                         std::string productName;
                         int quantity;
                         double priceAtPurchase;
@@ -502,7 +550,9 @@ void OrderManager::getUserOrders(const std::string &username,
                             // 确保解析了足够的部分
                             if (parts.size() >= 5)
                             {
-                                productId = parts[0];
+                                // 旧订单第一列是商品名称，ID 记为 0
+                                productId = 0;
+                                Store::parseProductId(parts[0], productId);
                                 productName = parts[1];
                                 quantity = std::stoi(parts[2]);
                                 priceAtPurchase = std::stod(parts[3]);
@@ -516,7 +566,7 @@ void OrderManager::getUserOrders(const std::string &username,
 
                         if (isUserOrder)
                         {
-                            auto order = std::make_shared<Order>(username);
+                            auto order = makeOrder(username);
                             order->setStatus(status);
 
                             // 如果有订单ID，设置它（否则会生成新的ID）
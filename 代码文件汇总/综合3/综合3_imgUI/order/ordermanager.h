@@ -4,6 +4,7 @@
 #include "../order/order.h"
 #include "../store/store.h"
 #include "../user/user.h"
+#include "../store/object_pool.h"
 #include <deque>
 #include <string>
 #include <vector>
@@ -26,6 +27,17 @@ private:
     std::condition_variable queueCondVar;
     std::atomic<bool> stopProcessing;
 
+    // 订单对象池。订单以 shared_ptr 交给调用方，删除器持有对象池的引用，
+    // 订单比 OrderManager 活得更久时也能正确归还
+    std::shared_ptr<ObjectPool<Order>> orderPool;
+
+    template <typename... Args>
+    std::shared_ptr<Order> makeOrder(Args &&...args)
+    {
+        std::shared_ptr<ObjectPool<Order>> pool = orderPool;
+        return std::shared_ptr<Order>(pool->create(std::forward<Args>(args)...), [pool](Order *order) { pool->destroy(order); });
+    }
+
     // Helper to save a single order to its own file
     bool saveOrderToFile(const Order &order) const;
 
@@ -52,6 +64,7 @@ public:
 
     // 添加这个声明！
     size_t getPendingOrderCount() const;
+    PoolStats getOrderPoolStats() const { return orderPool->getStats(); }
 
     // 显示待处理订单
     void displayPendingOrders() const;
@@ -2,7 +2,9 @@
 #include <string>
 #include <signal.h>
 #include "network/server.h"
+#ifdef _WIN32
 #include <windows.h>
+#endif
 
 // 全局服务器指针，用于信号处理
 NetworkServer *g_server = nullptr;
@@ -50,10 +52,58 @@ int main()
     std::cout << "按 Ctrl+C 停止服务器" << std::endl;
 
     // 服务器主循环
+    auto lastStatsTime = std::chrono::steady_clock::now();
+    uint64_t lastSubmitted = 0;
     while (server.isServerRunning())
     {
         // 服务器在后台运行，这里可以添加管理命令
         std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+        // 每分钟输出一次业务线程池状态（无新请求时不输出）
+        auto now = std::chrono::steady_clock::now();
+        if (now - lastStatsTime >= std::chrono::seconds(60))
+        {
+            lastStatsTime = now;
+            HandlerPool::Stats stats = server.getHandlerPoolStats();
+            if (stats.submitted != lastSubmitted)
+            {
+                lastSubmitted = stats.submitted;
+                std::cout << "[线程池] 在线会话: " << server.getActiveSessionCount()
+                          << ", 排队: " << stats.queueDepth << " (峰值 " << stats.maxQueueDepth << "/" << stats.capacity << ")"
+                          << ", 忙碌线程: " << stats.busyWorkers << "/" << stats.workerCount
+                          << ", 已完成: " << stats.completed << ", 已拒绝: " << stats.rejected
+                          << ", 平均等待: " << stats.avgWaitMs << "ms (最大 " << stats.maxWaitMs << "ms)"
+                          << ", 平均执行: " << stats.avgRunMs << "ms" << std::endl;
+                CatalogSnapshotCache::Stats catalog = server.getCatalogStats();
+                std::cout << "[目录快照] 命中: " << catalog.hits << ", 重建: " << catalog.rebuilds
+                          << ", 重新编码记录: " << catalog.encodedRecords << ", 复用记录: " << catalog.reusedRecords << std::endl;
+                SubscriptionManager::Stats push = server.getSubscriptionStats();
+                std::cout << "[推送] 订阅会话: " << push.subscribers << ", 推送: " << push.pushes
+                          << ", 商品记录: " << push.pushedProducts << ", 积压推迟: " << push.deferred
+                          << ", 要求重新同步: " << push.resyncs << std::endl;
+                PoolStats products = server.getProductPoolStats();
+                PoolStats orders = server.getOrderPoolStats();
+                std::cout << "[内存池] 商品: " << products.liveObjects << " 个 (空闲槽位 " << products.freeSlots
+                          << ", 碎片率 " << static_cast<int>(products.fragmentation() * 100) << "%, " << products.reservedBytes / 1024 << "KB)"
+                          << ", 订单: " << orders.liveObjects << " 个 (峰值 " << orders.peakLiveObjects << ", 空闲槽位 " << orders.freeSlots
+                          << ", " << orders.reservedBytes / 1024 << "KB)" << std::endl;
+                StoreWriter::Stats writer = server.getStoreWriterStats();
+                std::cout << "[商品写入] 积压: " << writer.pendingChanges << " 条变更/" << writer.pendingSellers << " 个商家"
+                          << " (最早 " << writer.oldestPendingMs << "ms)"
+                          << ", 写入轮数: " << writer.flushes << ", 写入文件: " << writer.sellerFilesWritten
+                          << ", 失败: " << writer.failedWrites
+                          << ", 耗时: 最近 " << writer.lastFlushMs << "ms, 平均 " << writer.avgFlushMs << "ms, 最大 " << writer.maxFlushMs << "ms" << std::endl;
+                MutationLog::Stats wal = server.getMutationLogStats();
+                std::cout << "[变更日志] 记录: " << wal.appendedRecords << " 条/" << wal.appendedBytes / 1024 << "KB"
+                          << ", 组提交: " << wal.groupCommits << " 次 (最大 " << wal.maxGroupRecords << " 条, 平均 " << wal.avgCommitMs << "ms)"
+                          << ", 日志段: " << wal.segments << " (当前 " << wal.currentSegment << ")"
+                          << ", 失败提交: " << wal.failedCommits << (wal.failed ? " (等待重试)" : "") << std::endl;
+                ReservationManager::Stats reservations = server.getReservationStats();
+                std::cout << "[库存预留] 当前: " << reservations.active << ", 已创建: " << reservations.created
+                          << ", 主动解锁: " << reservations.released << ", 下单消耗: " << reservations.ordered << ", 会话断开释放: " << reservations.sessionClosed
+                          << ", 到期释放: " << reservations.expired << " (" << reservations.expiredUnits << " 件)" << std::endl;
+            }
+        }
     }
 
     std::cout << "服务器已停止" << std::endl;
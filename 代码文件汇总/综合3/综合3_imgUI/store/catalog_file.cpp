@@ -0,0 +1,339 @@
+#include "catalog_file.h"
+#include "store.h"
+#include "mutation_log.h"
+#include <iostream>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#include <io.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+namespace
+{
+    const char kMagic[4] = {'S', 'C', 'A', 'T'};
+
+    struct FileHeader
+    {
+        char magic[4];
+        uint32_t version;
+        uint64_t productCount;
+        uint64_t stringsSize;
+        uint32_t checksum; // 记录表与字符串区的 CRC32
+        uint32_t reserved;
+    };
+
+    struct StringRef
+    {
+        uint32_t offset; // 相对字符串区起点
+        uint32_t length;
+    };
+
+    const size_t kStringFields = 5;
+
+    struct ProductRecord
+    {
+        uint64_t id;
+        double originalPrice;
+        double discountRate;
+        int32_t quantity;
+        uint8_t kind;
+        uint8_t reserved[3];
+        StringRef fields[kStringFields]; // 名称、描述、商家、种类特有字段 1、2
+    };
+
+    static_assert(sizeof(FileHeader) == 32, "快照文件头必须是 32 字节");
+    static_assert(sizeof(ProductRecord) == 72, "快照记录必须是 72 字节");
+
+    bool appendString(std::string &pool, const std::string &text, StringRef &ref)
+    {
+        if (pool.size() + text.size() > UINT32_MAX)
+        {
+            return false;
+        }
+        ref.offset = static_cast<uint32_t>(pool.size());
+        ref.length = static_cast<uint32_t>(text.size());
+        pool += text;
+        return true;
+    }
+}
+
+CatalogFile::CatalogFile()
+    : data(nullptr), length(0), productCount(0), records(nullptr), strings(nullptr), stringsSize(0)
+#ifdef _WIN32
+      ,
+      fileHandle(nullptr), mappingHandle(nullptr)
+#endif
+{
+}
+
+CatalogFile::~CatalogFile()
+{
+    close();
+}
+
+bool CatalogFile::fail(const std::string &path, const char *reason)
+{
+    std::cerr << "商品目录快照 " << path << " 无效: " << reason << std::endl;
+    close();
+    return false;
+}
+
+bool CatalogFile::open(const std::string &path)
+{
+    close();
+
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        return false;
+    }
+    fileHandle = file;
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart < static_cast<LONGLONG>(sizeof(FileHeader)))
+    {
+        return fail(path, "文件过短");
+    }
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!mapping)
+    {
+        return fail(path, "无法映射文件");
+    }
+    mappingHandle = mapping;
+    void *view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (!view)
+    {
+        return fail(path, "无法映射文件");
+    }
+    data = static_cast<const char *>(view);
+    length = static_cast<size_t>(fileSize.QuadPart);
+#else
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        return false;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size < static_cast<off_t>(sizeof(FileHeader)))
+    {
+        ::close(fd);
+        return fail(path, "文件过短");
+    }
+    void *view = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd); // 映射建立后不再需要文件描述符
+    if (view == MAP_FAILED)
+    {
+        return fail(path, "无法映射文件");
+    }
+    data = static_cast<const char *>(view);
+    length = static_cast<size_t>(info.st_size);
+#endif
+
+    FileHeader header;
+    memcpy(&header, data, sizeof(header));
+    if (memcmp(header.magic, kMagic, sizeof(kMagic)) != 0)
+    {
+        return fail(path, "魔数不符");
+    }
+    if (header.version != kFormatVersion)
+    {
+        return fail(path, "格式版本不符");
+    }
+    size_t body = length - sizeof(FileHeader);
+    if (header.productCount > body / sizeof(ProductRecord) ||
+        header.stringsSize != body - header.productCount * sizeof(ProductRecord))
+    {
+        return fail(path, "长度与文件头不符");
+    }
+    if (MutationLog::crc32(data + sizeof(FileHeader), body) != header.checksum)
+    {
+        return fail(path, "校验和不符");
+    }
+
+    productCount = static_cast<size_t>(header.productCount);
+    stringsSize = static_cast<size_t>(header.stringsSize);
+    records = data + sizeof(FileHeader);
+    strings = records + productCount * sizeof(ProductRecord);
+
+    // 校验一遍全部字符串引用，之后 product() 不再检查边界
+    for (size_t i = 0; i < productCount; ++i)
+    {
+        ProductRecord record;
+        memcpy(&record, records + i * sizeof(ProductRecord), sizeof(record));
+        if (record.kind > static_cast<uint8_t>(ProductKind::GENERIC))
+        {
+            return fail(path, "商品种类无效");
+        }
+        for (const StringRef &ref : record.fields)
+        {
+            if (ref.offset > stringsSize || ref.length > stringsSize - ref.offset)
+            {
+                return fail(path, "字符串越界");
+            }
+        }
+    }
+    return true;
+}
+
+void CatalogFile::close()
+{
+#ifdef _WIN32
+    if (data)
+    {
+        UnmapViewOfFile(data);
+    }
+    if (mappingHandle)
+    {
+        CloseHandle(static_cast<HANDLE>(mappingHandle));
+        mappingHandle = nullptr;
+    }
+    if (fileHandle)
+    {
+        CloseHandle(static_cast<HANDLE>(fileHandle));
+        fileHandle = nullptr;
+    }
+#else
+    if (data)
+    {
+        munmap(const_cast<char *>(data), length);
+    }
+#endif
+    data = nullptr;
+    length = 0;
+    productCount = 0;
+    records = nullptr;
+    strings = nullptr;
+    stringsSize = 0;
+}
+
+CatalogFile::ProductView CatalogFile::product(size_t index) const
+{
+    ProductRecord record;
+    memcpy(&record, records + index * sizeof(ProductRecord), sizeof(record));
+    auto field = [this, &record](size_t i)
+    {
+        return std::string_view(strings + record.fields[i].offset, record.fields[i].length);
+    };
+
+    ProductView view;
+    view.id = record.id;
+    view.kind = record.kind;
+    view.originalPrice = record.originalPrice;
+    view.discountRate = record.discountRate;
+    view.quantity = record.quantity;
+    view.name = field(0);
+    view.description = field(1);
+    view.sellerUsername = field(2);
+    view.attribute1 = field(3);
+    view.attribute2 = field(4);
+    return view;
+}
+
+bool CatalogFile::write(const std::string &path, const std::vector<const Product *> &products)
+{
+    std::string body(products.size() * sizeof(ProductRecord), '\0');
+    std::string pool;
+    static const std::string empty;
+
+    for (size_t i = 0; i < products.size(); ++i)
+    {
+        const Product *p = products[i];
+        ProductRecord record;
+        memset(&record, 0, sizeof(record));
+        record.id = p->getId();
+        record.originalPrice = p->getOriginalPrice();
+        record.discountRate = p->getDiscountRate();
+        record.quantity = p->getQuantity();
+        record.kind = static_cast<uint8_t>(p->getKind());
+
+        const std::string *attribute1 = &empty;
+        const std::string *attribute2 = &empty;
+        if (const BookAttributes *book = p->getAttributesAs<BookAttributes>())
+        {
+            attribute1 = &book->author;
+            attribute2 = &book->isbn;
+        }
+        else if (const ClothingAttributes *clothing = p->getAttributesAs<ClothingAttributes>())
+        {
+            attribute1 = &clothing->size;
+            attribute2 = &clothing->color;
+        }
+        else if (const FoodAttributes *food = p->getAttributesAs<FoodAttributes>())
+        {
+            attribute1 = &food->expirationDate;
+        }
+        else if (const GenericAttributes *generic = p->getAttributesAs<GenericAttributes>())
+        {
+            attribute1 = &generic->categoryTag;
+        }
+
+        const std::string *fields[kStringFields] = {&p->getName(), &p->getDescription(), &p->getSellerUsername(), attribute1, attribute2};
+        for (size_t f = 0; f < kStringFields; ++f)
+        {
+            if (!appendString(pool, *fields[f], record.fields[f]))
+            {
+                std::cerr << "错误: 商品目录过大，无法写入快照" << std::endl;
+                return false;
+            }
+        }
+        memcpy(&body[i * sizeof(ProductRecord)], &record, sizeof(record));
+    }
+    body += pool;
+
+    FileHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.version = kFormatVersion;
+    header.productCount = products.size();
+    header.stringsSize = pool.size();
+    header.checksum = MutationLog::crc32(body.data(), body.size());
+
+    std::string tempPath = path + ".tmp";
+    FILE *file = fopen(tempPath.c_str(), "wb");
+    if (!file)
+    {
+        std::cerr << "错误: 无法创建商品目录快照: " << tempPath << std::endl;
+        return false;
+    }
+    bool ok = fwrite(&header, 1, sizeof(header), file) == sizeof(header) &&
+              fwrite(body.data(), 1, body.size(), file) == body.size() &&
+              fflush(file) == 0;
+    // 快照替换后会删除旧的变更日志段，必须先确保快照落盘
+#ifdef _WIN32
+    ok = ok && _commit(_fileno(file)) == 0;
+#else
+    ok = ok && fsync(fileno(file)) == 0;
+#endif
+    ok = fclose(file) == 0 && ok;
+    if (!ok)
+    {
+        std::cerr << "错误: 写入商品目录快照失败: " << tempPath << std::endl;
+        return false;
+    }
+
+    std::error_code ec;
+    fs::rename(tempPath, path, ec);
+    if (ec)
+    {
+        // 部分平台不能覆盖已存在的文件
+        fs::remove(path, ec);
+        fs::rename(tempPath, path, ec);
+        if (ec)
+        {
+            std::cerr << "错误: 无法替换商品目录快照 " << path << ": " << ec.message() << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,70 @@
+#ifndef CATALOG_FILE_H
+#define CATALOG_FILE_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+
+class Product;
+
+// 商品目录的二进制快照（catalog.bin），启动时映射到内存直接读取，不做文本解析。
+// 布局（本机字节序，x86 为小端）：
+//   文件头 32 字节：魔数 "SCAT"、格式版本、商品数、字符串区字节数、CRC32（记录表与字符串区）
+//   记录表：每件商品一条定长记录（ID、原价、折扣、库存、种类、5 个字符串的偏移和长度）
+//   字符串区：名称、描述、商家、种类特有字段依次存放
+// 记录定长，第 i 件商品可直接定位；字符串以视图返回，由调用方决定何时拷贝
+class CatalogFile
+{
+public:
+    static const uint32_t kFormatVersion = 1;
+
+    // 指向映射内存的只读视图，CatalogFile 关闭后失效
+    struct ProductView
+    {
+        uint64_t id;
+        uint8_t kind; // ProductKind 的值
+        double originalPrice;
+        double discountRate;
+        int quantity;
+        std::string_view name;
+        std::string_view description;
+        std::string_view sellerUsername;
+        // 种类特有字段：图书为作者、ISBN，服装为尺码、颜色，食品为保质期，通用商品为分类标签
+        std::string_view attribute1;
+        std::string_view attribute2;
+    };
+
+    CatalogFile();
+    ~CatalogFile();
+
+    CatalogFile(const CatalogFile &) = delete;
+    CatalogFile &operator=(const CatalogFile &) = delete;
+
+    // 映射文件并校验文件头、版本、长度与校验和；失败时返回 false 并输出原因
+    bool open(const std::string &path);
+    void close();
+    bool isOpen() const { return data != nullptr; }
+
+    size_t size() const { return productCount; }
+    ProductView product(size_t index) const;
+
+    // 把商品按顺序写成快照：先写临时文件并刷到磁盘，再替换 path
+    static bool write(const std::string &path, const std::vector<const Product *> &products);
+
+private:
+    const char *data;
+    size_t length;
+    size_t productCount;
+    const char *records;
+    const char *strings;
+    size_t stringsSize;
+#ifdef _WIN32
+    void *fileHandle;
+    void *mappingHandle;
+#endif
+
+    bool fail(const std::string &path, const char *reason);
+};
+
+#endif // CATALOG_FILE_H
@@ -0,0 +1,462 @@
+#include "catalog_snapshot.h"
+#include "facet_index.h"
+#include <unordered_set>
+#include <algorithm>
+#include <numeric>
+#include <sstream>
+
+Protocol::ProductData makeProductData(const Product *product)
+{
+    Protocol::ProductData productData;
+    productData.id = std::to_string(product->getId());
+    productData.name = product->getName();
+    productData.description = product->getDescription();
+
+    // 修复Generic产品显示问题：使用getUserCategory()显示实际类别名称
+    const std::string &userCategory = product->getUserCategory();
+    if (!userCategory.empty())
+    {
+        productData.type = userCategory; // 显示实际类别名称（如自定义标签）
+    }
+    else
+    {
+        productData.type = product->getType(); // 回退到基本类型
+    }
+    // 修复价格显示：发送折扣后的实际价格
+    productData.price = product->getPrice();                 // 使用 getPrice() 获取折扣后价格
+    productData.originalPrice = product->getOriginalPrice(); // 添加原价字段
+    productData.quantity = product->getQuantity();
+    productData.discountRate = product->getDiscountRate();
+    productData.sellerUsername = product->getSellerUsername();
+
+    return productData;
+}
+
+bool parseCatalogSortKey(const std::string &name, CatalogSortKey &key)
+{
+    static const std::pair<const char *, CatalogSortKey> names[] = {
+        {"", CatalogSortKey::NONE},
+        {"price", CatalogSortKey::PRICE},
+        {"discount", CatalogSortKey::DISCOUNT},
+        {"stock", CatalogSortKey::STOCK},
+        {"name", CatalogSortKey::NAME},
+        {"seller", CatalogSortKey::SELLER}};
+    for (const auto &item : names)
+    {
+        if (name == item.first)
+        {
+            key = item.second;
+            return true;
+        }
+    }
+    return false;
+}
+
+uint64_t hashCatalogQuery(const CatalogPageQuery &query)
+{
+    // FNV-1a：只用于识别游标是否属于同一查询，不需要抗碰撞
+    uint64_t hash = 1469598103934665603ULL;
+    auto mix = [&hash](unsigned char byte)
+    {
+        hash ^= byte;
+        hash *= 1099511628211ULL;
+    };
+    for (char c : query.keyword)
+    {
+        mix(static_cast<unsigned char>(c));
+    }
+    mix(0);
+    for (char c : query.filterKey)
+    {
+        mix(static_cast<unsigned char>(c));
+    }
+    mix(0);
+    mix(static_cast<unsigned char>(query.sortKey));
+    mix(query.descending ? 1 : 0);
+    return hash;
+}
+
+std::string encodeCatalogCursor(const CatalogCursor &cursor)
+{
+    std::ostringstream out;
+    out << std::hex << cursor.epoch << '.' << cursor.version << '.' << cursor.queryHash << '.' << cursor.offset;
+    return out.str();
+}
+
+bool decodeCatalogCursor(const std::string &text, CatalogCursor &cursor)
+{
+    uint64_t parts[4];
+    size_t start = 0;
+    for (int i = 0; i < 4; ++i)
+    {
+        size_t end = i < 3 ? text.find('.', start) : text.size();
+        if (end == std::string::npos || end == start)
+        {
+            return false;
+        }
+        try
+        {
+            size_t used = 0;
+            parts[i] = std::stoull(text.substr(start, end - start), &used, 16);
+            if (used != end - start)
+            {
+                return false;
+            }
+        }
+        catch (const std::exception &)
+        {
+            return false;
+        }
+        start = end + 1;
+    }
+    cursor.epoch = parts[0];
+    cursor.version = parts[1];
+    cursor.queryHash = parts[2];
+    cursor.offset = static_cast<size_t>(parts[3]);
+    return true;
+}
+
+bool CatalogSnapshot::findPosition(const Product *product, size_t &position) const
+{
+    auto it = positions.find(product);
+    if (it == positions.end())
+    {
+        return false;
+    }
+    position = it->second;
+    return true;
+}
+
+std::shared_ptr<const std::string> CatalogSnapshot::getBody(Protocol::WireFormat format) const
+{
+    const int index = static_cast<int>(format);
+    auto build = [this, format, index]
+    {
+        Protocol::Message response(Protocol::MessageType::RESPONSE_DATA);
+        response.setData("epoch", std::to_string(epoch));
+        response.setData("version", std::to_string(version));
+        std::vector<std::string> &list = response.addList("products");
+        list.reserve(entries.size());
+        for (const auto &entry : entries)
+        {
+            list.push_back(format == Protocol::WireFormat::BINARY ? entry->binaryRecord : entry->textRecord);
+        }
+        bodies[index] = std::make_shared<const std::string>(response.encodeBody(format));
+    };
+    std::call_once(bodyOnce[index], build);
+    return bodies[index];
+}
+
+std::shared_ptr<const CatalogSnapshot::SortOrder> CatalogSnapshot::getSortOrder(CatalogSortKey key) const
+{
+    const int index = static_cast<int>(key);
+    std::lock_guard<std::mutex> lock(sortMutex);
+    if (sortOrders[index])
+    {
+        return sortOrders[index];
+    }
+
+    auto order = std::make_shared<SortOrder>();
+    order->positions.resize(entries.size());
+    std::iota(order->positions.begin(), order->positions.end(), 0);
+    auto less = [this, key](size_t a, size_t b)
+    {
+        const Entry &left = *entries[a];
+        const Entry &right = *entries[b];
+        switch (key)
+        {
+        case CatalogSortKey::PRICE:
+            return left.price < right.price;
+        case CatalogSortKey::DISCOUNT:
+            return left.discountRate < right.discountRate;
+        case CatalogSortKey::STOCK:
+            return left.quantity < right.quantity;
+        case CatalogSortKey::NAME:
+            return left.name < right.name;
+        case CatalogSortKey::SELLER:
+            return left.sellerUsername < right.sellerUsername;
+        default:
+            return false;
+        }
+    };
+    std::stable_sort(order->positions.begin(), order->positions.end(), less);
+    order->ranks.resize(entries.size());
+    for (size_t rank = 0; rank < order->positions.size(); ++rank)
+    {
+        order->ranks[order->positions[rank]] = rank;
+    }
+    sortOrders[index] = order;
+    return order;
+}
+
+std::shared_ptr<const std::vector<size_t>> CatalogSnapshot::getSortedPositions(CatalogSortKey key) const
+{
+    if (key == CatalogSortKey::NONE)
+    {
+        return nullptr;
+    }
+    std::shared_ptr<const SortOrder> order = getSortOrder(key);
+    return std::shared_ptr<const std::vector<size_t>>(order, &order->positions);
+}
+
+void CatalogSnapshot::collectPage(const CatalogPageQuery &query, CatalogPage &page) const
+{
+    page.positions.clear();
+    page.total = 0;
+
+    std::shared_ptr<const SortOrder> order;
+    if (query.sortKey != CatalogSortKey::NONE)
+    {
+        order = getSortOrder(query.sortKey);
+    }
+    const size_t count = entries.size();
+    auto positionAt = [&](size_t rank)
+    {
+        size_t sortedRank = query.descending ? count - 1 - rank : rank;
+        return order ? order->positions[sortedRank] : sortedRank;
+    };
+
+    if (query.keyword.empty() && !query.filter)
+    {
+        // 不过滤时直接按排名截取，只需访问本页的商品
+        page.total = count;
+        for (size_t rank = query.offset; rank < count && page.positions.size() < query.limit; ++rank)
+        {
+            page.positions.push_back(positionAt(rank));
+        }
+        return;
+    }
+
+    // 只处理关键词命中、满足筛选条件的商品：换算成本快照中的排名，排序后截取
+    std::vector<size_t> ranks;
+    auto addPosition = [&](size_t position)
+    {
+        if (query.filter && !query.filter->test(position))
+        {
+            return;
+        }
+        size_t sortedRank = order ? order->ranks[position] : position;
+        ranks.push_back(query.descending ? count - 1 - sortedRank : sortedRank);
+    };
+    if (!query.keyword.empty())
+    {
+        if (query.matches)
+        {
+            ranks.reserve(query.matches->size());
+            for (const Product *product : *query.matches)
+            {
+                size_t position = 0;
+                if (findPosition(product, position))
+                {
+                    addPosition(position);
+                }
+            }
+        }
+    }
+    else
+    {
+        query.filter->forEach(addPosition);
+    }
+    std::sort(ranks.begin(), ranks.end());
+    page.total = ranks.size();
+    for (size_t i = query.offset; i < ranks.size() && page.positions.size() < query.limit; ++i)
+    {
+        page.positions.push_back(positionAt(ranks[i]));
+    }
+}
+
+std::shared_ptr<const FacetIndex> CatalogSnapshot::getFacetIndex() const
+{
+    std::call_once(facetOnce, [this]
+                   { facets = std::make_shared<const FacetIndex>(*this); });
+    return facets;
+}
+
+CatalogSnapshotCache::CatalogSnapshotCache(Store &store)
+    : store(store), hitCount(0), rebuildCount(0), encodedCount(0), reusedCount(0)
+{
+}
+
+std::shared_ptr<const CatalogSnapshot> CatalogSnapshotCache::get()
+{
+    std::shared_ptr<const CatalogSnapshot> snapshot = std::atomic_load(&current);
+    if (snapshot && snapshot->getVersion() == store.getCatalogVersion())
+    {
+        hitCount++;
+        return snapshot;
+    }
+
+    std::lock_guard<std::mutex> lock(buildMutex);
+    // 等待锁期间其他线程可能已经重建完成
+    snapshot = std::atomic_load(&current);
+    if (snapshot && snapshot->getVersion() == store.getCatalogVersion())
+    {
+        hitCount++;
+        return snapshot;
+    }
+
+    snapshot = rebuild(snapshot);
+    std::atomic_store(&current, snapshot);
+    return snapshot;
+}
+
+std::shared_ptr<const CatalogSnapshot> CatalogSnapshotCache::rebuild(const std::shared_ptr<const CatalogSnapshot> &previous)
+{
+    // 上一份快照中未变化的记录按商品指针复用；变更日志不完整（如商品整体重新加载）时全部重新编码
+    uint64_t version = 0;
+    std::vector<CatalogChange> changes;
+    bool incremental = previous && previous->getEpoch() == store.getCatalogEpoch() &&
+                       store.getChangesSince(previous->getVersion(), changes, version);
+    if (!incremental)
+    {
+        version = store.getCatalogVersion();
+    }
+
+    std::unordered_set<const Product *> changedSet;
+    for (const auto &change : changes)
+    {
+        changedSet.insert(change.product);
+    }
+
+    auto snapshot = std::make_shared<CatalogSnapshot>();
+    snapshot->version = version;
+    snapshot->epoch = store.getCatalogEpoch();
+    auto catalog = store.getCatalog(); // 整个重建过程使用同一个目录版本
+    const std::vector<Product *> &products = catalog->products;
+    snapshot->entries.reserve(products.size());
+    snapshot->positions.reserve(products.size());
+
+    uint64_t encoded = 0;
+    for (const Product *product : products)
+    {
+        snapshot->positions.emplace(product, snapshot->entries.size());
+        if (incremental && changedSet.count(product) == 0)
+        {
+            auto it = previous->positions.find(product);
+            if (it != previous->positions.end())
+            {
+                snapshot->entries.push_back(previous->entries[it->second]);
+                continue;
+            }
+        }
+
+        auto entry = std::make_shared<CatalogSnapshot::Entry>();
+        Protocol::ProductData productData = makeProductData(product);
+        entry->product = product;
+        entry->productId = productData.id;
+        entry->textRecord = productData.encode(Protocol::WireFormat::TEXT);
+        entry->binaryRecord = productData.encode(Protocol::WireFormat::BINARY);
+        entry->name = productData.name;
+        entry->sellerUsername = productData.sellerUsername;
+        entry->type = product->getType();
+        entry->category = product->getUserCategory();
+        entry->price = productData.price;
+        entry->discountRate = productData.discountRate;
+        entry->quantity = productData.quantity;
+        snapshot->entries.push_back(std::move(entry));
+        encoded++;
+    }
+
+    rebuildCount++;
+    encodedCount += encoded;
+    reusedCount += snapshot->entries.size() - encoded;
+    std::cout << "[目录快照] 版本 " << version << "：" << snapshot->entries.size() << " 件商品，重新编码 "
+              << encoded << " 条" << (incremental ? "" : "（全量）") << std::endl;
+    return snapshot;
+}
+
+bool CatalogSnapshotCache::getDelta(const CatalogSnapshot &snapshot, uint64_t sinceVersion, CatalogDelta &delta) const
+{
+    delta.positions.clear();
+    delta.removed.clear();
+
+    std::vector<CatalogChange> changes;
+    uint64_t currentVersion = 0;
+    if (snapshot.getEpoch() != store.getCatalogEpoch() || sinceVersion > snapshot.getVersion() ||
+        !store.getChangesSince(sinceVersion, changes, currentVersion))
+    {
+        return false;
+    }
+
+    // 只取到快照版本为止的变更，之后的变更留给下一次；同一商品只取最后一次
+    std::unordered_set<const Product *> seen;
+    for (auto it = changes.rbegin(); it != changes.rend(); ++it)
+    {
+        if (it->version > snapshot.getVersion() || !seen.insert(it->product).second)
+        {
+            continue;
+        }
+        size_t position = 0;
+        if (snapshot.findPosition(it->product, position))
+        {
+            delta.positions.push_back(position);
+        }
+        else
+        {
+            delta.removed.push_back(*it);
+        }
+    }
+    std::sort(delta.positions.begin(), delta.positions.end());
+    return true;
+}
+
+void CatalogSnapshotCache::pin(const std::shared_ptr<const CatalogSnapshot> &snapshot)
+{
+    auto now = std::chrono::steady_clock::now();
+    std::lock_guard<std::mutex> lock(pinnedMutex);
+    pinned[snapshot->getVersion()] = PinnedSnapshot{snapshot, now};
+
+    for (auto it = pinned.begin(); it != pinned.end();)
+    {
+        if (now - it->second.lastUsed > std::chrono::seconds(kPinnedSnapshotIdleSeconds))
+        {
+            it = pinned.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+    while (pinned.size() > kMaxPinnedSnapshots)
+    {
+        auto oldest = pinned.begin();
+        for (auto it = pinned.begin(); it != pinned.end(); ++it)
+        {
+            if (it->second.lastUsed < oldest->second.lastUsed)
+            {
+                oldest = it;
+            }
+        }
+        pinned.erase(oldest);
+    }
+}
+
+std::shared_ptr<const CatalogSnapshot> CatalogSnapshotCache::find(uint64_t epoch, uint64_t version)
+{
+    {
+        std::lock_guard<std::mutex> lock(pinnedMutex);
+        auto it = pinned.find(version);
+        if (it != pinned.end() && it->second.snapshot->getEpoch() == epoch)
+        {
+            it->second.lastUsed = std::chrono::steady_clock::now();
+            return it->second.snapshot;
+        }
+    }
+
+    std::shared_ptr<const CatalogSnapshot> snapshot = std::atomic_load(&current);
+    if (snapshot && snapshot->getEpoch() == epoch && snapshot->getVersion() == version)
+    {
+        return snapshot;
+    }
+    return nullptr;
+}
+
+CatalogSnapshotCache::Stats CatalogSnapshotCache::getStats() const
+{
+    Stats stats;
+    stats.hits = hitCount.load();
+    stats.rebuilds = rebuildCount.load();
+    stats.encodedRecords = encodedCount.load();
+    stats.reusedRecords = reusedCount.load();
+    return stats;
+}
@@ -0,0 +1,197 @@
+#ifndef CATALOG_SNAPSHOT_H
+#define CATALOG_SNAPSHOT_H
+
+#include "../network/protocol.h"
+#include "store.h"
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <unordered_map>
+#include <map>
+#include <chrono>
+#include <cstdint>
+
+class FacetIndex;
+class FacetBitmap;
+
+// 将商品转换为协议中的商品数据
+Protocol::ProductData makeProductData(const Product *product);
+
+// 商品列表的排序键
+enum class CatalogSortKey
+{
+    NONE, // 目录顺序
+    PRICE,
+    DISCOUNT,
+    STOCK,
+    NAME,
+    SELLER
+};
+const int kCatalogSortKeyCount = 6;
+
+// 解析请求中的排序字段（price/discount/stock/name/seller），空字符串表示目录顺序
+bool parseCatalogSortKey(const std::string &name, CatalogSortKey &key);
+
+// 分页查询：在一份快照上按关键词过滤、按排序键排序后取 [offset, offset + limit)
+struct CatalogPageQuery
+{
+    std::string keyword;                             // 经 SearchIndex::normalize 规范化，为空时不过滤
+    const std::vector<Product *> *matches = nullptr; // keyword 非空时为 Store::searchProducts 的结果
+    const FacetBitmap *filter = nullptr;             // 筛选结果（FacetIndex::apply），为空时不筛选
+    std::string filterKey;                           // CatalogFilter::describe，参与查询摘要
+    CatalogSortKey sortKey = CatalogSortKey::NONE;
+    bool descending = false;
+    size_t offset = 0;
+    size_t limit = 0;
+};
+
+struct CatalogPage
+{
+    std::vector<size_t> positions; // 本页商品在快照中的位置
+    size_t total = 0;              // 满足条件的商品总数
+};
+
+// 分页游标：记录快照标识、版本、查询条件摘要和下一页的起点。
+// 对客户端不透明，取下一页时连同原查询条件原样带回
+struct CatalogCursor
+{
+    uint64_t epoch = 0;
+    uint64_t version = 0;
+    uint64_t queryHash = 0;
+    size_t offset = 0;
+};
+
+uint64_t hashCatalogQuery(const CatalogPageQuery &query);
+std::string encodeCatalogCursor(const CatalogCursor &cursor);
+bool decodeCatalogCursor(const std::string &text, CatalogCursor &cursor);
+
+// 商品目录快照：某一目录版本下所有商品的预编码记录，以及两种线上格式的 GET_ALL 响应消息体。
+// 创建后内容不再变化，多个业务线程、多个会话的发送队列可以同时持有同一份快照；
+// 完整消息体和各排序键的顺序在首次使用时才生成并缓存。
+class CatalogSnapshot
+{
+public:
+    // 单个商品的预编码记录及排序、过滤用的字段；商品未变化时在新旧快照之间共享
+    struct Entry
+    {
+        const Product *product;
+        std::string productId;
+        std::string textRecord;
+        std::string binaryRecord;
+        std::string name;
+        std::string sellerUsername;
+        std::string type;     // Product::getType
+        std::string category; // Product::getUserCategory
+        double price;
+        double discountRate;
+        int quantity;
+    };
+
+    uint64_t getVersion() const { return version; }
+    uint64_t getEpoch() const { return epoch; }
+    size_t getProductCount() const { return entries.size(); }
+    const std::vector<std::shared_ptr<const Entry>> &getEntries() const { return entries; }
+    // 查找商品在本快照中的位置，商品不在目录中时返回 false
+    bool findPosition(const Product *product, size_t &position) const;
+
+    // 预编码的 GET_ALL 响应消息体（不含帧头），发送时只需按请求拼接帧头。
+    // 消息体带 epoch/version 字段，客户端据此发起增量同步；PRODUCT_SYNC 的全量回退也直接发送它
+    std::shared_ptr<const std::string> getBody(Protocol::WireFormat format) const;
+
+    // 按排序键升序排列的商品位置，键相同时按目录顺序；NONE 返回空指针（即目录顺序）
+    std::shared_ptr<const std::vector<size_t>> getSortedPositions(CatalogSortKey key) const;
+    // 取一页商品，降序时从升序排列的末尾往前取。有关键词或筛选条件时只对命中的商品按排名排序，
+    // 不在本快照中的商品（快照之后新增的）跳过，翻页期间结果保持一致
+    void collectPage(const CatalogPageQuery &query, CatalogPage &page) const;
+
+    // 本快照的筛选索引，首次使用时创建
+    std::shared_ptr<const FacetIndex> getFacetIndex() const;
+
+private:
+    friend class CatalogSnapshotCache;
+
+    uint64_t version = 0;
+    uint64_t epoch = 0;
+    std::vector<std::shared_ptr<const Entry>> entries; // 与 Store::getProducts() 顺序一致
+    std::unordered_map<const Product *, size_t> positions;
+
+    mutable std::once_flag bodyOnce[2]; // 按线上格式索引
+    mutable std::shared_ptr<const std::string> bodies[2];
+    mutable std::once_flag facetOnce;
+    mutable std::shared_ptr<const FacetIndex> facets;
+    // 某一排序键下的升序排列及其逆映射（位置 -> 排名）
+    struct SortOrder
+    {
+        std::vector<size_t> positions;
+        std::vector<size_t> ranks;
+    };
+    mutable std::mutex sortMutex;
+    mutable std::shared_ptr<const SortOrder> sortOrders[kCatalogSortKeyCount];
+
+    std::shared_ptr<const SortOrder> getSortOrder(CatalogSortKey key) const;
+};
+
+// 两个目录版本之间的变化：仍在目录中的商品以快照中的位置给出（按目录顺序、每个商品一次），
+// 已不在目录中的商品以变更记录给出
+struct CatalogDelta
+{
+    std::vector<size_t> positions;
+    std::vector<CatalogChange> removed;
+
+    size_t size() const { return positions.size() + removed.size(); }
+};
+
+// 目录快照缓存：目录版本未变时直接返回当前快照；
+// 版本变化后只重新编码变化过的商品，其余记录从上一份快照复用
+class CatalogSnapshotCache
+{
+public:
+    struct Stats
+    {
+        uint64_t hits = 0;           // 直接命中当前快照的次数
+        uint64_t rebuilds = 0;       // 重建快照的次数
+        uint64_t encodedRecords = 0; // 重建时重新编码的商品记录数
+        uint64_t reusedRecords = 0;  // 重建时复用的商品记录数
+    };
+
+    explicit CatalogSnapshotCache(Store &store);
+
+    std::shared_ptr<const CatalogSnapshot> get();
+    Stats getStats() const;
+
+    // 计算 sinceVersion 之后到 snapshot 版本为止的变化；变更日志已无法覆盖该区间时返回 false
+    bool getDelta(const CatalogSnapshot &snapshot, uint64_t sinceVersion, CatalogDelta &delta) const;
+
+    // 分页浏览期间保留快照，后续页面即使目录已经变化也在同一版本上取，不会重复或遗漏商品。
+    // 保留的快照空闲超过 kPinnedSnapshotIdleSeconds 或数量超过 kMaxPinnedSnapshots 时按最久未用淘汰
+    void pin(const std::shared_ptr<const CatalogSnapshot> &snapshot);
+    // 查找保留中的快照（当前快照也算），已淘汰时返回空指针
+    std::shared_ptr<const CatalogSnapshot> find(uint64_t epoch, uint64_t version);
+
+    static const size_t kMaxPinnedSnapshots = 16;
+    static const int kPinnedSnapshotIdleSeconds = 120;
+
+private:
+    struct PinnedSnapshot
+    {
+        std::shared_ptr<const CatalogSnapshot> snapshot;
+        std::chrono::steady_clock::time_point lastUsed;
+    };
+
+    Store &store;
+    std::shared_ptr<const CatalogSnapshot> current; // 通过 std::atomic_load/atomic_store 访问
+    std::mutex buildMutex;                          // 同一时间只有一个线程重建
+    std::map<uint64_t, PinnedSnapshot> pinned;      // 目录版本 -> 保留的快照
+    std::mutex pinnedMutex;
+
+    std::atomic<uint64_t> hitCount;
+    std::atomic<uint64_t> rebuildCount;
+    std::atomic<uint64_t> encodedCount;
+    std::atomic<uint64_t> reusedCount;
+
+    std::shared_ptr<const CatalogSnapshot> rebuild(const std::shared_ptr<const CatalogSnapshot> &previous);
+};
+
+#endif // CATALOG_SNAPSHOT_H
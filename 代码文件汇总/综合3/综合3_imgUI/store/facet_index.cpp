@@ -0,0 +1,239 @@
+#include "facet_index.h"
+#include <algorithm>
+#include <sstream>
+
+namespace
+{
+    // 价格区间的下界，最后一个区间不设上界
+    const double kPriceRangeBounds[FacetIndex::kPriceRangeCount] = {0.0, 50.0, 100.0, 500.0, 1000.0, 5000.0};
+
+    size_t priceRangeOf(double price)
+    {
+        size_t range = 0;
+        while (range + 1 < FacetIndex::kPriceRangeCount && price >= kPriceRangeBounds[range + 1])
+        {
+            range++;
+        }
+        return range;
+    }
+
+    // 同一维度内任一取值匹配即可
+    FacetBitmap unionOf(const std::map<std::string, FacetBitmap> &values, const std::vector<std::string> &selected, size_t size)
+    {
+        FacetBitmap result(size);
+        for (const std::string &value : selected)
+        {
+            auto it = values.find(value);
+            if (it != values.end())
+            {
+                result |= it->second;
+            }
+        }
+        return result;
+    }
+
+    FacetBitmap &bitmapFor(std::map<std::string, FacetBitmap> &values, const std::string &value, size_t size)
+    {
+        auto it = values.find(value);
+        if (it == values.end())
+        {
+            it = values.emplace(value, FacetBitmap(size)).first;
+        }
+        return it->second;
+    }
+}
+
+FacetBitmap::FacetBitmap(size_t size, bool filled)
+    : words((size + 63) / 64, filled ? ~uint64_t(0) : 0), bitCount(size)
+{
+    if (filled && (size & 63) != 0)
+    {
+        words.back() = (uint64_t(1) << (size & 63)) - 1;
+    }
+}
+
+size_t FacetBitmap::count() const
+{
+    size_t total = 0;
+    for (uint64_t word : words)
+    {
+        total += static_cast<size_t>(__builtin_popcountll(word));
+    }
+    return total;
+}
+
+size_t FacetBitmap::countAnd(const FacetBitmap &other) const
+{
+    size_t total = 0;
+    size_t n = std::min(words.size(), other.words.size());
+    for (size_t i = 0; i < n; ++i)
+    {
+        total += static_cast<size_t>(__builtin_popcountll(words[i] & other.words[i]));
+    }
+    return total;
+}
+
+FacetBitmap &FacetBitmap::operator&=(const FacetBitmap &other)
+{
+    for (size_t i = 0; i < words.size(); ++i)
+    {
+        words[i] &= i < other.words.size() ? other.words[i] : 0;
+    }
+    return *this;
+}
+
+FacetBitmap &FacetBitmap::operator|=(const FacetBitmap &other)
+{
+    for (size_t i = 0; i < words.size() && i < other.words.size(); ++i)
+    {
+        words[i] |= other.words[i];
+    }
+    return *this;
+}
+
+std::string CatalogFilter::describe() const
+{
+    std::ostringstream out;
+    auto list = [&out](const std::vector<std::string> &values)
+    {
+        std::vector<std::string> sorted(values);
+        std::sort(sorted.begin(), sorted.end());
+        for (const std::string &value : sorted)
+        {
+            out << value << '\x1f';
+        }
+        out << '\x1e';
+    };
+    list(categories);
+    list(types);
+    list(sellers);
+    out << minPrice << '\x1e' << maxPrice << '\x1e' << inStockOnly << discountedOnly;
+    return out.str();
+}
+
+std::string FacetIndex::priceRangeName(size_t range)
+{
+    std::ostringstream out;
+    out << kPriceRangeBounds[range] << '-';
+    if (range + 1 < kPriceRangeCount)
+    {
+        out << kPriceRangeBounds[range + 1];
+    }
+    return out.str();
+}
+
+FacetIndex::FacetIndex(const CatalogSnapshot &snapshot)
+    : productCount(snapshot.getProductCount()), inStock(productCount), discounted(productCount)
+{
+    for (FacetBitmap &range : priceRanges)
+    {
+        range = FacetBitmap(productCount);
+    }
+    byPrice.reserve(productCount);
+
+    const auto &entries = snapshot.getEntries();
+    for (size_t position = 0; position < entries.size(); ++position)
+    {
+        const CatalogSnapshot::Entry &entry = *entries[position];
+        bitmapFor(byCategory, entry.category, productCount).set(position);
+        bitmapFor(byType, entry.type, productCount).set(position);
+        bitmapFor(bySeller, entry.sellerUsername, productCount).set(position);
+        priceRanges[priceRangeOf(entry.price)].set(position);
+        if (entry.quantity > 0)
+        {
+            inStock.set(position);
+        }
+        if (entry.discountRate > 0.0)
+        {
+            discounted.set(position);
+        }
+        byPrice.emplace_back(entry.price, position);
+    }
+    std::sort(byPrice.begin(), byPrice.end());
+}
+
+FacetBitmap FacetIndex::applyExcept(const CatalogFilter &filter, Dimension skip, const FacetBitmap *extra) const
+{
+    FacetBitmap result(productCount, true);
+    if (extra)
+    {
+        result &= *extra;
+    }
+    if (skip != Dimension::CATEGORY && !filter.categories.empty())
+    {
+        result &= unionOf(byCategory, filter.categories, productCount);
+    }
+    if (skip != Dimension::TYPE && !filter.types.empty())
+    {
+        result &= unionOf(byType, filter.types, productCount);
+    }
+    if (skip != Dimension::SELLER && !filter.sellers.empty())
+    {
+        result &= unionOf(bySeller, filter.sellers, productCount);
+    }
+    if (skip != Dimension::PRICE && (filter.minPrice >= 0.0 || filter.maxPrice >= 0.0))
+    {
+        // 在按价格排序的数组上二分出区间，再转成位图
+        auto first = filter.minPrice >= 0.0
+                         ? std::lower_bound(byPrice.begin(), byPrice.end(), std::make_pair(filter.minPrice, size_t(0)))
+                         : byPrice.begin();
+        auto last = filter.maxPrice >= 0.0
+                        ? std::upper_bound(byPrice.begin(), byPrice.end(), std::make_pair(filter.maxPrice, productCount))
+                        : byPrice.end();
+        FacetBitmap inRange(productCount);
+        for (auto it = first; it < last; ++it)
+        {
+            inRange.set(it->second);
+        }
+        result &= inRange;
+    }
+    if (skip != Dimension::STOCK && filter.inStockOnly)
+    {
+        result &= inStock;
+    }
+    if (skip != Dimension::DISCOUNT && filter.discountedOnly)
+    {
+        result &= discounted;
+    }
+    return result;
+}
+
+FacetBitmap FacetIndex::apply(const CatalogFilter &filter, const FacetBitmap *extra) const
+{
+    return applyExcept(filter, Dimension::NONE, extra);
+}
+
+std::vector<FacetCount> FacetIndex::countValues(const std::map<std::string, FacetBitmap> &values, const FacetBitmap &result)
+{
+    std::vector<FacetCount> counts;
+    for (const auto &value : values)
+    {
+        size_t count = value.second.countAnd(result);
+        if (count > 0)
+        {
+            counts.push_back(FacetCount{value.first, count});
+        }
+    }
+    return counts;
+}
+
+CatalogFacetCounts FacetIndex::count(const CatalogFilter &filter, const FacetBitmap *extra) const
+{
+    CatalogFacetCounts counts;
+    counts.categories = countValues(byCategory, applyExcept(filter, Dimension::CATEGORY, extra));
+    counts.types = countValues(byType, applyExcept(filter, Dimension::TYPE, extra));
+    counts.sellers = countValues(bySeller, applyExcept(filter, Dimension::SELLER, extra));
+
+    FacetBitmap withoutPrice = applyExcept(filter, Dimension::PRICE, extra);
+    for (size_t range = 0; range < kPriceRangeCount; ++range)
+    {
+        size_t count = priceRanges[range].countAnd(withoutPrice);
+        if (count > 0)
+        {
+            counts.priceRanges.push_back(FacetCount{priceRangeName(range), count});
+        }
+    }
+    counts.inStock = inStock.countAnd(applyExcept(filter, Dimension::STOCK, extra));
+    counts.discounted = discounted.countAnd(applyExcept(filter, Dimension::DISCOUNT, extra));
+    return counts;
+}
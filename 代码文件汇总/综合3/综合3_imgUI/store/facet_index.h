@@ -0,0 +1,118 @@
+#ifndef FACET_INDEX_H
+#define FACET_INDEX_H
+
+#include "catalog_snapshot.h"
+#include <string>
+#include <vector>
+#include <map>
+#include <cstdint>
+
+// 位图：第 i 位对应目录快照中位置 i 的商品
+class FacetBitmap
+{
+public:
+    FacetBitmap() = default;
+    explicit FacetBitmap(size_t size, bool filled = false);
+
+    void set(size_t position) { words[position >> 6] |= uint64_t(1) << (position & 63); }
+    bool test(size_t position) const { return (words[position >> 6] >> (position & 63)) & 1; }
+    size_t size() const { return bitCount; }
+    size_t count() const;
+    size_t countAnd(const FacetBitmap &other) const;
+    FacetBitmap &operator&=(const FacetBitmap &other);
+    FacetBitmap &operator|=(const FacetBitmap &other);
+
+    // 按位置升序访问所有置位的商品
+    template <typename Visitor>
+    void forEach(Visitor visit) const
+    {
+        for (size_t w = 0; w < words.size(); ++w)
+        {
+            uint64_t word = words[w];
+            while (word != 0)
+            {
+                visit((w << 6) + static_cast<size_t>(__builtin_ctzll(word)));
+                word &= word - 1;
+            }
+        }
+    }
+
+private:
+    std::vector<uint64_t> words;
+    size_t bitCount = 0;
+};
+
+// 筛选条件：同一维度内多个取值为"或"，不同维度之间为"与"；为空的维度不参与筛选
+struct CatalogFilter
+{
+    std::vector<std::string> categories; // Product::getUserCategory
+    std::vector<std::string> types;      // Product::getType
+    std::vector<std::string> sellers;
+    double minPrice = -1.0; // 按折扣后价格（getPrice），小于 0 表示不限
+    double maxPrice = -1.0;
+    bool inStockOnly = false;
+    bool discountedOnly = false;
+
+    // 规范化的条件文本，参与分页游标的查询摘要
+    std::string describe() const;
+};
+
+struct FacetCount
+{
+    std::string value;
+    size_t count;
+};
+
+// 各维度的计数。每个维度的计数应用了其他维度的条件、不含本维度自身的条件，
+// 客户端据此展示"改选该项后能得到多少件商品"
+struct CatalogFacetCounts
+{
+    std::vector<FacetCount> categories;
+    std::vector<FacetCount> types;
+    std::vector<FacetCount> sellers;
+    std::vector<FacetCount> priceRanges; // 见 FacetIndex::priceRangeName
+    size_t inStock = 0;
+    size_t discounted = 0;
+};
+
+// 一份目录快照的筛选索引：每个分类、类型、商家、价格区间以及有货、有折扣各一张位图，
+// 另有按价格排序的位置数组供任意价格区间二分查找。随快照一起创建后只读，可被多个线程共享
+class FacetIndex
+{
+public:
+    explicit FacetIndex(const CatalogSnapshot &snapshot);
+
+    // 满足筛选条件的商品；extra 不为空时再与其求交（如关键词搜索的命中结果）
+    FacetBitmap apply(const CatalogFilter &filter, const FacetBitmap *extra = nullptr) const;
+    CatalogFacetCounts count(const CatalogFilter &filter, const FacetBitmap *extra = nullptr) const;
+
+    static const size_t kPriceRangeCount = 6;
+    static std::string priceRangeName(size_t range);
+
+private:
+    enum class Dimension
+    {
+        NONE,
+        CATEGORY,
+        TYPE,
+        SELLER,
+        PRICE,
+        STOCK,
+        DISCOUNT
+    };
+
+    size_t productCount;
+    std::map<std::string, FacetBitmap> byCategory;
+    std::map<std::string, FacetBitmap> byType;
+    std::map<std::string, FacetBitmap> bySeller;
+    FacetBitmap priceRanges[kPriceRangeCount];
+    FacetBitmap inStock;
+    FacetBitmap discounted;
+    std::vector<std::pair<double, size_t>> byPrice; // (价格, 位置)，按价格升序
+
+    // 按筛选条件求交，跳过 skip 指定的维度
+    FacetBitmap applyExcept(const CatalogFilter &filter, Dimension skip, const FacetBitmap *extra) const;
+    static std::vector<FacetCount> countValues(const std::map<std::string, FacetBitmap> &values, const FacetBitmap &result);
+};
+
+#endif // FACET_INDEX_H
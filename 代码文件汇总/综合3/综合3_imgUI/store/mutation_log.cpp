@@ -0,0 +1,408 @@
+#include "mutation_log.h"
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <filesystem>
+#include <algorithm>
+#include <chrono>
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+namespace
+{
+    const size_t kRecordHeaderSize = 8;
+    const auto kRetryInterval = std::chrono::milliseconds(200); // 写入失败后重试的间隔
+
+    void putUint32(std::string &out, uint32_t value)
+    {
+        for (int i = 0; i < 4; ++i)
+        {
+            out.push_back(static_cast<char>((value >> (8 * i)) & 0xFF));
+        }
+    }
+
+    uint32_t getUint32(const char *data)
+    {
+        uint32_t value = 0;
+        for (int i = 0; i < 4; ++i)
+        {
+            value |= static_cast<uint32_t>(static_cast<unsigned char>(data[i])) << (8 * i);
+        }
+        return value;
+    }
+
+    bool syncFile(FILE *file)
+    {
+        if (fflush(file) != 0)
+        {
+            return false;
+        }
+#ifdef _WIN32
+        return _commit(_fileno(file)) == 0;
+#else
+        return fsync(fileno(file)) == 0;
+#endif
+    }
+}
+
+uint32_t MutationLog::crc32(const char *data, size_t size)
+{
+    // 标准 CRC-32（多项式 0xEDB88320），查表法
+    static const auto table = []()
+    {
+        std::vector<uint32_t> values(256);
+        for (uint32_t i = 0; i < 256; ++i)
+        {
+            uint32_t c = i;
+            for (int k = 0; k < 8; ++k)
+            {
+                c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            }
+            values[i] = c;
+        }
+        return values;
+    }();
+
+    uint32_t crc = 0xFFFFFFFFu;
+    for (size_t i = 0; i < size; ++i)
+    {
+        crc = table[(crc ^ static_cast<unsigned char>(data[i])) & 0xFF] ^ (crc >> 8);
+    }
+    return crc ^ 0xFFFFFFFFu;
+}
+
+MutationLog::MutationLog()
+    : running(false), stopping(false), pendingRecords(0), appendedSequence(0), durableSequence(0), failed(false),
+      failedCommits(0), file(nullptr), currentSegment(0), segmentBroken(false), appendedRecords(0), appendedBytes(0),
+      groupCommits(0), maxGroupRecords(0), totalCommitNs(0)
+{
+}
+
+MutationLog::~MutationLog()
+{
+    close();
+}
+
+std::string MutationLog::segmentPath(uint64_t segment) const
+{
+    std::ostringstream name;
+    name << std::setw(6) << std::setfill('0') << segment << ".log";
+    return (fs::path(directory) / name.str()).string();
+}
+
+std::vector<uint64_t> MutationLog::listSegments() const
+{
+    std::vector<uint64_t> segments;
+    std::error_code ec;
+    for (const auto &entry : fs::directory_iterator(directory, ec))
+    {
+        if (!entry.is_regular_file() || entry.path().extension() != ".log")
+        {
+            continue;
+        }
+        try
+        {
+            segments.push_back(std::stoull(entry.path().stem().string()));
+        }
+        catch (const std::exception &)
+        {
+            // 不是日志段的文件，忽略
+        }
+    }
+    std::sort(segments.begin(), segments.end());
+    return segments;
+}
+
+bool MutationLog::openSegmentLocked(uint64_t segment)
+{
+    FILE *next = fopen(segmentPath(segment).c_str(), "ab");
+    if (!next)
+    {
+        std::cerr << "无法创建日志段: " << segmentPath(segment) << std::endl;
+        return false;
+    }
+    if (file)
+    {
+        fclose(file);
+    }
+    file = next;
+    currentSegment = segment;
+    segmentBroken = false;
+    return true;
+}
+
+bool MutationLog::open(const std::string &dir)
+{
+    if (isOpen())
+    {
+        return true;
+    }
+    std::error_code ec;
+    fs::create_directories(dir, ec);
+    if (ec)
+    {
+        std::cerr << "无法创建日志目录: " << dir << " (" << ec.message() << ")" << std::endl;
+        return false;
+    }
+    directory = dir;
+
+    std::vector<uint64_t> segments = listSegments();
+    {
+        std::lock_guard<std::mutex> ioLock(ioMutex);
+        if (!openSegmentLocked(segments.empty() ? 1 : segments.back() + 1))
+        {
+            return false;
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    failed = false;
+    stopping = false;
+    running = true;
+    thread = std::thread(&MutationLog::run, this);
+    return true;
+}
+
+void MutationLog::close()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!running)
+        {
+            return;
+        }
+        stopping = true;
+    }
+    pendingCondition.notify_all();
+    if (thread.joinable())
+    {
+        thread.join();
+    }
+
+    std::lock_guard<std::mutex> ioLock(ioMutex);
+    writePendingLocked();
+    if (file)
+    {
+        fclose(file);
+        file = nullptr;
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    running = false;
+    durableCondition.notify_all();
+}
+
+bool MutationLog::isOpen() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return running;
+}
+
+uint64_t MutationLog::append(const std::string &payload)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!running)
+    {
+        return 0;
+    }
+    putUint32(pending, static_cast<uint32_t>(payload.size()));
+    putUint32(pending, crc32(payload.data(), payload.size()));
+    pending += payload;
+    pendingRecords++;
+    appendedRecords++;
+    appendedBytes += kRecordHeaderSize + payload.size();
+    if (pendingRecords == 1)
+    {
+        pendingCondition.notify_one();
+    }
+    return ++appendedSequence;
+}
+
+bool MutationLog::sync()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    uint64_t target = appendedSequence;
+    uint64_t failuresBefore = failedCommits;
+    durableCondition.wait(lock, [&]() { return durableSequence >= target || failedCommits != failuresBefore || !running; });
+    return durableSequence >= target;
+}
+
+void MutationLog::writePendingLocked()
+{
+    std::string batch;
+    size_t records = 0;
+    uint64_t batchSequence = 0;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        batch.swap(pending);
+        records = pendingRecords;
+        pendingRecords = 0;
+        batchSequence = appendedSequence;
+    }
+    if (records == 0)
+    {
+        return;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    if (segmentBroken && file)
+    {
+        openSegmentLocked(currentSegment + 1);
+    }
+    bool ok = file && !segmentBroken && fwrite(batch.data(), 1, batch.size(), file) == batch.size() && syncFile(file);
+    int64_t elapsedNs = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+    if (!ok)
+    {
+        segmentBroken = true;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (ok)
+        {
+            durableSequence = batchSequence;
+            if (failed)
+            {
+                failed = false;
+                std::cerr << "日志写入已恢复，当前段: " << segmentPath(currentSegment) << std::endl;
+            }
+        }
+        else
+        {
+            // 这批记录放回缓冲区最前面，与写入期间新追加的记录一起重试，顺序不变
+            pending.insert(0, batch);
+            pendingRecords += records;
+            failedCommits++;
+            if (!failed)
+            {
+                failed = true;
+                std::cerr << "写入日志段失败: " << segmentPath(currentSegment) << "，稍后换段重试" << std::endl;
+            }
+        }
+        groupCommits++;
+        totalCommitNs += elapsedNs;
+        if (records > maxGroupRecords)
+        {
+            maxGroupRecords = records;
+        }
+    }
+    durableCondition.notify_all();
+}
+
+void MutationLog::run()
+{
+    while (true)
+    {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            pendingCondition.wait(lock, [this]() { return stopping || pendingRecords > 0; });
+            if (failed)
+            {
+                // 上一次写入失败：等一会儿再重试，避免磁盘持续出错时空转
+                pendingCondition.wait_for(lock, kRetryInterval, [this]() { return stopping; });
+            }
+            if (stopping)
+            {
+                break;
+            }
+        }
+        // 写入期间新追加的记录留在缓冲区，下一轮一起写入
+        std::lock_guard<std::mutex> ioLock(ioMutex);
+        writePendingLocked();
+    }
+}
+
+uint64_t MutationLog::rotate()
+{
+    std::lock_guard<std::mutex> ioLock(ioMutex);
+    writePendingLocked();
+    if (!file)
+    {
+        return currentSegment;
+    }
+    if (!openSegmentLocked(currentSegment + 1))
+    {
+        // 无法换段时继续写当前段，旧段不会被删除
+        return currentSegment;
+    }
+    return currentSegment;
+}
+
+void MutationLog::removeSegmentsBefore(uint64_t segment)
+{
+    for (uint64_t existing : listSegments())
+    {
+        if (existing >= segment)
+        {
+            break;
+        }
+        std::error_code ec;
+        fs::remove(segmentPath(existing), ec);
+        if (ec)
+        {
+            std::cerr << "删除日志段失败: " << segmentPath(existing) << " (" << ec.message() << ")" << std::endl;
+        }
+    }
+}
+
+size_t MutationLog::replay(const std::function<void(std::string_view)> &apply)
+{
+    // 缓冲区中的记录先落盘，重放时能读到
+    sync();
+
+    size_t replayed = 0;
+    for (uint64_t segment : listSegments())
+    {
+        std::string path = segmentPath(segment);
+        std::ifstream in(path, std::ios::binary);
+        std::string data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+
+        size_t offset = 0;
+        while (offset < data.size())
+        {
+            if (data.size() - offset < kRecordHeaderSize)
+            {
+                break;
+            }
+            uint32_t length = getUint32(data.data() + offset);
+            uint32_t checksum = getUint32(data.data() + offset + 4);
+            if (data.size() - offset - kRecordHeaderSize < length ||
+                crc32(data.data() + offset + kRecordHeaderSize, length) != checksum)
+            {
+                break;
+            }
+            apply(std::string_view(data.data() + offset + kRecordHeaderSize, length));
+            offset += kRecordHeaderSize + length;
+            replayed++;
+        }
+        if (offset < data.size())
+        {
+            // 通常是崩溃时未写完的最后一条记录
+            std::cerr << "警告: 日志段 " << path << " 在偏移 " << offset << " 处不完整或校验失败，忽略其后 "
+                      << data.size() - offset << " 字节" << std::endl;
+        }
+    }
+    return replayed;
+}
+
+MutationLog::Stats MutationLog::getStats() const
+{
+    size_t segments = listSegments().size();
+    std::lock_guard<std::mutex> lock(mutex);
+    Stats stats;
+    stats.appendedRecords = appendedRecords;
+    stats.appendedBytes = appendedBytes;
+    stats.groupCommits = groupCommits;
+    stats.maxGroupRecords = maxGroupRecords;
+    stats.avgCommitMs = groupCommits == 0 ? 0.0 : totalCommitNs / 1e6 / groupCommits;
+    stats.currentSegment = currentSegment;
+    stats.segments = segments;
+    stats.failedCommits = failedCommits;
+    stats.failed = failed;
+    return stats;
+}
@@ -0,0 +1,102 @@
+#ifndef MUTATION_LOG_H
+#define MUTATION_LOG_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdint>
+
+// 只追加的预写日志（WAL）。记录内容由调用方编码，日志只负责分帧、校验与持久化：
+//   [uint32 内容长度][uint32 CRC32][内容]（小端）
+// 日志按段存放在目录下（000001.log、000002.log ...），每次打开都从新的一段开始写。
+// append 只把记录放进内存缓冲区；日志线程把缓冲区中积累的全部记录一次写入并 fsync（组提交），
+// sync 等待此前追加的记录全部落盘。
+// 写入失败时这批记录放回缓冲区，日志线程稍后换到新的一段重试（失败的段末尾可能有半条记录，
+// 重放读到那里就会跳过该段余下的内容），重试成功后日志恢复正常。
+// 压缩：rotate 切换到新的一段后，调用方写出完整快照，再用 removeSegmentsBefore 删除旧段
+class MutationLog
+{
+public:
+    struct Stats
+    {
+        uint64_t appendedRecords = 0;
+        uint64_t appendedBytes = 0;
+        uint64_t groupCommits = 0;   // 写入并 fsync 的次数
+        size_t maxGroupRecords = 0;  // 单次组提交的最大记录数
+        double avgCommitMs = 0.0;    // 每次组提交的平均耗时
+        uint64_t currentSegment = 0;
+        size_t segments = 0;         // 目录中现存的段数
+        uint64_t failedCommits = 0;  // 写入或 fsync 失败的组提交次数
+        bool failed = false;         // 最近一次组提交失败，缓冲的记录等待重试
+    };
+
+    MutationLog();
+    ~MutationLog();
+
+    MutationLog(const MutationLog &) = delete;
+    MutationLog &operator=(const MutationLog &) = delete;
+
+    // 打开（必要时创建）日志目录，新建一段用于追加并启动日志线程
+    bool open(const std::string &directory);
+    void close();
+    bool isOpen() const;
+
+    // 返回记录的序号；日志未打开时返回 0
+    uint64_t append(const std::string &payload);
+    // 等待此前追加的记录全部写入并 fsync；等待期间发生写入错误时返回 false，记录留在缓冲区等待重试
+    bool sync();
+
+    // 按顺序重放目录中全部段的记录。遇到不完整或校验失败的记录时跳过该段余下的内容；返回重放的记录数
+    size_t replay(const std::function<void(std::string_view)> &apply);
+
+    // 写完已缓冲的记录后切换到新的一段，返回新段的编号
+    uint64_t rotate();
+    // 删除编号小于 segment 的段（其中的记录已全部包含在快照中）
+    void removeSegmentsBefore(uint64_t segment);
+
+    Stats getStats() const;
+
+    static uint32_t crc32(const char *data, size_t size);
+
+private:
+    std::string directory;
+    std::thread thread;
+    bool running;
+    bool stopping;
+
+    mutable std::mutex mutex; // 保护缓冲区、序号与统计
+    std::condition_variable pendingCondition;
+    std::condition_variable durableCondition;
+    std::string pending;       // 已追加、尚未写入文件的记录
+    size_t pendingRecords;
+    uint64_t appendedSequence; // 最后一条追加的记录序号
+    uint64_t durableSequence;  // 已 fsync 的最大序号
+    bool failed;
+    uint64_t failedCommits;
+
+    // 文件写入与换段互斥；日志线程持有它之后才从缓冲区取出记录，保证记录按序号顺序落到各段
+    std::mutex ioMutex;
+    FILE *file;
+    uint64_t currentSegment;
+    bool segmentBroken; // 当前段写入失败过，下一次写入前先换段
+
+    uint64_t appendedRecords;
+    uint64_t appendedBytes;
+    uint64_t groupCommits;
+    size_t maxGroupRecords;
+    int64_t totalCommitNs;
+
+    void run();
+    // 调用方持有 ioMutex：取出缓冲区写入当前段并 fsync
+    void writePendingLocked();
+    bool openSegmentLocked(uint64_t segment);
+    std::string segmentPath(uint64_t segment) const;
+    std::vector<uint64_t> listSegments() const;
+};
+
+#endif // MUTATION_LOG_H
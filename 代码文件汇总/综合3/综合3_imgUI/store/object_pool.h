@@ -0,0 +1,182 @@
+#ifndef OBJECT_POOL_H
+#define OBJECT_POOL_H
+
+#include <vector>
+#include <memory>
+#include <new>
+#include <mutex>
+#include <utility>
+#include <cstddef>
+#include <cstdint>
+
+// 内存池统计，供长时间运行的服务端观察碎片情况
+struct PoolStats
+{
+    size_t objectSize = 0;     // 每个槽位的字节数
+    size_t liveObjects = 0;    // 当前存活的对象
+    size_t peakLiveObjects = 0;
+    size_t freeSlots = 0;      // 已分配但空闲的槽位（被销毁对象留下的空洞与块尾未用部分）
+    size_t blocks = 0;
+    size_t reservedBytes = 0;  // 所有块占用的字节数
+    uint64_t created = 0;
+    uint64_t destroyed = 0;
+
+    // 空闲槽位占全部槽位的比例
+    double fragmentation() const
+    {
+        size_t slots = liveObjects + freeSlots;
+        return slots == 0 ? 0.0 : static_cast<double>(freeSlots) / slots;
+    }
+    PoolStats &operator+=(const PoolStats &other)
+    {
+        liveObjects += other.liveObjects;
+        peakLiveObjects += other.peakLiveObjects;
+        freeSlots += other.freeSlots;
+        blocks += other.blocks;
+        reservedBytes += other.reservedBytes;
+        created += other.created;
+        destroyed += other.destroyed;
+        return *this;
+    }
+};
+
+// 定长对象池：按块（每块 slotsPerBlock 个槽位）向系统申请内存，槽位通过空闲链表复用。
+// destroy 只调用析构函数并把槽位放回链表；clear 析构全部存活对象并一次性释放所有块。
+// 线程安全；create 返回的指针在 destroy 或 clear 之前保持有效
+template <typename T>
+class ObjectPool
+{
+public:
+    explicit ObjectPool(size_t slotsPerBlock = 64) : slotsPerBlock(slotsPerBlock == 0 ? 1 : slotsPerBlock) {}
+    ~ObjectPool() { clear(); }
+
+    ObjectPool(const ObjectPool &) = delete;
+    ObjectPool &operator=(const ObjectPool &) = delete;
+
+    template <typename... Args>
+    T *create(Args &&...args)
+    {
+        Slot *slot = nullptr;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            slot = takeSlotLocked();
+        }
+        T *object = nullptr;
+        try
+        {
+            object = new (slot->storage) T(std::forward<Args>(args)...);
+        }
+        catch (...)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            returnSlotLocked(slot);
+            throw;
+        }
+
+        std::lock_guard<std::mutex> lock(mutex);
+        slot->live = true;
+        liveCount++;
+        createdCount++;
+        if (liveCount > peakLiveCount)
+        {
+            peakLiveCount = liveCount;
+        }
+        return object;
+    }
+
+    // object 必须来自本池的 create
+    void destroy(T *object)
+    {
+        if (!object)
+        {
+            return;
+        }
+        Slot *slot = reinterpret_cast<Slot *>(object);
+        object->~T();
+        std::lock_guard<std::mutex> lock(mutex);
+        slot->live = false;
+        liveCount--;
+        destroyedCount++;
+        returnSlotLocked(slot);
+    }
+
+    // 析构所有存活对象并释放全部内存块
+    void clear()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (auto &block : blocks)
+        {
+            for (size_t i = 0; i < slotsPerBlock; ++i)
+            {
+                if (block[i].live)
+                {
+                    reinterpret_cast<T *>(block[i].storage)->~T();
+                    block[i].live = false;
+                    destroyedCount++;
+                }
+            }
+        }
+        blocks.clear();
+        freeList = nullptr;
+        liveCount = 0;
+        nextUnused = 0;
+    }
+
+    PoolStats getStats() const
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        PoolStats stats;
+        stats.objectSize = sizeof(Slot);
+        stats.liveObjects = liveCount;
+        stats.peakLiveObjects = peakLiveCount;
+        stats.blocks = blocks.size();
+        stats.freeSlots = blocks.size() * slotsPerBlock - liveCount;
+        stats.reservedBytes = blocks.size() * slotsPerBlock * sizeof(Slot);
+        stats.created = createdCount;
+        stats.destroyed = destroyedCount;
+        return stats;
+    }
+
+private:
+    // storage 必须是第一个成员，对象指针与槽位指针可以互相转换
+    struct Slot
+    {
+        alignas(T) unsigned char storage[sizeof(T)];
+        Slot *nextFree;
+        bool live;
+    };
+
+    size_t slotsPerBlock;
+    std::vector<std::unique_ptr<Slot[]>> blocks;
+    Slot *freeList = nullptr; // 被销毁对象留下的槽位
+    size_t nextUnused = 0;    // 最后一块中尚未使用过的第一个槽位
+    size_t liveCount = 0;
+    size_t peakLiveCount = 0;
+    uint64_t createdCount = 0;
+    uint64_t destroyedCount = 0;
+    mutable std::mutex mutex;
+
+    Slot *takeSlotLocked()
+    {
+        if (freeList)
+        {
+            Slot *slot = freeList;
+            freeList = slot->nextFree;
+            return slot;
+        }
+        if (blocks.empty() || nextUnused == slotsPerBlock)
+        {
+            blocks.emplace_back(new Slot[slotsPerBlock]());
+            nextUnused = 0;
+        }
+        return &blocks.back()[nextUnused++];
+    }
+
+    void returnSlotLocked(Slot *slot)
+    {
+        slot->nextFree = freeList;
+        freeList = slot;
+    }
+};
+
+#endif // OBJECT_POOL_H
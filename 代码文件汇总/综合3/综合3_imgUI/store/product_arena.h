@@ -0,0 +1,27 @@
+#ifndef PRODUCT_ARENA_H
+#define PRODUCT_ARENA_H
+
+#include "store.h"
+#include "object_pool.h"
+#include <utility>
+
+// 一代商品对象的分配区。Store 的商品全部从这里创建；重新加载目录时 clear 一次性析构并释放整代商品，
+// 不再逐个 delete，单个商品被删除时 destroy 把槽位留给下一个商品复用
+class ProductArena
+{
+public:
+    template <typename... Args>
+    Product *create(Args &&...args)
+    {
+        return products.create(std::forward<Args>(args)...);
+    }
+
+    void destroy(Product *product) { products.destroy(product); }
+    void clear() { products.clear(); }
+    PoolStats getStats() const { return products.getStats(); }
+
+private:
+    ObjectPool<Product> products;
+};
+
+#endif // PRODUCT_ARENA_H
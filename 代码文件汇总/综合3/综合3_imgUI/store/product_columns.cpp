@@ -0,0 +1,423 @@
+#include "product_columns.h"
+#include "store.h"
+
+#if (defined(__SSE2__) || defined(_M_X64)) && !defined(PRODUCT_COLUMNS_SCALAR)
+#define PRODUCT_COLUMNS_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+    // 把比较结果掩码中置位的通道转成行号
+    inline void emitMask(int mask, uint32_t base, std::vector<uint32_t> &rows)
+    {
+        while (mask != 0)
+        {
+            rows.push_back(base + static_cast<uint32_t>(__builtin_ctz(mask)));
+            mask &= mask - 1;
+        }
+    }
+}
+
+void ColumnScan::selectRangeScalar(const double *values, size_t count, double low, double high, std::vector<uint32_t> &rows)
+{
+    for (size_t i = 0; i < count; ++i)
+    {
+        if (values[i] >= low && values[i] <= high)
+        {
+            rows.push_back(static_cast<uint32_t>(i));
+        }
+    }
+}
+
+void ColumnScan::selectAtLeastScalar(const double *values, size_t count, double threshold, std::vector<uint32_t> &rows)
+{
+    for (size_t i = 0; i < count; ++i)
+    {
+        if (values[i] >= threshold)
+        {
+            rows.push_back(static_cast<uint32_t>(i));
+        }
+    }
+}
+
+void ColumnScan::selectAvailableBelowScalar(const int32_t *quantity, const int32_t *locked, size_t count, int32_t threshold, std::vector<uint32_t> &rows)
+{
+    for (size_t i = 0; i < count; ++i)
+    {
+        if (quantity[i] - locked[i] < threshold)
+        {
+            rows.push_back(static_cast<uint32_t>(i));
+        }
+    }
+}
+
+void ColumnScan::selectEqualPairScalar(const uint32_t *first, const uint32_t *second, size_t count, uint32_t a, uint32_t b, std::vector<uint32_t> &rows)
+{
+    for (size_t i = 0; i < count; ++i)
+    {
+        if (first[i] == a && second[i] == b)
+        {
+            rows.push_back(static_cast<uint32_t>(i));
+        }
+    }
+}
+
+#ifdef PRODUCT_COLUMNS_SSE2
+
+bool ColumnScan::simdEnabled()
+{
+    return true;
+}
+
+void ColumnScan::selectRange(const double *values, size_t count, double low, double high, std::vector<uint32_t> &rows)
+{
+    const __m128d lowVec = _mm_set1_pd(low);
+    const __m128d highVec = _mm_set1_pd(high);
+    size_t i = 0;
+    // 每轮 4 个值（两组 2 通道比较），掩码合并后一次输出
+    for (; i + 4 <= count; i += 4)
+    {
+        __m128d a = _mm_loadu_pd(values + i);
+        __m128d b = _mm_loadu_pd(values + i + 2);
+        __m128d inA = _mm_and_pd(_mm_cmpge_pd(a, lowVec), _mm_cmple_pd(a, highVec));
+        __m128d inB = _mm_and_pd(_mm_cmpge_pd(b, lowVec), _mm_cmple_pd(b, highVec));
+        int mask = _mm_movemask_pd(inA) | (_mm_movemask_pd(inB) << 2);
+        emitMask(mask, static_cast<uint32_t>(i), rows);
+    }
+    for (; i < count; ++i)
+    {
+        if (values[i] >= low && values[i] <= high)
+        {
+            rows.push_back(static_cast<uint32_t>(i));
+        }
+    }
+}
+
+void ColumnScan::selectAtLeast(const double *values, size_t count, double threshold, std::vector<uint32_t> &rows)
+{
+    const __m128d thresholdVec = _mm_set1_pd(threshold);
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        int mask = _mm_movemask_pd(_mm_cmpge_pd(_mm_loadu_pd(values + i), thresholdVec)) |
+                   (_mm_movemask_pd(_mm_cmpge_pd(_mm_loadu_pd(values + i + 2), thresholdVec)) << 2);
+        emitMask(mask, static_cast<uint32_t>(i), rows);
+    }
+    for (; i < count; ++i)
+    {
+        if (values[i] >= threshold)
+        {
+            rows.push_back(static_cast<uint32_t>(i));
+        }
+    }
+}
+
+void ColumnScan::selectAvailableBelow(const int32_t *quantity, const int32_t *locked, size_t count, int32_t threshold, std::vector<uint32_t> &rows)
+{
+    const __m128i thresholdVec = _mm_set1_epi32(threshold);
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        __m128i available = _mm_sub_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(quantity + i)),
+                                          _mm_loadu_si128(reinterpret_cast<const __m128i *>(locked + i)));
+        int mask = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmplt_epi32(available, thresholdVec)));
+        emitMask(mask, static_cast<uint32_t>(i), rows);
+    }
+    for (; i < count; ++i)
+    {
+        if (quantity[i] - locked[i] < threshold)
+        {
+            rows.push_back(static_cast<uint32_t>(i));
+        }
+    }
+}
+
+void ColumnScan::selectEqualPair(const uint32_t *first, const uint32_t *second, size_t count, uint32_t a, uint32_t b, std::vector<uint32_t> &rows)
+{
+    const __m128i aVec = _mm_set1_epi32(static_cast<int>(a));
+    const __m128i bVec = _mm_set1_epi32(static_cast<int>(b));
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        __m128i equal = _mm_and_si128(_mm_cmpeq_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(first + i)), aVec),
+                                      _mm_cmpeq_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(second + i)), bVec));
+        emitMask(_mm_movemask_ps(_mm_castsi128_ps(equal)), static_cast<uint32_t>(i), rows);
+    }
+    for (; i < count; ++i)
+    {
+        if (first[i] == a && second[i] == b)
+        {
+            rows.push_back(static_cast<uint32_t>(i));
+        }
+    }
+}
+
+#else
+
+bool ColumnScan::simdEnabled()
+{
+    return false;
+}
+
+void ColumnScan::selectRange(const double *values, size_t count, double low, double high, std::vector<uint32_t> &rows)
+{
+    selectRangeScalar(values, count, low, high, rows);
+}
+
+void ColumnScan::selectAtLeast(const double *values, size_t count, double threshold, std::vector<uint32_t> &rows)
+{
+    selectAtLeastScalar(values, count, threshold, rows);
+}
+
+void ColumnScan::selectAvailableBelow(const int32_t *quantity, const int32_t *locked, size_t count, int32_t threshold, std::vector<uint32_t> &rows)
+{
+    selectAvailableBelowScalar(quantity, locked, count, threshold, rows);
+}
+
+void ColumnScan::selectEqualPair(const uint32_t *first, const uint32_t *second, size_t count, uint32_t a, uint32_t b, std::vector<uint32_t> &rows)
+{
+    selectEqualPairScalar(first, second, count, a, b, rows);
+}
+
+#endif
+
+namespace
+{
+    // 各实例共用的代号来源，保证线程缓存不会把另一个实例的版本当成本实例的
+    std::atomic<uint64_t> nextColumnsGeneration(1);
+}
+
+ProductColumns::ProductColumns()
+    : current(std::make_shared<Version>(Version{std::make_shared<Layout>(), std::make_shared<NumberColumns>(), {}})),
+      generation(nextColumnsGeneration++)
+{
+}
+
+uint32_t ProductColumns::internId(std::unordered_map<std::string, uint32_t> &ids, const std::string &text)
+{
+    auto inserted = ids.emplace(text, static_cast<uint32_t>(ids.size()));
+    return inserted.first->second;
+}
+
+bool ProductColumns::findId(const std::unordered_map<std::string, uint32_t> &ids, const std::string &text, uint32_t &id)
+{
+    auto it = ids.find(text);
+    if (it == ids.end())
+    {
+        return false;
+    }
+    id = it->second;
+    return true;
+}
+
+ProductColumns::Numbers ProductColumns::readNumbers(const Product *product)
+{
+    Numbers numbers;
+    numbers.originalPrice = product->getOriginalPrice();
+    numbers.discountRate = product->getDiscountRate();
+    numbers.price = numbers.originalPrice * (1.0 - numbers.discountRate);
+    numbers.quantity = product->getQuantity();
+    return numbers;
+}
+
+void ProductColumns::publish(std::shared_ptr<const Version> next)
+{
+    // 先发布版本再更新代号：读到新代号的线程一定能取到新版本
+    std::atomic_store(&current, std::move(next));
+    generation.store(nextColumnsGeneration++, std::memory_order_release);
+}
+
+const ProductColumns::Version &ProductColumns::currentVersion() const
+{
+    struct CachedVersion
+    {
+        uint64_t generation = 0;
+        std::shared_ptr<const Version> version;
+    };
+    static thread_local CachedVersion cached;
+    uint64_t latest = generation.load(std::memory_order_acquire);
+    if (cached.generation != latest || !cached.version)
+    {
+        cached.version = std::atomic_load(&current);
+        cached.generation = latest;
+    }
+    return *cached.version;
+}
+
+void ProductColumns::rebuild(const std::vector<Product *> &products)
+{
+    auto layout = std::make_shared<Layout>();
+    auto numbers = std::make_shared<NumberColumns>();
+    layout->products.reserve(products.size());
+    layout->sellerId.reserve(products.size());
+    layout->categoryId.reserve(products.size());
+    numbers->originalPrice.reserve(products.size());
+    numbers->discountRate.reserve(products.size());
+    numbers->price.reserve(products.size());
+    numbers->quantity.reserve(products.size());
+
+    // 在写锁内读取数值：与之并发的 update 要么在此之前（数值已写入商品），要么在此之后进入增量表
+    std::lock_guard<std::mutex> lock(writeMutex);
+    for (Product *product : products)
+    {
+        if (!layout->rowOf.emplace(product, static_cast<uint32_t>(layout->products.size())).second)
+        {
+            continue;
+        }
+        const std::string &category = product->getUserCategory().empty() ? product->getType() : product->getUserCategory();
+        layout->products.push_back(product);
+        layout->sellerId.push_back(internId(layout->sellerIds, product->getSellerUsername()));
+        layout->categoryId.push_back(internId(layout->categoryIds, category));
+        Numbers values = readNumbers(product);
+        numbers->originalPrice.push_back(values.originalPrice);
+        numbers->discountRate.push_back(values.discountRate);
+        numbers->price.push_back(values.price);
+        numbers->quantity.push_back(values.quantity);
+    }
+    publish(std::make_shared<Version>(Version{std::move(layout), std::move(numbers), {}}));
+}
+
+void ProductColumns::update(const Product *product)
+{
+    std::lock_guard<std::mutex> lock(writeMutex);
+    std::shared_ptr<const Version> latest = std::atomic_load(&current);
+    auto row = latest->layout->rowOf.find(product);
+    if (row == latest->layout->rowOf.end())
+    {
+        return;
+    }
+
+    // 只复制增量表，行布局与数值列和旧版本共享
+    auto next = std::make_shared<Version>(*latest);
+    next->delta[product] = readNumbers(product);
+    if (next->delta.size() > kMaxDeltaProducts)
+    {
+        auto merged = std::make_shared<NumberColumns>(*next->numbers);
+        for (const auto &entry : next->delta)
+        {
+            uint32_t index = next->layout->rowOf.at(entry.first);
+            merged->originalPrice[index] = entry.second.originalPrice;
+            merged->discountRate[index] = entry.second.discountRate;
+            merged->price[index] = entry.second.price;
+            merged->quantity[index] = entry.second.quantity;
+        }
+        next->numbers = std::move(merged);
+        next->delta.clear();
+    }
+    publish(std::move(next));
+}
+
+size_t ProductColumns::size() const
+{
+    return currentVersion().layout->products.size();
+}
+
+template <typename Matches>
+std::vector<Product *> ProductColumns::collect(const Version &version, const std::vector<uint32_t> &rows, Matches matches)
+{
+    const Layout &layout = *version.layout;
+    std::vector<Product *> result;
+    result.reserve(rows.size());
+    for (uint32_t row : rows)
+    {
+        Product *product = layout.products[row];
+        if (version.delta.empty() || version.delta.count(product) == 0)
+        {
+            result.push_back(product);
+        }
+    }
+    for (const auto &entry : version.delta)
+    {
+        uint32_t row = layout.rowOf.at(entry.first);
+        if (matches(row, entry.second))
+        {
+            result.push_back(layout.products[row]);
+        }
+    }
+    return result;
+}
+
+std::vector<Product *> ProductColumns::selectPriceRange(double low, double high) const
+{
+    const Version &version = currentVersion();
+    std::vector<uint32_t> rows;
+    ColumnScan::selectRange(version.numbers->price.data(), version.numbers->price.size(), low, high, rows);
+    auto matches = [low, high](uint32_t, const Numbers &numbers)
+    {
+        return numbers.price >= low && numbers.price <= high;
+    };
+    return collect(version, rows, matches);
+}
+
+std::vector<Product *> ProductColumns::selectDiscountAtLeast(double minRate) const
+{
+    const Version &version = currentVersion();
+    std::vector<uint32_t> rows;
+    ColumnScan::selectAtLeast(version.numbers->discountRate.data(), version.numbers->discountRate.size(), minRate, rows);
+    auto matches = [minRate](uint32_t, const Numbers &numbers)
+    {
+        return numbers.discountRate >= minRate;
+    };
+    return collect(version, rows, matches);
+}
+
+std::vector<Product *> ProductColumns::selectLowStock(int threshold, const std::string &sellerUsername) const
+{
+    const Version &version = currentVersion();
+    const Layout &layout = *version.layout;
+    uint32_t seller = 0;
+    bool anySeller = sellerUsername.empty();
+    if (!anySeller && !findId(layout.sellerIds, sellerUsername, seller))
+    {
+        return {};
+    }
+
+    // 锁定、解锁不经过列式镜像，扫描前读入各商品当前的锁定数量
+    std::vector<int32_t> locked(layout.products.size());
+    for (size_t row = 0; row < layout.products.size(); ++row)
+    {
+        locked[row] = layout.products[row]->getReserved();
+    }
+    std::vector<uint32_t> rows;
+    ColumnScan::selectAvailableBelow(version.numbers->quantity.data(), locked.data(), locked.size(), threshold, rows);
+    if (!anySeller)
+    {
+        size_t kept = 0;
+        for (uint32_t row : rows)
+        {
+            if (layout.sellerId[row] == seller)
+            {
+                rows[kept++] = row;
+            }
+        }
+        rows.resize(kept);
+    }
+    auto matches = [&](uint32_t row, const Numbers &numbers)
+    {
+        return (anySeller || layout.sellerId[row] == seller) && numbers.quantity - locked[row] < threshold;
+    };
+    return collect(version, rows, matches);
+}
+
+std::vector<Product *> ProductColumns::selectSellerCategory(const std::string &sellerUsername, const std::string &category) const
+{
+    // 只用到行布局，不受增量表影响
+    const Version &version = currentVersion();
+    const Layout &layout = *version.layout;
+    uint32_t seller = 0;
+    uint32_t categoryValue = 0;
+    if (!findId(layout.sellerIds, sellerUsername, seller) || !findId(layout.categoryIds, category, categoryValue))
+    {
+        return {};
+    }
+    std::vector<uint32_t> rows;
+    ColumnScan::selectEqualPair(layout.sellerId.data(), layout.categoryId.data(), layout.sellerId.size(), seller, categoryValue, rows);
+    std::vector<Product *> result;
+    result.reserve(rows.size());
+    for (uint32_t row : rows)
+    {
+        result.push_back(layout.products[row]);
+    }
+    return result;
+}
@@ -0,0 +1,114 @@
+#ifndef PRODUCT_COLUMNS_H
+#define PRODUCT_COLUMNS_H
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <cstdint>
+
+class Product;
+
+// 列式扫描内核：把满足条件的行号追加到 rows。
+// 编译目标支持 SSE2 时（x86-64 总是支持）每次比较 2 个 double 或 4 个 int32，
+// 否则（或定义了 PRODUCT_COLUMNS_SCALAR 时）使用标量版本；标量版本始终可用，供基准测试对比
+namespace ColumnScan
+{
+    // low <= values[i] <= high
+    void selectRange(const double *values, size_t count, double low, double high, std::vector<uint32_t> &rows);
+    void selectRangeScalar(const double *values, size_t count, double low, double high, std::vector<uint32_t> &rows);
+    // values[i] >= threshold
+    void selectAtLeast(const double *values, size_t count, double threshold, std::vector<uint32_t> &rows);
+    void selectAtLeastScalar(const double *values, size_t count, double threshold, std::vector<uint32_t> &rows);
+    // quantity[i] - locked[i] < threshold（可售库存不足）
+    void selectAvailableBelow(const int32_t *quantity, const int32_t *locked, size_t count, int32_t threshold, std::vector<uint32_t> &rows);
+    void selectAvailableBelowScalar(const int32_t *quantity, const int32_t *locked, size_t count, int32_t threshold, std::vector<uint32_t> &rows);
+    // first[i] == a && second[i] == b
+    void selectEqualPair(const uint32_t *first, const uint32_t *second, size_t count, uint32_t a, uint32_t b, std::vector<uint32_t> &rows);
+    void selectEqualPairScalar(const uint32_t *first, const uint32_t *second, size_t count, uint32_t a, uint32_t b, std::vector<uint32_t> &rows);
+
+    bool simdEnabled();
+}
+
+// 商品热点数值字段的列式镜像：原价、折扣、折后价、库存、商家编号、分类编号各存一个数组，
+// 低库存、价格区间、折扣等扫描顺序读取连续内存，不再逐个解引用分散在堆上的商品。
+// 镜像以不可变版本发布，读者取当前版本后不加锁扫描，与修改者、其他读者都不争用：
+//   - 商品的增删随目录版本发布整体重建（rebuild），行号与商家、分类编号只在重建时变化；
+//   - markProductChanged 调用 update：复制当前版本的增量表（最近修改过的商品 -> 最新数值）并发布，
+//     扫描时先按数值列筛选，再用增量表修正这些商品；增量表超过上限时合并进新的数值列。
+// 锁定数量由商品自身的原子计数维护，低库存扫描时才读取。行号只在一次扫描内有效
+class ProductColumns
+{
+public:
+    ProductColumns();
+
+    // 按商品列表重建整个镜像，丢弃增量表；Store 在发布新的目录版本时调用
+    void rebuild(const std::vector<Product *> &products);
+    void update(const Product *product); // 重新读取价格、折扣、库存
+
+    std::vector<Product *> selectPriceRange(double low, double high) const; // 按折后价格
+    std::vector<Product *> selectDiscountAtLeast(double minRate) const;
+    // 可售库存（库存减去锁定数量）低于 threshold 的商品；sellerUsername 为空时不限商家
+    std::vector<Product *> selectLowStock(int threshold, const std::string &sellerUsername) const;
+    // 分类取 getUserCategory，为空时取 getType
+    std::vector<Product *> selectSellerCategory(const std::string &sellerUsername, const std::string &category) const;
+
+    size_t size() const;
+
+private:
+    static const size_t kMaxDeltaProducts = 256; // 增量表超过该数量时合并进数值列
+
+    struct Numbers
+    {
+        double originalPrice;
+        double discountRate;
+        double price;
+        int32_t quantity;
+    };
+
+    // 行布局：只在重建时生成，之后各版本共享
+    struct Layout
+    {
+        std::vector<Product *> products;
+        std::vector<uint32_t> sellerId;
+        std::vector<uint32_t> categoryId;
+        std::unordered_map<const Product *, uint32_t> rowOf;
+        std::unordered_map<std::string, uint32_t> sellerIds;   // 商家用户名 -> 编号
+        std::unordered_map<std::string, uint32_t> categoryIds; // 分类 -> 编号
+    };
+
+    struct NumberColumns
+    {
+        std::vector<double> originalPrice;
+        std::vector<double> discountRate;
+        std::vector<double> price;
+        std::vector<int32_t> quantity;
+    };
+
+    // 一个发布的版本：发布后不再修改
+    struct Version
+    {
+        std::shared_ptr<const Layout> layout;
+        std::shared_ptr<const NumberColumns> numbers;
+        std::unordered_map<const Product *, Numbers> delta; // 数值列之后修改过的商品
+    };
+
+    // 通过 std::atomic_load/atomic_store 访问；读者改用 currentVersion，代号未变时不取全局锁
+    std::shared_ptr<const Version> current;
+    std::atomic<uint64_t> generation;
+    std::mutex writeMutex; // 重建与更新之间互斥，读者不加锁
+
+    static Numbers readNumbers(const Product *product);
+    static uint32_t internId(std::unordered_map<std::string, uint32_t> &ids, const std::string &text);
+    static bool findId(const std::unordered_map<std::string, uint32_t> &ids, const std::string &text, uint32_t &id);
+    void publish(std::shared_ptr<const Version> next);
+    // 本线程缓存的当前版本，只在本线程下一次调用前有效
+    const Version &currentVersion() const;
+    // 数值列筛出的行去掉增量表中的商品，再按 matches(行号, 最新数值) 加回增量表中符合条件的商品
+    template <typename Matches>
+    static std::vector<Product *> collect(const Version &version, const std::vector<uint32_t> &rows, Matches matches);
+};
+
+#endif // PRODUCT_COLUMNS_H
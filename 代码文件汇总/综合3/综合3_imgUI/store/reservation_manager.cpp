@@ -0,0 +1,427 @@
+#include "reservation_manager.h"
+#include "store.h"
+#include <iostream>
+#include <functional>
+
+ReservationManager::ReservationManager(Store &store, std::chrono::milliseconds tickInterval)
+    : store(store), tickInterval(tickInterval), nextSequence(1), stopping(false), running(false),
+      created(0), released(0), ordered(0), expired(0), sessionClosed(0), expiredUnits(0)
+{
+    for (Shard &shard : shards)
+    {
+        shard.wheel.resize(kWheelSlots);
+    }
+}
+
+ReservationManager::~ReservationManager()
+{
+    stop();
+}
+
+void ReservationManager::start()
+{
+    std::lock_guard<std::mutex> lock(sweepMutex);
+    if (running)
+    {
+        return;
+    }
+    running = true;
+    stopping = false;
+    sweepThread = std::thread(&ReservationManager::sweepLoop, this);
+}
+
+void ReservationManager::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(sweepMutex);
+        if (!running)
+        {
+            return;
+        }
+        stopping = true;
+    }
+    sweepCondition.notify_all();
+    if (sweepThread.joinable())
+    {
+        sweepThread.join();
+    }
+
+    std::lock_guard<std::mutex> lock(sweepMutex);
+    running = false;
+}
+
+int64_t ReservationManager::effectiveTtl(int64_t ttlSeconds)
+{
+    if (ttlSeconds <= 0)
+    {
+        return kDefaultTtlSeconds;
+    }
+    if (ttlSeconds > kMaxTtlSeconds)
+    {
+        return kMaxTtlSeconds;
+    }
+    return ttlSeconds;
+}
+
+size_t ReservationManager::shardIndex(const std::string &sessionId)
+{
+    return std::hash<std::string>()(sessionId) % kShardCount;
+}
+
+ReservationManager::Shard &ReservationManager::shardForReservation(uint64_t reservationId)
+{
+    return shards[reservationId & (kShardCount - 1)];
+}
+
+void ReservationManager::unlockItems(const std::vector<Item> &items)
+{
+    for (const Item &item : items)
+    {
+        if (item.quantity > 0)
+        {
+            store.unlockInventory(item.productId, item.quantity);
+        }
+    }
+}
+
+void ReservationManager::forgetLocked(Shard &shard, const std::string &sessionId, uint64_t reservationId)
+{
+    auto it = shard.bySession.find(sessionId);
+    if (it == shard.bySession.end())
+    {
+        return;
+    }
+    std::vector<uint64_t> &ids = it->second;
+    for (size_t i = 0; i < ids.size(); ++i)
+    {
+        if (ids[i] == reservationId)
+        {
+            ids.erase(ids.begin() + i);
+            break;
+        }
+    }
+    if (ids.empty())
+    {
+        shard.bySession.erase(it);
+    }
+}
+
+uint64_t ReservationManager::reserve(const std::string &sessionId, const std::vector<Item> &items, int64_t ttlSeconds,
+                                     const std::function<bool()> &sessionActive)
+{
+    if (items.empty())
+    {
+        return 0;
+    }
+    // 先扣减各商品的可售库存（无锁），全部成功后才记账
+    for (size_t i = 0; i < items.size(); ++i)
+    {
+        if (!store.lockInventory(items[i].productId, items[i].quantity))
+        {
+            unlockItems(std::vector<Item>(items.begin(), items.begin() + i));
+            return 0;
+        }
+    }
+
+    // 有效期换算成节拍数，不足一个节拍按一个节拍计
+    int64_t ttlMs = effectiveTtl(ttlSeconds) * 1000;
+    int64_t tickMs = tickInterval.count() > 0 ? tickInterval.count() : 1;
+    uint64_t ticks = static_cast<uint64_t>((ttlMs + tickMs - 1) / tickMs);
+    if (ticks == 0)
+    {
+        ticks = 1;
+    }
+
+    size_t index = shardIndex(sessionId);
+    uint64_t reservationId = (nextSequence++ << kShardBits) | index;
+    Shard &shard = shards[index];
+    bool sessionGone = false;
+    {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        // 会话已断开时 releaseSession 已经或即将执行，不能再记到它名下
+        sessionGone = sessionActive && !sessionActive();
+        if (!sessionGone)
+        {
+            uint64_t expireTick = shard.sweptTick + ticks;
+            shard.wheel[expireTick % kWheelSlots].push_back(reservationId);
+            shard.bySession[sessionId].push_back(reservationId);
+            shard.reservations.emplace(reservationId, Reservation{sessionId, items, expireTick});
+        }
+    }
+    if (sessionGone)
+    {
+        unlockItems(items);
+        return 0;
+    }
+    created++;
+    return reservationId;
+}
+
+bool ReservationManager::release(const std::string &sessionId, uint64_t reservationId)
+{
+    Shard &shard = shardForReservation(reservationId);
+    std::vector<Item> items;
+    {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        auto it = shard.reservations.find(reservationId);
+        if (it == shard.reservations.end() || it->second.sessionId != sessionId)
+        {
+            return false;
+        }
+        items.swap(it->second.items);
+        shard.reservations.erase(it);
+        forgetLocked(shard, sessionId, reservationId);
+    }
+    unlockItems(items);
+    released++;
+    return true;
+}
+
+bool ReservationManager::take(const std::string &sessionId, uint64_t reservationId, std::vector<Item> &items)
+{
+    Shard &shard = shardForReservation(reservationId);
+    {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        auto it = shard.reservations.find(reservationId);
+        if (it == shard.reservations.end() || it->second.sessionId != sessionId)
+        {
+            return false;
+        }
+        items.swap(it->second.items);
+        shard.reservations.erase(it);
+        forgetLocked(shard, sessionId, reservationId);
+    }
+    ordered++;
+    return true;
+}
+
+int ReservationManager::takeQuantityLocked(Shard &shard, const std::string &sessionId, uint64_t productId, int quantity, size_t &emptied)
+{
+    emptied = 0;
+    auto sessionIt = shard.bySession.find(sessionId);
+    if (sessionIt == shard.bySession.end() || quantity <= 0)
+    {
+        return 0;
+    }
+
+    int remaining = quantity;
+    std::vector<uint64_t> emptiedIds;
+    for (uint64_t id : sessionIt->second)
+    {
+        auto it = shard.reservations.find(id);
+        if (it == shard.reservations.end())
+        {
+            continue;
+        }
+        std::vector<Item> &items = it->second.items;
+        for (Item &item : items)
+        {
+            if (remaining > 0 && item.productId == productId)
+            {
+                int taken = item.quantity < remaining ? item.quantity : remaining;
+                item.quantity -= taken;
+                remaining -= taken;
+            }
+        }
+        bool empty = true;
+        for (const Item &item : items)
+        {
+            empty = empty && item.quantity == 0;
+        }
+        if (empty)
+        {
+            emptiedIds.push_back(id);
+        }
+        if (remaining == 0)
+        {
+            break;
+        }
+    }
+    for (uint64_t id : emptiedIds)
+    {
+        shard.reservations.erase(id);
+        forgetLocked(shard, sessionId, id);
+    }
+    emptied = emptiedIds.size();
+    return quantity - remaining;
+}
+
+bool ReservationManager::releaseQuantity(const std::string &sessionId, uint64_t productId, int quantity)
+{
+    if (quantity <= 0)
+    {
+        return false;
+    }
+    Shard &shard = shards[shardIndex(sessionId)];
+    size_t emptied = 0;
+    {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        auto sessionIt = shard.bySession.find(sessionId);
+        if (sessionIt == shard.bySession.end())
+        {
+            return false;
+        }
+
+        // 先确认该会话锁定的数量足够，不足时不做任何修改
+        int reserved = 0;
+        for (uint64_t id : sessionIt->second)
+        {
+            auto it = shard.reservations.find(id);
+            if (it == shard.reservations.end())
+            {
+                continue;
+            }
+            for (const Item &item : it->second.items)
+            {
+                if (item.productId == productId)
+                {
+                    reserved += item.quantity;
+                }
+            }
+        }
+        if (reserved < quantity)
+        {
+            return false;
+        }
+        takeQuantityLocked(shard, sessionId, productId, quantity, emptied);
+    }
+    store.unlockInventory(productId, quantity);
+    released += emptied;
+    return true;
+}
+
+int ReservationManager::takeQuantity(const std::string &sessionId, uint64_t productId, int quantity)
+{
+    Shard &shard = shards[shardIndex(sessionId)];
+    size_t emptied = 0;
+    int taken = 0;
+    {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        taken = takeQuantityLocked(shard, sessionId, productId, quantity, emptied);
+    }
+    ordered += emptied;
+    return taken;
+}
+
+size_t ReservationManager::releaseSession(const std::string &sessionId)
+{
+    Shard &shard = shards[shardIndex(sessionId)];
+    std::vector<Item> items;
+    size_t count = 0;
+    {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        auto sessionIt = shard.bySession.find(sessionId);
+        if (sessionIt == shard.bySession.end())
+        {
+            return 0;
+        }
+        for (uint64_t id : sessionIt->second)
+        {
+            auto it = shard.reservations.find(id);
+            if (it != shard.reservations.end())
+            {
+                items.insert(items.end(), it->second.items.begin(), it->second.items.end());
+                shard.reservations.erase(it);
+                count++;
+            }
+        }
+        shard.bySession.erase(sessionIt);
+    }
+    unlockItems(items);
+    sessionClosed += count;
+    return count;
+}
+
+void ReservationManager::sweepLoop()
+{
+    // 按固定的时间点推进节拍；线程被耽搁时补扫错过的节拍，到期时间不会因此漂移
+    std::unique_lock<std::mutex> lock(sweepMutex);
+    auto nextTick = std::chrono::steady_clock::now() + tickInterval;
+    while (!stopping)
+    {
+        sweepCondition.wait_until(lock, nextTick, [this]
+                                  { return stopping; });
+        if (stopping)
+        {
+            break;
+        }
+
+        lock.unlock();
+        while (std::chrono::steady_clock::now() >= nextTick)
+        {
+            try
+            {
+                sweep();
+            }
+            catch (const std::exception &e)
+            {
+                std::cerr << "清扫到期库存预留时发生异常: " << e.what() << std::endl;
+            }
+            nextTick += tickInterval;
+        }
+        lock.lock();
+    }
+}
+
+void ReservationManager::sweep()
+{
+    std::vector<Item> items;
+    size_t count = 0;
+    for (Shard &shard : shards)
+    {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        uint64_t tick = ++shard.sweptTick;
+        std::vector<uint64_t> &slot = shard.wheel[tick % kWheelSlots];
+        size_t kept = 0;
+        for (uint64_t id : slot)
+        {
+            auto it = shard.reservations.find(id);
+            if (it == shard.reservations.end())
+            {
+                continue; // 已释放
+            }
+            if (it->second.expireTick > tick)
+            {
+                slot[kept++] = id; // 以后某一圈才到期
+                continue;
+            }
+            items.insert(items.end(), it->second.items.begin(), it->second.items.end());
+            forgetLocked(shard, it->second.sessionId, id);
+            shard.reservations.erase(it);
+            count++;
+        }
+        slot.resize(kept);
+    }
+    if (count == 0)
+    {
+        return;
+    }
+
+    // 分片锁已全部释放，再把库存还给各商品
+    uint64_t units = 0;
+    for (const Item &item : items)
+    {
+        units += item.quantity > 0 ? item.quantity : 0;
+    }
+    unlockItems(items);
+    expired += count;
+    expiredUnits += units;
+    std::cout << "库存预留到期释放: " << count << " 个预留，共 " << units << " 件库存" << std::endl;
+}
+
+ReservationManager::Stats ReservationManager::getStats() const
+{
+    Stats stats;
+    for (const Shard &shard : shards)
+    {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        stats.active += shard.reservations.size();
+    }
+    stats.created = created.load();
+    stats.released = released.load();
+    stats.ordered = ordered.load();
+    stats.expired = expired.load();
+    stats.sessionClosed = sessionClosed.load();
+    stats.expiredUnits = expiredUnits.load();
+    return stats;
+}
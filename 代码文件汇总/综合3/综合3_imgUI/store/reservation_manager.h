@@ -0,0 +1,132 @@
+#ifndef RESERVATION_MANAGER_H
+#define RESERVATION_MANAGER_H
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <chrono>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+
+class Store;
+
+// 库存预留：每次锁定库存生成一个预留，记录预留ID、所属会话、锁定的商品与数量以及到期时间。
+// 可售库存仍由商品自身的原子计数扣减（见 Store::lockInventory），这里只记账，决定何时释放：
+//   - 客户端按预留ID或按商品、数量主动解锁；
+//   - 会话断开时释放该会话的全部预留；
+//   - 到期未释放的预留由清扫线程批量释放，客户端崩溃或忘记解锁时库存不会被永久占用。
+// 到期时间用时间轮管理：每个节拍只检查一个槽位，预留数量再多，清扫的开销也只与本节拍到期的预留有关。
+// 记账按会话分片，每片各有一把锁和一个时间轮，不同会话的锁定、解锁很少争用同一把锁
+class ReservationManager
+{
+public:
+    struct Item
+    {
+        uint64_t productId;
+        int quantity;
+    };
+
+    struct Stats
+    {
+        size_t active = 0;           // 当前未释放的预留
+        uint64_t created = 0;
+        uint64_t released = 0;       // 客户端主动解锁
+        uint64_t ordered = 0;        // 下单时交给订单结算
+        uint64_t expired = 0;        // 到期后由清扫线程释放
+        uint64_t sessionClosed = 0;  // 会话断开时释放
+        uint64_t expiredUnits = 0;   // 到期释放的库存件数
+    };
+
+    static const int64_t kDefaultTtlSeconds = 300;
+    static const int64_t kMaxTtlSeconds = 1800;
+
+    explicit ReservationManager(Store &store, std::chrono::milliseconds tickInterval = std::chrono::milliseconds(1000));
+    ~ReservationManager();
+
+    ReservationManager(const ReservationManager &) = delete;
+    ReservationManager &operator=(const ReservationManager &) = delete;
+
+    void start();
+    void stop();
+
+    // 锁定全部商品：全部成功时返回预留ID，任一商品库存不足时回滚已锁定的部分并返回 0。
+    // ttlSeconds 不大于 0 时使用默认值，超过上限时按上限。
+    // sessionActive 在分片锁内判断会话是否仍在线：会话先标记为离线再调用 releaseSession，
+    // 所以断开前排队、断开后才执行的锁定请求要么被 releaseSession 释放，要么在这里回滚，不会留下无主的预留
+    uint64_t reserve(const std::string &sessionId, const std::vector<Item> &items, int64_t ttlSeconds = 0,
+                     const std::function<bool()> &sessionActive = nullptr);
+    // 释放该会话的指定预留
+    bool release(const std::string &sessionId, uint64_t reservationId);
+    // 下单时取出该会话的指定预留交给订单结算：只删除记账、不解锁库存，锁定的库存由结算消耗或解锁
+    bool take(const std::string &sessionId, uint64_t reservationId, std::vector<Item> &items);
+    // 下单未指定预留时，从该会话锁定了此商品的预留中（先早后晚）取出至多 quantity 件交给订单，返回取出的件数
+    int takeQuantity(const std::string &sessionId, uint64_t productId, int quantity);
+    // 兼容不带预留ID的解锁请求：从该会话锁定了此商品的预留中（先早后晚）释放 quantity 件
+    bool releaseQuantity(const std::string &sessionId, uint64_t productId, int quantity);
+    // 释放会话的全部预留，返回释放的预留数
+    size_t releaseSession(const std::string &sessionId);
+
+    // 实际生效的有效期（秒）
+    static int64_t effectiveTtl(int64_t ttlSeconds);
+
+    Stats getStats() const;
+
+private:
+    struct Reservation
+    {
+        std::string sessionId;
+        std::vector<Item> items;
+        uint64_t expireTick; // 在此节拍到期
+    };
+
+    static const size_t kShardBits = 4;
+    static const size_t kShardCount = size_t(1) << kShardBits;
+    static const size_t kWheelSlots = 512; // 每片的时间轮槽位数，节拍 1 秒时转一圈约 8.5 分钟
+
+    struct Shard
+    {
+        mutable std::mutex mutex;
+        std::unordered_map<uint64_t, Reservation> reservations;           // 预留ID -> 预留
+        std::unordered_map<std::string, std::vector<uint64_t>> bySession; // 会话ID -> 预留ID（按创建顺序）
+        // 槽位中的预留ID在释放时不删除，清扫到该槽位时发现已不存在再丢弃；
+        // 有效期超过一圈的预留留在槽位中，等到期那一圈再释放
+        std::vector<std::vector<uint64_t>> wheel;
+        uint64_t sweptTick = 0; // 已清扫到的节拍，新预留从这之后计算到期节拍
+    };
+
+    Store &store;
+    std::chrono::milliseconds tickInterval;
+    Shard shards[kShardCount];
+    std::atomic<uint64_t> nextSequence;
+
+    std::thread sweepThread;
+    std::mutex sweepMutex;
+    std::condition_variable sweepCondition;
+    bool stopping;
+    bool running;
+
+    std::atomic<uint64_t> created;
+    std::atomic<uint64_t> released;
+    std::atomic<uint64_t> ordered;
+    std::atomic<uint64_t> expired;
+    std::atomic<uint64_t> sessionClosed;
+    std::atomic<uint64_t> expiredUnits;
+
+    // 预留ID的低 kShardBits 位是分片编号，按ID释放时直接定位分片
+    static size_t shardIndex(const std::string &sessionId);
+    Shard &shardForReservation(uint64_t reservationId);
+    void unlockItems(const std::vector<Item> &items);
+    // 调用方持有分片锁：从会话列表中移除预留ID
+    static void forgetLocked(Shard &shard, const std::string &sessionId, uint64_t reservationId);
+    // 调用方持有分片锁：从会话锁定了此商品的预留中（先早后晚）扣除至多 quantity 件，删除扣空的预留。
+    // 返回扣除的件数，emptied 为删除的预留数
+    static int takeQuantityLocked(Shard &shard, const std::string &sessionId, uint64_t productId, int quantity, size_t &emptied);
+    void sweepLoop();
+    void sweep();
+};
+
+#endif // RESERVATION_MANAGER_H
@@ -0,0 +1,379 @@
+#include "search_index.h"
+#include "store.h"
+#include <algorithm>
+#include <iterator>
+
+namespace
+{
+    const uint32_t kInvalidCodePoint = 0xFFFD;
+
+    // 读取 pos 处的一个 UTF-8 字符并前移 pos；非法字节按一个字节计，返回 U+FFFD
+    uint32_t nextCodePoint(const std::string &text, size_t &pos)
+    {
+        unsigned char lead = static_cast<unsigned char>(text[pos]);
+        size_t length = 0;
+        uint32_t codePoint = 0;
+        if (lead < 0x80)
+        {
+            pos++;
+            return lead;
+        }
+        else if ((lead & 0xE0) == 0xC0)
+        {
+            length = 2;
+            codePoint = lead & 0x1F;
+        }
+        else if ((lead & 0xF0) == 0xE0)
+        {
+            length = 3;
+            codePoint = lead & 0x0F;
+        }
+        else if ((lead & 0xF8) == 0xF0)
+        {
+            length = 4;
+            codePoint = lead & 0x07;
+        }
+        else
+        {
+            pos++;
+            return kInvalidCodePoint;
+        }
+
+        if (pos + length > text.size())
+        {
+            pos++;
+            return kInvalidCodePoint;
+        }
+        for (size_t i = 1; i < length; ++i)
+        {
+            unsigned char next = static_cast<unsigned char>(text[pos + i]);
+            if ((next & 0xC0) != 0x80)
+            {
+                pos++;
+                return kInvalidCodePoint;
+            }
+            codePoint = (codePoint << 6) | (next & 0x3F);
+        }
+        pos += length;
+        return codePoint;
+    }
+
+    void appendUtf8(std::string &out, uint32_t codePoint)
+    {
+        if (codePoint < 0x80)
+        {
+            out += static_cast<char>(codePoint);
+        }
+        else if (codePoint < 0x800)
+        {
+            out += static_cast<char>(0xC0 | (codePoint >> 6));
+            out += static_cast<char>(0x80 | (codePoint & 0x3F));
+        }
+        else if (codePoint < 0x10000)
+        {
+            out += static_cast<char>(0xE0 | (codePoint >> 12));
+            out += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (codePoint & 0x3F));
+        }
+        else
+        {
+            out += static_cast<char>(0xF0 | (codePoint >> 18));
+            out += static_cast<char>(0x80 | ((codePoint >> 12) & 0x3F));
+            out += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (codePoint & 0x3F));
+        }
+    }
+
+    bool isAsciiWordChar(uint32_t codePoint)
+    {
+        return (codePoint >= '0' && codePoint <= '9') || (codePoint >= 'a' && codePoint <= 'z') ||
+               (codePoint >= 'A' && codePoint <= 'Z');
+    }
+
+    // 非 ASCII 的分隔字符：中文标点、全角标点和空格、替换字符
+    bool isWideSeparator(uint32_t codePoint)
+    {
+        return (codePoint >= 0x3000 && codePoint <= 0x303F) || (codePoint >= 0xFF00 && codePoint <= 0xFF0F) ||
+               (codePoint >= 0xFF1A && codePoint <= 0xFF20) || (codePoint >= 0xFF3B && codePoint <= 0xFF40) ||
+               (codePoint >= 0xFF5B && codePoint <= 0xFF65) || (codePoint >= 0x2000 && codePoint <= 0x206F) ||
+               codePoint == kInvalidCodePoint;
+    }
+
+    // 把规范化后的文本切成连续片段：ASCII 字母数字串（word 为 true）或其他文字的连续片段
+    template <typename Visitor>
+    void forEachRun(const std::string &normalized, Visitor visit)
+    {
+        size_t pos = 0;
+        size_t runStart = 0;
+        bool inRun = false;
+        bool runIsWord = false;
+        while (pos < normalized.size())
+        {
+            size_t charStart = pos;
+            uint32_t codePoint = nextCodePoint(normalized, pos);
+            bool word = codePoint < 0x80 && isAsciiWordChar(codePoint);
+            bool gram = codePoint >= 0x80 && !isWideSeparator(codePoint);
+            if (inRun && (!(word || gram) || word != runIsWord))
+            {
+                visit(normalized.substr(runStart, charStart - runStart), runIsWord);
+                inRun = false;
+            }
+            if (!inRun && (word || gram))
+            {
+                inRun = true;
+                runIsWord = word;
+                runStart = charStart;
+            }
+        }
+        if (inRun)
+        {
+            visit(normalized.substr(runStart), runIsWord);
+        }
+    }
+
+    // 把片段拆成逐个字符
+    std::vector<std::string> splitChars(const std::string &run)
+    {
+        std::vector<std::string> chars;
+        size_t pos = 0;
+        while (pos < run.size())
+        {
+            size_t start = pos;
+            nextCodePoint(run, pos);
+            chars.push_back(run.substr(start, pos - start));
+        }
+        return chars;
+    }
+}
+
+std::string SearchIndex::normalize(const std::string &text)
+{
+    std::string result;
+    result.reserve(text.size());
+    size_t pos = 0;
+    while (pos < text.size())
+    {
+        uint32_t codePoint = nextCodePoint(text, pos);
+        if (codePoint >= 0xFF01 && codePoint <= 0xFF5E)
+        {
+            codePoint -= 0xFEE0; // 全角 ASCII 转半角
+        }
+        if (codePoint >= 'A' && codePoint <= 'Z')
+        {
+            codePoint += 'a' - 'A';
+        }
+        appendUtf8(result, codePoint);
+    }
+    return result;
+}
+
+void SearchIndex::addTerm(const std::string &term, uint64_t productId)
+{
+    std::vector<uint64_t> &list = postings[term];
+    // 商品ID递增分配，新商品通常直接追加在末尾
+    if (list.empty() || list.back() < productId)
+    {
+        list.push_back(productId);
+        return;
+    }
+    auto it = std::lower_bound(list.begin(), list.end(), productId);
+    if (it == list.end() || *it != productId)
+    {
+        list.insert(it, productId);
+    }
+}
+
+void SearchIndex::removeTerm(const std::string &term, uint64_t productId)
+{
+    auto found = postings.find(term);
+    if (found == postings.end())
+    {
+        return;
+    }
+    std::vector<uint64_t> &list = found->second;
+    auto it = std::lower_bound(list.begin(), list.end(), productId);
+    if (it != list.end() && *it == productId)
+    {
+        list.erase(it);
+    }
+    if (list.empty())
+    {
+        postings.erase(found);
+    }
+}
+
+void SearchIndex::addProduct(const Product &product)
+{
+    if (product.getId() == 0)
+    {
+        return;
+    }
+    std::string text = normalize(product.getName() + "\n" + product.getDescription() + "\n" + product.getUserCategory());
+    auto inserted = documents.emplace(product.getId(), text);
+    if (!inserted.second)
+    {
+        return;
+    }
+    auto addRun = [&](const std::string &run, bool word)
+    {
+        if (word)
+        {
+            addTerm(run, product.getId());
+            return;
+        }
+        std::vector<std::string> chars = splitChars(run);
+        for (size_t i = 0; i < chars.size(); ++i)
+        {
+            addTerm(chars[i], product.getId());
+            if (i > 0)
+            {
+                addTerm(chars[i - 1] + chars[i], product.getId());
+            }
+        }
+    };
+    forEachRun(text, addRun);
+}
+
+void SearchIndex::removeProduct(uint64_t productId)
+{
+    auto found = documents.find(productId);
+    if (found == documents.end())
+    {
+        return;
+    }
+    auto removeRun = [&](const std::string &run, bool word)
+    {
+        if (word)
+        {
+            removeTerm(run, productId);
+            return;
+        }
+        std::vector<std::string> chars = splitChars(run);
+        for (size_t i = 0; i < chars.size(); ++i)
+        {
+            removeTerm(chars[i], productId);
+            if (i > 0)
+            {
+                removeTerm(chars[i - 1] + chars[i], productId);
+            }
+        }
+    };
+    forEachRun(found->second, removeRun);
+    documents.erase(found);
+}
+
+void SearchIndex::clear()
+{
+    postings.clear();
+    documents.clear();
+}
+
+std::vector<uint64_t> SearchIndex::lookup(const QueryTerm &term) const
+{
+    if (!term.prefix)
+    {
+        auto found = postings.find(term.text);
+        return found != postings.end() ? found->second : std::vector<uint64_t>();
+    }
+
+    std::vector<uint64_t> merged;
+    size_t lists = 0;
+    for (auto it = postings.lower_bound(term.text);
+         it != postings.end() && it->first.compare(0, term.text.size(), term.text) == 0; ++it)
+    {
+        merged.insert(merged.end(), it->second.begin(), it->second.end());
+        lists++;
+    }
+    if (lists > 1)
+    {
+        std::sort(merged.begin(), merged.end());
+        merged.erase(std::unique(merged.begin(), merged.end()), merged.end());
+    }
+    return merged;
+}
+
+std::vector<uint64_t> SearchIndex::search(const std::string &keyword) const
+{
+    std::vector<QueryTerm> terms;
+    std::vector<std::string> phrases; // 三个字以上的片段，bigram 交集之后还要确认连续出现
+    auto parseRun = [&](const std::string &run, bool word)
+    {
+        if (word)
+        {
+            terms.push_back(QueryTerm{run, true});
+            return;
+        }
+        std::vector<std::string> chars = splitChars(run);
+        if (chars.size() == 1)
+        {
+            terms.push_back(QueryTerm{chars[0], false});
+            return;
+        }
+        for (size_t i = 1; i < chars.size(); ++i)
+        {
+            terms.push_back(QueryTerm{chars[i - 1] + chars[i], false});
+        }
+        if (chars.size() > 2)
+        {
+            phrases.push_back(run);
+        }
+    };
+    forEachRun(normalize(keyword), parseRun);
+    if (terms.empty())
+    {
+        return {};
+    }
+
+    std::vector<std::vector<uint64_t>> lists;
+    lists.reserve(terms.size());
+    for (const QueryTerm &term : terms)
+    {
+        lists.push_back(lookup(term));
+        if (lists.back().empty())
+        {
+            return {};
+        }
+    }
+
+    // 从最短的倒排表开始求交集，结果只会越来越短
+    std::sort(lists.begin(), lists.end(), [](const std::vector<uint64_t> &a, const std::vector<uint64_t> &b)
+              { return a.size() < b.size(); });
+    std::vector<uint64_t> result = std::move(lists[0]);
+    for (size_t i = 1; i < lists.size() && !result.empty(); ++i)
+    {
+        std::vector<uint64_t> narrowed;
+        narrowed.reserve(result.size());
+        std::set_intersection(result.begin(), result.end(), lists[i].begin(), lists[i].end(), std::back_inserter(narrowed));
+        result.swap(narrowed);
+    }
+
+    if (!phrases.empty())
+    {
+        auto missingPhrase = [&](uint64_t productId)
+        {
+            const std::string &text = documents.at(productId);
+            for (const std::string &phrase : phrases)
+            {
+                if (text.find(phrase) == std::string::npos)
+                {
+                    return true;
+                }
+            }
+            return false;
+        };
+        result.erase(std::remove_if(result.begin(), result.end(), missingPhrase), result.end());
+    }
+    return result;
+}
+
+SearchIndex::Stats SearchIndex::getStats() const
+{
+    Stats stats;
+    stats.documents = documents.size();
+    stats.terms = postings.size();
+    for (const auto &entry : postings)
+    {
+        stats.postings += entry.second.size();
+    }
+    return stats;
+}
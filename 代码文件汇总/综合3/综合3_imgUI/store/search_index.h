@@ -0,0 +1,59 @@
+#ifndef SEARCH_INDEX_H
+#define SEARCH_INDEX_H
+
+#include <string>
+#include <vector>
+#include <map>
+#include <unordered_map>
+#include <cstdint>
+
+class Product;
+
+// 商品搜索倒排索引：覆盖商品名称、描述和分类标签。
+// 文本先规范化（ASCII 字母转小写、全角字母数字转半角），再切分为词项：
+//   - ASCII 字母数字串整体作为一个词，查询词按前缀匹配（"iph" 可以找到 "iphone"）
+//   - 中文等其他文字按单字和相邻两字（bigram）建索引，查询时取各 bigram 倒排表的交集，
+//     再到候选商品的文本中确认整段连续出现；单个字直接查单字倒排表
+// 查询中的多个词之间是"与"的关系。倒排表按商品ID升序保存，求交集从最短的表开始，
+// 查询耗时取决于命中的商品数，不随目录规模线性增长。商品增删时增量维护。
+// 索引本身不加锁：它是 ProductCatalog 的一部分，随目录版本写时复制，发布后只读
+class SearchIndex
+{
+public:
+    struct Stats
+    {
+        size_t documents = 0; // 已索引的商品数
+        size_t terms = 0;     // 不同词项数
+        size_t postings = 0;  // 倒排表总长度
+    };
+
+    void addProduct(const Product &product);
+    void removeProduct(uint64_t productId);
+    void clear();
+
+    // 返回同时包含关键词中全部词项的商品ID（升序）；关键词中没有可检索的字符时返回空
+    std::vector<uint64_t> search(const std::string &keyword) const;
+
+    Stats getStats() const;
+
+    // 规范化文本，建索引和查询使用同一规则
+    static std::string normalize(const std::string &text);
+
+private:
+    // 查询中的一个词：ASCII 词按前缀查找；其他文字的连续片段拆成 bigram 后需要回到原文确认
+    struct QueryTerm
+    {
+        std::string text;
+        bool prefix;
+    };
+
+    std::map<std::string, std::vector<uint64_t>> postings; // 词项 -> 商品ID（升序）
+    std::unordered_map<uint64_t, std::string> documents;   // 商品ID -> 规范化后的名称、描述、分类
+
+    void addTerm(const std::string &term, uint64_t productId);
+    void removeTerm(const std::string &term, uint64_t productId);
+    // 取词项的倒排表；前缀查找时合并所有以该词开头的词项
+    std::vector<uint64_t> lookup(const QueryTerm &term) const;
+};
+
+#endif // SEARCH_INDEX_H
@@ -1,10 +1,45 @@
 #include "store.h"
+#include "product_arena.h"
+#include "catalog_file.h"
+#include "../network/wire.h"
 
 namespace fs = std::filesystem;
 
 using namespace std;
 
 // --- Product 方法实现 ---
+static_assert(std::is_same<std::variant_alternative_t<static_cast<size_t>(ProductKind::BOOK), ProductAttributes>, BookAttributes>::value &&
+                  std::is_same<std::variant_alternative_t<static_cast<size_t>(ProductKind::CLOTHING), ProductAttributes>, ClothingAttributes>::value &&
+                  std::is_same<std::variant_alternative_t<static_cast<size_t>(ProductKind::FOOD), ProductAttributes>, FoodAttributes>::value &&
+                  std::is_same<std::variant_alternative_t<static_cast<size_t>(ProductKind::GENERIC), ProductAttributes>, GenericAttributes>::value,
+              "ProductKind 的取值必须与 ProductAttributes 的备选类型顺序一致");
+
+namespace
+{
+    const std::string kProductKindNames[] = {"Book", "Clothing", "Food", "Generic"};
+
+    // 商品目录版本的代号，见 Store::catalogGeneration；从 1 开始，0 表示线程尚未缓存任何版本
+    std::atomic<uint64_t> nextCatalogGeneration(1);
+}
+
+const std::string &productKindName(ProductKind kind)
+{
+    return kProductKindNames[static_cast<size_t>(kind)];
+}
+
+bool parseProductKind(const std::string &name, ProductKind &kind)
+{
+    for (size_t i = 0; i < sizeof(kProductKindNames) / sizeof(kProductKindNames[0]); ++i)
+    {
+        if (name == kProductKindNames[i])
+        {
+            kind = static_cast<ProductKind>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
 void Product::display() const
 {
     std::cout << "  商户名称：" << sellerUsername << std::endl;
@@ -16,87 +51,96 @@ void Product::display() const
         std::cout << "  分类标签: " << getUserCategory() << std::endl;
     }
 
-    if (discountRate > 0)
+    if (getDiscountRate() > 0)
     {
-        std::cout << "  原价: ¥" << std::fixed << std::setprecision(2) << originalPrice << std::endl;
-        std::cout << "  折扣: " << (discountRate * 100) << "%" << std::endl;
+        std::cout << "  原价: ¥" << std::fixed << std::setprecision(2) << getOriginalPrice() << std::endl;
+        std::cout << "  折扣: " << (getDiscountRate() * 100) << "%" << std::endl;
         std::cout << "  现价: ¥" << std::fixed << std::setprecision(2) << getPrice() << std::endl;
     }
     else
     {
         std::cout << "  价格: ¥" << std::fixed << std::setprecision(2) << getPrice() << std::endl;
     }
-    std::cout << "  库存: " << quantity << " 件" << std::endl;
+    std::cout << "  库存: " << getQuantity() << " 件" << std::endl;
     if (!sellerUsername.empty())
     {
         std::cout << "  商家: " << sellerUsername << std::endl;
     }
-}
-
-void Product::save(std::ofstream &ofs) const
-{
-    ofs << getType() << "," << name << "," << description << ","
-        << originalPrice << "," << quantity << "," << discountRate << "," << sellerUsername;
-}
-
-void Book::display() const // 复用父类
-{
-    Product::display();
-    std::cout << "  作者: " << author << std::endl;
-    std::cout << "  ISBN: " << isbn << std::endl;
-}
-
-void Book::save(std::ofstream &ofs) const
-{
-    Product::save(ofs);
-    ofs << "," << author << "," << isbn;
-}
-
-void Clothing::display() const
-{
-    Product::display();
-    std::cout << "  尺寸: " << size << std::endl;
-    std::cout << "  颜色: " << color << std::endl;
-}
-
-void Clothing::save(std::ofstream &ofs) const
-{
-    Product::save(ofs);
-    ofs << "," << size << "," << color;
-}
-
-void Food::display() const
-{
-    Product::display();
-    std::cout << "  保质期限: " << expirationDate << std::endl;
-}
 
-void Food::save(std::ofstream &ofs) const
-{
-    Product::save(ofs);
-    ofs << "," << expirationDate;
+    // 种类特有字段
+    switch (getKind())
+    {
+    case ProductKind::BOOK:
+    {
+        const BookAttributes &book = std::get<BookAttributes>(attributes);
+        std::cout << "  作者: " << book.author << std::endl;
+        std::cout << "  ISBN: " << book.isbn << std::endl;
+        break;
+    }
+    case ProductKind::CLOTHING:
+    {
+        const ClothingAttributes &clothing = std::get<ClothingAttributes>(attributes);
+        std::cout << "  尺寸: " << clothing.size << std::endl;
+        std::cout << "  颜色: " << clothing.color << std::endl;
+        break;
+    }
+    case ProductKind::FOOD:
+        std::cout << "  保质期限: " << std::get<FoodAttributes>(attributes).expirationDate << std::endl;
+        break;
+    case ProductKind::GENERIC:
+        break;
+    }
 }
 
-void GenericProduct::display() const
+void Product::save(std::ofstream &ofs) const
 {
-    Product::display();
-}
+    ofs << id << "," << getType() << "," << name << "," << description << ","
+        << getOriginalPrice() << "," << getQuantity() << "," << getDiscountRate() << "," << sellerUsername;
 
-void GenericProduct::save(std::ofstream &ofs) const
-{
-    Product::save(ofs);
-    ofs << "," << categoryTag;
+    switch (getKind())
+    {
+    case ProductKind::BOOK:
+    {
+        const BookAttributes &book = std::get<BookAttributes>(attributes);
+        ofs << "," << book.author << "," << book.isbn;
+        break;
+    }
+    case ProductKind::CLOTHING:
+    {
+        const ClothingAttributes &clothing = std::get<ClothingAttributes>(attributes);
+        ofs << "," << clothing.size << "," << clothing.color;
+        break;
+    }
+    case ProductKind::FOOD:
+        ofs << "," << std::get<FoodAttributes>(attributes).expirationDate;
+        break;
+    case ProductKind::GENERIC:
+        ofs << "," << std::get<GenericAttributes>(attributes).categoryTag;
+        break;
+    }
 }
 
 // --- Store 类实现 ---
 
 // 构造函数
-Store::Store(const string &directory) : storeDirectory(directory)
+Store::Store(const string &directory)
+    : storeDirectory(directory), productArena(new ProductArena()), catalog(std::make_shared<ProductCatalog>()),
+      catalogGeneration(nextCatalogGeneration++), nextProductId(1), catalogVersion(0), catalogLogStart(0), writer(*this)
 {
+    catalogEpoch = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+                                             std::chrono::system_clock::now().time_since_epoch())
+                                             .count());
+
     // 确保商家目录存在
     string sellersDir = storeDirectory + "/sellers";
     ensureDirectoryExists(sellersDir);
 
+    // 先打开变更日志：加载商家文件后重放日志中的变更
+    if (!mutationLog.open(storeDirectory + "/wal"))
+    {
+        cerr << "警告: 无法打开商品变更日志，商品变更将直接写入商家文件" << endl;
+    }
+
     // 加载所有商品数据
     if (!loadAllProducts())
     {
@@ -104,19 +148,19 @@ Store::Store(const string &directory) : storeDirectory(directory)
     }
     else
     {
-        cout << "已从商店加载 " << allProducts.size() << " 件商品。" << endl;
+        cout << "已从商店加载 " << getCatalog()->products.size() << " 件商品。" << endl;
     }
 }
 
 // 析构函数
 Store::~Store()
 {
-    for (Product *p : allProducts)
-    {
-        delete p;
-    }
-    allProducts.clear();
-    sellerProducts.clear(); // 清除映射
+    // 先写出未保存的变更并停止写入线程，之后才能释放商品
+    writer.stop();
+    writer.flush();
+    mutationLog.close();
+    publishCatalog(std::make_shared<ProductCatalog>());
+    productArena->clear();
 }
 
 // 确保目录存在
@@ -136,7 +180,11 @@ bool Store::ensureDirectoryExists(const string &path) const
         cerr << "创建目录失败 " << path << ": " << e.what() << endl;
 
         // 尝试使用传统方法创建目录
+#ifdef _WIN32
         if (_mkdir(path.c_str()) == 0)
+#else
+        if (mkdir(path.c_str(), 0755) == 0)
+#endif
         {
             cout << "使用传统方法创建目录: " << path << endl;
             return true;
@@ -157,16 +205,35 @@ string Store::getSellerFilename(const string &username) const
     return storeDirectory + "/sellers/" + username + ".txt";
 }
 
+PoolStats Store::getProductPoolStats() const
+{
+    return productArena->getStats();
+}
+
 // 加载所有商品
 bool Store::loadAllProducts()
 {
-    // 清空现有商品
-    for (Product *p : allProducts)
+    auto loadStart = std::chrono::steady_clock::now();
+    auto elapsedMs = [](std::chrono::steady_clock::time_point since)
+    {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - since).count();
+    };
+    StoreLoadTimings timings;
+
+    // 未保存的变更先写入文件，再清空现有商品：整代商品随分配区一起释放。
+    // 重新加载是目录版本之外的一次整体更替，调用方须保证此时没有读者持有旧版本的商品
+    writer.flush();
+    std::lock_guard<std::mutex> writeLock(catalogWriteMutex);
+    publishCatalog(std::make_shared<ProductCatalog>());
+    productArena->clear();
+
     {
-        delete p;
+        // 旧的商品指针全部失效，变更日志从新版本重新开始
+        std::lock_guard<std::mutex> lock(catalogMutex);
+        catalogLog.clear();
+        catalogVersion++;
+        catalogLogStart = catalogVersion.load();
     }
-    allProducts.clear();
-    sellerProducts.clear();
 
     // 获取sellers目录下的所有文件
     string sellersDir = storeDirectory + "/sellers";
@@ -180,17 +247,63 @@ bool Store::loadAllProducts()
             return true;
         }
 
-        // 遍历目录中的所有文件
-        for (const auto &entry : fs::directory_iterator(sellersDir))
+        // 二进制快照不旧于商家文件时直接映射快照；否则（首次启动、商家文件被外部修改）从商家文件导入
+        // 新版本在发布前只属于当前线程，加载、分配ID、重放日志都直接修改它
+        auto draft = std::make_shared<ProductCatalog>();
+        timings.fromSnapshot = catalogSnapshotIsCurrent() && loadCatalogSnapshot(*draft, timings.readMs, timings.indexMs);
+        if (!timings.fromSnapshot)
         {
-            if (entry.is_regular_file())
+            // 遍历目录中的所有文件
+            vector<string> sellers;
+            for (const auto &entry : fs::directory_iterator(sellersDir))
             {
-                string filename = entry.path().string();
-                string sellerUsername = entry.path().stem().string(); // 获取不带扩展名的文件名
-
-                loadSellerProducts(sellerUsername);
+                // 只加载 .txt 商家文件，忽略写入中途留下的临时文件
+                if (entry.is_regular_file() && entry.path().extension() == ".txt")
+                {
+                    sellers.push_back(entry.path().stem().string()); // 获取不带扩展名的文件名
+                }
             }
+            timings.parseThreads = loadSellerFilesParallel(*draft, sellers, timings.readMs, timings.indexMs);
+        }
+        set<string> sellersToSave = assignMissingProductIds(*draft);
+        auto replayStart = std::chrono::steady_clock::now();
+        replayMutationLog(*draft);
+        timings.replayMs = elapsedMs(replayStart);
+        timings.products = draft->products.size();
+        publishCatalog(draft);
+
+        // 写回文件读取的是已发布的版本
+        for (const string &seller : sellersToSave)
+        {
+            saveProductsForSeller(seller);
         }
+        if (!timings.fromSnapshot)
+        {
+            // 导入后立即写出快照，下次启动不再解析文本
+            auto snapshotStart = std::chrono::steady_clock::now();
+            saveCatalogSnapshot();
+            timings.snapshotMs = elapsedMs(snapshotStart);
+        }
+        timings.totalMs = elapsedMs(loadStart);
+        loadTimings = timings;
+        cout << "商品加载耗时: 共 " << timings.totalMs << "ms，"
+             << (timings.fromSnapshot ? "读取快照 " : "解析商家文件 ") << timings.readMs << "ms";
+        if (!timings.fromSnapshot)
+        {
+            cout << "（" << timings.parseThreads << " 个线程）";
+        }
+        cout << "，建立索引 " << timings.indexMs << "ms";
+        if (!timings.fromSnapshot)
+        {
+            cout << "，写出快照 " << timings.snapshotMs << "ms";
+        }
+        cout << "，重放日志 " << timings.replayMs << "ms" << endl;
+        SearchIndex::Stats searchStats = draft->searchIndex.getStats();
+        cout << "搜索索引: " << searchStats.documents << " 件商品，" << searchStats.terms << " 个词项，"
+             << draft->suggestIndex.getKeyCount() << " 个联想键" << endl;
+        PoolStats poolStats = productArena->getStats();
+        cout << "商品内存池: " << poolStats.liveObjects << " 个对象，" << poolStats.blocks << " 块，"
+             << poolStats.reservedBytes / 1024 << "KB" << endl;
         return true;
     }
     catch (const fs::filesystem_error &e)
@@ -207,16 +320,33 @@ bool Store::loadAllProducts()
 
 // 加载指定商家的商品
 bool Store::loadSellerProducts(const string &sellerUsername)
+{
+    vector<Product *> products;
+    if (parseSellerFile(sellerUsername, products))
+    {
+        std::lock_guard<std::mutex> writeLock(catalogWriteMutex);
+        auto draft = std::make_shared<ProductCatalog>(*getCatalog());
+        mergeSellerProducts(*draft, sellerUsername, products);
+        for (Product *product : products)
+        {
+            indexProduct(*draft, product);
+        }
+        publishCatalog(draft);
+    }
+    // 对于新商家，文件不存在是正常的
+    return true;
+}
+
+// 解析商家文件并创建商品；只使用线程安全的分配区，不修改商品列表和索引，可在多个线程中同时调用
+bool Store::parseSellerFile(const string &sellerUsername, vector<Product *> &sellerProductsList)
 {
     string filename = getSellerFilename(sellerUsername);
     ifstream file(filename);
     if (!file.is_open())
     {
-        // 对于新商家，文件不存在是正常的
-        return true;
+        return false;
     }
 
-    vector<Product *> sellerProductsList;
     string line;
 
     while (getline(file, line))
@@ -230,7 +360,14 @@ bool Store::loadSellerProducts(const string &sellerUsername)
             seglist.push_back(segment);
         }
 
-        // 格式检查: 至少需要7个字段 (类型,名称,描述,价格,数量,折扣,商家)
+        // 第一列是数字时为商品ID；旧格式没有这一列，加载完成后统一分配
+        uint64_t productId = 0;
+        if (!seglist.empty() && parseProductId(seglist[0], productId))
+        {
+            seglist.erase(seglist.begin());
+        }
+
+        // 格式检查: 除ID外至少需要7个字段 (类型,名称,描述,价格,数量,折扣,商家)
         if (seglist.size() < 7)
         {
             cerr << "无效的产品数据行: " << line << endl;
@@ -260,22 +397,22 @@ bool Store::loadSellerProducts(const string &sellerUsername)
             if (type == "Book" && seglist.size() >= 9)
             {
                 // Book需要额外的author和isbn字段
-                newProduct = new Book(name, desc, price, qty, seglist[7], seglist[8], seller);
+                newProduct = productArena->create(name, desc, price, qty, BookAttributes{seglist[7], seglist[8]}, seller);
             }
             else if (type == "Clothing" && seglist.size() >= 9)
             {
                 // Clothing需要额外的size和color字段
-                newProduct = new Clothing(name, desc, price, qty, seglist[7], seglist[8], seller);
+                newProduct = productArena->create(name, desc, price, qty, ClothingAttributes{seglist[7], seglist[8]}, seller);
             }
             else if (type == "Food" && seglist.size() >= 8)
             {
                 // Food需要额外的expirationDate字段
-                newProduct = new Food(name, desc, price, qty, seglist[7], seller);
+                newProduct = productArena->create(name, desc, price, qty, FoodAttributes{seglist[7]}, seller);
             }
             else if (type == "Generic" && seglist.size() >= 8)
             {
                 // GenericProduct需要额外的categoryTag字段
-                newProduct = new GenericProduct(name, desc, price, qty, seglist[7], seller);
+                newProduct = productArena->create(name, desc, price, qty, GenericAttributes{seglist[7]}, seller);
             }
             else
             {
@@ -286,7 +423,7 @@ bool Store::loadSellerProducts(const string &sellerUsername)
             if (newProduct)
             {
                 newProduct->setDiscountRate(discount);
-                allProducts.push_back(newProduct);
+                newProduct->setId(productId);
                 sellerProductsList.push_back(newProduct);
             }
         }
@@ -297,28 +434,98 @@ bool Store::loadSellerProducts(const string &sellerUsername)
     }
 
     file.close();
+    return true;
+}
 
-    // 更新商家商品映射
-    sellerProducts[sellerUsername] = sellerProductsList;
+// 把解析出的商品加入商品列表和商家商品映射，由调用方建立索引
+void Store::mergeSellerProducts(ProductCatalog &draft, const string &sellerUsername, const vector<Product *> &products)
+{
+    draft.products.insert(draft.products.end(), products.begin(), products.end());
+    draft.sellerProducts[sellerUsername] = products;
     cout << "已加载商家 \"" << sellerUsername << "\" 的 "
-         << sellerProductsList.size() << " 件商品" << endl;
+         << products.size() << " 件商品" << endl;
+}
 
-    return true;
+// 多个线程同时解析商家文件，每个商家的结果放在各自的槽位里；全部解析完后按文件顺序合并，再按商品ID顺序建索引。
+// 返回解析使用的线程数
+size_t Store::loadSellerFilesParallel(ProductCatalog &draft, const vector<string> &sellers, double &parseMs, double &indexMs)
+{
+    auto parseStart = std::chrono::steady_clock::now();
+    vector<vector<Product *>> results(sellers.size());
+    vector<char> found(sellers.size(), 0);
+    std::atomic<size_t> next(0);
+    auto parseWorker = [this, &sellers, &results, &found, &next]()
+    {
+        for (size_t i = next++; i < sellers.size(); i = next++)
+        {
+            try
+            {
+                found[i] = parseSellerFile(sellers[i], results[i]) ? 1 : 0;
+            }
+            catch (const exception &e)
+            {
+                cerr << "解析商家 \"" << sellers[i] << "\" 的文件时出错: " << e.what() << endl;
+            }
+        }
+    };
+
+    size_t threadCount = std::min<size_t>(sellers.size(), std::max(1u, std::thread::hardware_concurrency()));
+    if (threadCount <= 1)
+    {
+        parseWorker();
+    }
+    else
+    {
+        vector<std::thread> workers;
+        for (size_t t = 0; t < threadCount; ++t)
+        {
+            workers.emplace_back(parseWorker);
+        }
+        for (std::thread &worker : workers)
+        {
+            worker.join();
+        }
+    }
+    auto indexStart = std::chrono::steady_clock::now();
+    parseMs = std::chrono::duration<double, std::milli>(indexStart - parseStart).count();
+
+    // 索引不是线程安全的，合并在当前线程进行。
+    // 各商家的商品ID交错，按文件顺序建索引时倒排表要在中间插入；按ID顺序建索引只需追加。
+    // 排序是稳定的，ID相同（包括尚未分配ID）的商品仍按文件顺序，重复ID、重复名称的处理与逐个加载相同
+    vector<Product *> merged;
+    for (size_t i = 0; i < sellers.size(); ++i)
+    {
+        if (found[i])
+        {
+            mergeSellerProducts(draft, sellers[i], results[i]);
+            merged.insert(merged.end(), results[i].begin(), results[i].end());
+        }
+    }
+    std::stable_sort(merged.begin(), merged.end(), [](const Product *a, const Product *b)
+                     { return a->getId() < b->getId(); });
+    for (Product *product : merged)
+    {
+        indexProduct(draft, product);
+    }
+    indexMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - indexStart).count();
+    return threadCount;
 }
 
 // 保存所有商品
 bool Store::saveAllProducts()
 {
     // 对于每个商家，保存其商品
-    set<string> processedSellers; // 用于跟踪已处理的商家
+    vector<string> sellers;
+    for (const auto &entry : getCatalog()->sellerProducts)
+    {
+        sellers.push_back(entry.first);
+    }
 
-    for (const auto &product : allProducts)
+    for (const string &seller : sellers)
     {
-        string seller = product->getSellerUsername();
-        if (!seller.empty() && processedSellers.find(seller) == processedSellers.end())
+        if (!seller.empty())
         {
             saveProductsForSeller(seller);
-            processedSellers.insert(seller);
         }
     }
 
@@ -334,23 +541,23 @@ bool Store::saveProductsForSeller(const string &sellerUsername)
         return false;
     }
 
-    vector<Product *> products;
+    // 整个文件重写，此前记下的未保存变更都会包含在内；之后的变更重新标记
+    writer.markClean(sellerUsername);
 
     // 获取该商家的所有商品
-    for (Product *p : allProducts)
-    {
-        if (p->getSellerUsername() == sellerUsername)
-        {
-            products.push_back(p);
-        }
-    }
+    auto current = getCatalog();
+    auto sellerIt = current->sellerProducts.find(sellerUsername);
+    const vector<Product *> &products = sellerIt != current->sellerProducts.end() ? sellerIt->second : vector<Product *>();
 
+    std::lock_guard<std::mutex> fileLock(sellerFileMutex);
     string filename = getSellerFilename(sellerUsername);
-    ofstream file(filename);
+    // 先写临时文件再替换：商家文件是变更日志的快照，写到一半崩溃时旧快照必须保持完整
+    string tempFilename = filename + ".tmp";
+    ofstream file(tempFilename);
 
     if (!file.is_open())
     {
-        cerr << "错误: 无法打开文件保存商品: " << filename << endl;
+        cerr << "错误: 无法打开文件保存商品: " << tempFilename << endl;
         return false;
     }
 
@@ -361,82 +568,531 @@ bool Store::saveProductsForSeller(const string &sellerUsername)
     }
 
     file.close();
+    if (file.fail())
+    {
+        cerr << "错误: 写入商品文件失败: " << tempFilename << endl;
+        return false;
+    }
+
+    std::error_code ec;
+    fs::rename(tempFilename, filename, ec);
+    if (ec)
+    {
+        // 部分平台不能覆盖已存在的文件
+        fs::remove(filename, ec);
+        fs::rename(tempFilename, filename, ec);
+        if (ec)
+        {
+            cerr << "错误: 无法替换商品文件 " << filename << ": " << ec.message() << endl;
+            return false;
+        }
+    }
     // cout << "商家 \"" << sellerUsername << "\" 的 " << products.size()
     //      << " 件商品已保存至 " << filename << endl;
 
     return true;
 }
 
-// 查找商品
-Product *Store::findProductByName(const string &name, const string &sellerUsername)
+string Store::getCatalogSnapshotFilename() const
 {
-    if (!sellerUsername.empty())
+    return storeDirectory + "/catalog.bin";
+}
+
+// 快照存在且没有比它更新的商家文件
+bool Store::catalogSnapshotIsCurrent() const
+{
+    std::error_code ec;
+    auto snapshotTime = fs::last_write_time(getCatalogSnapshotFilename(), ec);
+    if (ec)
     {
-        // 只在指定商家的商品中查找
-        auto it = sellerProducts.find(sellerUsername);
-        if (it != sellerProducts.end())
+        return false;
+    }
+    for (const auto &entry : fs::directory_iterator(storeDirectory + "/sellers", ec))
+    {
+        if (entry.is_regular_file() && entry.path().extension() == ".txt")
         {
-            for (Product *p : it->second)
+            auto fileTime = fs::last_write_time(entry.path(), ec);
+            if (ec || fileTime > snapshotTime)
             {
-                if (p->getName() == name)
-                {
-                    return p;
-                }
+                return false;
             }
         }
-        return nullptr;
+    }
+    return !ec;
+}
+
+bool Store::loadCatalogSnapshot(ProductCatalog &draft, double &readMs, double &indexMs)
+{
+    auto readStart = std::chrono::steady_clock::now();
+    CatalogFile catalog;
+    if (!catalog.open(getCatalogSnapshotFilename()))
+    {
+        return false;
+    }
+
+    // 先创建全部商品，再统一加入列表和索引，分别计时
+    vector<Product *> products;
+    products.reserve(catalog.size());
+    for (size_t i = 0; i < catalog.size(); ++i)
+    {
+        CatalogFile::ProductView view = catalog.product(i);
+        ProductAttributes attributes;
+        switch (static_cast<ProductKind>(view.kind))
+        {
+        case ProductKind::BOOK:
+            attributes = BookAttributes{string(view.attribute1), string(view.attribute2)};
+            break;
+        case ProductKind::CLOTHING:
+            attributes = ClothingAttributes{string(view.attribute1), string(view.attribute2)};
+            break;
+        case ProductKind::FOOD:
+            attributes = FoodAttributes{string(view.attribute1)};
+            break;
+        case ProductKind::GENERIC:
+            attributes = GenericAttributes{string(view.attribute1)};
+            break;
+        }
+        Product *product = productArena->create(string(view.name), string(view.description), view.originalPrice,
+                                                view.quantity, std::move(attributes), string(view.sellerUsername));
+        product->setDiscountRate(view.discountRate);
+        product->setId(view.id);
+        products.push_back(product);
+    }
+    auto indexStart = std::chrono::steady_clock::now();
+    readMs = std::chrono::duration<double, std::milli>(indexStart - readStart).count();
+
+    for (Product *product : products)
+    {
+        draft.products.push_back(product);
+        draft.sellerProducts[product->getSellerUsername()].push_back(product);
+        indexProduct(draft, product);
+    }
+    indexMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - indexStart).count();
+
+    cout << "已从商品目录快照加载 " << draft.products.size() << " 件商品（" << draft.sellerProducts.size() << " 个商家）" << endl;
+    return true;
+}
+
+bool Store::saveCatalogSnapshot()
+{
+    // 按商品ID顺序写出：加载时搜索索引的倒排表只需追加，不会在中间插入。
+    // 同一商家的商品按创建顺序分配ID，加载后商家内的顺序与商家文件一致
+    auto current = getCatalog();
+    vector<const Product *> products(current->products.begin(), current->products.end());
+    std::stable_sort(products.begin(), products.end(), [](const Product *a, const Product *b)
+                     { return a->getId() < b->getId(); });
+    std::lock_guard<std::mutex> fileLock(sellerFileMutex);
+    return CatalogFile::write(getCatalogSnapshotFilename(), products);
+}
+
+void Store::publishCatalog(std::shared_ptr<ProductCatalog> next)
+{
+    next->suggestIndex.seal();
+    productColumns.rebuild(next->products);
+    // 先发布版本再更新代号：读到新代号的线程一定能取到新版本
+    std::atomic_store(&catalog, std::shared_ptr<const ProductCatalog>(std::move(next)));
+    catalogGeneration.store(nextCatalogGeneration++, std::memory_order_release);
+}
+
+const ProductCatalog &Store::currentCatalog() const
+{
+    struct CachedCatalog
+    {
+        uint64_t generation = 0;
+        std::shared_ptr<const ProductCatalog> catalog;
+    };
+    static thread_local CachedCatalog cached;
+    uint64_t generation = catalogGeneration.load(std::memory_order_acquire);
+    if (cached.generation != generation || !cached.catalog)
+    {
+        cached.catalog = getCatalog();
+        cached.generation = generation;
+    }
+    return *cached.catalog;
+}
+
+// 复制当前版本，加入商品后发布。复制的是指针容器，商品对象本身不复制；
+// 商品的增删远少于查询，复制的开销换来读者完全不加锁
+void Store::addProduct(Product *product)
+{
+    std::lock_guard<std::mutex> writeLock(catalogWriteMutex);
+    auto draft = std::make_shared<ProductCatalog>(*getCatalog());
+    draft->products.push_back(product);
+    draft->sellerProducts[product->getSellerUsername()].push_back(product);
+    indexProduct(*draft, product);
+    publishCatalog(draft);
+}
+
+// 从新版本中移除商品。商品对象不释放：旧版本的读者可能仍在使用它
+void Store::removeProduct(Product *product)
+{
+    std::lock_guard<std::mutex> writeLock(catalogWriteMutex);
+    auto draft = std::make_shared<ProductCatalog>(*getCatalog());
+    auto &all = draft->products;
+    all.erase(std::remove(all.begin(), all.end(), product), all.end());
+    auto sellerIt = draft->sellerProducts.find(product->getSellerUsername());
+    if (sellerIt != draft->sellerProducts.end())
+    {
+        auto &own = sellerIt->second;
+        own.erase(std::remove(own.begin(), own.end(), product), own.end());
+    }
+    unindexProduct(*draft, product);
+    publishCatalog(draft);
+}
+
+void Store::startWriteBehind(const StoreWriter::Options &options)
+{
+    writer.start(options);
+    cout << "商品后台写入已启动，间隔 " << options.interval.count() << "ms，积压阈值 "
+         << options.maxPendingChanges << " 条变更" << endl;
+}
+
+bool Store::flush()
+{
+    return writer.flush();
+}
+
+bool Store::saveChanges()
+{
+    // 变更已在 markProductChanged 中追加到日志，这里等待落盘；并发请求的等待由日志线程一次 fsync 满足
+    if (mutationLog.isOpen())
+    {
+        return mutationLog.sync();
+    }
+    // 没有日志时：后台写入线程运行时由它按间隔或积压阈值写入
+    if (writer.isRunning())
+    {
+        return true;
+    }
+    return writer.flush();
+}
+
+// 商品记录：操作类型、商品ID、种类、名称、描述、商家、原价、库存、折扣、种类特有字段。
+// 每条记录都是商品的完整状态，重复重放结果相同
+namespace
+{
+    const uint8_t kRecordUpsertProduct = 1;
+}
+
+string Store::encodeProductRecord(const Product *product)
+{
+    string record;
+    Wire::Writer writer(record);
+    writer.writeByte(kRecordUpsertProduct);
+    writer.writeVarint(product->getId());
+    writer.writeByte(static_cast<uint8_t>(product->getKind()));
+    writer.writeString(product->getName());
+    writer.writeString(product->getDescription());
+    writer.writeString(product->getSellerUsername());
+    writer.writeDouble(product->getOriginalPrice());
+    writer.writeSigned(product->getQuantity());
+    writer.writeDouble(product->getDiscountRate());
+    const ProductAttributes &attributes = product->getAttributes();
+    switch (product->getKind())
+    {
+    case ProductKind::BOOK:
+    {
+        const BookAttributes &book = std::get<BookAttributes>(attributes);
+        writer.writeString(book.author);
+        writer.writeString(book.isbn);
+        break;
+    }
+    case ProductKind::CLOTHING:
+    {
+        const ClothingAttributes &clothing = std::get<ClothingAttributes>(attributes);
+        writer.writeString(clothing.size);
+        writer.writeString(clothing.color);
+        break;
+    }
+    case ProductKind::FOOD:
+        writer.writeString(std::get<FoodAttributes>(attributes).expirationDate);
+        break;
+    case ProductKind::GENERIC:
+        writer.writeString(std::get<GenericAttributes>(attributes).categoryTag);
+        break;
+    }
+    return record;
+}
+
+// 已有该ID的商品时更新价格、库存、折扣（名称、种类等创建后不会再变），否则新建商品
+bool Store::applyProductRecord(ProductCatalog &draft, std::string_view record)
+{
+    Wire::Reader reader(record);
+    uint8_t op = reader.readByte();
+    uint64_t productId = reader.readVarint();
+    uint8_t kind = reader.readByte();
+    string name = reader.readString();
+    string desc = reader.readString();
+    string seller = reader.readString();
+    double price = reader.readDouble();
+    int64_t quantity = reader.readSigned();
+    double discount = reader.readDouble();
+    if (!reader.isOk() || op != kRecordUpsertProduct || productId == 0 || seller.empty() ||
+        kind > static_cast<uint8_t>(ProductKind::GENERIC))
+    {
+        return false;
+    }
+
+    auto existing = draft.byId.find(productId);
+    Product *product = existing != draft.byId.end() ? existing->second : nullptr;
+    if (!product)
+    {
+        ProductAttributes attributes;
+        switch (static_cast<ProductKind>(kind))
+        {
+        case ProductKind::BOOK:
+        {
+            string author = reader.readString();
+            string isbn = reader.readString();
+            attributes = BookAttributes{author, isbn};
+            break;
+        }
+        case ProductKind::CLOTHING:
+        {
+            string size = reader.readString();
+            string color = reader.readString();
+            attributes = ClothingAttributes{size, color};
+            break;
+        }
+        case ProductKind::FOOD:
+            attributes = FoodAttributes{reader.readString()};
+            break;
+        case ProductKind::GENERIC:
+            attributes = GenericAttributes{reader.readString()};
+            break;
+        }
+        if (!reader.isOk())
+        {
+            return false;
+        }
+        product = productArena->create(name, desc, price, static_cast<int>(quantity), std::move(attributes), seller);
+        product->setDiscountRate(discount);
+        product->setId(productId);
+        draft.products.push_back(product);
+        draft.sellerProducts[seller].push_back(product);
+        indexProduct(draft, product);
     }
     else
     {
-        // 在所有商品中查找
-        for (Product *p : allProducts)
+        product->setOriginalPrice(price);
+        product->setQuantity(static_cast<int>(quantity));
+        product->setDiscountRate(discount);
+    }
+    // 重放出的变更要写进下一轮快照
+    writer.markDirty(product->getSellerUsername());
+    return true;
+}
+
+void Store::replayMutationLog(ProductCatalog &draft)
+{
+    if (!mutationLog.isOpen())
+    {
+        return;
+    }
+    size_t invalid = 0;
+    auto apply = [this, &draft, &invalid](std::string_view record)
+    {
+        if (!applyProductRecord(draft, record))
         {
-            if (p->getName() == name)
+            invalid++;
+        }
+    };
+    size_t replayed = mutationLog.replay(apply);
+    if (replayed > 0)
+    {
+        cout << "已从商品变更日志重放 " << replayed - invalid << " 条变更" << endl;
+    }
+    if (invalid > 0)
+    {
+        cerr << "警告: 商品变更日志中有 " << invalid << " 条无法识别的记录" << endl;
+    }
+}
+
+string Store::sellerProductKey(const string &sellerUsername, const string &name)
+{
+    return sellerUsername + '\x1f' + name;
+}
+
+// 加入商品索引；同一商家的重复商品只有第一个可被查到，与原先按顺序查找的结果一致。
+// 商品ID与已有商品重复时清零，由 assignMissingProductIds 重新分配
+void Store::indexProduct(ProductCatalog &draft, Product *product)
+{
+    if (product->getId() != 0)
+    {
+        if (draft.byId.emplace(product->getId(), product).second)
+        {
+            if (product->getId() >= nextProductId)
             {
-                return p;
+                nextProductId = product->getId() + 1;
             }
+            draft.searchIndex.addProduct(*product);
+        }
+        else
+        {
+            cerr << "警告: 商品 \"" << product->getName() << "\" 的ID " << product->getId() << " 与其他商品重复，将重新分配" << endl;
+            product->setId(0);
         }
-        return nullptr;
     }
+    draft.byName[product->getName()].push_back(product);
+    draft.suggestIndex.addProduct(product);
+    draft.bySellerAndName.emplace(sellerProductKey(product->getSellerUsername(), product->getName()), product);
 }
 
-// 查找商品（const版本）
-const Product *Store::findProductByName(const string &name, const string &sellerUsername) const
+void Store::unindexProduct(ProductCatalog &draft, Product *product)
 {
+    auto idIt = draft.byId.find(product->getId());
+    if (idIt != draft.byId.end() && idIt->second == product)
+    {
+        draft.byId.erase(idIt);
+        draft.searchIndex.removeProduct(product->getId());
+    }
+    draft.suggestIndex.removeProduct(product);
+    auto it = draft.byName.find(product->getName());
+    if (it != draft.byName.end())
+    {
+        auto &sameName = it->second;
+        sameName.erase(std::remove(sameName.begin(), sameName.end(), product), sameName.end());
+        if (sameName.empty())
+        {
+            draft.byName.erase(it);
+        }
+    }
+    auto keyIt = draft.bySellerAndName.find(sellerProductKey(product->getSellerUsername(), product->getName()));
+    if (keyIt != draft.bySellerAndName.end() && keyIt->second == product)
+    {
+        draft.bySellerAndName.erase(keyIt);
+    }
+}
+
+// 为旧格式文件中没有ID的商品分配ID，返回的商家由调用方在发布后写回文件，之后重启时ID保持不变
+set<string> Store::assignMissingProductIds(ProductCatalog &draft)
+{
+    set<string> sellersToSave;
+    size_t assigned = 0;
+    for (Product *p : draft.products)
+    {
+        if (p->getId() != 0)
+        {
+            continue;
+        }
+        p->setId(nextProductId++);
+        draft.byId.emplace(p->getId(), p);
+        draft.searchIndex.addProduct(*p);
+        sellersToSave.insert(p->getSellerUsername());
+        assigned++;
+    }
+    if (assigned > 0)
+    {
+        cout << "已为 " << assigned << " 件商品分配商品ID" << endl;
+    }
+    return sellersToSave;
+}
+
+bool Store::parseProductId(const string &text, uint64_t &productId)
+{
+    if (text.empty() || text.size() > 19 || !all_of(text.begin(), text.end(), [](unsigned char c)
+                                                     { return isdigit(c) != 0; }))
+    {
+        return false;
+    }
+    productId = stoull(text);
+    return productId != 0;
+}
+
+string Store::productIdText(uint64_t productId, const string &productName)
+{
+    return productId != 0 ? to_string(productId) : productName;
+}
+
+Product *Store::findProductById(uint64_t productId) const
+{
+    const ProductCatalog &current = currentCatalog();
+    auto it = current.byId.find(productId);
+    return it != current.byId.end() ? it->second : nullptr;
+}
+
+// 查找商品
+ProductLookup Store::lookupProduct(const string &productId, const string &sellerUsername, Product *&product) const
+{
+    product = nullptr;
+    uint64_t numericId = 0;
+    if (parseProductId(productId, numericId))
+    {
+        Product *found = findProductById(numericId);
+        if (found && (sellerUsername.empty() || found->getSellerUsername() == sellerUsername))
+        {
+            product = found;
+            return ProductLookup::FOUND;
+        }
+        // 不是已知的ID，可能是纯数字的商品名称，继续按名称查找
+    }
+
+    auto current = getCatalog();
     if (!sellerUsername.empty())
     {
         // 只在指定商家的商品中查找
-        auto it = sellerProducts.find(sellerUsername);
-        if (it != sellerProducts.end())
+        auto it = current->bySellerAndName.find(sellerProductKey(sellerUsername, productId));
+        if (it == current->bySellerAndName.end())
         {
-            for (const Product *p : it->second)
-            {
-                if (p->getName() == name)
-                {
-                    return p;
-                }
-            }
+            return ProductLookup::NOT_FOUND;
         }
-        return nullptr;
+        product = it->second;
+        return ProductLookup::FOUND;
     }
-    else
+
+    auto it = current->byName.find(productId);
+    if (it == current->byName.end() || it->second.empty())
     {
-        // 在所有商品中查找
-        for (const Product *p : allProducts)
+        return ProductLookup::NOT_FOUND;
+    }
+    for (const Product *candidate : it->second)
+    {
+        if (candidate->getSellerUsername() != it->second.front()->getSellerUsername())
         {
-            if (p->getName() == name)
-            {
-                return p;
-            }
+            return ProductLookup::AMBIGUOUS;
         }
-        return nullptr;
     }
+    product = it->second.front();
+    return ProductLookup::FOUND;
+}
+
+Product *Store::resolveProduct(uint64_t productId, const string &productName, const string &sellerUsername) const
+{
+    if (productId != 0)
+    {
+        return findProductById(productId);
+    }
+    auto current = getCatalog();
+    auto it = current->bySellerAndName.find(sellerProductKey(sellerUsername, productName));
+    return it != current->bySellerAndName.end() ? it->second : nullptr;
+}
+
+Product *Store::findProductByName(const string &name, const string &sellerUsername)
+{
+    Product *product = nullptr;
+    if (lookupProduct(name, sellerUsername, product) == ProductLookup::AMBIGUOUS)
+    {
+        cerr << "警告: 多个商家都有名为 \"" << name << "\" 的商品，查找时须指定商家" << endl;
+    }
+    return product;
+}
+
+// 查找商品（const版本）
+const Product *Store::findProductByName(const string &name, const string &sellerUsername) const
+{
+    Product *product = nullptr;
+    if (lookupProduct(name, sellerUsername, product) == ProductLookup::AMBIGUOUS)
+    {
+        cerr << "警告: 多个商家都有名为 \"" << name << "\" 的商品，查找时须指定商家" << endl;
+    }
+    return product;
 }
 
 // 显示所有商品
 void Store::displayAllProducts() const
 {
-    if (allProducts.empty())
+    auto current = getCatalog();
+    if (current->products.empty())
     {
         cout << "\n--- 商品列表为空 ---" << endl;
         return;
@@ -445,7 +1101,7 @@ void Store::displayAllProducts() const
     cout << "\n--- 所有商品列表 ---" << endl;
     int count = 0;
 
-    for (const Product *p : allProducts)
+    for (const Product *p : current->products)
     {
         cout << "--------------------------" << endl;
         p->display();
@@ -459,9 +1115,10 @@ void Store::displayAllProducts() const
 // 显示指定商家的商品
 void Store::displaySellerProducts(const string &sellerUsername) const
 {
-    auto it = sellerProducts.find(sellerUsername);
+    auto current = getCatalog();
+    auto it = current->sellerProducts.find(sellerUsername);
 
-    if (it == sellerProducts.end() || it->second.empty())
+    if (it == current->sellerProducts.end() || it->second.empty())
     {
         cout << "\n--- 商家 \"" << sellerUsername << "\" 没有商品 ---" << endl;
         return;
@@ -486,19 +1143,14 @@ vector<Product *> Store::searchProductsByName(const string &searchTerm, const st
 {
     vector<Product *> results;
 
-    const vector<Product *> &productsToSearch = sellerUsername.empty() ? allProducts : (sellerProducts.count(sellerUsername) ? sellerProducts.at(sellerUsername) : vector<Product *>());
+    auto current = getCatalog();
+    const vector<Product *> &productsToSearch = sellerUsername.empty() ? current->products : (current->sellerProducts.count(sellerUsername) ? current->sellerProducts.at(sellerUsername) : vector<Product *>());
 
+    // 简单的包含搜索 (不区分大小写)
+    string searchTermLower = SearchIndex::normalize(searchTerm);
     for (Product *p : productsToSearch)
     {
-        // 简单的包含搜索 (不区分大小写)
-        string productName = p->getName();
-        string searchTermLower = searchTerm;
-
-        // 将两个字符串转为小写进行比较
-        transform(productName.begin(), productName.end(), productName.begin(), ::tolower);
-        transform(searchTermLower.begin(), searchTermLower.end(), searchTermLower.begin(), ::tolower);
-
-        if (productName.find(searchTermLower) != string::npos)
+        if (SearchIndex::normalize(p->getName()).find(searchTermLower) != string::npos)
         {
             results.push_back(p);
         }
@@ -507,11 +1159,29 @@ vector<Product *> Store::searchProductsByName(const string &searchTerm, const st
     return results;
 }
 
+// 按关键词检索名称、描述和分类
+vector<Product *> Store::searchProducts(const string &keyword, const string &sellerUsername) const
+{
+    // 检索与按ID取商品使用同一个目录版本
+    const ProductCatalog &current = currentCatalog();
+    vector<Product *> results;
+    for (uint64_t productId : current.searchIndex.search(keyword))
+    {
+        auto it = current.byId.find(productId);
+        if (it != current.byId.end() && (sellerUsername.empty() || it->second->getSellerUsername() == sellerUsername))
+        {
+            results.push_back(it->second);
+        }
+    }
+    return results;
+}
+
 // 获取商家的商品
 vector<Product *> Store::getSellerProducts(const string &sellerUsername) const
 {
-    auto it = sellerProducts.find(sellerUsername);
-    return (it != sellerProducts.end()) ? it->second : vector<Product *>();
+    auto current = getCatalog();
+    auto it = current->sellerProducts.find(sellerUsername);
+    return (it != current->sellerProducts.end()) ? it->second : vector<Product *>();
 }
 
 // 创建图书
@@ -547,14 +1217,13 @@ bool Store::createBook(User *currentUser, const string &name, const string &desc
 
     try
     {
-        Book *newBook = new Book(name, desc, price, qty, author, isbn, sellerUsername);
-        allProducts.push_back(newBook);
-
-        // 更新商家商品映射
-        sellerProducts[sellerUsername].push_back(newBook);
+        Product *newBook = productArena->create(name, desc, price, qty, BookAttributes{author, isbn}, sellerUsername);
+        newBook->setId(nextProductId++);
+        addProduct(newBook); // 发布包含新商品的目录版本
+        markProductChanged(newBook);
 
         // 保存商家的商品
-        if (saveProductsForSeller(sellerUsername))
+        if (saveChanges())
         {
             cout << "商品 \"" << name << "\" 添加成功！" << endl;
             return true;
@@ -615,15 +1284,14 @@ bool Store::createClothing(User *currentUser, const string &name, const string &
 
     try
     {
-        Clothing *newClothing = new Clothing(name, desc, price, qty, size, color, sellerUsername);
-        allProducts.push_back(newClothing);
-
-        // 更新商家商品映射
-        sellerProducts[sellerUsername].push_back(newClothing);
+        Product *newClothing = productArena->create(name, desc, price, qty, ClothingAttributes{size, color}, sellerUsername);
+        newClothing->setId(nextProductId++);
+        addProduct(newClothing); // 发布包含新商品的目录版本
+        markProductChanged(newClothing);
 
         // 保存商家的商品
 
-        if (saveProductsForSeller(sellerUsername))
+        if (saveChanges())
         {
             cout << "商品 \"" << name << "\" 添加成功！" << endl;
             return true;
@@ -684,14 +1352,13 @@ bool Store::createFood(User *currentUser, const string &name, const string &desc
 
     try
     {
-        Food *newFood = new Food(name, desc, price, qty, expDate, sellerUsername);
-        allProducts.push_back(newFood);
-
-        // 更新商家商品映射
-        sellerProducts[sellerUsername].push_back(newFood);
+        Product *newFood = productArena->create(name, desc, price, qty, FoodAttributes{expDate}, sellerUsername);
+        newFood->setId(nextProductId++);
+        addProduct(newFood); // 发布包含新商品的目录版本
+        markProductChanged(newFood);
 
         // 保存商家的商品
-        if (saveProductsForSeller(sellerUsername))
+        if (saveChanges())
         {
             cout << "商品 \"" << name << "\" 添加成功！" << endl;
             return true;
@@ -755,22 +1422,21 @@ bool Store::createGenericProduct(User *currentUser, const string &name, const st
 
     try
     {
-        GenericProduct *newGenericProduct = new GenericProduct(name, desc, price, qty, categoryTag, sellerUsername);
-        allProducts.push_back(newGenericProduct);
-        sellerProducts[sellerUsername].push_back(newGenericProduct);
+        Product *newGenericProduct = productArena->create(name, desc, price, qty, GenericAttributes{categoryTag}, sellerUsername);
+        newGenericProduct->setId(nextProductId++);
+        addProduct(newGenericProduct); // 发布包含新商品的目录版本
+        markProductChanged(newGenericProduct);
 
-        if (saveProductsForSeller(sellerUsername))
+        if (saveChanges())
         {
             cout << "通用商品 \"" << name << "\" (分类: " << categoryTag << ") 添加成功！" << endl;
             return true;
         }
         else
         {
-            // 如果保存失败，应该从内存中移除，以保持一致性
-            allProducts.pop_back();
-            sellerProducts[sellerUsername].pop_back();
-            delete newGenericProduct;
-            cout << "通用商品 \"" << name << "\" 添加失败（保存错误）！" << endl;
+            // 与其他种类一致，不从目录中移除：变更记录已在日志缓冲区中，会在日志恢复后写入，
+            // 移除后重放时商品又会出现；没有日志时由写入线程下一轮重试写商家文件
+            cout << "通用商品 \"" << name << "\" 已添加，但保存失败，将自动重试！" << endl;
             return false;
         }
     }
@@ -792,7 +1458,7 @@ bool Store::createGenericProduct(User *currentUser, const string &name, const st
 }
 
 // 修改商品价格
-bool Store::manageProductPrice(User *currentUser, const string &productName, double newPrice)
+bool Store::manageProductPrice(User *currentUser, const string &productId, double newPrice)
 {
     if (!currentUser)
     {
@@ -807,11 +1473,10 @@ bool Store::manageProductPrice(User *currentUser, const string &productName, dou
     }
 
     string sellerUsername = currentUser->getUsername();
-    Product *product = findProductByName(productName, sellerUsername);
-
-    if (!product)
+    Product *product = nullptr;
+    if (lookupProduct(productId, sellerUsername, product) != ProductLookup::FOUND)
     {
-        cerr << "错误: 未找到您的商品 \"" << productName << "\"" << endl;
+        cerr << "错误: 未找到您的商品 \"" << productId << "\"" << endl;
         return false;
     }
 
@@ -822,8 +1487,9 @@ bool Store::manageProductPrice(User *currentUser, const string &productName, dou
     }
 
     product->setOriginalPrice(newPrice);
+    markProductChanged(product);
     // 保存商家的商品
-    if (saveProductsForSeller(sellerUsername))
+    if (saveChanges())
     {
         cout << "价格保存成功！" << endl;
         return true;
@@ -836,7 +1502,7 @@ bool Store::manageProductPrice(User *currentUser, const string &productName, dou
 }
 
 // 修改商品库存
-bool Store::manageProductQuantity(User *currentUser, const string &productName, int newQuantity)
+bool Store::manageProductQuantity(User *currentUser, const string &productId, int newQuantity)
 {
     if (!currentUser)
     {
@@ -851,11 +1517,10 @@ bool Store::manageProductQuantity(User *currentUser, const string &productName,
     }
 
     string sellerUsername = currentUser->getUsername();
-    Product *product = findProductByName(productName, sellerUsername);
-
-    if (!product)
+    Product *product = nullptr;
+    if (lookupProduct(productId, sellerUsername, product) != ProductLookup::FOUND)
     {
-        cerr << "错误: 未找到您的商品 \"" << productName << "\"" << endl;
+        cerr << "错误: 未找到您的商品 \"" << productId << "\"" << endl;
         return false;
     }
 
@@ -866,7 +1531,8 @@ bool Store::manageProductQuantity(User *currentUser, const string &productName,
     }
 
     product->setQuantity(newQuantity);
-    if (saveProductsForSeller(sellerUsername))
+    markProductChanged(product);
+    if (saveChanges())
     {
         cout << "库存修改成功！" << endl;
         return true;
@@ -879,7 +1545,7 @@ bool Store::manageProductQuantity(User *currentUser, const string &productName,
 }
 
 // 修改商品折扣
-bool Store::manageProductDiscount(User *currentUser, const string &productName, double newDiscount)
+bool Store::manageProductDiscount(User *currentUser, const string &productId, double newDiscount)
 {
     if (!currentUser)
     {
@@ -894,11 +1560,10 @@ bool Store::manageProductDiscount(User *currentUser, const string &productName,
     }
 
     string sellerUsername = currentUser->getUsername();
-    Product *product = findProductByName(productName, sellerUsername);
-
-    if (!product)
+    Product *product = nullptr;
+    if (lookupProduct(productId, sellerUsername, product) != ProductLookup::FOUND)
     {
-        cerr << "错误: 未找到您的商品 \"" << productName << "\"" << endl;
+        cerr << "错误: 未找到您的商品 \"" << productId << "\"" << endl;
         return false;
     }
 
@@ -909,14 +1574,16 @@ bool Store::manageProductDiscount(User *currentUser, const string &productName,
     }
 
     product->setDiscountRate(newDiscount);
-    return saveProductsForSeller(sellerUsername);
+    markProductChanged(product);
+    return saveChanges();
 }
 
 std::vector<std::string> Store::getUniqueCategoriesForSeller(const std::string &sellerUsername) const
 {
     std::set<std::string> uniqueCategories;
-    auto it = sellerProducts.find(sellerUsername);
-    if (it != sellerProducts.end())
+    auto current = getCatalog();
+    auto it = current->sellerProducts.find(sellerUsername);
+    if (it != current->sellerProducts.end())
     {
         for (const Product *p : it->second)
         {
@@ -955,143 +1622,127 @@ bool Store::applyCategoryDiscount(User *currentUser, const string &category, dou
     }
 
     string sellerUsername = currentUser->getUsername();
-    bool changed = false; // 只应用折扣到该商家的商品
-    auto it = sellerProducts.find(sellerUsername);
-    if (it != sellerProducts.end())
-    {
-        for (Product *p : it->second)
+    // 只应用折扣到该商家的商品。分类按 getUserCategory 匹配，未设置时按 getType 匹配，
+    // 在列式镜像中按（商家编号, 分类编号）扫描
+    std::vector<Product *> matched = productColumns.selectSellerCategory(sellerUsername, category);
+    if (category == "其他")
+    {
+        // 特殊情况："其他"选择时应用于所有非标准类型商品
+        auto current = getCatalog();
+        auto it = current->sellerProducts.find(sellerUsername);
+        if (it != current->sellerProducts.end())
         {
-            // 修复类别折扣匹配问题：使用getUserCategory()而不是getType()来匹配
-            std::string productCategory = p->getUserCategory();
-            if (!productCategory.empty())
-            {
-                // 使用用户定义的类别进行匹配
-                if (productCategory == category)
-                {
-                    p->setDiscountRate(discount);
-                    changed = true;
-                }
-            }
-            else
+            for (Product *p : it->second)
             {
-                // 处理标准类型以及自定义类型
-                if (p->getType() == category)
-                {
-                    p->setDiscountRate(discount);
-                    changed = true;
-                }
-                // 处理特殊情况："其他"选择时应用于所有非标准类型商品
-                else if (category == "其他" && p->getType() != "Book" && p->getType() != "Clothing" && p->getType() != "Food")
+                if (p->getKind() == ProductKind::GENERIC && p->getUserCategory().empty())
                 {
-                    p->setDiscountRate(discount);
-                    changed = true;
+                    matched.push_back(p);
                 }
             }
         }
     }
 
+    bool changed = !matched.empty();
+    for (Product *p : matched)
+    {
+        p->setDiscountRate(discount);
+        markProductChanged(p);
+    }
+
     if (changed)
     {
-        return saveProductsForSeller(sellerUsername);
+        return saveChanges();
     }
 
     cerr << "错误: 未找到分类为 \"" << category << "\" 的商品" << endl;
     return false;
 }
 
-// 库存锁定功能实现
-bool Store::lockInventory(const std::string &productName, int quantity)
+// 商品目录版本跟踪
+void Store::markProductChanged(const Product *product)
 {
-    std::lock_guard<std::mutex> lock(inventoryMutex);
-
-    // 查找商品
-    Product *product = findProductByName(productName);
-    if (!product)
     {
-        std::cerr << "商品不存在: " << productName << std::endl;
-        return false;
+        std::lock_guard<std::mutex> recordLock(productRecordMutexes[product->getId() % kProductRecordStripes]);
+        productColumns.update(product);
+        // 先标记再追加：日志压缩时，已写入旧日志段的变更一定属于本轮要写出的商家
+        writer.markDirty(product->getSellerUsername());
+        mutationLog.append(encodeProductRecord(product));
     }
-
-    // 检查可用库存（实际库存 - 已锁定库存）
-    int currentLocked = 0;
-    auto it = lockedInventory.find(productName);
-    if (it != lockedInventory.end())
+    std::lock_guard<std::mutex> lock(catalogMutex);
+    uint64_t version = ++catalogVersion;
+    catalogLog.push_back(CatalogChange{version, product, std::to_string(product->getId()), product->getSellerUsername()});
+    if (catalogLog.size() > kMaxCatalogChanges)
     {
-        currentLocked = it->second;
+        catalogLogStart = catalogLog.front().version;
+        catalogLog.pop_front();
     }
+}
 
-    int availableInventory = product->getQuantity() - currentLocked;
-    if (availableInventory < quantity)
+bool Store::getChangesSince(uint64_t sinceVersion, std::vector<CatalogChange> &changes, uint64_t &currentVersion) const
+{
+    std::lock_guard<std::mutex> lock(catalogMutex);
+    currentVersion = catalogVersion.load();
+    if (sinceVersion < catalogLogStart || sinceVersion > currentVersion)
     {
-        std::cerr << "库存不足，无法锁定。商品: " << productName
-                  << ", 总库存: " << product->getQuantity()
-                  << ", 已锁定: " << currentLocked
-                  << ", 可用: " << availableInventory
-                  << ", 请求锁定: " << quantity << std::endl;
         return false;
     }
 
-    // 锁定库存
-    lockedInventory[productName] = currentLocked + quantity;
-
-    std::cout << "库存锁定成功: " << productName
-              << ", 锁定数量: " << quantity
-              << ", 总锁定: " << lockedInventory[productName] << std::endl;
-
+    auto first = std::upper_bound(catalogLog.begin(), catalogLog.end(), sinceVersion,
+                                  [](uint64_t version, const CatalogChange &change)
+                                  { return version < change.version; });
+    changes.assign(first, catalogLog.end());
     return true;
 }
 
-bool Store::unlockInventory(const std::string &productName, int quantity)
+// 库存锁定功能实现：按ID查找走无锁的目录版本，锁定与解锁是商品自身计数上的 CAS，
+// 不同商品之间没有共享的锁；低库存扫描时才把锁定数量读入列式镜像
+bool Store::lockInventory(uint64_t productId, int quantity)
 {
-    std::lock_guard<std::mutex> lock(inventoryMutex);
-
-    auto it = lockedInventory.find(productName);
-    if (it == lockedInventory.end())
+    Product *product = findProductById(productId);
+    if (!product)
     {
-        std::cerr << "没有找到锁定的库存: " << productName << std::endl;
+        std::cerr << "商品不存在: " << productId << std::endl;
         return false;
     }
-
-    if (it->second < quantity)
+    if (quantity < 0)
     {
-        std::cerr << "解锁数量超过锁定数量。商品: " << productName
-                  << ", 锁定数量: " << it->second
-                  << ", 请求解锁: " << quantity << std::endl;
+        std::cerr << "无效的锁定数量: " << quantity << std::endl;
         return false;
     }
 
-    // 解锁库存
-    it->second -= quantity;
-
-    // 如果锁定数量为0，从map中移除
-    if (it->second <= 0)
+    if (!product->tryReserve(quantity))
     {
-        lockedInventory.erase(it);
+        std::cerr << "库存不足，无法锁定。商品: " << product->getName()
+                  << ", 总库存: " << product->getQuantity()
+                  << ", 已锁定: " << product->getReserved()
+                  << ", 可用: " << product->getAvailable()
+                  << ", 请求锁定: " << quantity << std::endl;
+        return false;
     }
-
-    std::cout << "库存解锁成功: " << productName
-              << ", 解锁数量: " << quantity << std::endl;
-
     return true;
 }
 
-bool Store::hasAvailableInventory(const std::string &productName, int quantity) const
+bool Store::unlockInventory(uint64_t productId, int quantity)
 {
-    std::lock_guard<std::mutex> lock(inventoryMutex);
-
-    const Product *product = findProductByName(productName);
-    if (!product)
+    Product *product = findProductById(productId);
+    if (!product || product->getReserved() == 0)
     {
+        std::cerr << "没有找到锁定的库存: " << productId << std::endl;
         return false;
     }
 
-    int currentLocked = 0;
-    auto it = lockedInventory.find(productName);
-    if (it != lockedInventory.end())
+    if (!product->release(quantity))
     {
-        currentLocked = it->second;
+        std::cerr << "解锁数量超过锁定数量。商品: " << productId
+                  << ", 锁定数量: " << product->getReserved()
+                  << ", 请求解锁: " << quantity << std::endl;
+        return false;
     }
+    return true;
+}
 
-    int availableInventory = product->getQuantity() - currentLocked;
-    return availableInventory >= quantity;
-}
\ No newline at end of file
+bool Store::hasAvailableInventory(uint64_t productId, int quantity) const
+{
+    const Product *product = findProductById(productId);
+    return product && product->getAvailable() >= quantity;
+}
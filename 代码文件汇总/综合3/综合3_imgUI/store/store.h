@@ -9,161 +9,317 @@
 #include <iomanip>
 #include <limits>
 #include <map>
+#include <unordered_map>
+#include <deque>
 #include <filesystem>
+#include <memory>
 #include <mutex>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <variant>
 #include "../user/user.h"
+#include "search_index.h"
+#include "suggest_index.h"
+#include "product_columns.h"
+#include "object_pool.h"
+#include "store_writer.h"
+#include "mutation_log.h"
 #include <algorithm>
 #include <set>
+#ifdef _WIN32
 #include <direct.h> // Windows 系统特定的目录操作
+#else
+#include <sys/stat.h>
+#endif
 
 // 前向声明 User
 class User;
+class ProductArena;
 
-// --- Product 基类和派生类 ---
+// --- 商品记录 ---
+// 商品种类，值与 ProductAttributes 中各备选类型的下标一致
+enum class ProductKind : uint8_t
+{
+    BOOK,
+    CLOTHING,
+    FOOD,
+    GENERIC
+};
+
+// 各种类商品特有的字段
+struct BookAttributes
+{
+    std::string author;
+    std::string isbn;
+};
+
+struct ClothingAttributes
+{
+    std::string size;
+    std::string color;
+};
+
+struct FoodAttributes
+{
+    std::string expirationDate;
+};
+
+struct GenericAttributes
+{
+    std::string categoryTag; // 用户自定义的分类标签
+};
+
+using ProductAttributes = std::variant<BookAttributes, ClothingAttributes, FoodAttributes, GenericAttributes>;
+
+// 种类在商家文件和协议中的名称（"Book"、"Clothing"、"Food"、"Generic"）
+const std::string &productKindName(ProductKind kind);
+bool parseProductKind(const std::string &name, ProductKind &kind);
+
+// 扁平的商品记录：公共字段加上按种类区分的 variant，没有虚函数。
+// 列表、折扣等循环里取价格、种类、分类都是内联调用，不产生临时字符串。
+// 商品发布到目录后，名称、描述、商家和种类字段不再修改，读者可以直接引用；
+// 价格、折扣、库存由商家管理和订单处理原地修改、读者不加锁读取，因此都是原子变量
 class Product
 {
-protected:
+private:
+    uint64_t id; // 由 Store 分配的商品ID，保存在商家文件中，0 表示尚未分配；只在发布前设置
     std::string name;
     std::string description;
-    double originalPrice;
-    int quantity;
-    double discountRate;
+    std::atomic<double> originalPrice;
+    // 库存（低 32 位）与已锁定数量（高 32 位）放在同一个原子字里，
+    // 锁定时一次 CAS 同时看到两者，不需要锁；不同商品的锁定互不争用
+    std::atomic<uint64_t> stock;
+    std::atomic<double> discountRate;
     std::string sellerUsername; // 添加商品所属商家
+    ProductAttributes attributes;
+
+    static uint64_t packStock(int quantity, int reserved)
+    {
+        return static_cast<uint32_t>(quantity) | static_cast<uint64_t>(static_cast<uint32_t>(reserved)) << 32;
+    }
+    static int stockQuantity(uint64_t packed) { return static_cast<int32_t>(static_cast<uint32_t>(packed)); }
+    static int stockReserved(uint64_t packed) { return static_cast<int32_t>(static_cast<uint32_t>(packed >> 32)); }
 
 public:
-    Product(std::string name, std::string desc, double price, int qty, std::string seller = "")
-        : name(name), description(desc), originalPrice(price), quantity(qty),
-          discountRate(0.0), sellerUsername(seller) {}
-    virtual ~Product() = default;
-    virtual double getPrice() const { return originalPrice * (1.0 - discountRate); }
-    virtual void display() const;
-    virtual std::string getType() const = 0;
-    virtual std::string getUserCategory() const { return ""; } // 默认返回空字符串
-    virtual void save(std::ofstream &ofs) const;
+    Product(std::string name, std::string desc, double price, int qty, ProductAttributes attrs, std::string seller = "")
+        : id(0), name(std::move(name)), description(std::move(desc)), originalPrice(price), stock(packStock(qty, 0)),
+          discountRate(0.0), sellerUsername(std::move(seller)), attributes(std::move(attrs)) {}
+
+    double getPrice() const { return getOriginalPrice() * (1.0 - getDiscountRate()); }
+    void display() const;
+    void save(std::ofstream &ofs) const;
+
+    ProductKind getKind() const { return static_cast<ProductKind>(attributes.index()); }
+    const std::string &getType() const { return productKindName(getKind()); }
+    // 用户可见的分类：自定义商品为分类标签，其他种类为种类名称
+    const std::string &getUserCategory() const
+    {
+        const GenericAttributes *generic = std::get_if<GenericAttributes>(&attributes);
+        return generic ? generic->categoryTag : getType();
+    }
+    const ProductAttributes &getAttributes() const { return attributes; }
+    // 种类特有字段；种类不符时返回 nullptr
+    template <typename Attributes>
+    const Attributes *getAttributesAs() const { return std::get_if<Attributes>(&attributes); }
 
     // Getters and Setters
-    std::string getName() const { return name; }
-    std::string getDescription() const { return description; }
-    double getOriginalPrice() const { return originalPrice; }
-    int getQuantity() const { return quantity; }
-    double getDiscountRate() const { return discountRate; }
-    std::string getSellerUsername() const { return sellerUsername; } // 获取商品所属商家
-
-    void setName(const std::string &newName) { name = newName; }
-    void setDescription(const std::string &newDesc) { description = newDesc; }
+    uint64_t getId() const { return id; }
+    const std::string &getName() const { return name; }
+    const std::string &getDescription() const { return description; }
+    double getOriginalPrice() const { return originalPrice.load(); }
+    int getQuantity() const { return stockQuantity(stock.load()); }
+    int getReserved() const { return stockReserved(stock.load()); }
+    // 可售库存：库存减去已锁定数量
+    int getAvailable() const
+    {
+        uint64_t packed = stock.load();
+        return stockQuantity(packed) - stockReserved(packed);
+    }
+    double getDiscountRate() const { return discountRate.load(); }
+    const std::string &getSellerUsername() const { return sellerUsername; } // 获取商品所属商家
+
+    void setId(uint64_t newId) { id = newId; }
     void setOriginalPrice(double newPrice)
     {
         if (newPrice >= 0)
-            originalPrice = newPrice;
+            originalPrice.store(newPrice);
     }
+    // 只改库存，保留已锁定数量
     void setQuantity(int newQuantity)
     {
-        if (newQuantity >= 0)
-            quantity = newQuantity;
+        if (newQuantity < 0)
+            return;
+        uint64_t packed = stock.load();
+        while (!stock.compare_exchange_weak(packed, packStock(newQuantity, stockReserved(packed))))
+        {
+        }
+    }
+    // 锁定 amount 件可售库存；可售库存不足时不做修改并返回 false
+    bool tryReserve(int amount)
+    {
+        uint64_t packed = stock.load();
+        do
+        {
+            if (amount < 0 || stockQuantity(packed) - stockReserved(packed) < amount)
+                return false;
+        } while (!stock.compare_exchange_weak(packed, packStock(stockQuantity(packed), stockReserved(packed) + amount)));
+        return true;
+    }
+    // 释放已锁定的库存；超过已锁定数量时不做修改并返回 false
+    bool release(int amount)
+    {
+        uint64_t packed = stock.load();
+        do
+        {
+            if (amount < 0 || stockReserved(packed) < amount)
+                return false;
+        } while (!stock.compare_exchange_weak(packed, packStock(stockQuantity(packed), stockReserved(packed) - amount)));
+        return true;
+    }
+    // 售出 amount 件：其中 fromReserved 件消耗买家自己的预留，其余只能取自可售库存（别人锁定的不动）。
+    // 库存与锁定数量在一次 CAS 中同时扣减；不满足条件时不做修改并返回 false
+    bool tryConsume(int amount, int fromReserved = 0)
+    {
+        uint64_t packed = stock.load();
+        do
+        {
+            int quantity = stockQuantity(packed);
+            int reserved = stockReserved(packed);
+            if (amount < 0 || fromReserved < 0 || fromReserved > amount || reserved < fromReserved ||
+                quantity - reserved < amount - fromReserved)
+                return false;
+        } while (!stock.compare_exchange_weak(packed, packStock(stockQuantity(packed) - amount, stockReserved(packed) - fromReserved)));
+        return true;
+    }
+    // 撤销 tryConsume：库存与锁定数量按原样加回
+    void restock(int amount, int fromReserved = 0)
+    {
+        uint64_t packed = stock.load();
+        while (!stock.compare_exchange_weak(packed, packStock(stockQuantity(packed) + amount, stockReserved(packed) + fromReserved)))
+        {
+        }
     }
     void setDiscountRate(double newRate)
     {
         if (newRate >= 0.0 && newRate <= 1.0)
-            discountRate = newRate;
+            discountRate.store(newRate);
     }
-    void setSellerUsername(const std::string &seller) { sellerUsername = seller; } // 设置商品所属商家
 };
 
-class Book : public Product
+// 目录变更日志中的一条记录。product 只用于比较，商品可能已不存在，不能解引用
+struct CatalogChange
 {
-private:
-    std::string author;
-    std::string isbn;
-
-public:
-    Book(std::string name, std::string desc, double price, int qty,
-         std::string auth, std::string isbn_num, std::string seller = "")
-        : Product(name, desc, price, qty, seller), author(auth), isbn(isbn_num) {}
-    std::string getType() const override { return "Book"; }
-    std::string getUserCategory() const override { return "Book"; } // 固定类型为 "Book"
-    void display() const override;
-    void save(std::ofstream &ofs) const override;
-
-    // 新增的 getters
-    std::string getAuthor() const { return author; }
-    std::string getIsbn() const { return isbn; }
+    uint64_t version;
+    const Product *product;
+    std::string productId;
+    std::string sellerUsername;
 };
 
-class Clothing : public Product
+// 按商品ID查找的结果：未指定商家而多个商家有同名商品时为 AMBIGUOUS，调用方须带上商家重新查找
+enum class ProductLookup
 {
-private:
-    std::string size;
-    std::string color;
-
-public:
-    Clothing(std::string name, std::string desc, double price, int qty,
-             std::string sz, std::string clr, std::string seller = "")
-        : Product(name, desc, price, qty, seller), size(sz), color(clr) {}
-    std::string getType() const override { return "Clothing"; }
-    std::string getUserCategory() const override { return "Clothing"; } // 固定类型为 "Clothing"
-    void display() const override;
-    void save(std::ofstream &ofs) const override;
-
-    // 新增的 getters
-    std::string getSize() const { return size; }
-    std::string getColor() const { return color; }
+    FOUND,
+    NOT_FOUND,
+    AMBIGUOUS
 };
 
-class Food : public Product
+// 商品目录的一个不可变版本：商品列表、商家商品映射、按ID和名称查找的索引，以及搜索、联想索引。
+// 发布后不再修改，读者取得版本指针后不加锁读取；增删商品时复制出新版本再发布（见 Store::getCatalog）。
+// 商品对象中可变的只有价格、折扣、库存三个原子字段（见 Product）
+struct ProductCatalog
 {
-private:
-    std::string expirationDate;
-
-public:
-    Food(std::string name, std::string desc, double price, int qty,
-         std::string expDate, std::string seller = "")
-        : Product(name, desc, price, qty, seller), expirationDate(expDate) {}
-    std::string getType() const override { return "Food"; }
-    std::string getUserCategory() const override { return "Food"; } // 固定类型为 "Food"
-    void display() const override;
-    void save(std::ofstream &ofs) const override;
-
-    // 新增的 getters
-    std::string getExpirationDate() const { return expirationDate; }
+    std::vector<Product *> products;                              // 所有商家的商品
+    std::map<std::string, std::vector<Product *>> sellerProducts; // 每个商家的商品
+    std::unordered_map<uint64_t, Product *> byId;
+    std::unordered_map<std::string, std::vector<Product *>> byName; // 名称 -> 各商家的同名商品
+    std::unordered_map<std::string, Product *> bySellerAndName;     // 商家+名称 -> 商品
+    SearchIndex searchIndex;                                        // 名称、描述、分类的倒排索引
+    SuggestIndex suggestIndex;                                      // 名称前缀联想
 };
 
-// 自定义商品类
-class GenericProduct : public Product
+// 最近一次加载商品的各阶段耗时（毫秒）
+struct StoreLoadTimings
 {
-private:
-    std::string categoryTag; // 用户自定义的分类标签
-
-public:
-    GenericProduct(std::string name, std::string desc, double price, int qty,
-                   std::string tag, std::string seller = "")
-        : Product(name, desc, price, qty, seller), categoryTag(tag) {}
-
-    std::string getType() const override { return "Generic"; }           // 固定类型为 "Generic"
-    std::string getUserCategory() const override { return categoryTag; } // 返回用户自定义标签
-    void display() const override;
-    void save(std::ofstream &ofs) const override;
-
-    // Getter for categoryTag
-    std::string getCategoryTag() const { return categoryTag; }
-    void setCategoryTag(const std::string &tag) { categoryTag = tag; }
+    bool fromSnapshot = false; // 从二进制快照加载，否则从商家文件导入
+    size_t products = 0;
+    size_t parseThreads = 0;   // 解析商家文件使用的线程数
+    double readMs = 0.0;       // 映射快照或解析商家文件并创建商品
+    double indexMs = 0.0;      // 加入商品列表并建立各索引
+    double snapshotMs = 0.0;   // 导入后写出快照
+    double replayMs = 0.0;     // 重放变更日志
+    double totalMs = 0.0;
 };
 
 // --- Store Class ---
 class Store
 {
 private:
-    std::vector<Product *> allProducts;                           // 存储所有商家的商品
-    std::map<std::string, std::vector<Product *>> sellerProducts; // 每个商家的商品映射
-    std::string storeDirectory;                                   // 商品文件所在目录
-
-    // 库存锁定数据结构
-    std::map<std::string, int> lockedInventory; // 商品名称 -> 锁定数量
-    mutable std::mutex inventoryMutex;          // 保护库存锁定操作的互斥锁
+    std::string storeDirectory;                 // 商品文件所在目录
+    std::unique_ptr<ProductArena> productArena; // 所有商品对象的分配区，重新加载时整代释放
+    StoreLoadTimings loadTimings;
+
+    // 当前发布的商品目录版本，通过 std::atomic_load/atomic_store 访问。
+    // 商品对象不随旧版本释放：读者可能仍持有旧版本中的指针，商品只在重新加载时随分配区整代释放
+    std::shared_ptr<const ProductCatalog> catalog;
+    // 每次发布取一个全局递增（所有 Store 实例之间也不重复）的代号。
+    // atomic_load 在 libstdc++ 中按地址取一把全局锁，热路径改用 currentCatalog：代号未变时直接用本线程缓存的版本
+    std::atomic<uint64_t> catalogGeneration;
+    std::atomic<uint64_t> nextProductId; // 下一个分配的商品ID
+    ProductColumns productColumns;       // 价格、库存等数值字段的列式镜像，供批量扫描；随目录版本发布重建
+
+    // 商品目录版本：商品展示数据（价格、库存、折扣、新增商品）每变化一次递增一次，
+    // 变更记入有界的变更日志，供目录快照增量重建和客户端增量同步使用
+    std::atomic<uint64_t> catalogVersion;
+    uint64_t catalogEpoch;                 // 本次进程加载目录的标识，服务端重启后版本号不可比较
+    std::deque<CatalogChange> catalogLog;  // 按版本递增
+    uint64_t catalogLogStart;              // 日志覆盖 (catalogLogStart, catalogVersion] 区间内的全部变更
+    mutable std::mutex catalogMutex;
+    static const size_t kMaxCatalogChanges = 4096;
+
+    // 商品目录的修改：复制当前版本、修改后发布，同一时间只有一个修改者；读者不加锁
+    std::mutex catalogWriteMutex;
+    std::mutex sellerFileMutex; // 同一时间只写一个商家文件
+    StoreWriter writer;         // 记录有未保存变更的商家，见 StoreWriter
+    friend class StoreWriter;
+    // 商品变更日志：商家文件与二进制目录快照之后的每次变更追加一条完整的商品记录，启动时重放。
+    // 写入线程每写完一轮快照就删除已被快照包含的日志段
+    MutationLog mutationLog;
+    // 同一商品的变更记录必须按状态先后追加：列式镜像的更新、记录的编码与追加在按商品ID分条的锁内完成，
+    // 并发修改同一商品时，后追加的记录读到的状态不会比先追加的旧，重放后得到最新状态
+    static const size_t kProductRecordStripes = 64;
+    std::mutex productRecordMutexes[kProductRecordStripes];
 
     // 辅助方法
     std::string getSellerFilename(const std::string &username) const;
+    static std::string sellerProductKey(const std::string &sellerUsername, const std::string &name);
+    // 在尚未发布的目录版本上维护查找、搜索与联想索引
+    void indexProduct(ProductCatalog &draft, Product *product);
+    void unindexProduct(ProductCatalog &draft, Product *product);
+    // 返回需要写回商家文件的商家
+    std::set<std::string> assignMissingProductIds(ProductCatalog &draft);
+    // 发布前归并联想索引的新键并重建列式镜像
+    void publishCatalog(std::shared_ptr<ProductCatalog> next);
+    // 本线程缓存的当前版本，只在本线程下一次调用前有效；调用方持有引用期间不能再间接调用它
+    const ProductCatalog &currentCatalog() const;
+    // 写时复制地加入、移除单个商品
+    void addProduct(Product *product);
+    void removeProduct(Product *product);
 
     bool saveProductsForSeller(const std::string &sellerUsername);
+    bool parseSellerFile(const std::string &sellerUsername, std::vector<Product *> &products);
+    void mergeSellerProducts(ProductCatalog &draft, const std::string &sellerUsername, const std::vector<Product *> &products);
+    size_t loadSellerFilesParallel(ProductCatalog &draft, const std::vector<std::string> &sellers, double &parseMs, double &indexMs);
+    // 二进制商品目录快照（见 CatalogFile），商家文本文件仍是导入、导出格式
+    std::string getCatalogSnapshotFilename() const;
+    bool catalogSnapshotIsCurrent() const;
+    bool loadCatalogSnapshot(ProductCatalog &draft, double &readMs, double &indexMs);
+    bool saveCatalogSnapshot();
+    // 商品记录的编码与重放；重放不再写日志
+    static std::string encodeProductRecord(const Product *product);
+    bool applyProductRecord(ProductCatalog &draft, std::string_view record);
+    void replayMutationLog(ProductCatalog &draft);
     bool ensureDirectoryExists(const std::string &path) const;
 
 public:
@@ -171,6 +327,13 @@ public:
     Store(const std::string &directory);
     ~Store();
 
+    Product *findProductById(uint64_t productId) const;
+    // 按请求中的商品标识查找：数字按商品ID查找，否则按名称查找（兼容旧客户端），
+    // sellerUsername 为空时在所有商家中查找
+    ProductLookup lookupProduct(const std::string &productId, const std::string &sellerUsername, Product *&product) const;
+    // 按ID查找；ID为0（分配ID之前保存的购物车、订单）时按名称和商家查找
+    Product *resolveProduct(uint64_t productId, const std::string &productName, const std::string &sellerUsername) const;
+    // 同 lookupProduct；找不到或未指定商家而存在多个同名商品时返回 nullptr，不会返回其他商家的同名商品
     Product *findProductByName(const std::string &name, const std::string &sellerUsername = "");
     const Product *findProductByName(const std::string &name, const std::string &sellerUsername = "") const;
 
@@ -178,6 +341,16 @@ public:
     bool loadAllProducts();
     bool loadSellerProducts(const std::string &sellerUsername);
     bool saveAllProducts();
+    const StoreLoadTimings &getLoadTimings() const { return loadTimings; }
+    // 商品变更的持久化：markProductChanged 把变更追加到变更日志并记下有变更的商家，不立即写商家文件。
+    // saveChanges 等待日志落盘（日志不可用时退回为写商家文件）；
+    // startWriteBehind 之后由后台线程按间隔或积压阈值写出商家文件快照并压缩日志；
+    // flush 总是立即写出全部未保存变更（关闭前调用）
+    void startWriteBehind(const StoreWriter::Options &options);
+    bool saveChanges();
+    bool flush();
+    StoreWriter::Stats getWriterStats() const { return writer.getStats(); }
+    MutationLog::Stats getMutationLogStats() const { return mutationLog.getStats(); }
 
     // 显示功能
     void displayAllProducts() const;                                     // 显示所有商品
@@ -185,6 +358,28 @@ public:
 
     // 搜索功能
     std::vector<Product *> searchProductsByName(const std::string &searchTerm, const std::string &sellerUsername = "") const;
+    // 在名称、描述和分类中检索关键词（见 SearchIndex），按商品ID顺序返回
+    std::vector<Product *> searchProducts(const std::string &keyword, const std::string &sellerUsername = "") const;
+    SearchIndex::Stats getSearchIndexStats() const { return getCatalog()->searchIndex.getStats(); }
+    PoolStats getProductPoolStats() const;
+    // 按名称前缀给出至多 limit 条联想，按同名商品的总库存从多到少排列
+    std::vector<SuggestIndex::Suggestion> suggestProducts(const std::string &prefix, size_t limit) const
+    {
+        return currentCatalog().suggestIndex.suggest(prefix, limit);
+    }
+    // 基于列式镜像的批量扫描（见 ProductColumns），结果不保证顺序
+    std::vector<Product *> findLowStockProducts(int threshold, const std::string &sellerUsername = "") const
+    {
+        return productColumns.selectLowStock(threshold, sellerUsername);
+    }
+    std::vector<Product *> findProductsInPriceRange(double minPrice, double maxPrice) const
+    {
+        return productColumns.selectPriceRange(minPrice, maxPrice);
+    }
+    std::vector<Product *> findDiscountedProducts(double minDiscountRate) const
+    {
+        return productColumns.selectDiscountAtLeast(minDiscountRate);
+    }
 
     // 商家商品管理功能
     bool createBook(User *currentUser, const std::string &name, const std::string &desc,
@@ -196,20 +391,37 @@ public:
     bool createGenericProduct(User *currentUser, const std::string &name, const std::string &desc,
                               double price, int qty, const std::string &categoryTag);
 
-    bool manageProductPrice(User *currentUser, const std::string &productName, double newPrice);
-    bool manageProductQuantity(User *currentUser, const std::string &productName, int newQuantity);
-    bool manageProductDiscount(User *currentUser, const std::string &productName, double newDiscount);
+    // productId 为商品ID或名称（见 lookupProduct），只在当前商家自己的商品中查找
+    bool manageProductPrice(User *currentUser, const std::string &productId, double newPrice);
+    bool manageProductQuantity(User *currentUser, const std::string &productId, int newQuantity);
+    bool manageProductDiscount(User *currentUser, const std::string &productId, double newDiscount);
     bool applyCategoryDiscount(User *currentUser, const std::string &category, double discount); // 获取商品
-    const std::vector<Product *> &getProducts() const { return allProducts; }
+    // 当前目录版本；持有期间其中的容器不会变化，其他线程发布的新版本不影响已取得的版本
+    std::shared_ptr<const ProductCatalog> getCatalog() const { return std::atomic_load(&catalog); }
+    std::vector<Product *> getProducts() const { return getCatalog()->products; }
     std::vector<Product *> getSellerProducts(const std::string &sellerUsername) const;
 
     // 获取商家商品的唯一分类
     std::vector<std::string> getUniqueCategoriesForSeller(const std::string &sellerUsername) const;
 
-    // 库存锁定功能
-    bool lockInventory(const std::string &productName, int quantity);
-    bool unlockInventory(const std::string &productName, int quantity);
-    bool hasAvailableInventory(const std::string &productName, int quantity) const;
+    // 商品目录版本
+    uint64_t getCatalogVersion() const { return catalogVersion.load(); }
+    uint64_t getCatalogEpoch() const { return catalogEpoch; }
+    // 在商品字段被修改后调用（包括 Store 之外的修改，如订单处理扣减库存）
+    void markProductChanged(const Product *product);
+    // 获取 sinceVersion 之后的全部变更（同一商品可能出现多次）以及当前版本。
+    // 日志已被截断或商品整体重新加载过、无法给出完整变更时返回 false，调用方应改为全量
+    bool getChangesSince(uint64_t sinceVersion, std::vector<CatalogChange> &changes, uint64_t &currentVersion) const;
+
+    // 商品ID的文本形式；解析失败（如旧数据中的商品名称）时返回 false
+    static bool parseProductId(const std::string &text, uint64_t &productId);
+    // 保存和发送用的商品标识：ID为0的旧数据以名称代替
+    static std::string productIdText(uint64_t productId, const std::string &productName);
+
+    // 库存锁定：锁定数量记在商品自身的原子计数上（见 Product::tryReserve），不加全局锁
+    bool lockInventory(uint64_t productId, int quantity);
+    bool unlockInventory(uint64_t productId, int quantity);
+    bool hasAvailableInventory(uint64_t productId, int quantity) const;
 };
 
 #endif // STORE_H
\ No newline at end of file
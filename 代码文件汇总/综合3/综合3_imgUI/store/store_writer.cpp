@@ -0,0 +1,219 @@
+#include "store_writer.h"
+#include "store.h"
+#include <iostream>
+#include <vector>
+
+StoreWriter::StoreWriter(Store &store)
+    : store(store), running(false), stopping(false), pendingChanges(0),
+      flushCount(0), sellerFilesWritten(0), changesWritten(0), failedWrites(0),
+      lastFlushNs(0), totalFlushNs(0), maxFlushNs(0)
+{
+}
+
+StoreWriter::~StoreWriter()
+{
+    stop();
+}
+
+void StoreWriter::start(const Options &newOptions)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (running)
+    {
+        return;
+    }
+    options = newOptions;
+    running = true;
+    stopping = false;
+    thread = std::thread(&StoreWriter::run, this);
+}
+
+void StoreWriter::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!running)
+        {
+            return;
+        }
+        stopping = true;
+    }
+    wakeCondition.notify_all();
+    if (thread.joinable())
+    {
+        thread.join();
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    running = false;
+}
+
+bool StoreWriter::isRunning() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return running && !stopping;
+}
+
+void StoreWriter::markDirty(const std::string &sellerUsername)
+{
+    if (sellerUsername.empty())
+    {
+        return;
+    }
+    bool wake = false;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (pendingChanges == 0)
+        {
+            oldestPending = Clock::now();
+        }
+        dirtySellers[sellerUsername]++;
+        pendingChanges++;
+        // 第一条变更让空闲的写入线程开始计时，达到阈值时让它提前写入
+        wake = running && (pendingChanges == 1 || pendingChanges == options.maxPendingChanges);
+    }
+    if (wake)
+    {
+        wakeCondition.notify_one();
+    }
+}
+
+void StoreWriter::markClean(const std::string &sellerUsername)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = dirtySellers.find(sellerUsername);
+    if (it != dirtySellers.end())
+    {
+        pendingChanges -= it->second;
+        dirtySellers.erase(it);
+    }
+}
+
+bool StoreWriter::flush()
+{
+    std::lock_guard<std::mutex> flushLock(flushMutex);
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (dirtySellers.empty())
+        {
+            return true;
+        }
+    }
+
+    // 先切换日志段再取走标记：旧段中的每条变更都在取走标记之前标记过商家，
+    // 本轮写出的商家文件包含了这些变更，全部写入成功后旧段可以删除
+    bool compactLog = store.mutationLog.isOpen();
+    uint64_t checkpoint = compactLog ? store.mutationLog.rotate() : 0;
+
+    std::unordered_map<std::string, size_t> sellers;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        sellers.swap(dirtySellers);
+        pendingChanges = 0;
+    }
+
+    // 先取走标记再写文件：写入期间产生的新变更会重新标记，留到下一轮
+    auto start = Clock::now();
+    std::vector<std::pair<std::string, size_t>> failed;
+    size_t written = 0;
+    for (const auto &seller : sellers)
+    {
+        if (store.saveProductsForSeller(seller.first))
+        {
+            written += seller.second;
+        }
+        else
+        {
+            failed.push_back(seller);
+        }
+    }
+    // 二进制目录快照每轮整体重写，下次启动直接映射
+    bool catalogSaved = store.saveCatalogSnapshot();
+    if (compactLog && failed.empty() && catalogSaved)
+    {
+        store.mutationLog.removeSegmentsBefore(checkpoint);
+    }
+    int64_t elapsedNs = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count();
+
+    std::lock_guard<std::mutex> lock(mutex);
+    for (const auto &seller : failed)
+    {
+        if (pendingChanges == 0)
+        {
+            oldestPending = start;
+        }
+        dirtySellers[seller.first] += seller.second;
+        pendingChanges += seller.second;
+    }
+    flushCount++;
+    sellerFilesWritten += sellers.size() - failed.size();
+    changesWritten += written;
+    failedWrites += failed.size();
+    lastFlushNs = elapsedNs;
+    totalFlushNs += elapsedNs;
+    if (elapsedNs > maxFlushNs)
+    {
+        maxFlushNs = elapsedNs;
+    }
+    if (!failed.empty())
+    {
+        std::cerr << "商品文件写入失败: " << failed.size() << " 个商家，将在下一轮重试" << std::endl;
+    }
+    return failed.empty();
+}
+
+StoreWriter::Stats StoreWriter::getStats() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    Stats stats;
+    stats.pendingSellers = dirtySellers.size();
+    stats.pendingChanges = pendingChanges;
+    if (pendingChanges > 0)
+    {
+        stats.oldestPendingMs = std::chrono::duration<double, std::milli>(Clock::now() - oldestPending).count();
+    }
+    stats.flushes = flushCount;
+    stats.sellerFilesWritten = sellerFilesWritten;
+    stats.changesWritten = changesWritten;
+    stats.failedWrites = failedWrites;
+    stats.lastFlushMs = lastFlushNs / 1e6;
+    stats.avgFlushMs = flushCount == 0 ? 0.0 : totalFlushNs / 1e6 / flushCount;
+    stats.maxFlushMs = maxFlushNs / 1e6;
+    return stats;
+}
+
+void StoreWriter::run()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    while (!stopping)
+    {
+        // 间隔到期，或积压达到阈值时写入；没有积压时一直等待
+        auto due = [this]()
+        {
+            return stopping || pendingChanges >= options.maxPendingChanges ||
+                   (pendingChanges > 0 && Clock::now() - oldestPending >= options.interval);
+        };
+        if (pendingChanges == 0)
+        {
+            wakeCondition.wait(lock, [this]() { return stopping || pendingChanges > 0; });
+        }
+        else
+        {
+            wakeCondition.wait_until(lock, oldestPending + options.interval, due);
+        }
+        if (stopping || !due())
+        {
+            continue;
+        }
+
+        lock.unlock();
+        flush();
+        lock.lock();
+    }
+    lock.unlock();
+
+    // 退出前写出剩余变更
+    flush();
+    std::cout << "商品后台写入线程已停止" << std::endl;
+}
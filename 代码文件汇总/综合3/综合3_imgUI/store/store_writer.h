@@ -0,0 +1,87 @@
+#ifndef STORE_WRITER_H
+#define STORE_WRITER_H
+
+#include <string>
+#include <unordered_map>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <cstdint>
+
+class Store;
+
+// 商品文件的后台写入（write-behind）：
+// - Store::markProductChanged 把商品所属商家记为"有未保存变更"，不立即写文件
+// - 写入线程按固定间隔，或未保存的变更数达到阈值时，重写有变更的商家文件（每个商家一个文件）
+// - flush 立即同步写出全部未保存变更，供关闭前调用；写入失败的商家保留标记，下次重试
+// - 每轮写入后重写二进制目录快照（catalog.bin）
+// - 变更日志打开时，每轮写入同时是一次日志压缩：写入前切换日志段，商家文件与目录快照全部写入成功后删除旧段
+// 未调用 start 时不启动线程，只记录有变更的商家，由 flush 写出
+class StoreWriter
+{
+public:
+    struct Options
+    {
+        std::chrono::milliseconds interval{2000}; // 两次后台写入的最大间隔
+        size_t maxPendingChanges = 256;           // 未保存的变更达到该数量时提前写入
+    };
+
+    struct Stats
+    {
+        size_t pendingSellers = 0;     // 积压：有未保存变更的商家数
+        size_t pendingChanges = 0;     // 积压：未保存的变更数
+        double oldestPendingMs = 0.0;  // 最早一条未保存变更距今的时间
+        uint64_t flushes = 0;          // 实际写过文件的写入轮数
+        uint64_t sellerFilesWritten = 0;
+        uint64_t changesWritten = 0;
+        uint64_t failedWrites = 0;
+        double lastFlushMs = 0.0; // 每轮写入耗时
+        double avgFlushMs = 0.0;
+        double maxFlushMs = 0.0;
+    };
+
+    explicit StoreWriter(Store &store);
+    ~StoreWriter();
+
+    void start(const Options &options);
+    // 写出全部未保存变更后停止写入线程
+    void stop();
+    bool isRunning() const;
+
+    void markDirty(const std::string &sellerUsername);
+    // 商家文件已由其他途径整体写出（如新增商品时的同步保存）
+    void markClean(const std::string &sellerUsername);
+    // 立即写出全部未保存变更；有商家写入失败时返回 false
+    bool flush();
+    Stats getStats() const;
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    Store &store;
+    Options options;
+    std::thread thread;
+    bool running;
+    bool stopping;
+
+    mutable std::mutex mutex; // 保护以下全部字段
+    std::condition_variable wakeCondition;
+    std::unordered_map<std::string, size_t> dirtySellers; // 商家 -> 未保存的变更数
+    size_t pendingChanges;
+    Clock::time_point oldestPending;
+
+    uint64_t flushCount;
+    uint64_t sellerFilesWritten;
+    uint64_t changesWritten;
+    uint64_t failedWrites;
+    int64_t lastFlushNs;
+    int64_t totalFlushNs;
+    int64_t maxFlushNs;
+
+    std::mutex flushMutex; // 同一时间只有一轮写入
+
+    void run();
+};
+
+#endif // STORE_WRITER_H
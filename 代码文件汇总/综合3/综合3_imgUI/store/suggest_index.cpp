@@ -0,0 +1,144 @@
+#include "suggest_index.h"
+#include "search_index.h"
+#include "store.h"
+#include <algorithm>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace
+{
+    bool isWordBoundary(char c)
+    {
+        return c == ' ' || c == '\t' || c == '-' || c == '_' || c == '/' || c == ',' || c == '.' || c == '(' || c == ')';
+    }
+}
+
+std::vector<std::string> SuggestIndex::keysFor(const Product *product)
+{
+    std::vector<std::string> result;
+    std::string name = SearchIndex::normalize(product->getName());
+    // 名称本身以及每个词开头的后缀；分隔符只按 ASCII 判断，不会切断多字节字符
+    for (size_t pos = 0; pos < name.size(); ++pos)
+    {
+        if (isWordBoundary(name[pos]))
+        {
+            continue;
+        }
+        if (pos == 0 || isWordBoundary(name[pos - 1]))
+        {
+            result.push_back(name.substr(pos));
+        }
+    }
+    return result;
+}
+
+void SuggestIndex::addProduct(const Product *product)
+{
+    std::vector<std::string> texts = keysFor(product);
+    for (std::string &text : texts)
+    {
+        keys.push_back(Key{std::move(text), product});
+    }
+}
+
+void SuggestIndex::removeProduct(const Product *product)
+{
+    std::vector<std::string> texts = keysFor(product);
+    seal();
+    for (const std::string &text : texts)
+    {
+        Key key{text, product};
+        auto it = std::lower_bound(keys.begin(), keys.end(), key);
+        if (it != keys.end() && it->text == text && it->product == product)
+        {
+            keys.erase(it);
+            sortedCount--;
+        }
+    }
+}
+
+void SuggestIndex::clear()
+{
+    keys.clear();
+    sortedCount = 0;
+}
+
+void SuggestIndex::seal()
+{
+    if (sortedCount == keys.size())
+    {
+        return;
+    }
+    auto middle = keys.begin() + sortedCount;
+    std::sort(middle, keys.end());
+    std::inplace_merge(keys.begin(), middle, keys.end());
+    sortedCount = keys.size();
+}
+
+size_t SuggestIndex::getKeyCount() const
+{
+    return keys.size();
+}
+
+std::vector<SuggestIndex::Suggestion> SuggestIndex::suggest(const std::string &prefix, size_t limit) const
+{
+    std::vector<Suggestion> result;
+    std::string normalized = SearchIndex::normalize(prefix);
+    size_t start = normalized.find_first_not_of(" \t");
+    if (start == std::string::npos || limit == 0)
+    {
+        return result;
+    }
+    normalized.erase(0, start);
+
+    // 区间内按名称合并；同一商品可能有多个键落在区间内，只计一次
+    std::unordered_map<std::string, size_t> byName;
+    std::unordered_set<const Product *> seen;
+    auto addKey = [&](const Key &key)
+    {
+        if (!seen.insert(key.product).second)
+        {
+            return;
+        }
+        const std::string &name = key.product->getName();
+        auto inserted = byName.emplace(name, result.size());
+        if (inserted.second)
+        {
+            result.push_back(Suggestion{name, 0, 0});
+        }
+        Suggestion &suggestion = result[inserted.first->second];
+        suggestion.stock += key.product->getQuantity();
+        suggestion.productCount++;
+    };
+
+    auto sortedEnd = keys.begin() + sortedCount;
+    auto first = std::lower_bound(keys.begin(), sortedEnd, normalized, [](const Key &key, const std::string &text)
+                                  { return key.text < text; });
+    for (auto it = first; it != sortedEnd && it->text.compare(0, normalized.size(), normalized) == 0; ++it)
+    {
+        addKey(*it);
+    }
+    // 未 seal 的索引（只在发布前的草稿上出现）逐个检查新键
+    for (auto it = sortedEnd; it != keys.end(); ++it)
+    {
+        if (it->text.compare(0, normalized.size(), normalized) == 0)
+        {
+            addKey(*it);
+        }
+    }
+
+    auto better = [](const Suggestion &a, const Suggestion &b)
+    {
+        return a.stock != b.stock ? a.stock > b.stock : a.name < b.name;
+    };
+    if (result.size() > limit)
+    {
+        std::partial_sort(result.begin(), result.begin() + limit, result.end(), better);
+        result.resize(limit);
+    }
+    else
+    {
+        std::sort(result.begin(), result.end(), better);
+    }
+    return result;
+}
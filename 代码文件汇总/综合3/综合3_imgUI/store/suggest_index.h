@@ -0,0 +1,54 @@
+#ifndef SUGGEST_INDEX_H
+#define SUGGEST_INDEX_H
+
+#include <string>
+#include <vector>
+
+class Product;
+
+// 搜索联想：按商品名称前缀给出补全建议。
+// 规范化后的名称（同 SearchIndex::normalize）以及名称中每个词开头的后缀作为键，
+// 保存在按键排序的数组中（"苹果 iphone 15" 也能由 "iph" 联想到）。查询时二分查找出前缀区间，
+// 区间内同名商品合并为一条建议，按总库存取前 K 个。库存在查询时从商品读取，库存变化不需要维护索引。
+// 新增的键先追加在数组末尾，由 seal 排序后归并进有序部分，加载大量商品时只排序一次。
+// 索引本身不加锁：它是 ProductCatalog 的一部分，随目录版本写时复制，Store 在发布版本前调用 seal，发布后只读
+class SuggestIndex
+{
+public:
+    struct Suggestion
+    {
+        std::string name;
+        int stock = 0;           // 同名商品的库存合计
+        size_t productCount = 0; // 同名商品数（不同商家）
+    };
+
+    void addProduct(const Product *product);
+    void removeProduct(const Product *product);
+    void clear();
+    // 把新增的键归并进有序部分
+    void seal();
+
+    std::vector<Suggestion> suggest(const std::string &prefix, size_t limit) const;
+    size_t getKeyCount() const;
+
+    static const size_t kMaxSuggestions = 20;
+
+private:
+    struct Key
+    {
+        std::string text;
+        const Product *product;
+
+        bool operator<(const Key &other) const
+        {
+            return text != other.text ? text < other.text : product < other.product;
+        }
+    };
+
+    std::vector<Key> keys; // [0, sortedCount) 有序，其后为尚未归并的新键
+    size_t sortedCount = 0;
+
+    static std::vector<std::string> keysFor(const Product *product);
+};
+
+#endif // SUGGEST_INDEX_H
@@ -0,0 +1,177 @@
+// 先锁定库存再购买的端到端测试：在本进程内启动服务端，用 NetworkClient 按客户端界面的流程操作。
+// 锁定某商品的全部剩余库存后立即购买同样数量，订单必须成功并把库存扣到 0：
+//   - 直接购买，下单时带上锁定得到的预留ID；
+//   - 直接购买，不带预留ID（旧客户端），服务端使用本会话锁定的该商品；
+//   - 购物车结账，锁定整个购物车后带预留ID下单。
+// 另外检查下单后预留已被订单消耗，不会留到到期才释放。
+// 测试在临时目录中复制一份数据目录运行，不修改原数据。
+// 用法: lock_then_buy_test [数据目录=server_data] [端口=18888]
+#include "../network/server.h"
+#include "../network/client.h"
+#include <iostream>
+#include <string>
+#include <vector>
+#include <filesystem>
+#include <cstdlib>
+
+namespace fs = std::filesystem;
+
+namespace
+{
+    const char *kUsername = "1234";
+    const char *kPassword = "1234";
+
+    int failures = 0;
+
+    void check(bool condition, const std::string &what)
+    {
+        std::cout << (condition ? "[通过] " : "[失败] ") << what << std::endl;
+        if (!condition)
+        {
+            failures++;
+        }
+    }
+
+    int currentQuantity(NetworkClient &client, const std::string &productId)
+    {
+        std::vector<Protocol::ProductData> products;
+        if (client.getAllProducts(products))
+        {
+            for (const auto &product : products)
+            {
+                if (product.id == productId)
+                {
+                    return product.quantity;
+                }
+            }
+        }
+        return -1;
+    }
+
+    // 挑选有库存、全部买下也付得起的商品，每个用例各用一件，互不影响
+    std::vector<Protocol::ProductData> pickProducts(NetworkClient &client, double budget, size_t count)
+    {
+        std::vector<Protocol::ProductData> products;
+        std::vector<Protocol::ProductData> picked;
+        if (!client.getAllProducts(products))
+        {
+            return picked;
+        }
+        for (const auto &product : products)
+        {
+            double cost = product.price * product.quantity;
+            if (product.quantity > 0 && cost <= budget)
+            {
+                picked.push_back(product);
+                budget -= cost;
+                if (picked.size() == count)
+                {
+                    break;
+                }
+            }
+        }
+        return picked;
+    }
+
+    void testDirectPurchaseWithReservation(NetworkClient &client, const Protocol::ProductData &product)
+    {
+        std::string reservationId;
+        bool locked = client.lockInventory(product.id, product.quantity, product.sellerUsername, reservationId);
+        check(locked && !reservationId.empty(), "直接购买: 锁定全部 " + std::to_string(product.quantity) + " 件并得到预留ID");
+
+        std::string orderId;
+        bool ordered = client.createDirectOrder(product.id, product.quantity, orderId, product.sellerUsername, reservationId);
+        check(ordered, "直接购买: 带预留ID下单");
+        check(currentQuantity(client, product.id) == 0, "直接购买: 锁定的库存被订单买下");
+        check(!client.releaseReservation(reservationId), "直接购买: 预留已被订单消耗");
+    }
+
+    void testDirectPurchaseWithoutReservation(NetworkClient &client, const Protocol::ProductData &product)
+    {
+        std::string reservationId;
+        bool locked = client.lockInventory(product.id, product.quantity, product.sellerUsername, reservationId);
+        check(locked, "旧客户端直接购买: 锁定全部 " + std::to_string(product.quantity) + " 件");
+
+        std::string orderId;
+        bool ordered = client.createDirectOrder(product.id, product.quantity, orderId, product.sellerUsername);
+        check(ordered, "旧客户端直接购买: 不带预留ID下单");
+        check(currentQuantity(client, product.id) == 0, "旧客户端直接购买: 本会话锁定的库存被订单买下");
+        check(!client.releaseReservation(reservationId), "旧客户端直接购买: 预留已被订单消耗");
+    }
+
+    void testCartCheckout(NetworkClient &client, const Protocol::ProductData &product)
+    {
+        client.clearCart();
+        check(client.addToCart(product.id, product.quantity, product.sellerUsername), "购物车结账: 加入购物车");
+        std::vector<Protocol::CartItemData> cartItems;
+        client.getCart(cartItems);
+
+        std::string reservationId;
+        bool locked = client.lockCartInventory(cartItems, reservationId);
+        check(locked && !reservationId.empty(), "购物车结账: 锁定购物车并得到预留ID");
+
+        std::string orderId;
+        bool ordered = client.createOrder(cartItems, orderId, reservationId);
+        check(ordered, "购物车结账: 带预留ID下单");
+        check(currentQuantity(client, product.id) == 0, "购物车结账: 锁定的库存被订单买下");
+        check(!client.releaseReservation(reservationId), "购物车结账: 预留已被订单消耗");
+    }
+}
+
+int main(int argc, char **argv)
+{
+    fs::path dataDirectory = fs::absolute(argc > 1 ? argv[1] : "server_data");
+    int port = argc > 2 ? std::atoi(argv[2]) : 18888;
+    if (!fs::is_directory(dataDirectory))
+    {
+        std::cerr << "数据目录不存在: " << dataDirectory << std::endl;
+        return 1;
+    }
+
+    // 服务端按相对路径读写 server_data，切换到临时目录中的副本
+    fs::path workDirectory = fs::temp_directory_path() / ("lock_then_buy_test_" + std::to_string(port));
+    fs::remove_all(workDirectory);
+    fs::create_directories(workDirectory);
+    fs::copy(dataDirectory, workDirectory / "server_data", fs::copy_options::recursive);
+    fs::current_path(workDirectory);
+
+    {
+        NetworkServer server(port);
+        if (!server.start())
+        {
+            std::cerr << "服务端启动失败" << std::endl;
+            return 1;
+        }
+
+        NetworkClient client("127.0.0.1", port);
+        Protocol::UserData user;
+        if (!client.connect() || !client.login(kUsername, kPassword, user))
+        {
+            std::cerr << "连接或登录失败" << std::endl;
+            server.stop();
+            return 1;
+        }
+
+        std::vector<Protocol::ProductData> products = pickProducts(client, user.balance, 3);
+        if (products.size() < 3)
+        {
+            std::cerr << "数据目录中没有足够的可购买商品" << std::endl;
+            client.disconnect();
+            server.stop();
+            return 1;
+        }
+
+        testDirectPurchaseWithReservation(client, products[0]);
+        testDirectPurchaseWithoutReservation(client, products[1]);
+        testCartCheckout(client, products[2]);
+
+        client.disconnect();
+        server.stop();
+    }
+
+    fs::current_path(dataDirectory.parent_path());
+    fs::remove_all(workDirectory);
+
+    std::cout << (failures == 0 ? "全部通过" : std::to_string(failures) + " 项失败") << std::endl;
+    return failures == 0 ? 0 : 1;
+}
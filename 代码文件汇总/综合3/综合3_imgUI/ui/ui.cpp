@@ -659,6 +659,7 @@ void UI::renderStoreCustomer()
 
                         // 减少库存
                         product->setQuantity(product->getQuantity() - buyQuantity);
+                        store->markProductChanged(product);
 
                         // 保存更改
                         User::saveUsersToFile(*users, "USER_FILE_PATH");
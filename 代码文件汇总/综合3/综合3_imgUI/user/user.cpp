@@ -19,6 +19,19 @@ User::User() : username(""), password(""), balance(0.0), userType("unknown") {}
 
 // --- Customer 类购物车相关方法实现 ---
 
+namespace
+{
+    // 购物车条目是否对应该商品；旧条目没有商品ID，按名称和商家比较
+    bool isSameProduct(const CartItem &item, const Product &product)
+    {
+        if (item.productId != 0)
+        {
+            return item.productId == product.getId();
+        }
+        return item.productName == product.getName() && item.sellerUsername == product.getSellerUsername();
+    }
+}
+
 std::string Customer::getCartFilePath() const
 {
     if (this->username.empty())
@@ -46,15 +59,18 @@ void Customer::loadCartFromFile()
     while (getline(file, line))
     {
         std::stringstream ss(line);
-        std::string productId, productName, sellerUsernameStr;
+        std::string productIdText, productName, sellerUsernameStr;
         int quantity;
         double priceAtAddition;
-        if (getline(ss, productId, ',') &&
+        if (getline(ss, productIdText, ',') &&
             getline(ss, productName, ',') &&
             (ss >> quantity) &&
             (ss.ignore(1) && ss >> priceAtAddition) &&
             (ss.ignore(1) && getline(ss, sellerUsernameStr)))
         {
+            // 旧文件第一列是商品名称，ID 记为 0，之后由 upgradeLegacyCartItems 补上
+            uint64_t productId = 0;
+            Store::parseProductId(productIdText, productId);
             shoppingCartItems.emplace_back(productId, productName, quantity, priceAtAddition, sellerUsernameStr);
         }
         else
@@ -83,7 +99,7 @@ bool Customer::saveCartToFile() const
 
     for (const auto &item : shoppingCartItems)
     {
-        file << item.productId << ","
+        file << Store::productIdText(item.productId, item.productName) << ","
              << item.productName << ","
              << item.quantity << ","
              << item.priceAtAddition << ","
@@ -130,8 +146,9 @@ bool Customer::addToCart(const Product &product, int quantity)
     bool found = false;
     for (auto &item : shoppingCartItems)
     {
-        if (item.productId == product.getName())
-        { // 假设商品名称是唯一ID
+        if (isSameProduct(item, product))
+        {
+            item.productId = product.getId();
             item.quantity += quantity;
             // 可选：更新 priceAtAddition 为最新价格或保持不变
             found = true;
@@ -141,7 +158,7 @@ bool Customer::addToCart(const Product &product, int quantity)
 
     if (!found)
     {
-        shoppingCartItems.emplace_back(product.getName(), product.getName(), quantity, product.getPrice(), product.getSellerUsername());
+        shoppingCartItems.emplace_back(product.getId(), product.getName(), quantity, product.getPrice(), product.getSellerUsername());
     }
     cout << "\"" << product.getName() << "\" 已成功加入购物车。" << endl;
     return saveCartToFile();
@@ -169,6 +186,84 @@ bool Customer::removeCartItem(const std::string &productName)
     }
 }
 
+bool Customer::removeCartItem(uint64_t productId)
+{
+    if (this->username.empty())
+        return false;
+    auto initial_size = shoppingCartItems.size();
+    shoppingCartItems.erase(std::remove_if(shoppingCartItems.begin(), shoppingCartItems.end(),
+                                           [&](const CartItem &item)
+                                           { return item.productId == productId; }),
+                            shoppingCartItems.end());
+
+    if (shoppingCartItems.size() < initial_size)
+    {
+        cout << "商品 " << productId << " 已从购物车移除。" << endl;
+        return saveCartToFile();
+    }
+    cout << "未在购物车中找到商品: " << productId << endl;
+    return false;
+}
+
+bool Customer::updateCartItemQuantity(const Product &product, int newQuantity)
+{
+    if (this->username.empty())
+        return false;
+    if (newQuantity < 0)
+    {
+        cout << "数量不能为负。" << endl;
+        return false;
+    }
+    if (newQuantity > product.getQuantity())
+    {
+        cout << "库存不足！无法将购物车中 \"" << product.getName() << "\" 的数量修改为 " << newQuantity
+             << "。当前库存: " << product.getQuantity() << endl;
+        return false;
+    }
+
+    auto it = std::find_if(shoppingCartItems.begin(), shoppingCartItems.end(), [&](const CartItem &item)
+                           { return isSameProduct(item, product); });
+    if (it == shoppingCartItems.end())
+    {
+        cout << "未在购物车中找到商品: " << product.getName() << endl;
+        return false;
+    }
+    if (newQuantity == 0)
+    {
+        shoppingCartItems.erase(it);
+    }
+    else
+    {
+        it->productId = product.getId();
+        it->quantity = newQuantity;
+    }
+
+    cout << "购物车商品 \"" << product.getName() << "\" 数量已更新。" << endl;
+    return saveCartToFile();
+}
+
+void Customer::upgradeLegacyCartItems(const Store &store)
+{
+    bool changed = false;
+    for (auto &item : shoppingCartItems)
+    {
+        if (item.productId != 0)
+        {
+            continue;
+        }
+        const Product *product = store.resolveProduct(0, item.productName, item.sellerUsername);
+        if (product)
+        {
+            item.productId = product->getId();
+            changed = true;
+        }
+    }
+    if (changed)
+    {
+        saveCartToFile();
+    }
+}
+
 bool Customer::updateCartItemQuantity(const std::string &productName, int newQuantity, Store &store)
 {
     if (this->username.empty())
@@ -183,7 +278,7 @@ bool Customer::updateCartItemQuantity(const std::string &productName, int newQua
     {
         if (item.productName == productName)
         {
-            Product *p_info = store.findProductByName(productName); // 检查最新库存
+            Product *p_info = store.resolveProduct(item.productId, item.productName, item.sellerUsername); // 检查最新库存
             if (p_info && newQuantity > p_info->getQuantity())
             {
                 cout << "库存不足！无法将购物车中 \"" << productName << "\" 的数量修改为 " << newQuantity
@@ -258,7 +353,7 @@ void Customer::viewCart(Store &store, std::vector<User *> &allUsers)
     for (size_t i = 0; i < shoppingCartItems.size(); ++i)
     {
         const auto &item = shoppingCartItems[i];
-        Product *p_info = store.findProductByName(item.productId);
+        Product *p_info = store.resolveProduct(item.productId, item.productName, item.sellerUsername);
         double currentItemPrice = p_info ? p_info->getPrice() : item.priceAtAddition;
 
         cout << i + 1 << ". 商品: " << item.productName
@@ -355,7 +450,7 @@ void Customer::viewCart(Store &store, std::vector<User *> &allUsers)
             bool preCheckOk = true;
             for (const auto &cart_item : shoppingCartItems)
             {
-                Product *product = store.findProductByName(cart_item.productId);
+                Product *product = store.resolveProduct(cart_item.productId, cart_item.productName, cart_item.sellerUsername);
                 if (!product)
                 {
                     cout << "错误: 购物车商品 \"" << cart_item.productName << "\" 已不存在。" << endl;
@@ -23,13 +23,13 @@ class Store;
 // 购物车中的商品项 (现在作为 Customer 类的内部结构或辅助结构)
 struct CartItem
 {
-    std::string productId; // 商品名称或唯一ID
+    uint64_t productId; // 商品ID，0 表示分配ID之前保存的旧条目（按名称和商家识别）
     std::string productName;
     int quantity;
     double priceAtAddition; // 添加到购物车时的价格
     std::string sellerUsername;
 
-    CartItem(std::string pid = "", std::string pName = "", int qty = 0, double price = 0.0, std::string sName = "")
+    CartItem(uint64_t pid = 0, std::string pName = "", int qty = 0, double price = 0.0, std::string sName = "")
         : productId(pid), productName(pName), quantity(qty), priceAtAddition(price), sellerUsername(sName) {}
 };
 
@@ -97,7 +97,11 @@ public:
     // 购物车管理方法
     bool addToCart(const Product &product, int quantity);
     bool removeCartItem(const std::string &productName);
+    bool removeCartItem(uint64_t productId);
     bool updateCartItemQuantity(const std::string &productName, int newQuantity, Store &store); // 需要 store 检查库存
+    bool updateCartItemQuantity(const Product &product, int newQuantity);
+    // 为旧购物车条目补上商品ID，有变化时写回文件
+    void upgradeLegacyCartItems(const Store &store);
     void viewCart(Store &store, std::vector<User *> &allUsers);                                 // 查看并管理购物车，结算也在这里处理
     bool isCartEmpty() const;
     void clearCartAndFile(); // 结算后清空购物车及文件